@@ -164,6 +164,18 @@ public:
         return libjami::getConferenceInfos(accountId, confId);
     }
 
+    std::vector<std::map<std::string, std::string>>
+    getCallLatencyStats(const std::string& accountId, const std::string& callId)
+    {
+        return libjami::getCallLatencyStats(accountId, callId);
+    }
+
+    void
+    resetCallLatencyStats(const std::string& accountId, const std::string& callId)
+    {
+        libjami::resetCallLatencyStats(accountId, callId);
+    }
+
     auto
     joinParticipant(const std::string& accountId,
                     const std::string& sel_callId,
@@ -524,6 +524,12 @@ public:
         libjami::setHistoryLimit(days);
     }
 
+    void
+    setSignalBatchInterval(const int32_t& intervalMs)
+    {
+        libjami::setSignalBatchInterval(std::chrono::milliseconds(intervalMs));
+    }
+
     auto
     getHistoryLimit() -> decltype(libjami::getHistoryLimit())
     {
@@ -1146,6 +1152,8 @@ private:
         const std::map<std::string, SharedCallback> dataXferEvHandlers = {
             exportable_serialized_callback<DataTransferSignal::DataTransferEvent>(
                 std::bind(&DBusConfigurationManager::emitDataTransferEvent, this, _1, _2, _3, _4, _5)),
+            exportable_serialized_callback<DataTransferSignal::DataTransferEvents>(
+                std::bind(&DBusConfigurationManager::emitDataTransferEvents, this, _1, _2, _3)),
         };
 
         const std::map<std::string, SharedCallback> convEvHandlers = {
@@ -1167,6 +1175,14 @@ private:
                 DBusSwarmMessage msg {message.id, message.type, message.linearizedParent, message.body, message.reactions, message.editions, message.status};
                 DBusConfigurationManager::emitSwarmMessageReceived(account_id, conversation_id, msg);
             }),
+            exportable_serialized_callback<ConversationSignal::SwarmMessagesReceived>([this](const std::string& account_id, const std::string& conversation_id, const std::vector<libjami::SwarmMessage>& messages) {
+                std::vector<DBusSwarmMessage> msgList;
+                for (const auto& message: messages) {
+                    DBusSwarmMessage msg {message.id, message.type, message.linearizedParent, message.body, message.reactions, message.editions, message.status};
+                    msgList.push_back(msg);
+                }
+                DBusConfigurationManager::emitSwarmMessagesReceived(account_id, conversation_id, msgList);
+            }),
             exportable_serialized_callback<ConversationSignal::SwarmMessageUpdated>([this](const std::string& account_id, const std::string& conversation_id, const libjami::SwarmMessage& message) {
                 DBusSwarmMessage msg {message.id, message.type, message.linearizedParent, message.body, message.reactions, message.editions, message.status};
                 DBusConfigurationManager::emitSwarmMessageUpdated(account_id, conversation_id, msg);
@@ -102,6 +102,8 @@ std::string getConferenceId(const std::string& accountId, const std::string& cal
 std::map<std::string, std::string> getConferenceDetails(const std::string& accountId, const std::string& callId);
 std::vector<libjami::MediaMap> currentMediaList(const std::string& accountId, const std::string& callId);
 std::vector<std::map<std::string, std::string>> getConferenceInfos(const std::string& accountId, const std::string& confId);
+std::vector<std::map<std::string, std::string>> getCallLatencyStats(const std::string& accountId, const std::string& callId);
+void resetCallLatencyStats(const std::string& accountId, const std::string& callId);
 void setModerator(const std::string& accountId, const std::string& confId, const std::string& peerId, const bool& state);
 void muteStream(const std::string& accountId,
                     const std::string& confId,
@@ -34,6 +34,7 @@ class DataTransferCallback {
 public:
     virtual ~DataTransferCallback(){}
     virtual void dataTransferEvent(const std::string& accountId, const std::string& conversationId, const std::string& interactionId, const std::string& fileId, int eventCode){}
+    virtual void dataTransferEvents(const std::string& accountId, const std::string& conversationId, std::vector<std::map<std::string, std::string>> events){}
 };
 %}
 
@@ -90,4 +91,5 @@ class DataTransferCallback {
 public:
     virtual ~DataTransferCallback(){}
     virtual void dataTransferEvent(const std::string& accountId, const std::string& conversationId, const std::string& interactionId, const std::string& fileId, int eventCode){}
+    virtual void dataTransferEvents(const std::string& accountId, const std::string& conversationId, std::vector<std::map<std::string, std::string>> events){}
 };
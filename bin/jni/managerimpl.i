@@ -32,3 +32,18 @@ namespace libjami {
 void fini(void);
 
 }
+
+%inline %{
+namespace libjami {
+
+/**
+ * Batch per-item signals (swarm messages, transfer events) over intervalMs.
+ * 0 disables batching.
+ */
+void setSignalBatchInterval(int32_t intervalMs)
+{
+    setSignalBatchInterval(std::chrono::milliseconds(intervalMs));
+}
+
+}
+%}
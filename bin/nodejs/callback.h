@@ -35,6 +35,7 @@ Persistent<Function> swarmLoadedCb;
 Persistent<Function> messagesFoundCb;
 Persistent<Function> messageReceivedCb;
 Persistent<Function> swarmMessageReceivedCb;
+Persistent<Function> swarmMessagesReceivedCb;
 Persistent<Function> swarmMessageUpdatedCb;
 Persistent<Function> reactionAddedCb;
 Persistent<Function> reactionRemovedCb;
@@ -112,6 +113,8 @@ getPresistentCb(std::string_view signal)
         return &messageReceivedCb;
     else if (signal == "SwarmMessageReceived")
         return &swarmMessageReceivedCb;
+    else if (signal == "SwarmMessagesReceived")
+        return &swarmMessagesReceivedCb;
     else if (signal == "SwarmMessageUpdated")
         return &swarmMessageUpdatedCb;
     else if (signal == "ReactionAdded")
@@ -727,6 +730,24 @@ swarmMessageReceived(const std::string& accountId,
     uv_async_send(&signalAsync);
 }
 
+void
+swarmMessagesReceived(const std::string& accountId,
+                      const std::string& conversationId,
+                      const std::vector<libjami::SwarmMessage>& messages)
+{
+    std::lock_guard lock(pendingSignalsLock);
+    pendingSignals.emplace([accountId, conversationId, messages]() {
+        Local<Function> func = Local<Function>::New(Isolate::GetCurrent(), swarmMessagesReceivedCb);
+        if (!func.IsEmpty()) {
+            SWIGV8_VALUE callback_args[] = {V8_STRING_NEW_LOCAL(accountId),
+                                            V8_STRING_NEW_LOCAL(conversationId),
+                                            swarmMessagesToJsArray(messages)};
+            func->Call(SWIGV8_CURRENT_CONTEXT(), SWIGV8_NULL(), 3, callback_args);
+        }
+    });
+    uv_async_send(&signalAsync);
+}
+
 void
 swarmMessageUpdated(const std::string& accountId,
                     const std::string& conversationId,
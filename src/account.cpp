@@ -175,7 +175,7 @@ Account::loadConfig() {
 void
 Account::saveConfig() const
 {
-    Manager::instance().saveConfig();
+    Manager::instance().saveConfig(Manager::CONFIG_ACCOUNTS);
 }
 
 std::map<std::string, std::string>
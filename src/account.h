@@ -126,6 +126,15 @@ public:
 
     virtual void saveConfig() const;
 
+    /**
+     * Serialize the configuration, consistently with concurrent edits.
+     */
+    void serializeConfig(YAML::Emitter& out) const
+    {
+        std::lock_guard lock(configurationMutex_);
+        config().serialize(out);
+    }
+
     void setAccountDetails(const std::map<std::string, std::string>& details)
     {
         std::lock_guard lock(configurationMutex_);
@@ -315,6 +324,7 @@ public:
     std::string getMailBox() const { return config().mailbox; }
 
     bool isRendezVous() const { return config().isRendezVous; }
+    bool isConferenceForwarding() const { return config().conferenceForwarding; }
     bool isAutoAnswerEnabled() const { return config().autoAnswerEnabled; }
     bool isReadReceiptEnabled() const { return config().sendReadReceipt; }
     bool isComposingEnabled() const { return config().sendComposing; }
@@ -41,6 +41,7 @@ constexpr const char* ACCOUNT_READRECEIPT_KEY = "sendReadReceipt";
 constexpr const char* ACCOUNT_COMPOSING_KEY = "sendComposing";
 constexpr const char* ACCOUNT_ISRENDEZVOUS_KEY = "rendezVous";
 constexpr const char* ACCOUNT_ACTIVE_CALL_LIMIT_KEY = "activeCallLimit";
+constexpr const char* CONFERENCE_FORWARDING_KEY = "conferenceForwarding";
 constexpr const char* MAILBOX_KEY = "mailbox";
 constexpr const char* USER_AGENT_KEY = "useragent";
 constexpr const char* HAS_CUSTOM_USER_AGENT_KEY = "hasCustomUserAgent";
@@ -72,6 +73,7 @@ AccountConfig::serializeDiff(YAML::Emitter& out, const AccountConfig& DEFAULT_CO
     SERIALIZE_CONFIG(ACCOUNT_COMPOSING_KEY, sendComposing);
     SERIALIZE_CONFIG(ACCOUNT_ISRENDEZVOUS_KEY, isRendezVous);
     SERIALIZE_CONFIG(ACCOUNT_ACTIVE_CALL_LIMIT_KEY, activeCallLimit);
+    SERIALIZE_CONFIG(CONFERENCE_FORWARDING_KEY, conferenceForwarding);
     SERIALIZE_CONFIG(RINGTONE_ENABLED_KEY, ringtoneEnabled);
     SERIALIZE_CONFIG(RINGTONE_PATH_KEY, ringtonePath);
     SERIALIZE_CONFIG(USER_AGENT_KEY, customUserAgent);
@@ -100,6 +102,7 @@ AccountConfig::unserialize(const YAML::Node& node)
     parseValueOptional(node, ACCOUNT_COMPOSING_KEY, sendComposing);
     parseValueOptional(node, ACCOUNT_ISRENDEZVOUS_KEY, isRendezVous);
     parseValueOptional(node, ACCOUNT_ACTIVE_CALL_LIMIT_KEY, activeCallLimit);
+    parseValueOptional(node, CONFERENCE_FORWARDING_KEY, conferenceForwarding);
     parseValueOptional(node, MAILBOX_KEY, mailbox);
 
     std::string codecs;
@@ -142,6 +145,8 @@ AccountConfig::toMap() const
             {Conf::CONFIG_ACCOUNT_SENDCOMPOSING, sendComposing ? TRUE_STR : FALSE_STR},
             {Conf::CONFIG_ACCOUNT_ISRENDEZVOUS, isRendezVous ? TRUE_STR : FALSE_STR},
             {libjami::Account::ConfProperties::ACTIVE_CALL_LIMIT, std::to_string(activeCallLimit)},
+            {libjami::Account::ConfProperties::CONFERENCE_FORWARDING,
+             conferenceForwarding ? TRUE_STR : FALSE_STR},
             {Conf::CONFIG_RINGTONE_ENABLED, ringtoneEnabled ? TRUE_STR : FALSE_STR},
             {Conf::CONFIG_RINGTONE_PATH, ringtonePath},
             {Conf::CONFIG_VIDEO_ENABLED, videoEnabled ? TRUE_STR : FALSE_STR},
@@ -166,6 +171,7 @@ AccountConfig::fromMap(const std::map<std::string, std::string>& details)
     parseBool(details, Conf::CONFIG_ACCOUNT_SENDCOMPOSING, sendComposing);
     parseBool(details, Conf::CONFIG_ACCOUNT_ISRENDEZVOUS, isRendezVous);
     parseInt(details, libjami::Account::ConfProperties::ACTIVE_CALL_LIMIT, activeCallLimit);
+    parseBool(details, libjami::Account::ConfProperties::CONFERENCE_FORWARDING, conferenceForwarding);
     parseBool(details, Conf::CONFIG_RINGTONE_ENABLED, ringtoneEnabled);
     parseString(details, Conf::CONFIG_RINGTONE_PATH, ringtonePath);
     parseString(details, Conf::CONFIG_ACCOUNT_USERAGENT, customUserAgent);
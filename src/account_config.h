@@ -80,6 +80,12 @@ struct AccountConfig : public Serializable
     /** If true mix calls into a conference */
     bool isRendezVous {false};
 
+    /**
+     * If true, hosted conferences forward the participants' video as
+     * received instead of decoding, mixing and encoding it.
+     */
+    bool conferenceForwarding {false};
+
     /**
      * The number of concurrent calls for the account
      * -1: Unlimited
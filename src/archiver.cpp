@@ -29,6 +29,7 @@
 #include "logger.h"
 
 #include <opendht/crypto.h>
+#include <opendht/thread_pool.h>
 #include <json/json.h>
 #include <zlib.h>
 
@@ -48,7 +49,13 @@ extern "C" {
 #endif
 
 #include <sys/stat.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 using namespace std::literals;
 
@@ -94,19 +101,27 @@ compressGzip(const std::vector<uint8_t>& dat, const std::string& path)
 std::vector<uint8_t>
 decompressGzip(const std::string& path)
 {
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
     std::vector<uint8_t> out;
     auto fi = openGzip(path, "rb");
+    gzbuffer(fi, BLOCK_SIZE);
     gzrewind(fi);
+    size_t size = 0;
     while (not gzeof(fi)) {
-        std::array<uint8_t, 32768> outbuffer;
-        int len = gzread(fi, outbuffer.data(), outbuffer.size());
+        // Read straight into the output, which grows geometrically
+        if (out.size() - size < BLOCK_SIZE)
+            out.resize(std::max(out.size() * 2, size + BLOCK_SIZE));
+        int len = gzread(fi, out.data() + size, BLOCK_SIZE);
         if (len == -1) {
             gzclose(fi);
             throw std::runtime_error("Exception during gzip decompression");
         }
-        out.insert(out.end(), outbuffer.begin(), outbuffer.begin() + len);
+        size += len;
+        if (len == 0)
+            break;
     }
     gzclose(fi);
+    out.resize(size);
     return out;
 }
 
@@ -124,21 +139,19 @@ decompress(const std::vector<uint8_t>& str)
 
     int ret;
     std::vector<uint8_t> out;
+    // Most archives compress about 3:1, start from there and grow geometrically
+    out.resize(std::max<size_t>(str.size() * 3, 32768));
 
-    // get the decompressed bytes blockwise using repeated calls to inflate
+    // inflate directly into the output buffer
     do {
-        std::array<uint8_t, 32768> outbuffer;
-        zs.next_out = reinterpret_cast<Bytef*>(outbuffer.data());
-        zs.avail_out = outbuffer.size();
+        if (zs.total_out == out.size())
+            out.resize(out.size() * 2);
+        zs.next_out = reinterpret_cast<Bytef*>(out.data() + zs.total_out);
+        zs.avail_out = out.size() - zs.total_out;
 
         ret = inflate(&zs, 0);
         if (ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
             break;
-
-        if (out.size() < zs.total_out) {
-            // append the block to the output string
-            out.insert(out.end(), outbuffer.begin(), outbuffer.begin() + zs.total_out - out.size());
-        }
     } while (ret == Z_OK);
 
     inflateEnd(&zs);
@@ -150,9 +163,401 @@ decompress(const std::vector<uint8_t>& str)
         throw(std::runtime_error(oss.str()));
     }
 
+    out.resize(zs.total_out);
     return out;
 }
 
+namespace {
+
+constexpr std::string_view STREAM_MAGIC {"JAMS"};
+constexpr uint8_t STREAM_VERSION = 1;
+constexpr uint8_t STREAM_CODEC_DEFLATE = 1;
+constexpr size_t STREAM_CHUNK_HEADER = 8 + 1;
+constexpr size_t STREAM_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+// AES-GCM nonce and tag
+constexpr size_t STREAM_CRYPTO_OVERHEAD = 12 + 16;
+
+void
+putU32(uint8_t* p, uint32_t v)
+{
+    for (int i = 3; i >= 0; --i, v >>= 8)
+        p[i] = v & 0xff;
+}
+
+uint32_t
+getU32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+size_t
+maxChunksInFlight()
+{
+    return std::max(2u, std::thread::hardware_concurrency() * 2);
+}
+
+size_t
+maxFrameSize(size_t chunkSize)
+{
+    return compressBound(chunkSize) + STREAM_CHUNK_HEADER + STREAM_CRYPTO_OVERHEAD;
+}
+
+/**
+ * Chunk job that runs on the computation pool, or inline on the thread
+ * waiting for it if the pool did not start it yet. This keeps the pipeline
+ * deadlock-free when itself running on a busy pool.
+ */
+template<typename T>
+class ChunkTask
+{
+public:
+    explicit ChunkTask(std::function<T()>&& job)
+        : job_(std::move(job))
+    {}
+
+    void run()
+    {
+        if (started_.exchange(true))
+            return;
+        try {
+            result_ = job_();
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+        job_ = {};
+        {
+            std::lock_guard lk(mtx_);
+            done_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    /**
+     * Wait for the job if it is running, or drop it if it did not start.
+     */
+    void cancel()
+    {
+        if (not started_.exchange(true)) {
+            job_ = {};
+            return;
+        }
+        std::unique_lock lk(mtx_);
+        cv_.wait(lk, [&] { return done_; });
+    }
+
+    T get()
+    {
+        run();
+        std::unique_lock lk(mtx_);
+        cv_.wait(lk, [&] { return done_; });
+        if (error_)
+            std::rethrow_exception(error_);
+        return std::move(result_);
+    }
+
+private:
+    std::function<T()> job_;
+    std::atomic_bool started_ {false};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool done_ {false};
+    T result_ {};
+    std::exception_ptr error_;
+};
+
+/**
+ * Runs chunk jobs in parallel and delivers their results in submission
+ * order, with at most maxChunksInFlight() chunks alive at any time.
+ */
+template<typename T>
+class ChunkPipeline
+{
+public:
+    explicit ChunkPipeline(std::function<void(T&&)>&& out)
+        : out_(std::move(out))
+        , max_(maxChunksInFlight())
+    {}
+
+    ~ChunkPipeline()
+    {
+        // Jobs reference state owned by the caller, which must outlive them
+        for (auto& task : queue_)
+            task->cancel();
+    }
+
+    void push(std::function<T()>&& job)
+    {
+        if (queue_.size() >= max_)
+            pop();
+        auto task = std::make_shared<ChunkTask<T>>(std::move(job));
+        queue_.emplace_back(task);
+        dht::ThreadPool::computation().run([task] { task->run(); });
+    }
+
+    void flush()
+    {
+        while (not queue_.empty())
+            pop();
+    }
+
+private:
+    void pop()
+    {
+        auto task = std::move(queue_.front());
+        queue_.pop_front();
+        out_(task->get());
+    }
+
+    std::function<void(T&&)> out_;
+    size_t max_;
+    std::deque<std::shared_ptr<ChunkTask<T>>> queue_;
+};
+
+std::vector<uint8_t>
+encodeChunk(uint64_t index, bool last, const std::vector<uint8_t>& data, const std::vector<uint8_t>& key)
+{
+    uLongf size = compressBound(data.size());
+    std::vector<uint8_t> plain(STREAM_CHUNK_HEADER + size);
+    for (int i = 7; i >= 0; --i, index >>= 8)
+        plain[i] = index & 0xff;
+    plain[8] = last ? 1 : 0;
+    auto ret = compress2(plain.data() + STREAM_CHUNK_HEADER, &size, data.data(), data.size(), Z_DEFAULT_COMPRESSION);
+    if (ret != Z_OK)
+        throw std::runtime_error("Exception during zlib compression: (" + std::to_string(ret) + ")");
+    plain.resize(STREAM_CHUNK_HEADER + size);
+
+    auto encrypted = dht::crypto::aesEncrypt(plain, key);
+    std::vector<uint8_t> frame(4 + encrypted.size());
+    putU32(frame.data(), encrypted.size());
+    std::copy(encrypted.begin(), encrypted.end(), frame.begin() + 4);
+    return frame;
+}
+
+struct DecodedChunk
+{
+    bool last {false};
+    std::vector<uint8_t> data;
+};
+
+DecodedChunk
+decodeChunk(uint64_t index, const std::vector<uint8_t>& encrypted, const std::vector<uint8_t>& key, size_t chunkSize)
+{
+    auto plain = dht::crypto::aesDecrypt(encrypted, key);
+    if (plain.size() < STREAM_CHUNK_HEADER)
+        throw std::runtime_error("Archive chunk too short");
+    uint64_t chunkIndex = 0;
+    for (size_t i = 0; i < 8; ++i)
+        chunkIndex = (chunkIndex << 8) | plain[i];
+    if (chunkIndex != index)
+        throw std::runtime_error("Archive chunk out of order");
+
+    DecodedChunk ret;
+    ret.last = plain[8] != 0;
+    ret.data.resize(chunkSize);
+    uLongf size = chunkSize;
+    auto err = uncompress(ret.data.data(), &size, plain.data() + STREAM_CHUNK_HEADER, plain.size() - STREAM_CHUNK_HEADER);
+    if (err != Z_OK)
+        throw std::runtime_error("Exception during zlib decompression: (" + std::to_string(err) + ")");
+    ret.data.resize(size);
+    return ret;
+}
+
+struct StreamHeader
+{
+    std::vector<uint8_t> salt;
+    size_t chunkSize {0};
+};
+
+StreamHeader
+readStreamHeader(std::istream& is)
+{
+    std::array<uint8_t, 7> fixed;
+    if (not is.read(reinterpret_cast<char*>(fixed.data()), fixed.size())
+        or not isStream(fixed.data(), fixed.size()))
+        throw std::runtime_error("Not an archive stream");
+    if (fixed[4] != STREAM_VERSION)
+        throw std::runtime_error("Unsupported archive stream version " + std::to_string(fixed[4]));
+    if (fixed[5] != STREAM_CODEC_DEFLATE)
+        throw std::runtime_error("Unsupported archive stream codec " + std::to_string(fixed[5]));
+
+    StreamHeader header;
+    header.salt.resize(fixed[6]);
+    std::array<uint8_t, 4> chunkSize;
+    if (not is.read(reinterpret_cast<char*>(header.salt.data()), header.salt.size())
+        or not is.read(reinterpret_cast<char*>(chunkSize.data()), chunkSize.size()))
+        throw std::runtime_error("Truncated archive stream header");
+    header.chunkSize = getU32(chunkSize.data());
+    if (header.chunkSize == 0 or header.chunkSize > STREAM_MAX_CHUNK_SIZE)
+        throw std::runtime_error("Invalid archive stream chunk size");
+    return header;
+}
+
+} // namespace
+
+bool
+isStream(const uint8_t* data, size_t size)
+{
+    return size >= STREAM_MAGIC.size()
+           and std::equal(STREAM_MAGIC.begin(), STREAM_MAGIC.end(), data);
+}
+
+bool
+isStream(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::array<uint8_t, STREAM_MAGIC.size()> magic;
+    return file.read(reinterpret_cast<char*>(magic.data()), magic.size())
+           and isStream(magic.data(), magic.size());
+}
+
+std::vector<uint8_t>
+streamSalt(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (not file)
+        throw std::runtime_error("Unable to open " + path.string());
+    return readStreamHeader(file).salt;
+}
+
+struct StreamWriter::Impl
+{
+    Impl(const std::filesystem::path& p, std::vector<uint8_t> k, size_t chunk)
+        : path(p)
+        , tmpPath(p.string() + ".tmp")
+        , key(std::move(k))
+        , chunkSize(chunk)
+        , pipeline([this](std::vector<uint8_t>&& frame) {
+            if (not file.write(reinterpret_cast<const char*>(frame.data()), frame.size()))
+                throw std::runtime_error("Unable to write " + tmpPath.string());
+        })
+    {}
+
+    void submit(bool last)
+    {
+        pipeline.push([index = index++, last, data = std::move(buffer), this] {
+            return encodeChunk(index, last, data, key);
+        });
+        buffer = {};
+        buffer.reserve(chunkSize);
+    }
+
+    std::filesystem::path path;
+    std::filesystem::path tmpPath;
+    std::ofstream file;
+    const std::vector<uint8_t> key;
+    const size_t chunkSize;
+    std::vector<uint8_t> buffer;
+    uint64_t index {0};
+    ChunkPipeline<std::vector<uint8_t>> pipeline;
+    bool closed {false};
+};
+
+StreamWriter::StreamWriter(const std::filesystem::path& path,
+                           std::vector<uint8_t> key,
+                           const std::vector<uint8_t>& salt,
+                           size_t chunkSize)
+{
+    if (chunkSize == 0 or chunkSize > STREAM_MAX_CHUNK_SIZE)
+        throw std::invalid_argument("Invalid archive stream chunk size");
+    if (salt.size() > 0xff)
+        throw std::invalid_argument("Archive salt too long");
+    pimpl_ = std::make_unique<Impl>(path, std::move(key), chunkSize);
+    pimpl_->file.open(pimpl_->tmpPath, std::ios::binary | std::ios::trunc);
+    if (not pimpl_->file)
+        throw std::runtime_error("Unable to open " + pimpl_->tmpPath.string());
+
+    std::vector<uint8_t> header(STREAM_MAGIC.begin(), STREAM_MAGIC.end());
+    header.push_back(STREAM_VERSION);
+    header.push_back(STREAM_CODEC_DEFLATE);
+    header.push_back(salt.size());
+    header.insert(header.end(), salt.begin(), salt.end());
+    header.resize(header.size() + 4);
+    putU32(header.data() + header.size() - 4, chunkSize);
+    pimpl_->file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    pimpl_->buffer.reserve(chunkSize);
+}
+
+StreamWriter::~StreamWriter()
+{
+    if (pimpl_ and not pimpl_->closed) {
+        // Incomplete stream: drop it rather than leave a truncated archive
+        pimpl_->file.close();
+        std::error_code ec;
+        std::filesystem::remove(pimpl_->tmpPath, ec);
+    }
+}
+
+void
+StreamWriter::write(const uint8_t* data, size_t size)
+{
+    auto& impl = *pimpl_;
+    if (impl.closed)
+        throw std::logic_error("Archive stream already closed");
+    while (size) {
+        auto n = std::min(size, impl.chunkSize - impl.buffer.size());
+        impl.buffer.insert(impl.buffer.end(), data, data + n);
+        data += n;
+        size -= n;
+        if (impl.buffer.size() == impl.chunkSize)
+            impl.submit(false);
+    }
+}
+
+void
+StreamWriter::close()
+{
+    auto& impl = *pimpl_;
+    if (impl.closed)
+        return;
+    // Always end with a chunk flagged as last, possibly empty
+    impl.submit(true);
+    impl.pipeline.flush();
+    impl.file.close();
+    if (impl.file.fail())
+        throw std::runtime_error("Unable to write " + impl.tmpPath.string());
+    std::filesystem::rename(impl.tmpPath, impl.path);
+    impl.closed = true;
+}
+
+void
+readStream(const std::filesystem::path& path,
+           const std::vector<uint8_t>& key,
+           const std::function<void(const uint8_t*, size_t)>& sink)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (not file)
+        throw std::runtime_error("Unable to open " + path.string());
+    auto header = readStreamHeader(file);
+    auto maxFrame = maxFrameSize(header.chunkSize);
+
+    bool done = false;
+    ChunkPipeline<DecodedChunk> pipeline([&](DecodedChunk&& chunk) {
+        if (done)
+            throw std::runtime_error("Archive stream has data after its last chunk");
+        done = chunk.last;
+        sink(chunk.data.data(), chunk.data.size());
+    });
+
+    uint64_t index = 0;
+    std::array<uint8_t, 4> len;
+    while (file.read(reinterpret_cast<char*>(len.data()), len.size())) {
+        auto size = getU32(len.data());
+        if (size > maxFrame)
+            throw std::runtime_error("Archive chunk too large");
+        std::vector<uint8_t> encrypted(size);
+        if (not file.read(reinterpret_cast<char*>(encrypted.data()), size))
+            throw std::runtime_error("Truncated archive stream");
+        pipeline.push([index = index++, encrypted = std::move(encrypted), &key, chunkSize = header.chunkSize] {
+            return decodeChunk(index, encrypted, key, chunkSize);
+        });
+    }
+    if (file.gcount() != 0)
+        throw std::runtime_error("Truncated archive stream");
+    pipeline.flush();
+    if (not done)
+        throw std::runtime_error("Truncated archive stream");
+}
+
 gzFile
 openGzip(const std::string& path, const char* mode)
 {
@@ -23,9 +23,12 @@
 #include "noncopyable.h"
 
 #include <cstdint>
+#include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
 #include <functional>
 
 #ifdef HAVE_CONFIG_H
@@ -70,6 +73,73 @@ std::vector<uint8_t> decompressGzip(const std::string& path);
  */
 gzFile openGzip(const std::string& path, const char* mode);
 
+/**
+ * Chunked, encrypted archive stream.
+ *
+ * Data is cut in chunks of fixed size, each chunk is deflated and encrypted
+ * (AES-GCM) on its own, so that chunks are processed in parallel on the
+ * computation thread pool. The compressed and encrypted copies only exist for
+ * the chunks in flight, never for the whole archive; the plain data is
+ * produced and consumed chunk by chunk (see fileutils::writeArchive).
+ *
+ * Layout:
+ *   header:  "JAMS" | version (1) | codec (1) | salt length (1) | salt | chunk size (4, BE)
+ *   chunk:   length (4, BE) | AES-GCM(index (8, BE) | last (1) | compressed data)
+ * The index and last flag are authenticated with the data, which makes
+ * reordered, dropped or truncated chunks detectable.
+ */
+static constexpr size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * True if data starts like an archive stream.
+ */
+bool isStream(const uint8_t* data, size_t size);
+bool isStream(const std::filesystem::path& path);
+
+/**
+ * Salt stored in the header of an archive stream.
+ */
+std::vector<uint8_t> streamSalt(const std::filesystem::path& path);
+
+class StreamWriter
+{
+public:
+    /**
+     * @param key   AES key (16, 24 or 32 bytes)
+     * @param salt  stored in clear in the header, used by readers to derive the key
+     */
+    StreamWriter(const std::filesystem::path& path,
+                 std::vector<uint8_t> key,
+                 const std::vector<uint8_t>& salt = {},
+                 size_t chunkSize = STREAM_CHUNK_SIZE);
+    ~StreamWriter();
+
+    void write(const uint8_t* data, size_t size);
+    void write(std::string_view data)
+    {
+        write(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    /**
+     * Flush pending chunks and close the file. Must be called for the stream
+     * to be readable: a stream without its last chunk is rejected.
+     */
+    void close();
+
+private:
+    NON_COPYABLE(StreamWriter);
+    struct Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+/**
+ * Read an archive stream, calling sink with the plain data in order.
+ * Throws if the key is wrong or the stream is corrupted or truncated.
+ */
+void readStream(const std::filesystem::path& path,
+                const std::vector<uint8_t>& key,
+                const std::function<void(const uint8_t*, size_t)>& sink);
+
 /**
  * @brief uncompressArchive Uncompresses an archive and puts the different files
  * in dir folder according to a FileMatchPair f
@@ -17,31 +17,421 @@
  */
 
 #include "base64.h"
-#include "connectivity/sip_utils.h"
 
-#include <pjlib.h>
-#include <pjlib-util/base64.h>
+#include <array>
+#include <cstring>
+
+/*
+ * Vectorized encoding and decoding for x86 (AVX2, then SSSE3, selected at
+ * runtime with GCC/Clang, or AVX2 when MSVC builds for it) and AArch64
+ * (NEON). They handle the bulk of the input; the scalar code finishes the
+ * tail, and decoding falls back to it as soon as a block holds anything
+ * other than base64 characters ('=', whitespace, garbage).
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BASE64_SIMD_X86 1
+#define BASE64_TARGET_AVX2  __attribute__((target("avx2")))
+#define BASE64_TARGET_SSSE3 __attribute__((target("ssse3")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#define BASE64_SIMD_X86 1
+#define BASE64_TARGET_AVX2
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BASE64_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 namespace jami {
 namespace base64 {
 
+static constexpr char ENCODE_TABLE[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr int8_t INVALID = -1;
+static constexpr char PADDING = '=';
+
+static constexpr std::array<int8_t, 256>
+makeDecodeTable()
+{
+    std::array<int8_t, 256> table {};
+    for (auto& v : table)
+        v = INVALID;
+    for (int i = 0; i < 64; ++i)
+        table[static_cast<uint8_t>(ENCODE_TABLE[i])] = static_cast<int8_t>(i);
+    return table;
+}
+static constexpr auto DECODE_TABLE = makeDecodeTable();
+
+static size_t
+encodeScalar(const uint8_t* in, size_t len, char* out)
+{
+    char* o = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *o++ = ENCODE_TABLE[v >> 18];
+        *o++ = ENCODE_TABLE[(v >> 12) & 0x3f];
+        *o++ = ENCODE_TABLE[(v >> 6) & 0x3f];
+        *o++ = ENCODE_TABLE[v & 0x3f];
+    }
+    if (i < len) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < len)
+            v |= in[i + 1] << 8;
+        *o++ = ENCODE_TABLE[v >> 18];
+        *o++ = ENCODE_TABLE[(v >> 12) & 0x3f];
+        *o++ = i + 1 < len ? ENCODE_TABLE[(v >> 6) & 0x3f] : PADDING;
+        *o++ = PADDING;
+    }
+    return o - out;
+}
+
+/*
+ * Same behavior as pj_base64_decode(), which was used before: characters
+ * outside of the alphabet are skipped, and a trailing one is decoded as if
+ * it had all bits set.
+ */
+static size_t
+decodeScalar(const char* buf, size_t len, uint8_t* out)
+{
+    size_t i = 0, j = 0;
+    int c[4];
+
+    while (i < len) {
+        int k;
+        for (k = 0; k < 4 && i < len; ++k) {
+            do {
+                c[k] = DECODE_TABLE[static_cast<uint8_t>(buf[i++])];
+            } while (c[k] == INVALID && i < len);
+        }
+
+        if (k < 4) {
+            if (k > 1) {
+                out[j++] = static_cast<uint8_t>((static_cast<unsigned>(c[0]) << 2)
+                                                | ((c[1] & 0x30) >> 4));
+                if (k > 2)
+                    out[j++] = static_cast<uint8_t>(((c[1] & 0x0F) << 4) | ((c[2] & 0x3C) >> 2));
+            }
+            break;
+        }
+
+        out[j++] = static_cast<uint8_t>((static_cast<unsigned>(c[0]) << 2)
+                                        | ((c[1] & 0x30) >> 4));
+        out[j++] = static_cast<uint8_t>(((c[1] & 0x0F) << 4) | ((c[2] & 0x3C) >> 2));
+        out[j++] = static_cast<uint8_t>(((c[2] & 0x03) << 6) | (c[3] & 0x3F));
+    }
+    return j;
+}
+
+/*
+ * The block functions below process whole blocks only and return the number
+ * of input bytes consumed; output advances by 4/3 (encode) or 3/4 (decode)
+ * of that. Some of them store a few bytes past the block: their loop
+ * conditions keep those stores within encodedSize()/decodedMaxSize().
+ */
+#ifdef BASE64_SIMD_X86
+
+/*
+ * Encoding after W. Muła & D. Lemire, "Faster Base64 Encoding and Decoding
+ * Using AVX2 Instructions" (2018): spread 3 bytes over 4 lanes with a
+ * shuffle, extract the 6-bit indices with two multiplies, then map indices
+ * to ASCII by adding a per-range offset picked with another shuffle.
+ */
+#ifdef BASE64_TARGET_SSSE3
+BASE64_TARGET_SSSE3 static inline __m128i
+encodeIndicesSsse3(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                        '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, range), indices);
+}
+
+BASE64_TARGET_SSSE3 static size_t
+encodeSsse3(const uint8_t* in, size_t len, char* out)
+{
+    size_t i = 0;
+    // each iteration reads 16 bytes for 12 consumed
+    for (; i + 16 <= len; i += 12, out += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encodeIndicesSsse3(v));
+    }
+    return i;
+}
+#endif
+
+BASE64_TARGET_AVX2 static size_t
+encodeAvx2(const uint8_t* in, size_t len, char* out)
+{
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                           'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    // two 12-byte groups, one per 128-bit lane; the second load reads up to i + 28
+    for (; i + 28 <= len; i += 24, out += 32) {
+        auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        auto v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_shuffle_epi8(v, spread);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        auto chars = _mm256_add_epi8(_mm256_shuffle_epi8(shift, range), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+    }
+    return i;
+}
+
+/*
+ * Decoding: classify every character by its two nibbles (an invalid
+ * character has a common bit in both lookups), turn it into its 6-bit value
+ * with a per-range offset, then pack 4 values into 3 bytes with two
+ * multiply-adds and a shuffle.
+ */
+#ifdef BASE64_TARGET_SSSE3
+BASE64_TARGET_SSSE3 static size_t
+decodeSsse3(const char* in, size_t len, uint8_t* out)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    // 16 characters give 12 bytes, but 16 are stored
+    for (; i + 32 <= len; i += 16, out += 12) {
+        auto str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        auto hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), nibble);
+        auto loNibbles = _mm_and_si128(str, nibble);
+        auto lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        auto hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        // (no ptest before SSE4.1; the flags are small positive values)
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
+            break;
+        auto roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(str, slash), hiNibbles));
+        auto values = _mm_add_epi8(str, roll);
+        auto merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(merged, pack));
+    }
+    return i;
+}
+#endif
+
+BASE64_TARGET_AVX2 static size_t
+decodeAvx2(const char* in, size_t len, uint8_t* out)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0,
+                                             0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0,
+                                             0, 0, 0, 0);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    // 32 characters give 24 bytes, but 32 are stored
+    for (; i + 48 <= len; i += 32, out += 24) {
+        auto str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        auto hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), nibble);
+        auto loNibbles = _mm256_and_si256(str, nibble);
+        auto lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        auto hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+        auto roll = _mm256_shuffle_epi8(lutRoll,
+                                        _mm256_add_epi8(_mm256_cmpeq_epi8(str, slash), hiNibbles));
+        auto values = _mm256_add_epi8(str, roll);
+        auto merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        merged = _mm256_permutevar8x32_epi32(merged, compact);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), merged);
+    }
+    return i;
+}
+
+#endif // BASE64_SIMD_X86
+
+#ifdef BASE64_SIMD_NEON
+
+/*
+ * The structured loads and stores (de)interleave 3-byte groups and
+ * 4-character groups for free; characters are then mapped with 64-byte
+ * table lookups.
+ */
+static inline uint8x16x4_t
+loadTable(const uint8_t* t)
+{
+    uint8x16x4_t table;
+    table.val[0] = vld1q_u8(t);
+    table.val[1] = vld1q_u8(t + 16);
+    table.val[2] = vld1q_u8(t + 32);
+    table.val[3] = vld1q_u8(t + 48);
+    return table;
+}
+
+static size_t
+encodeNeon(const uint8_t* in, size_t len, char* out)
+{
+    const auto table = loadTable(reinterpret_cast<const uint8_t*>(ENCODE_TABLE));
+    const auto mask = vdupq_n_u8(0x3f);
+    size_t i = 0;
+    for (; i + 48 <= len; i += 48, out += 64) {
+        auto src = vld3q_u8(in + i);
+        uint8x16x4_t idx;
+        idx.val[0] = vshrq_n_u8(src.val[0], 2);
+        idx.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(src.val[1], 4), vshlq_n_u8(src.val[0], 4)), mask);
+        idx.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(src.val[2], 6), vshlq_n_u8(src.val[1], 2)), mask);
+        idx.val[3] = vandq_u8(src.val[2], mask);
+        uint8x16x4_t chars;
+        for (int k = 0; k < 4; ++k)
+            chars.val[k] = vqtbl4q_u8(table, idx.val[k]);
+        vst4q_u8(reinterpret_cast<uint8_t*>(out), chars);
+    }
+    return i;
+}
+
+/* Value + 1 of characters 0..127, 0 for the ones outside of the alphabet */
+static constexpr std::array<uint8_t, 128>
+makeNeonDecodeTable()
+{
+    std::array<uint8_t, 128> table {};
+    for (int i = 0; i < 64; ++i)
+        table[static_cast<uint8_t>(ENCODE_TABLE[i])] = static_cast<uint8_t>(i + 1);
+    return table;
+}
+alignas(16) static constexpr auto NEON_DECODE_TABLE = makeNeonDecodeTable();
+
+static size_t
+decodeNeon(const char* in, size_t len, uint8_t* out)
+{
+    const auto tableLo = loadTable(NEON_DECODE_TABLE.data());
+    const auto tableHi = loadTable(NEON_DECODE_TABLE.data() + 64);
+    const auto offset = vdupq_n_u8(64);
+    const auto one = vdupq_n_u8(1);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64, out += 48) {
+        auto str = vld4q_u8(reinterpret_cast<const uint8_t*>(in + i));
+        uint8x16x4_t v;
+        // out of range indices give 0 in both lookups
+        for (int k = 0; k < 4; ++k)
+            v.val[k] = vorrq_u8(vqtbl4q_u8(tableLo, str.val[k]),
+                                vqtbl4q_u8(tableHi, vsubq_u8(str.val[k], offset)));
+        auto valid = vminq_u8(vminq_u8(v.val[0], v.val[1]), vminq_u8(v.val[2], v.val[3]));
+        if (vminvq_u8(valid) == 0)
+            break;
+        for (int k = 0; k < 4; ++k)
+            v.val[k] = vsubq_u8(v.val[k], one);
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+        vst3q_u8(out, bytes);
+    }
+    return i;
+}
+
+#endif // BASE64_SIMD_NEON
+
+using EncodeFn = size_t (*)(const uint8_t*, size_t, char*);
+using DecodeFn = size_t (*)(const char*, size_t, uint8_t*);
+
+struct Impl
+{
+    EncodeFn encode {nullptr};
+    DecodeFn decode {nullptr};
+};
+
+static Impl
+pickImpl()
+{
+#if defined(BASE64_SIMD_X86) && defined(BASE64_TARGET_SSSE3)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {&encodeAvx2, &decodeAvx2};
+    if (__builtin_cpu_supports("ssse3"))
+        return {&encodeSsse3, &decodeSsse3};
+    return {};
+#elif defined(BASE64_SIMD_X86)
+    return {&encodeAvx2, &decodeAvx2};
+#elif defined(BASE64_SIMD_NEON)
+    return {&encodeNeon, &decodeNeon};
+#else
+    return {};
+#endif
+}
+
+static const Impl&
+impl()
+{
+    static const Impl i = pickImpl();
+    return i;
+}
+
+size_t
+encode(const uint8_t* data, size_t size, char* out)
+{
+    size_t done = 0;
+    if (auto fn = impl().encode)
+        done = fn(data, size, out);
+    return done / 3 * 4 + encodeScalar(data + done, size - done, out + done / 3 * 4);
+}
+
 std::string
 encode(std::string_view dat)
 {
-    if (dat.empty() || dat.size() > INT_MAX)
+    if (dat.empty())
         return {};
 
-    int input_length = (int)dat.size();
-    int output_length = PJ_BASE256_TO_BASE64_LEN(input_length);
     std::string out;
-    out.resize(output_length);
+    out.resize(encodedSize(dat.size()));
+    encode(reinterpret_cast<const uint8_t*>(dat.data()), dat.size(), out.data());
+    return out;
+}
 
-    if (pj_base64_encode((const uint8_t*)dat.data(), input_length, &(*out.begin()), &output_length) != PJ_SUCCESS) {
-        throw base64_exception();
-    }
+size_t
+decode(std::string_view str, uint8_t* out)
+{
+    while (!str.empty() && str.back() == PADDING)
+        str.remove_suffix(1);
 
-    out.resize(output_length);
-    return out;
+    size_t done = 0;
+    if (auto fn = impl().decode)
+        done = fn(str.data(), str.size(), out);
+    return done / 4 * 3 + decodeScalar(str.data() + done, str.size() - done, out + done / 4 * 3);
 }
 
 std::vector<uint8_t>
@@ -50,17 +440,9 @@ decode(std::string_view str)
     if (str.empty())
         return {};
 
-    int output_length = PJ_BASE64_TO_BASE256_LEN(str.length());
-    auto input = sip_utils::CONST_PJ_STR(str);
-
     std::vector<uint8_t> out;
-    out.resize(output_length);
-
-    if (pj_base64_decode(&input, &(*out.begin()), &output_length) != PJ_SUCCESS) {
-        throw base64_exception();
-    }
-
-    out.resize(output_length);
+    out.resize(decodedMaxSize(str.size()));
+    out.resize(decode(str, out.data()));
     return out;
 }
 
@@ -31,13 +31,46 @@ namespace base64 {
 class base64_exception : public std::exception
 {};
 
+/**
+ * Length of the padded base64 encoding of @size bytes.
+ */
+constexpr size_t
+encodedSize(size_t size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+/**
+ * Upper bound of the number of bytes decoded from @size base64 characters.
+ */
+constexpr size_t
+decodedMaxSize(size_t size)
+{
+    return size / 4 * 3 + size % 4 * 3 / 4;
+}
+
 std::string encode(std::string_view);
 
 inline std::string encode(const std::vector<uint8_t>& data) {
     return encode(std::string_view((const char*)data.data(), data.size()));
 }
 
+/**
+ * Encode @size bytes into @out, which must have room for encodedSize(size)
+ * characters. No terminating nul is written.
+ * @return the number of characters written
+ */
+size_t encode(const uint8_t* data, size_t size, char* out);
+
 std::vector<uint8_t> decode(std::string_view);
 
+/**
+ * Decode @str into @out, which must have room for decodedMaxSize(str.size())
+ * bytes. As with decode(std::string_view), characters outside of the base64
+ * alphabet are skipped rather than reported.
+ * @return the number of bytes written
+ */
+size_t decode(std::string_view str, uint8_t* out);
+
 } // namespace base64
 } // namespace jami
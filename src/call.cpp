@@ -644,8 +644,24 @@ Call::setConferenceInfo(const std::string& msg)
     std::string err;
     Json::CharReaderBuilder rbuilder;
     auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
+    std::unique_lock lk(confInfoMutex_);
     if (reader->parse(msg.data(), msg.data() + msg.size(), &json, &err)) {
-        if (json.isObject()) {
+        if (json.isObject() and json["delta"].asBool()) {
+            // Only what changed since a previous version
+            if (json["base"].asUInt64() != hostConfInfoVersion_) {
+                JAMI_WARN("[call:%s] Missed a conference information update, request a snapshot",
+                          getCallId().c_str());
+                lk.unlock();
+                requestConfInfoSnapshot();
+                return;
+            }
+            newInfo = hostConfInfo_;
+            newInfo.applyDelta(json);
+            if (json.isMember("v")) {
+                newInfo.v = json["v"].asInt();
+                peerConfProtocol_ = newInfo.v;
+            }
+        } else if (json.isObject()) {
             // new confInfo
             if (json.isMember("p")) {
                 for (const auto& participantInfo : json["p"]) {
@@ -664,6 +680,8 @@ Call::setConferenceInfo(const std::string& msg)
                 newInfo.w = json["w"].asInt();
             if (json.isMember("h"))
                 newInfo.h = json["h"].asInt();
+            if (json.isMember("layout"))
+                newInfo.layout = json["layout"].asInt();
         } else {
             // old confInfo
             for (const auto& participantInfo : json) {
@@ -676,23 +694,33 @@ Call::setConferenceInfo(const std::string& msg)
         }
     }
 
-    {
-        std::lock_guard lk(confInfoMutex_);
-        if (not isConferenceParticipant()) {
-            // confID_ empty -> participant set confInfo with the received one
-            confInfo_ = std::move(newInfo);
+    // The host supports delta updates if it versions its conference information
+    auto version = json.isObject() ? json["version"].asUInt64() : 0;
+    auto requestDelta = version and not json["delta"].asBool() and not confInfoDeltaRequested_;
+    confInfoDeltaRequested_ = version != 0 and (confInfoDeltaRequested_ or requestDelta);
+    hostConfInfoVersion_ = version;
+    hostConfInfo_ = newInfo;
+    // The peer hosts a conference as long as it sends participants ("{}" when we leave it)
+    auto peerHosting = not newInfo.empty();
 
-            // Create sink for each participant
+    if (not isConferenceParticipant()) {
+        // confID_ empty -> participant set confInfo with the received one
+        confInfo_ = std::move(newInfo);
+
+        // Create sink for each participant
 #ifdef ENABLE_VIDEO
-            createSinks(confInfo_);
+        createSinks(confInfo_);
 #endif
-            // Inform client that layout has changed
-            jami::emitSignal<libjami::CallSignal::OnConferenceInfosUpdated>(
-                id_, confInfo_.toVectorMapStringString());
-        } else if (auto conf = conf_.lock()) {
-            conf->mergeConfInfo(newInfo, getPeerNumber());
-        }
+        // Inform client that layout has changed
+        jami::emitSignal<libjami::CallSignal::OnConferenceInfosUpdated>(
+            id_, confInfo_.toVectorMapStringString());
+    } else if (auto conf = conf_.lock()) {
+        conf->mergeConfInfo(newInfo, getPeerNumber());
     }
+    lk.unlock();
+    enableAudioLevel(peerHosting);
+    if (requestDelta)
+        requestConfInfoSnapshot();
 }
 
 void
@@ -725,6 +753,15 @@ Call::sendConfInfo(const std::string& json)
         sendTextMessage(messages, account->getFromUri());
 }
 
+void
+Call::requestConfInfoSnapshot()
+{
+    Json::Value root;
+    root["version"] = 1;
+    root["confInfo"]["delta"] = true;
+    sendConfOrder(root);
+}
+
 void
 Call::resetConfInfo()
 {
@@ -377,6 +377,11 @@ public:
     virtual void createSinks(ConfInfo& infos) = 0;
 #endif
 
+    /**
+     * Send the audio level of outgoing packets, for a peer hosting a conference.
+     */
+    virtual void enableAudioLevel(bool /*enable*/) {}
+
     virtual void switchInput(const std::string& = {}) {};
 
     /**
@@ -450,10 +455,22 @@ public:
     std::unique_ptr<AudioDeviceGuard> audioGuard;
     void sendConfOrder(const Json::Value& root);
     void sendConfInfo(const std::string& json);
+    /**
+     * Tell the conference host that delta updates are supported, and ask it
+     * for a full snapshot of the conference information.
+     */
+    void requestConfInfoSnapshot();
     void resetConfInfo();
 
     virtual void monitor() const = 0;
 
+    /**
+     * Latency histograms summaries of the call's media streams, one map per
+     * stream and stage (see MediaLatencyStats for the stages definition).
+     */
+    virtual std::vector<std::map<std::string, std::string>> getLatencyStats() const { return {}; }
+    virtual void resetLatencyStats() {}
+
     int conferenceProtocolVersion() const
     {
         return peerConfProtocol_;
@@ -495,6 +512,11 @@ protected:
 
     mutable std::mutex confInfoMutex_ {};
     mutable ConfInfo confInfo_ {};
+    // Last conference information received from the host and its version,
+    // used to apply delta updates
+    ConfInfo hostConfInfo_ {};
+    uint64_t hostConfInfoVersion_ {0};
+    bool confInfoDeltaRequested_ {false};
     time_point duration_start_ {time_point::min()};
 
 private:
@@ -25,20 +25,46 @@
 #include "sip/sipaccountbase.h"
 #include "string_utils.h"
 
+#include <opendht/crypto.h>
+
 namespace jami {
 
+CallFactory::CallFactory(std::mt19937_64& rand)
+    : rand_(dht::crypto::getDerivedRandomEngine(rand))
+{}
+
 // generate something like 7ea037947eb9fb2f
+std::string
+CallFactory::randomId() const
+{
+    std::lock_guard lk(randMutex_);
+    return std::to_string(std::uniform_int_distribution<uint64_t>(1, JAMI_ID_MAX_VAL)(rand_));
+}
+
 std::string
 CallFactory::getNewCallID() const
 {
     std::string random_id;
     do {
-        random_id = std::to_string(
-            std::uniform_int_distribution<uint64_t>(1, JAMI_ID_MAX_VAL)(rand_));
+        random_id = randomId();
     } while (hasCall(random_id));
     return random_id;
 }
 
+std::shared_ptr<Call>
+CallFactory::erase(const std::string& id)
+{
+    // The call is returned, so that it is never destroyed under the shard lock
+    auto& s = shard(id);
+    std::unique_lock lk(s.mutex);
+    auto it = s.calls.find(id);
+    if (it == s.calls.end())
+        return {};
+    auto call = std::move(it->second.call);
+    s.calls.erase(it);
+    return call;
+}
+
 std::shared_ptr<SIPCall>
 CallFactory::newSipCall(const std::shared_ptr<SIPAccountBase>& account,
                         Call::CallType type,
@@ -49,10 +75,18 @@ CallFactory::newSipCall(const std::shared_ptr<SIPAccountBase>& account,
         return {};
     }
 
-    std::lock_guard lk(callMapsMutex_);
-    auto id = getNewCallID();
-    auto call = std::make_shared<SIPCall>(account, id, type, mediaList);
-    callMaps_[call->getLinkType()].emplace(id, call);
+    // The ID is checked and the call inserted under the same lock, so that
+    // two threads never take the same ID
+    std::shared_ptr<SIPCall> call;
+    while (not call) {
+        auto id = randomId();
+        auto& s = shard(id);
+        std::unique_lock lk(s.mutex);
+        if (s.calls.find(id) != s.calls.end())
+            continue;
+        call = std::make_shared<SIPCall>(account, id, type, mediaList);
+        s.calls.emplace(id, CallEntry {call, call->getLinkType()});
+    }
     account->attach(call);
     return call;
 }
@@ -66,22 +100,18 @@ CallFactory::forbid()
 void
 CallFactory::removeCall(Call& call)
 {
-    std::lock_guard lk(callMapsMutex_);
-
     const auto& id = call.getCallId();
     JAMI_DBG("Removing call %s", id.c_str());
-    auto& map = callMaps_.at(call.getLinkType());
-    map.erase(id);
-    JAMI_DBG("Remaining %zu call", map.size());
+    erase(id);
+    JAMI_DBG("Remaining %zu call", callCount(call.getLinkType()));
 }
 
 void
 CallFactory::removeCall(const std::string& id)
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    if (auto call = getCall(id)) {
-        removeCall(*call);
+    if (auto call = erase(id)) {
+        JAMI_DBG("Removing call %s", id.c_str());
+        JAMI_DBG("Remaining %zu call", callCount(call->getLinkType()));
     } else
         JAMI_ERR("No call with ID %s", id.c_str());
 }
@@ -89,65 +119,50 @@ CallFactory::removeCall(const std::string& id)
 bool
 CallFactory::hasCall(const std::string& id) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        if (map.find(id) != map.cend())
-            return true;
-    }
-
-    return false;
+    const auto& s = shard(id);
+    std::shared_lock lk(s.mutex);
+    return s.calls.find(id) != s.calls.cend();
 }
 
 bool
 CallFactory::empty() const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        if (not item.second.empty())
+    for (const auto& s : shards_) {
+        std::shared_lock lk(s.mutex);
+        if (not s.calls.empty())
             return false;
     }
-
     return true;
 }
 
 void
 CallFactory::clear()
 {
-    std::lock_guard lk(callMapsMutex_);
-    callMaps_.clear();
+    for (auto& s : shards_) {
+        // Destroy the calls once the lock is released, as their destructors
+        // may call back into the factory
+        std::unordered_map<std::string, CallEntry> calls;
+        {
+            std::unique_lock lk(s.mutex);
+            calls.swap(s.calls);
+        }
+    }
 }
 
 std::shared_ptr<Call>
 CallFactory::getCall(const std::string& id) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        const auto& iter = map.find(id);
-        if (iter != map.cend())
-            return iter->second;
-    }
-
-    return nullptr;
+    const auto& s = shard(id);
+    std::shared_lock lk(s.mutex);
+    auto it = s.calls.find(id);
+    return it != s.calls.cend() ? it->second.call : nullptr;
 }
 
 std::vector<std::shared_ptr<Call>>
 CallFactory::getAllCalls() const
 {
-    std::lock_guard lk(callMapsMutex_);
     std::vector<std::shared_ptr<Call>> v;
-
-    for (const auto& itemmap : callMaps_) {
-        const auto& map = itemmap.second;
-        v.reserve(v.size() + map.size());
-        for (const auto& item : map)
-            v.push_back(item.second);
-    }
-
+    forEach([&](const std::string&, const CallEntry& entry) { v.push_back(entry.call); });
     return v;
 }
 
@@ -155,105 +170,78 @@ std::vector<std::string>
 CallFactory::getCallIDs() const
 {
     std::vector<std::string> v;
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        for (const auto& it : map)
-            v.push_back(it.first);
-    }
-
-    v.shrink_to_fit();
+    forEach([&](const std::string& id, const CallEntry&) { v.push_back(id); });
     return v;
 }
 
 std::size_t
 CallFactory::callCount() const
 {
-    std::lock_guard lk(callMapsMutex_);
     std::size_t count = 0;
-
-    for (const auto& itemmap : callMaps_)
-        count += itemmap.second.size();
-
+    for (const auto& s : shards_) {
+        std::shared_lock lk(s.mutex);
+        count += s.calls.size();
+    }
     return count;
 }
 
 bool
 CallFactory::hasCall(const std::string& id, Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    auto const map = getMap_(link);
-    return map and map->find(id) != map->cend();
+    const auto& s = shard(id);
+    std::shared_lock lk(s.mutex);
+    auto it = s.calls.find(id);
+    return it != s.calls.cend() and it->second.link == link;
 }
 
 bool
 CallFactory::empty(Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    return !map or map->empty();
+    return callCount(link) == 0;
 }
 
 std::shared_ptr<Call>
 CallFactory::getCall(const std::string& id, Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    if (!map)
-        return nullptr;
-
-    const auto& it = map->find(id);
-    if (it == map->cend())
+    const auto& s = shard(id);
+    std::shared_lock lk(s.mutex);
+    auto it = s.calls.find(id);
+    if (it == s.calls.cend() or it->second.link != link)
         return nullptr;
-
-    return it->second;
+    return it->second.call;
 }
 
 std::vector<std::shared_ptr<Call>>
 CallFactory::getAllCalls(Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
     std::vector<std::shared_ptr<Call>> v;
-
-    const auto map = getMap_(link);
-    if (map) {
-        for (const auto& it : *map)
-            v.push_back(it.second);
-    }
-
-    v.shrink_to_fit();
+    forEach([&](const std::string&, const CallEntry& entry) {
+        if (entry.link == link)
+            v.push_back(entry.call);
+    });
     return v;
 }
 
 std::vector<std::string>
 CallFactory::getCallIDs(Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
     std::vector<std::string> v;
-
-    const auto map = getMap_(link);
-    if (map) {
-        for (const auto& it : *map)
-            v.push_back(it.first);
-    }
-
-    v.shrink_to_fit();
+    forEach([&](const std::string& id, const CallEntry& entry) {
+        if (entry.link == link)
+            v.push_back(id);
+    });
     return v;
 }
 
 std::size_t
 CallFactory::callCount(Call::LinkType link) const
 {
-    std::lock_guard lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    if (!map)
-        return 0;
-
-    return map->size();
+    std::size_t count = 0;
+    forEach([&](const std::string&, const CallEntry& entry) {
+        if (entry.link == link)
+            ++count;
+    });
+    return count;
 }
 
 } // namespace jami
@@ -20,11 +20,14 @@
 
 #pragma once
 
-#include <map>
+#include <array>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <shared_mutex>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "call.h"
@@ -38,9 +41,10 @@ class SIPCall;
 class CallFactory
 {
 public:
-    CallFactory(std::mt19937_64& rand)
-        : rand_(rand)
-    {}
+    /**
+     * @param rand  engine used to seed the one of the factory, only used here
+     */
+    CallFactory(std::mt19937_64& rand);
 
     std::string getNewCallID() const;
 
@@ -118,27 +122,54 @@ public:
     std::size_t callCount(Call::LinkType link) const;
 
 private:
+    struct CallEntry
+    {
+        std::shared_ptr<Call> call;
+        Call::LinkType link;
+    };
+
+    /**
+     * Calls are indexed by ID in a fixed number of shards, each with its
+     * own reader/writer lock, so that concurrent lookups from SIP callbacks,
+     * the client API and conferences neither serialize nor contend on a
+     * single mutex.
+     */
+    struct Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, CallEntry> calls;
+    };
+    static constexpr std::size_t SHARD_COUNT = 16;
+
+    Shard& shard(const std::string& id) { return shards_[std::hash<std::string> {}(id) % SHARD_COUNT]; }
+    const Shard& shard(const std::string& id) const
+    {
+        return shards_[std::hash<std::string> {}(id) % SHARD_COUNT];
+    }
+
     /**
-     * @brief Get the calls map
-     * @param link The call type
-     * @return A pointer to the calls map instance
-     * @warning Concurrency protection must done by the caller.
+     * Call func(id, entry) for every call, one shard at a time under its read lock.
      */
-    const CallMap* getMap_(Call::LinkType link) const
+    template<typename F>
+    void forEach(F&& func) const
     {
-        auto const& itermap = callMaps_.find(link);
-        if (itermap != callMaps_.cend())
-            return &itermap->second;
-        return nullptr;
+        for (const auto& s : shards_) {
+            std::shared_lock lk(s.mutex);
+            for (const auto& [id, entry] : s.calls)
+                func(id, entry);
+        }
     }
 
-    std::mt19937_64& rand_;
+    std::string randomId() const;
+    std::shared_ptr<Call> erase(const std::string& id);
 
-    mutable std::recursive_mutex callMapsMutex_ {};
+    // Own engine, as IDs are drawn concurrently from any thread
+    mutable std::mutex randMutex_ {};
+    mutable std::mt19937_64 rand_;
 
     std::atomic_bool allowNewCall_ {true};
 
-    std::map<Call::LinkType, CallMap> callMaps_ {};
+    std::array<Shard, SHARD_COUNT> shards_ {};
 };
 
 } // namespace jami
@@ -309,6 +309,23 @@ currentMediaList(const std::string& accountId, const std::string& callId)
     return {};
 }
 
+std::vector<std::map<std::string, std::string>>
+getCallLatencyStats(const std::string& accountId, const std::string& callId)
+{
+    if (const auto account = jami::Manager::instance().getAccount(accountId))
+        if (auto call = account->getCall(callId))
+            return call->getLatencyStats();
+    return {};
+}
+
+void
+resetCallLatencyStats(const std::string& accountId, const std::string& callId)
+{
+    if (const auto account = jami::Manager::instance().getAccount(accountId))
+        if (auto call = account->getCall(callId))
+            call->resetLatencyStats();
+}
+
 std::vector<std::string>
 getConferenceList(const std::string& accountId)
 {
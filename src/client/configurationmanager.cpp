@@ -760,7 +760,7 @@ setRecordPreview(bool rec)
 {
 #ifdef ENABLE_VIDEO
     jami::Manager::instance().videoPreferences.setRecordPreview(rec);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
 #endif
 }
 
@@ -779,7 +779,7 @@ setRecordQuality(int32_t quality)
 {
 #ifdef ENABLE_VIDEO
     jami::Manager::instance().videoPreferences.setRecordQuality(quality);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
 #endif
 }
 
@@ -37,7 +37,7 @@ loadPlugin(const std::string& path)
     bool status = jami::Manager::instance().getJamiPluginManager().loadPlugin(path);
 
     jami::Manager::instance().pluginPreferences.saveStateLoadedPlugins(path, status);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_PLUGINS);
     return status;
 #endif
     return false;
@@ -50,7 +50,7 @@ unloadPlugin(const std::string& path)
     bool status = jami::Manager::instance().getJamiPluginManager().unloadPlugin(path);
 
     jami::Manager::instance().pluginPreferences.saveStateLoadedPlugins(path, false);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_PLUGINS);
     return status;
 #endif
     return false;
@@ -141,7 +141,7 @@ uninstallPlugin(const std::string& pluginRootPath)
 #ifdef ENABLE_PLUGIN
     int status = jami::Manager::instance().getJamiPluginManager().uninstallPlugin(pluginRootPath);
     jami::Manager::instance().pluginPreferences.saveStateLoadedPlugins(pluginRootPath, false);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_PLUGINS);
     return status;
 #endif
     return -1;
@@ -272,7 +272,7 @@ setPluginsEnabled(bool state)
         else
             jami::Manager::instance().getJamiPluginManager().unloadPlugin(item);
     }
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_PLUGINS);
 #endif
 }
 
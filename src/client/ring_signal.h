@@ -47,17 +47,361 @@
 #include <TargetConditionals.h>
 #endif
 
+#include <array>
+#include <chrono>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <type_traits>
 #include <utility>
 #include <string>
+#include <vector>
 
 namespace jami {
 
-using SignalHandlerMap = std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>>;
+template<typename... Ts>
+struct SignalTypeList
+{
+    static constexpr std::size_t size = sizeof...(Ts);
+
+    template<typename T>
+    static constexpr std::size_t indexOf()
+    {
+        constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+        for (std::size_t i = 0; i < size; ++i)
+            if (matches[i])
+                return i;
+        return size;
+    }
+
+    static constexpr std::array<const char*, size> names() { return {Ts::name...}; }
+};
+
+/*
+ * Every signal the daemon can emit. Each one is given a slot in the
+ * handler table from its position in this list, so that emitting a
+ * signal doesn't need any lookup by name.
+ */
+using ExportedSignals = SignalTypeList<
+    /* Call */
+    libjami::CallSignal::StateChange,
+    libjami::CallSignal::TransferFailed,
+    libjami::CallSignal::TransferSucceeded,
+    libjami::CallSignal::RecordPlaybackStopped,
+    libjami::CallSignal::VoiceMailNotify,
+    libjami::CallSignal::IncomingMessage,
+    libjami::CallSignal::IncomingCall,
+    libjami::CallSignal::IncomingCallWithMedia,
+    libjami::CallSignal::MediaChangeRequested,
+    libjami::CallSignal::RecordPlaybackFilepath,
+    libjami::CallSignal::ConferenceCreated,
+    libjami::CallSignal::ConferenceChanged,
+    libjami::CallSignal::UpdatePlaybackScale,
+    libjami::CallSignal::ConferenceRemoved,
+    libjami::CallSignal::RecordingStateChanged,
+    libjami::CallSignal::RtcpReportReceived,
+    libjami::CallSignal::PeerHold,
+    libjami::CallSignal::VideoMuted,
+    libjami::CallSignal::AudioMuted,
+    libjami::CallSignal::SmartInfo,
+    libjami::CallSignal::ConnectionUpdate,
+    libjami::CallSignal::OnConferenceInfosUpdated,
+    libjami::CallSignal::RemoteRecordingChanged,
+    libjami::CallSignal::MediaNegotiationStatus,
+
+    /* Configuration */
+    libjami::ConfigurationSignal::VolumeChanged,
+    libjami::ConfigurationSignal::AccountsChanged,
+    libjami::ConfigurationSignal::AccountDetailsChanged,
+    libjami::ConfigurationSignal::StunStatusFailed,
+    libjami::ConfigurationSignal::RegistrationStateChanged,
+    libjami::ConfigurationSignal::VolatileDetailsChanged,
+    libjami::ConfigurationSignal::CertificatePinned,
+    libjami::ConfigurationSignal::CertificatePathPinned,
+    libjami::ConfigurationSignal::CertificateExpired,
+    libjami::ConfigurationSignal::CertificateStateChanged,
+    libjami::ConfigurationSignal::IncomingAccountMessage,
+    libjami::ConfigurationSignal::ComposingStatusChanged,
+    libjami::ConfigurationSignal::AccountMessageStatusChanged,
+    libjami::ConfigurationSignal::NeedsHost,
+    libjami::ConfigurationSignal::ActiveCallsChanged,
+    libjami::ConfigurationSignal::ProfileReceived,
+    libjami::ConfigurationSignal::IncomingTrustRequest,
+    libjami::ConfigurationSignal::ContactAdded,
+    libjami::ConfigurationSignal::ContactRemoved,
+    libjami::ConfigurationSignal::ExportOnRingEnded,
+    libjami::ConfigurationSignal::KnownDevicesChanged,
+    libjami::ConfigurationSignal::NameRegistrationEnded,
+    libjami::ConfigurationSignal::RegisteredNameFound,
+    libjami::ConfigurationSignal::UserSearchEnded,
+    libjami::ConfigurationSignal::MediaParametersChanged,
+    libjami::ConfigurationSignal::MigrationEnded,
+    libjami::ConfigurationSignal::DeviceRevocationEnded,
+    libjami::ConfigurationSignal::AccountProfileReceived,
+    libjami::ConfigurationSignal::Error,
+#if defined(__ANDROID__) || (defined(TARGET_OS_IOS) && TARGET_OS_IOS)
+    libjami::ConfigurationSignal::GetHardwareAudioFormat,
+#endif
+#if defined(__ANDROID__) || (defined(TARGET_OS_IOS) && TARGET_OS_IOS)
+    libjami::ConfigurationSignal::GetAppDataPath,
+    libjami::ConfigurationSignal::GetDeviceName,
+#endif
+    libjami::ConfigurationSignal::HardwareDecodingChanged,
+    libjami::ConfigurationSignal::HardwareEncodingChanged,
+    libjami::ConfigurationSignal::MessageSend,
+
+    /* Presence */
+    libjami::PresenceSignal::NewServerSubscriptionRequest,
+    libjami::PresenceSignal::NearbyPeerNotification,
+    libjami::PresenceSignal::ServerError,
+    libjami::PresenceSignal::NewBuddyNotification,
+    libjami::PresenceSignal::SubscriptionStateChanged,
+
+    /* Audio */
+    libjami::AudioSignal::DeviceEvent,
+    libjami::AudioSignal::AudioMeter,
+
+    /* DataTransfer */
+    libjami::DataTransferSignal::DataTransferEvent,
+    libjami::DataTransferSignal::DataTransferEvents,
+
+#ifdef ENABLE_VIDEO
+    /* MediaPlayer */
+    libjami::MediaPlayerSignal::FileOpened,
+
+    /* Video */
+    libjami::VideoSignal::DeviceEvent,
+    libjami::VideoSignal::DecodingStarted,
+    libjami::VideoSignal::DecodingStopped,
+#ifdef __ANDROID__
+    libjami::VideoSignal::GetCameraInfo,
+    libjami::VideoSignal::SetParameters,
+    libjami::VideoSignal::RequestKeyFrame,
+    libjami::VideoSignal::SetBitrate,
+#endif
+    libjami::VideoSignal::StartCapture,
+    libjami::VideoSignal::StopCapture,
+    libjami::VideoSignal::DeviceAdded,
+    libjami::VideoSignal::ParametersChanged,
+#endif
+
+#ifdef ENABLE_PLUGIN
+    libjami::PluginSignal::WebViewMessageReceived,
+#endif
+
+    /* Conversation */
+    libjami::ConversationSignal::ConversationLoaded,
+    libjami::ConversationSignal::SwarmLoaded,
+    libjami::ConversationSignal::MessagesFound,
+    libjami::ConversationSignal::MessageReceived,
+    libjami::ConversationSignal::SwarmMessageReceived,
+    libjami::ConversationSignal::SwarmMessagesReceived,
+    libjami::ConversationSignal::SwarmMessageUpdated,
+    libjami::ConversationSignal::ReactionAdded,
+    libjami::ConversationSignal::ReactionRemoved,
+    libjami::ConversationSignal::ConversationProfileUpdated,
+    libjami::ConversationSignal::ConversationRequestReceived,
+    libjami::ConversationSignal::ConversationRequestDeclined,
+    libjami::ConversationSignal::ConversationReady,
+    libjami::ConversationSignal::ConversationRemoved,
+    libjami::ConversationSignal::ConversationMemberEvent,
+    libjami::ConversationSignal::ConversationSyncFinished,
+    libjami::ConversationSignal::ConversationCloned,
+    libjami::ConversationSignal::CallConnectionRequest,
+    libjami::ConversationSignal::OnConversationError,
+    libjami::ConversationSignal::ConversationPreferencesUpdated>;
+
+template<typename Ts>
+constexpr std::size_t signalSlot()
+{
+    constexpr auto slot = ExportedSignals::template indexOf<Ts>();
+    static_assert(slot < ExportedSignals::size, "Signal is not part of ExportedSignals");
+    return slot;
+}
+
+using SignalHandlerMap = std::array<std::shared_ptr<libjami::CallbackWrapperBase>,
+                                    ExportedSignals::size>;
 extern SignalHandlerMap& getSignalHandlers();
 
+template<typename Ts>
+std::shared_ptr<libjami::CallbackWrapperBase>
+getSignalHandler()
+{
+    return std::atomic_load(&getSignalHandlers()[signalSlot<Ts>()]);
+}
+
+/*
+ * Batched delivery.
+ *
+ * Some signals fire once per item (message, transfer event...) and can
+ * flood clients, during a sync for instance. Such signals have a batched
+ * counterpart carrying a vector of items; if the client registered a
+ * handler for it and a batch interval is set (see
+ * libjami::setSignalBatchInterval), items are accumulated per account and
+ * conversation and delivered at most once per interval instead.
+ *
+ * SignalBatch<Ts> describes how to turn the arguments of Ts into an item
+ * of Ts::Batched. The first two arguments are always the account and
+ * conversation IDs.
+ *
+ * Items must not be overtaken by later signals about the same conversation
+ * (an edition or a reaction referring to a batched message, for instance):
+ * emitting a signal for which FlushesBatches is true first delivers what is
+ * pending for its conversation in the other batches.
+ */
+template<typename Ts>
+struct SignalBatch;
+
+template<>
+struct SignalBatch<libjami::ConversationSignal::SwarmMessageReceived>
+{
+    using Batched = libjami::ConversationSignal::SwarmMessagesReceived;
+    using Item = libjami::SwarmMessage;
+    static Item item(const libjami::SwarmMessage& message) { return message; }
+};
+
+template<>
+struct SignalBatch<libjami::DataTransferSignal::DataTransferEvent>
+{
+    using Batched = libjami::DataTransferSignal::DataTransferEvents;
+    using Item = std::map<std::string, std::string>;
+    static Item item(const std::string& interactionId, const std::string& fileId, int eventCode)
+    {
+        return {{"interactionId", interactionId},
+                {"fileId", fileId},
+                {"eventCode", std::to_string(eventCode)}};
+    }
+};
+
+template<typename Ts, typename = void>
+struct IsBatchable : std::false_type
+{};
+template<typename Ts>
+struct IsBatchable<Ts, std::void_t<typename SignalBatch<Ts>::Batched>> : std::true_type
+{};
+
+template<typename Ts>
+struct FlushesBatches : IsBatchable<Ts>
+{};
+template<>
+struct FlushesBatches<libjami::ConversationSignal::SwarmMessageUpdated> : std::true_type
+{};
+template<>
+struct FlushesBatches<libjami::ConversationSignal::ReactionAdded> : std::true_type
+{};
+template<>
+struct FlushesBatches<libjami::ConversationSignal::ReactionRemoved> : std::true_type
+{};
+template<>
+struct FlushesBatches<libjami::ConversationSignal::ConversationMemberEvent> : std::true_type
+{};
+template<>
+struct FlushesBatches<libjami::ConversationSignal::ConversationRemoved> : std::true_type
+{};
+
+std::chrono::milliseconds getSignalBatchInterval();
+void scheduleSignalFlush(std::function<void()>&& flush, std::chrono::milliseconds delay);
+// Held while batches are delivered, so that a flush is never overtaken
+std::recursive_mutex& getSignalFlushMutex();
+// Deliver every pending batch
+void flushSignalBatches();
+
+template<typename Ts, typename... Args>
+void emitSignal(Args... args);
+
+template<typename Ts>
+class SignalBatcher
+{
+public:
+    using Batch = SignalBatch<Ts>;
+
+    static SignalBatcher& instance()
+    {
+        static SignalBatcher batcher;
+        return batcher;
+    }
+
+    template<typename... Args>
+    void add(const std::string& accountId, const std::string& conversationId, Args&&... args)
+    {
+        std::lock_guard lk(mutex_);
+        pending_[{accountId, conversationId}].emplace_back(Batch::item(std::forward<Args>(args)...));
+        if (not scheduled_) {
+            scheduled_ = true;
+            scheduleSignalFlush([this] { flush(); }, getSignalBatchInterval());
+        }
+    }
+
+    void flush()
+    {
+        std::lock_guard flushLock(getSignalFlushMutex());
+        decltype(pending_) pending;
+        {
+            std::lock_guard lk(mutex_);
+            pending.swap(pending_);
+            scheduled_ = false;
+        }
+        for (auto& [key, items] : pending)
+            emitSignal<typename Batch::Batched>(key.first, key.second, std::move(items));
+    }
+
+    /**
+     * Deliver the items pending for one conversation, if any.
+     */
+    void flush(const std::string& accountId, const std::string& conversationId)
+    {
+        std::lock_guard flushLock(getSignalFlushMutex());
+        std::vector<typename Batch::Item> items;
+        {
+            std::lock_guard lk(mutex_);
+            auto it = pending_.find({accountId, conversationId});
+            if (it == pending_.end())
+                return;
+            items = std::move(it->second);
+            pending_.erase(it);
+        }
+        emitSignal<typename Batch::Batched>(accountId, conversationId, std::move(items));
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::pair<std::string, std::string>, std::vector<typename Batch::Item>> pending_;
+    bool scheduled_ {false};
+};
+
+template<typename... Ts>
+struct BatchedSignalList
+{
+    static void flush() { (SignalBatcher<Ts>::instance().flush(), ...); }
+
+    // Flush the batches of a conversation, except the one of Except
+    template<typename Except>
+    static void flush(const std::string& accountId, const std::string& conversationId)
+    {
+        (flushOne<Ts, Except>(accountId, conversationId), ...);
+    }
+
+private:
+    template<typename T, typename Except>
+    static void flushOne(const std::string& accountId, const std::string& conversationId)
+    {
+        if constexpr (not std::is_same_v<T, Except>)
+            SignalBatcher<T>::instance().flush(accountId, conversationId);
+    }
+};
+
+using BatchedSignals = BatchedSignalList<libjami::ConversationSignal::SwarmMessageReceived,
+                                         libjami::DataTransferSignal::DataTransferEvent>;
+
+template<typename Ts, typename... Args>
+void
+flushBatchesBefore(const std::string& accountId, const std::string& conversationId, const Args&...)
+{
+    BatchedSignals::flush<Ts>(accountId, conversationId);
+}
+
 /*
  * Find related user given callback and call it with given
  * arguments.
@@ -69,16 +413,33 @@ void emitSignal(Args... args)
 {
     jami_tracepoint_if_enabled(emit_signal, demangle<Ts>().c_str());
 
-    const auto& handlers = getSignalHandlers();
-    if (auto wrap = libjami::CallbackWrapper<typename Ts::cb_type>(handlers.at(Ts::name))) {
-        try {
-            auto cb = *wrap;
-            jami_tracepoint(emit_signal_begin_callback,
-                            wrap.file_, wrap.linum_);
-            cb(args...);
-            jami_tracepoint(emit_signal_end_callback);
-        } catch (std::exception& e) {
-            JAMI_ERR("Exception during emit signal %s:\n%s", Ts::name, e.what());
+    if constexpr (FlushesBatches<Ts>::value) {
+        if (getSignalBatchInterval().count() > 0)
+            flushBatchesBefore<Ts>(args...);
+    }
+
+    if constexpr (IsBatchable<Ts>::value) {
+        if (getSignalBatchInterval().count() > 0
+            and getSignalHandler<typename SignalBatch<Ts>::Batched>()) {
+            SignalBatcher<Ts>::instance().add(args...);
+            jami_tracepoint(emit_signal_end);
+            return;
+        }
+    }
+
+    // Holding the handler keeps the callback alive even if handlers are
+    // registered again concurrently, without copying the std::function.
+    if (auto handler = getSignalHandler<Ts>()) {
+        auto wrap = (libjami::CallbackWrapper<typename Ts::cb_type>*) handler.get();
+        if (*wrap) {
+            try {
+                jami_tracepoint(emit_signal_begin_callback,
+                                wrap->file_, wrap->linum_);
+                (**wrap)(args...);
+                jami_tracepoint(emit_signal_end_callback);
+            } catch (std::exception& e) {
+                JAMI_ERR("Exception during emit signal %s:\n%s", Ts::name, e.what());
+            }
         }
     }
 
@@ -86,12 +447,4 @@ void emitSignal(Args... args)
 }
 #pragma GCC diagnostic pop
 
-template<typename Ts>
-std::pair<std::string, std::shared_ptr<libjami::CallbackWrapper<typename Ts::cb_type>>>
-exported_callback()
-{
-    return std::make_pair((const std::string&) Ts::name,
-                          std::make_shared<libjami::CallbackWrapper<typename Ts::cb_type>>());
-}
-
 } // namespace jami
@@ -406,7 +406,7 @@ setDefaultDevice(const std::string& deviceId)
 {
     JAMI_DBG("Setting default device to %s", deviceId.c_str());
     if (jami::Manager::instance().getVideoManager().videoDeviceMonitor.setDefaultDevice(deviceId))
-        jami::Manager::instance().saveConfig();
+        jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
 }
 
 void
@@ -441,7 +441,7 @@ void
 applySettings(const std::string& deviceId, const std::map<std::string, std::string>& settings)
 {
     jami::Manager::instance().getVideoManager().videoDeviceMonitor.applySettings(deviceId, settings);
-    jami::Manager::instance().saveConfig();
+    jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
 }
 
 std::string
@@ -628,7 +628,7 @@ setDecodingAccelerated(bool state)
 #ifdef RING_ACCEL
     JAMI_DBG("%s hardware acceleration", (state ? "Enabling" : "Disabling"));
     if (jami::Manager::instance().videoPreferences.setDecodingAccelerated(state))
-        jami::Manager::instance().saveConfig();
+        jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
 #endif
 }
 
@@ -648,7 +648,7 @@ setEncodingAccelerated(bool state)
 #ifdef RING_ACCEL
     JAMI_DBG("%s hardware acceleration", (state ? "Enabling" : "Disabling"));
     if (jami::Manager::instance().videoPreferences.setEncodingAccelerated(state))
-        jami::Manager::instance().saveConfig();
+        jami::Manager::instance().saveConfig(jami::Manager::CONFIG_VIDEO);
     else
         return;
 #endif
@@ -35,6 +35,7 @@
 #include "call.h"
 #include "video/video_input.h"
 #include "video/video_mixer.h"
+#include "video/video_forwarder.h"
 #endif
 
 #ifdef ENABLE_PLUGIN
@@ -54,6 +55,9 @@ using namespace std::literals;
 
 namespace jami {
 
+// Coalesce conference information updates (e.g. voice activity) sent to peers
+static constexpr auto CONF_INFO_MIN_INTERVAL = 200ms;
+
 Conference::Conference(const std::shared_ptr<Account>& account,
                        const std::string& confId)
     : id_(confId.empty() ? Manager::instance().callFactory.getNewCallID() : confId)
@@ -67,6 +71,8 @@ Conference::Conference(const std::shared_ptr<Account>& account,
 
 #ifdef ENABLE_VIDEO
     videoMixer_ = std::make_shared<video::VideoMixer>(id_);
+    if (account->isConferenceForwarding())
+        videoForwarder_ = std::make_shared<video::VideoForwarder>(id_);
     videoMixer_->setOnSourcesUpdated([this](std::vector<video::SourceInfo>&& infos) {
         runOnMainThread([w = weak(), infos = std::move(infos)] {
             auto shared = w.lock();
@@ -238,6 +244,8 @@ Conference::Conference(const std::shared_ptr<Account>& account,
 Conference::~Conference()
 {
     JAMI_INFO("Destroying conference %s", id_.c_str());
+    if (confInfoTask_)
+        confInfoTask_->cancel();
 
 #ifdef ENABLE_VIDEO
     foreachCall([&](auto call) {
@@ -716,6 +724,17 @@ Conference::addSubCall(const std::string& callId)
             if (account->isAllModerators())
                 moderators_.emplace(getRemoteId(call));
         }
+        // Follow who speaks from the audio levels sent by the participant,
+        // or measured on its decoded audio if it doesn't send them
+        auto sinkId = sip_utils::streamId(callId,
+                                          MediaAttribute::hasMediaType(call->getMediaAttributeList(),
+                                                                       MediaType::MEDIA_VIDEO)
+                                              ? sip_utils::DEFAULT_VIDEO_STREAMID
+                                              : sip_utils::DEFAULT_AUDIO_STREAMID);
+        call->setAudioLevelCallback([w = weak(), sinkId = std::move(sinkId)](AudioLevel level) {
+            if (auto shared = w.lock())
+                shared->onAudioLevel(sinkId, level);
+        });
 #ifdef ENABLE_VIDEO
         // In conference, if a participant joins with an audio only
         // call, it must be listed in the audioonlylist.
@@ -756,18 +775,30 @@ Conference::removeSubCall(const std::string& callId)
         if (!subCalls_.erase(callId))
             return;
     }
+    {
+        std::lock_guard lk(confInfoMutex_);
+        peersConfInfo_.erase(callId);
+    }
     if (auto call = std::dynamic_pointer_cast<SIPCall>(getCall(callId))) {
         const auto& peerId = getRemoteId(call);
         participantsMuted_.erase(call->getCallId());
         if (auto* transport = call->getTransport())
             handsRaised_.erase(std::string(transport->deviceId()));
+        call->setAudioLevelCallback({});
+        {
+            std::lock_guard lk(speakersMtx_);
+            speakers_.remove(sip_utils::streamId(callId, sip_utils::DEFAULT_VIDEO_STREAMID));
+            speakers_.remove(sip_utils::streamId(callId, sip_utils::DEFAULT_AUDIO_STREAMID));
+        }
 #ifdef ENABLE_VIDEO
         if (videoMixer_) {
             for (auto const& rtpSession : call->getRtpSessionList()) {
                 if (rtpSession->getMediaType() == MediaType::MEDIA_AUDIO)
                     videoMixer_->removeAudioOnlySource(callId, rtpSession->streamId());
-                if (videoMixer_->verifyActive(rtpSession->streamId()))
+                if (videoMixer_->verifyActive(rtpSession->streamId())) {
+                    activeStreamPinned_ = false;
                     videoMixer_->resetActiveStream();
+                }
             }
         }
 
@@ -787,10 +818,12 @@ Conference::setActiveParticipant(const std::string& participant_id)
     if (!videoMixer_)
         return;
     if (isHost(participant_id)) {
+        activeStreamPinned_ = true;
         videoMixer_->setActiveStream(sip_utils::streamId("", sip_utils::DEFAULT_VIDEO_STREAMID));
         return;
     }
     if (auto call = getCallFromPeerID(participant_id)) {
+        activeStreamPinned_ = true;
         videoMixer_->setActiveStream(
             sip_utils::streamId(call->getCallId(), sip_utils::DEFAULT_VIDEO_STREAMID));
         return;
@@ -803,6 +836,7 @@ Conference::setActiveParticipant(const std::string& participant_id)
         return;
     }
     // Unset active participant by default
+    activeStreamPinned_ = false;
     videoMixer_->resetActiveStream();
 #endif
 }
@@ -813,6 +847,7 @@ Conference::setActiveStream(const std::string& streamId, bool state)
 #ifdef ENABLE_VIDEO
     if (!videoMixer_)
         return;
+    activeStreamPinned_ = state;
     if (state)
         videoMixer_->setActiveStream(streamId);
     else
@@ -834,7 +869,10 @@ Conference::setLayout(int layout)
         std::lock_guard lk(confInfoMutex_);
         confInfo_.layout = layout;
     }
+    if (layout == static_cast<int>(video::Layout::GRID))
+        activeStreamPinned_ = false;
     videoMixer_->setVideoLayout(static_cast<video::Layout>(layout));
+    followDominantSpeaker();
 #endif
 }
 
@@ -848,23 +886,149 @@ ConfInfo::toVectorMapStringString() const
     return infos;
 }
 
+Json::Value
+ConfInfo::toJson() const
+{
+    Json::Value val = {};
+    for (const auto& info : *this) {
+        val["p"].append(info.toJson());
+    }
+    val["w"] = w;
+    val["h"] = h;
+    val["v"] = v;
+    val["layout"] = layout;
+    return val;
+}
+
 std::string
 ConfInfo::toString() const
 {
+    return Json::writeString(Json::StreamWriterBuilder {}, toJson());
+}
+
+static std::string
+participantKey(std::string_view uri, std::string_view device, std::string_view sinkId)
+{
+    std::string key;
+    key.reserve(uri.size() + device.size() + sinkId.size() + 2);
+    key.append(uri).append(1, '\n').append(device).append(1, '\n').append(sinkId);
+    return key;
+}
+
+static std::string
+participantKey(const ParticipantInfo& info)
+{
+    return participantKey(info.uri, info.device, info.sinkId);
+}
+
+Json::Value
+ConfInfo::deltaFrom(const ConfInfo& base) const
+{
+    std::map<std::string, const ParticipantInfo*> previous;
+    for (const auto& info : base)
+        previous.emplace(participantKey(info), &info);
+
     Json::Value val = {};
+    bool changed = w != base.w or h != base.h or layout != base.layout;
     for (const auto& info : *this) {
+        auto it = previous.find(participantKey(info));
+        if (it != previous.end()) {
+            auto same = *it->second == info;
+            previous.erase(it);
+            if (same)
+                continue;
+        }
         val["p"].append(info.toJson());
+        changed = true;
     }
+    for (const auto& [key, info] : previous) {
+        Json::Value removed;
+        removed["uri"] = info->uri;
+        removed["device"] = info->device;
+        removed["sinkId"] = info->sinkId;
+        val["removed"].append(std::move(removed));
+        changed = true;
+    }
+    if (not changed)
+        return Json::Value::nullSingleton();
+
+    val["delta"] = true;
     val["w"] = w;
     val["h"] = h;
     val["v"] = v;
     val["layout"] = layout;
-    return Json::writeString(Json::StreamWriterBuilder {}, val);
+    return val;
+}
+
+void
+ConfInfo::applyDelta(const Json::Value& delta)
+{
+    for (const auto& removed : delta["removed"]) {
+        auto key = participantKey(removed["uri"].asString(),
+                                  removed["device"].asString(),
+                                  removed["sinkId"].asString());
+        erase(std::remove_if(begin(),
+                             end(),
+                             [&](const ParticipantInfo& info) {
+                                 return participantKey(info) == key;
+                             }),
+              end());
+    }
+    for (const auto& participantInfo : delta["p"]) {
+        if (!participantInfo.isMember("uri"))
+            continue;
+        ParticipantInfo pInfo;
+        pInfo.fromJson(participantInfo);
+        auto key = participantKey(pInfo);
+        auto it = std::find_if(begin(), end(), [&](const ParticipantInfo& info) {
+            return participantKey(info) == key;
+        });
+        if (it != end())
+            *it = std::move(pInfo);
+        else
+            emplace_back(std::move(pInfo));
+    }
+    if (delta.isMember("w"))
+        w = delta["w"].asInt();
+    if (delta.isMember("h"))
+        h = delta["h"].asInt();
+    if (delta.isMember("layout"))
+        layout = delta["layout"].asInt();
 }
 
 void
 Conference::sendConferenceInfos()
 {
+    if (confInfoTask_)
+        return; // already scheduled, will send the latest state
+
+    auto now = clock::now();
+    auto next = lastConfInfoSent_ + CONF_INFO_MIN_INTERVAL;
+    if (now >= next) {
+        flushConferenceInfos();
+        return;
+    }
+    confInfoTask_ = Manager::instance().scheduler().scheduleIn(
+        [w = weak()] {
+            if (auto shared = w.lock()) {
+                std::lock_guard lk(shared->confInfoMutex_);
+                shared->confInfoTask_.reset();
+                shared->flushConferenceInfos();
+            }
+        },
+        next - now);
+}
+
+void
+Conference::flushConferenceInfos()
+{
+    lastConfInfoSent_ = clock::now();
+    auto version = ++confInfoVersion_;
+
+    Json::StreamWriterBuilder wbuilder;
+    wbuilder["commentStyle"] = "None";
+    wbuilder["indentation"] = "";
+
     // Inform calls that the layout has changed
     foreachCall([&](auto call) {
         // Produce specific JSON for each participant (2 separate accounts can host ...
@@ -874,12 +1038,29 @@ Conference::sendConferenceInfos()
         if (!account)
             return;
 
-        dht::ThreadPool::io().run(
-            [call,
-             confInfo = getConfInfoHostUri(account->getUsername() + "@ring.dht",
-                                           call->getPeerNumber())] {
-                call->sendConfInfo(confInfo.toString());
-            });
+        auto confInfo = getConfInfoHostUri(account->getUsername() + "@ring.dht",
+                                           call->getPeerNumber());
+        auto& peer = peersConfInfo_[call->getCallId()];
+        Json::Value json;
+        if (peer.delta and peer.version) {
+            // Only send participants that changed since the last version the peer got
+            json = confInfo.deltaFrom(peer.info);
+            if (json.isNull())
+                return;
+            json["base"] = Json::UInt64(peer.version);
+        } else {
+            if (peer.version and confInfo == peer.info and confInfo.layout == peer.info.layout)
+                return;
+            // Full snapshot. The version tells the peer that deltas are supported.
+            json = confInfo.toJson();
+        }
+        json["version"] = Json::UInt64(version);
+        peer.version = version;
+        peer.info = std::move(confInfo);
+
+        dht::ThreadPool::io().run([call, msg = Json::writeString(wbuilder, json)] {
+            call->sendConfInfo(msg);
+        });
     });
 
     auto confInfo = getConfInfoHostUri("", "");
@@ -1059,6 +1240,21 @@ Conference::getVideoMixer()
     return videoMixer_;
 }
 
+void
+Conference::updateForwarding()
+{
+    if (!videoForwarder_)
+        return;
+    std::vector<std::string> priorities;
+    for (const auto& participant : confInfo_)
+        if (participant.active)
+            priorities.emplace_back(participant.sinkId);
+    for (const auto& participant : confInfo_)
+        if (participant.voiceActivity and not participant.active)
+            priorities.emplace_back(participant.sinkId);
+    videoForwarder_->setPriorities(std::move(priorities));
+}
+
 std::string
 Conference::getVideoInput() const
 {
@@ -1132,6 +1328,17 @@ Conference::onConfOrder(const std::string& callId, const std::string& confOrder)
             return;
         }
 
+        // A peer able to apply delta updates asks for a full snapshot
+        // (when joining, or if it missed an update)
+        if (root.isMember("confInfo") and root["confInfo"].isObject()
+            and root["confInfo"]["delta"].asBool()) {
+            std::lock_guard lk(confInfoMutex_);
+            auto& peer = peersConfInfo_[callId];
+            peer.delta = true;
+            peer.version = 0;
+            sendConferenceInfos();
+        }
+
         parser_.initData(std::move(root), peerId);
         parser_.parse();
     }
@@ -1204,16 +1411,13 @@ Conference::isVoiceActive(std::string_view streamId) const
 void
 Conference::setVoiceActivity(const std::string& streamId, const bool& newState)
 {
-    // verify that streamID exists in our confInfo
-    bool exists = false;
-    for (auto& participant : confInfo_) {
-        if (participant.sinkId == streamId) {
-            exists = true;
-            break;
-        }
-    }
+    std::lock_guard lk(confInfoMutex_);
 
-    if (!exists) {
+    // verify that streamID exists in our confInfo
+    auto participant = std::find_if(confInfo_.begin(),
+                                    confInfo_.end(),
+                                    [&](const ParticipantInfo& p) { return p.sinkId == streamId; });
+    if (participant == confInfo_.end()) {
         JAMI_ERR("participant not found with streamId: %s", streamId.c_str());
         return;
     }
@@ -1225,19 +1429,93 @@ Conference::setVoiceActivity(const std::string& streamId, const bool& newState)
         return;
     }
 
-    if (newState and not previousState) {
-        // voice going from inactive to active
+    if (newState)
         streamsVoiceActive.emplace(streamId);
-        updateVoiceActivity();
+    else
+        streamsVoiceActive.erase(streamId);
+
+    // Only this participant changed
+    auto activity = participantVoiceActivity(*participant);
+    if (participant->voiceActivity == activity)
         return;
+    participant->voiceActivity = activity;
+    bool speakerChanged;
+    {
+        std::lock_guard lkSpeakers(speakersMtx_);
+        speakerChanged = speakers_.onVoice(streamId, activity, clock::now());
     }
+#ifdef ENABLE_VIDEO
+    updateForwarding();
+    if (speakerChanged)
+        followDominantSpeaker();
+#endif
+    sendConferenceInfos(); // also emits signal to client
+}
 
-    if (not newState and previousState) {
-        // voice going from active to inactive
-        streamsVoiceActive.erase(streamId);
-        updateVoiceActivity();
+void
+Conference::onAudioLevel(const std::string& streamId, AudioLevel level)
+{
+    {
+        std::lock_guard lk(speakersMtx_);
+        if (not speakers_.onLevel(streamId, level, clock::now()))
+            return;
+    }
+    runOnMainThread([w = weak()] {
+        if (auto shared = w.lock())
+            shared->updateSpeakers();
+    });
+}
+
+std::optional<bool>
+Conference::reportedVoiceActivity(std::string_view streamId) const
+{
+    std::lock_guard lk(speakersMtx_);
+    if (not speakers_.reportsLevels(streamId))
+        return {};
+    return speakers_.isSpeaking(streamId);
+}
+
+void
+Conference::updateSpeakers()
+{
+    updateVoiceActivity();
+#ifdef ENABLE_VIDEO
+    followDominantSpeaker();
+#endif
+}
+
+#ifdef ENABLE_VIDEO
+void
+Conference::followDominantSpeaker()
+{
+    if (!videoMixer_ or activeStreamPinned_
+        or videoMixer_->getVideoLayout() == video::Layout::GRID)
+        return;
+    std::string dominant;
+    {
+        std::lock_guard lk(speakersMtx_);
+        dominant = speakers_.dominant();
+    }
+    if (dominant.empty() or videoMixer_->verifyActive(dominant))
         return;
+    JAMI_DEBUG("[conf:{}] Dominant speaker: {}", id_, dominant);
+    videoMixer_->setActiveStream(dominant);
+}
+#endif
+
+bool
+Conference::participantVoiceActivity(const ParticipantInfo& participant)
+{
+    if (auto reported = reportedVoiceActivity(participant.sinkId))
+        return *reported;
+    if (auto call = getCallWith(std::string(string_remove_suffix(participant.uri, '@')),
+                                participant.device)) {
+        // if this participant is in a direct call with us
+        // grab voice activity info directly from the call
+        return call->hasPeerVoice();
     }
+    // check for it
+    return isVoiceActive(participant.sinkId);
 }
 
 void
@@ -1287,24 +1565,67 @@ Conference::updateVoiceActivity()
 {
     std::lock_guard lk(confInfoMutex_);
 
-    // streamId is actually sinkId
-    for (ParticipantInfo& participantInfo : confInfo_) {
-        bool newActivity;
-
-        if (auto call = getCallWith(std::string(string_remove_suffix(participantInfo.uri, '@')),
-                                    participantInfo.device)) {
-            // if this participant is in a direct call with us
-            // grab voice activity info directly from the call
-            newActivity = call->hasPeerVoice();
-        } else {
-            // check for it
-            newActivity = isVoiceActive(participantInfo.sinkId);
+    // Voice activity of the participants in a direct call with us,
+    // collected once instead of looking up the call of each participant
+    std::map<std::string, bool> callsVoice;
+    for (const auto& p : getSubCalls()) {
+        if (auto call = std::dynamic_pointer_cast<SIPCall>(getCall(p))) {
+            if (auto* transport = call->getTransport())
+                callsVoice.emplace(participantKey(string_remove_suffix(call->getPeerNumber(), '@'),
+                                                  transport->deviceId(),
+                                                  {}),
+                                   call->hasPeerVoice());
         }
+    }
 
-        if (participantInfo.voiceActivity != newActivity) {
-            participantInfo.voiceActivity = newActivity;
+    // streamId is actually sinkId
+    bool changed = false;
+    bool speakerChanged = false;
+    {
+        std::lock_guard lkSpeakers(speakersMtx_);
+        auto now = clock::now();
+        std::vector<std::string_view> sinks;
+        sinks.reserve(confInfo_.size());
+        for (ParticipantInfo& participantInfo : confInfo_) {
+            bool newActivity;
+
+            if (speakers_.reportsLevels(participantInfo.sinkId)) {
+                // the participant sends its audio levels
+                newActivity = speakers_.isSpeaking(participantInfo.sinkId).value_or(false);
+            } else {
+                auto it = callsVoice.find(
+                    participantKey(string_remove_suffix(participantInfo.uri, '@'),
+                                   participantInfo.device,
+                                   {}));
+                if (it != callsVoice.end()) {
+                    // if this participant is in a direct call with us
+                    // grab voice activity info directly from the call
+                    newActivity = it->second;
+                } else {
+                    // check for it
+                    newActivity = isVoiceActive(participantInfo.sinkId);
+                }
+                if (not participantInfo.sinkId.empty())
+                    speakerChanged |= speakers_.onVoice(participantInfo.sinkId, newActivity, now);
+            }
+            sinks.emplace_back(participantInfo.sinkId);
+
+            if (participantInfo.voiceActivity != newActivity) {
+                participantInfo.voiceActivity = newActivity;
+                changed = true;
+            }
         }
+        speakerChanged |= speakers_.retainVoiceStreams(sinks);
     }
+#ifdef ENABLE_VIDEO
+    if (speakerChanged)
+        followDominantSpeaker();
+#endif
+    if (not changed)
+        return;
+#ifdef ENABLE_VIDEO
+    updateForwarding();
+#endif
     sendConferenceInfos(); // also emits signal to client
 }
 
@@ -1507,6 +1828,9 @@ Conference::updateConferenceInfo(ConfInfo confInfo)
 {
     std::lock_guard lk(confInfoMutex_);
     confInfo_ = std::move(confInfo);
+#ifdef ENABLE_VIDEO
+    updateForwarding();
+#endif
     sendConferenceInfos();
 }
 
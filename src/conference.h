@@ -24,7 +24,10 @@
 #include "config.h"
 #endif
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 #include <memory>
@@ -34,7 +37,9 @@
 #include <functional>
 
 #include "conference_protocol.h"
+#include "scheduled_executor.h"
 #include "media/audio/audio_input.h"
+#include "media/audio/audio_level.h"
 #include "media/media_attribute.h"
 #include "media/recordable.h"
 
@@ -56,6 +61,7 @@ class Account;
 #ifdef ENABLE_VIDEO
 namespace video {
 class VideoMixer;
+class VideoForwarder;
 }
 #endif
 
@@ -183,7 +189,20 @@ struct ConfInfo : public std::vector<ParticipantInfo>
     friend bool operator!=(const ConfInfo& c1, const ConfInfo& c2) { return !(c1 == c2); }
 
     std::vector<std::map<std::string, std::string>> toVectorMapStringString() const;
+    Json::Value toJson() const;
     std::string toString() const;
+
+    /**
+     * Describe the changes from base to this info: participants added or
+     * modified in "p", identifiers (uri, device, sinkId) of the removed ones
+     * in "removed", plus the conference properties.
+     * @return a null value if nothing changed
+     */
+    Json::Value deltaFrom(const ConfInfo& base) const;
+    /**
+     * Apply a delta produced by deltaFrom() on the base it was computed from.
+     */
+    void applyDelta(const Json::Value& delta);
 };
 
 using CallIdSet = std::set<std::string>;
@@ -318,6 +337,10 @@ public:
 #ifdef ENABLE_VIDEO
     void createSinks(const ConfInfo& infos);
     std::shared_ptr<video::VideoMixer> getVideoMixer();
+    /**
+     * @return the forwarder used instead of mixing video, if enabled for the account
+     */
+    std::shared_ptr<video::VideoForwarder> getVideoForwarder() const { return videoForwarder_; }
     std::string getVideoInput() const;
 #endif
 
@@ -332,6 +355,11 @@ public:
     void hangupParticipant(const std::string& accountUri, const std::string& deviceId = "");
     void setHandRaised(const std::string& uri, const bool& state);
     void setVoiceActivity(const std::string& streamId, const bool& newState);
+    /**
+     * Audio level sent by a participant, called from the receiving thread.
+     * @param streamId  sink of the participant
+     */
+    void onAudioLevel(const std::string& streamId, AudioLevel level);
 
     void muteParticipant(const std::string& uri, const bool& state);
     void muteLocalHost(bool is_muted, const std::string& mediaType);
@@ -411,13 +439,44 @@ private:
     mutable std::mutex confInfoMutex_ {};
     ConfInfo confInfo_ {};
 
+    /**
+     * Conference information last sent to a sub-call. Peers announcing
+     * delta support only receive what changed since that version.
+     */
+    struct PeerConfInfo
+    {
+        bool delta {false};
+        // 0 if nothing was sent yet: next update is a full snapshot
+        uint64_t version {0};
+        ConfInfo info {};
+    };
+    std::map<std::string, PeerConfInfo> peersConfInfo_ {};
+    uint64_t confInfoVersion_ {0};
+    clock::time_point lastConfInfoSent_ {clock::time_point::min()};
+    std::shared_ptr<Task> confInfoTask_ {};
+
+    /**
+     * Schedule sending conference information to peers and client.
+     * Updates are coalesced so that they are sent at most once per
+     * CONF_INFO_MIN_INTERVAL. Must be called with confInfoMutex_ locked.
+     */
     void sendConferenceInfos();
+    void flushConferenceInfos();
+    bool participantVoiceActivity(const ParticipantInfo& participant);
     std::shared_ptr<RingBuffer> ghostRingBuffer_;
 
 #ifdef ENABLE_VIDEO
     bool videoEnabled_;
     std::shared_ptr<video::VideoMixer> videoMixer_;
+    std::shared_ptr<video::VideoForwarder> videoForwarder_;
     std::map<std::string, std::shared_ptr<video::SinkClient>> confSinksMap_ {};
+
+    /**
+     * Forward to each participant the most important other stream:
+     * the active stream, then the participants speaking.
+     * Must be called with confInfoMutex_ locked.
+     */
+    void updateForwarding();
 #endif
 
     std::shared_ptr<jami::AudioInput> audioMixer_;
@@ -428,6 +487,25 @@ private:
     // stream IDs
     std::set<std::string, std::less<>> streamsVoiceActive {};
 
+    // Who is speaking, from the audio levels sent by the participants,
+    // or their voice activity otherwise. Locked after confInfoMutex_.
+    mutable std::mutex speakersMtx_;
+    ActiveSpeakerDetector speakers_;
+    /**
+     * @return the voice activity of the stream according to its audio
+     * levels, if the participant sends them
+     */
+    std::optional<bool> reportedVoiceActivity(std::string_view streamId) const;
+    void updateSpeakers();
+#ifdef ENABLE_VIDEO
+    // A moderator chose the active stream: don't follow the dominant speaker
+    std::atomic_bool activeStreamPinned_ {false};
+    /**
+     * With a layout showing an active stream, make the dominant speaker active.
+     */
+    void followDominantSpeaker();
+#endif
+
     void initRecorder(std::shared_ptr<MediaRecorder>& rec);
     void deinitRecorder(std::shared_ptr<MediaRecorder>& rec);
 
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "config_writer.h"
+
+#include "scheduled_executor.h"
+#include "fileutils.h"
+#include "logger.h"
+
+#include <dhtnet/fileutils.h>
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace jami {
+
+struct ConfigWriter::State
+{
+    State(ScheduledExecutor& e, std::chrono::milliseconds d)
+        : executor(e)
+        , delay(d)
+    {}
+
+    void write();
+
+    ScheduledExecutor& executor;
+    const std::chrono::milliseconds delay;
+
+    std::mutex mtx;
+    std::filesystem::path path;
+    // Dirty sections, in the order they were saved
+    std::vector<std::pair<std::string, Serializer>> pending;
+    std::shared_ptr<Task> task;
+
+    // Held while serializing and writing, so that the owner can wait for
+    // a write in progress before going away
+    std::mutex writeMtx;
+    std::vector<std::pair<std::string, std::string>> sections;
+    std::size_t lastHash {0};
+    std::filesystem::path lastPath;
+};
+
+void
+ConfigWriter::State::write()
+{
+    std::lock_guard lkw(writeMtx);
+    std::filesystem::path dest;
+    decltype(pending) dirty;
+    {
+        std::lock_guard lk(mtx);
+        if (pending.empty())
+            return;
+        dirty = std::exchange(pending, {});
+        if (task) {
+            task->cancel();
+            task.reset();
+        }
+        dest = path;
+    }
+    if (dest.empty())
+        return;
+
+    for (auto& [name, serializer] : dirty) {
+        auto it = std::find_if(sections.begin(), sections.end(), [&](const auto& s) {
+            return s.first == name;
+        });
+        if (it == sections.end())
+            it = sections.emplace(sections.end(), name, std::string {});
+        try {
+            it->second = serializer();
+        } catch (const std::exception& e) {
+            // Keep the last content of this section
+            JAMI_ERROR("Unable to serialize configuration section '{}' for {}: {}",
+                       name,
+                       dest,
+                       e.what());
+        }
+    }
+
+    std::string content;
+    for (const auto& s : sections)
+        content += s.second;
+
+    auto hash = std::hash<std::string> {}(content);
+    if (hash == lastHash and dest == lastPath and std::filesystem::is_regular_file(dest))
+        return;
+
+    std::error_code ec;
+    if (not std::filesystem::is_directory(dest.parent_path(), ec)) {
+        // The owner (e.g. a removed account) is gone with its directory
+        JAMI_DEBUG("Skipping configuration write to {}: no such directory", dest);
+        return;
+    }
+
+    {
+        std::lock_guard lock(dhtnet::fileutils::getFileLock(dest));
+        if (not fileutils::replaceFileSync(dest, content)) {
+            JAMI_ERROR("Error saving configuration to {}", dest);
+            return;
+        }
+    }
+    lastHash = hash;
+    lastPath = std::move(dest);
+    JAMI_DEBUG("Saved configuration to {}", lastPath);
+}
+
+ConfigWriter::ConfigWriter(ScheduledExecutor& executor, std::chrono::milliseconds delay)
+    : state_(std::make_shared<State>(executor, delay))
+{}
+
+ConfigWriter::~ConfigWriter()
+{
+    flush();
+    cancel();
+}
+
+void
+ConfigWriter::save(const std::filesystem::path& path,
+                   const std::string& section,
+                   Serializer serializer)
+{
+    std::lock_guard lk(state_->mtx);
+    state_->path = path;
+    auto it = std::find_if(state_->pending.begin(), state_->pending.end(), [&](const auto& s) {
+        return s.first == section;
+    });
+    if (it != state_->pending.end())
+        it->second = std::move(serializer);
+    else
+        state_->pending.emplace_back(section, std::move(serializer));
+    // Trailing write, delayed from the first change rather than the last
+    // one, so that a stream of changes can't postpone it indefinitely
+    if (not state_->task) {
+        state_->task = state_->executor.scheduleIn(
+            [w = std::weak_ptr<State>(state_)] {
+                if (auto state = w.lock())
+                    state->write();
+            },
+            state_->delay);
+    }
+}
+
+void
+ConfigWriter::flush()
+{
+    state_->write();
+}
+
+void
+ConfigWriter::cancel()
+{
+    std::lock_guard lkw(state_->writeMtx);
+    std::lock_guard lk(state_->mtx);
+    state_->pending.clear();
+    if (state_->task) {
+        state_->task->cancel();
+        state_->task.reset();
+    }
+}
+
+} // namespace jami
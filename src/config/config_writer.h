@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace jami {
+
+class ScheduledExecutor;
+
+/**
+ * Debounced, asynchronous writer for a configuration file.
+ *
+ * The file is the concatenation of named sections, in the order they were
+ * first saved. save() only marks a section dirty: serializers run at most
+ * once per delay on the executor, whatever the number of save() calls in
+ * between, and only for the dirty sections; the others keep their last
+ * content. The file is replaced atomically and durably (see
+ * fileutils::replaceFileSync), and left untouched when its content did not
+ * change since the last write.
+ */
+class ConfigWriter
+{
+public:
+    /**
+     * Produces the content of a section. Runs on the executor: it must only
+     * use a snapshot taken by the caller of save(), or take the locks that
+     * protect the data it reads.
+     */
+    using Serializer = std::function<std::string()>;
+
+    static constexpr std::chrono::milliseconds DEFAULT_DELAY {500};
+
+    ConfigWriter(ScheduledExecutor& executor, std::chrono::milliseconds delay = DEFAULT_DELAY);
+
+    /**
+     * Write any pending change, then stop.
+     */
+    ~ConfigWriter();
+
+    /**
+     * Mark section dirty and schedule a write to path. serializer replaces
+     * any pending serializer of the same section.
+     */
+    void save(const std::filesystem::path& path, const std::string& section, Serializer serializer);
+
+    /**
+     * Write now, on the caller thread, if there is a pending change.
+     */
+    void flush();
+
+    /**
+     * Drop any pending change (e.g. the file is about to be removed).
+     */
+    void cancel();
+
+private:
+    NON_COPYABLE(ConfigWriter);
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace jami
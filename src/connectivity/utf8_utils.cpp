@@ -22,6 +22,7 @@
 
 #include <cstring>
 #include <cassert>
+#include <cstdint>
 #include "connectivity/utf8_utils.h"
 
 #if defined(_MSC_VER)
@@ -29,6 +30,37 @@
 using ssize_t = SSIZE_T;
 #endif
 
+/*
+ * Vectorized validation is compiled for every x86 target with GCC/Clang and
+ * selected at runtime (AVX2, then SSE4.1). MSVC only gets it when the whole
+ * build already targets AVX2. AArch64 always has NEON.
+ *
+ * The ISA-specific helpers carry their target attribute; the generic
+ * algorithm is force-inlined into a per-target entry point so that vectors
+ * never cross a call between functions compiled for different ISAs.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define UTF8_SIMD_X86 1
+#define UTF8_TARGET_AVX2  __attribute__((target("avx2")))
+#define UTF8_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define UTF8_FLATTEN      __attribute__((flatten))
+#define UTF8_INLINE       inline __attribute__((always_inline))
+#include <immintrin.h>
+/* the generic code is only ever inlined into a matching target, the ABI note is moot */
+#pragma GCC diagnostic ignored "-Wpsabi"
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#define UTF8_SIMD_X86 1
+#define UTF8_TARGET_AVX2
+#define UTF8_FLATTEN
+#define UTF8_INLINE __forceinline
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define UTF8_SIMD_NEON 1
+#define UTF8_FLATTEN __attribute__((flatten))
+#define UTF8_INLINE  inline __attribute__((always_inline))
+#include <arm_neon.h>
+#endif
+
 /*
  * The LIKELY and UNLIKELY macros let the programmer give hints to
  * the compiler about the expected result of an expression. Some compilers
@@ -64,6 +96,19 @@ namespace jami {
 
 bool utf8_validate_c_str(const char* str, ssize_t max_len, const char** end);
 
+/*
+ * True if the 8 bytes at @p are all ASCII and none of them is nul.
+ */
+static inline bool
+is_ascii_word(const char* p)
+{
+    constexpr uint64_t ONES = 0x0101010101010101ull;
+    constexpr uint64_t HIGHS = 0x8080808080808080ull;
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return ((w | ((w - ONES) & ~w)) & HIGHS) == 0;
+}
+
 static const char*
 fast_validate(const char* str)
 {
@@ -132,7 +177,14 @@ fast_validate_len(const char* str, ssize_t max_len)
 
     assert(max_len >= 0);
 
-    for (p = str; ((p - str) < max_len) && *p; p++) {
+    for (p = str;; p++) {
+        /* skip runs of non-nul ASCII a word at a time */
+        while (max_len - (p - str) >= 8 && is_ascii_word(p))
+            p += 8;
+
+        if ((p - str) >= max_len || !*p)
+            break;
+
         if (*(unsigned char*) p < 128)
             /* done */;
         else {
@@ -193,6 +245,311 @@ fast_validate_len(const char* str, ssize_t max_len)
     return p;
 }
 
+#if defined(UTF8_SIMD_X86) || defined(UTF8_SIMD_NEON)
+
+/*
+ * Vectorized validation, after Keiser & Lemire, "Validating UTF-8 In Less
+ * Than One Instruction Per Byte" (2021).
+ *
+ * Every byte is classified together with the byte before it through three
+ * 16-entry nibble lookups; ANDing the lookups leaves a bit set for each
+ * error kind the pair exhibits. Third and fourth bytes of long sequences
+ * are checked separately by looking two and three bytes back. Runs of pure
+ * ASCII only need the sign bits tested, 32 bytes per iteration.
+ */
+namespace simd {
+
+constexpr uint8_t TOO_SHORT = 1 << 0;  /* lead byte or ASCII after a lead byte */
+constexpr uint8_t TOO_LONG = 1 << 1;   /* continuation after ASCII */
+constexpr uint8_t OVERLONG_3 = 1 << 2; /* E0 80..9F */
+constexpr uint8_t TOO_LARGE = 1 << 3;  /* F4 90..BF, F5..FF */
+constexpr uint8_t SURROGATE = 1 << 4;  /* ED A0..BF */
+constexpr uint8_t OVERLONG_2 = 1 << 5; /* C0, C1 */
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6; /* F0 80..8F */
+constexpr uint8_t TWO_CONTS = 1 << 7;  /* continuation after continuation */
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+/* Indexed by the high nibble of the first byte */
+alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+/* Indexed by the low nibble of the first byte */
+alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+/* Indexed by the high nibble of the second byte */
+alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+/*
+ * A block is incomplete when one of its last three bytes starts a sequence
+ * that does not fit: the last byte may not be >= C0, the one before it
+ * >= E0, the one before that >= F0. Read the last vector-sized window.
+ */
+alignas(32) constexpr uint8_t INCOMPLETE_MAX[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+
+constexpr size_t BLOCK = 32;
+
+#ifdef UTF8_SIMD_X86
+#ifdef UTF8_TARGET_SSE41
+struct Sse41
+{
+    using vec = __m128i;
+    static constexpr size_t SIZE = 16;
+
+    UTF8_TARGET_SSE41 static inline vec load(const uint8_t* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    UTF8_TARGET_SSE41 static inline vec table(const uint8_t* t) { return load(t); }
+    UTF8_TARGET_SSE41 static inline vec splat(uint8_t v) { return _mm_set1_epi8((char) v); }
+    UTF8_TARGET_SSE41 static inline vec zero() { return _mm_setzero_si128(); }
+    UTF8_TARGET_SSE41 static inline vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+    UTF8_TARGET_SSE41 static inline vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+    UTF8_TARGET_SSE41 static inline vec xor_(vec a, vec b) { return _mm_xor_si128(a, b); }
+    UTF8_TARGET_SSE41 static inline vec subs(vec a, vec b) { return _mm_subs_epu8(a, b); }
+    UTF8_TARGET_SSE41 static inline vec high_nibble(vec a)
+    {
+        return _mm_and_si128(_mm_srli_epi16(a, 4), splat(0x0f));
+    }
+    UTF8_TARGET_SSE41 static inline vec lookup(vec t, vec idx) { return _mm_shuffle_epi8(t, idx); }
+    template<int N>
+    UTF8_TARGET_SSE41 static inline vec prev(vec input, vec prevInput)
+    {
+        return _mm_alignr_epi8(input, prevInput, 16 - N);
+    }
+    UTF8_TARGET_SSE41 static inline bool is_ascii(vec a) { return _mm_movemask_epi8(a) == 0; }
+    UTF8_TARGET_SSE41 static inline bool any(vec a) { return !_mm_testz_si128(a, a); }
+};
+#endif
+
+struct Avx2
+{
+    using vec = __m256i;
+    static constexpr size_t SIZE = 32;
+
+    UTF8_TARGET_AVX2 static inline vec load(const uint8_t* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    UTF8_TARGET_AVX2 static inline vec table(const uint8_t* t)
+    {
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+    }
+    UTF8_TARGET_AVX2 static inline vec splat(uint8_t v) { return _mm256_set1_epi8((char) v); }
+    UTF8_TARGET_AVX2 static inline vec zero() { return _mm256_setzero_si256(); }
+    UTF8_TARGET_AVX2 static inline vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+    UTF8_TARGET_AVX2 static inline vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+    UTF8_TARGET_AVX2 static inline vec xor_(vec a, vec b) { return _mm256_xor_si256(a, b); }
+    UTF8_TARGET_AVX2 static inline vec subs(vec a, vec b) { return _mm256_subs_epu8(a, b); }
+    UTF8_TARGET_AVX2 static inline vec high_nibble(vec a)
+    {
+        return _mm256_and_si256(_mm256_srli_epi16(a, 4), splat(0x0f));
+    }
+    UTF8_TARGET_AVX2 static inline vec lookup(vec t, vec idx) { return _mm256_shuffle_epi8(t, idx); }
+    template<int N>
+    UTF8_TARGET_AVX2 static inline vec prev(vec input, vec prevInput)
+    {
+        /* alignr works per 128-bit lane: feed it the lane straddling both inputs */
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prevInput, input, 0x21), 16 - N);
+    }
+    UTF8_TARGET_AVX2 static inline bool is_ascii(vec a) { return _mm256_movemask_epi8(a) == 0; }
+    UTF8_TARGET_AVX2 static inline bool any(vec a) { return !_mm256_testz_si256(a, a); }
+};
+#endif
+
+#ifdef UTF8_SIMD_NEON
+struct Neon
+{
+    using vec = uint8x16_t;
+    static constexpr size_t SIZE = 16;
+
+    static inline vec load(const uint8_t* p) { return vld1q_u8(p); }
+    static inline vec table(const uint8_t* t) { return vld1q_u8(t); }
+    static inline vec splat(uint8_t v) { return vdupq_n_u8(v); }
+    static inline vec zero() { return vdupq_n_u8(0); }
+    static inline vec or_(vec a, vec b) { return vorrq_u8(a, b); }
+    static inline vec and_(vec a, vec b) { return vandq_u8(a, b); }
+    static inline vec xor_(vec a, vec b) { return veorq_u8(a, b); }
+    static inline vec subs(vec a, vec b) { return vqsubq_u8(a, b); }
+    static inline vec high_nibble(vec a) { return vshrq_n_u8(a, 4); }
+    static inline vec lookup(vec t, vec idx) { return vqtbl1q_u8(t, idx); }
+    template<int N>
+    static inline vec prev(vec input, vec prevInput)
+    {
+        return vextq_u8(prevInput, input, 16 - N);
+    }
+    static inline bool is_ascii(vec a) { return vmaxvq_u8(a) < 0x80; }
+    static inline bool any(vec a) { return vmaxvq_u8(a) != 0; }
+};
+#endif
+
+template<class V>
+struct Validator
+{
+    using vec = typename V::vec;
+    static constexpr size_t PER_BLOCK = BLOCK / V::SIZE;
+
+    vec error;
+    vec prevInput;
+    vec prevIncomplete;
+    const vec byte1High;
+    const vec byte1Low;
+    const vec byte2High;
+    const vec incompleteMax;
+
+    UTF8_INLINE Validator()
+        : error(V::zero())
+        , prevInput(V::zero())
+        , prevIncomplete(V::zero())
+        , byte1High(V::table(BYTE_1_HIGH))
+        , byte1Low(V::table(BYTE_1_LOW))
+        , byte2High(V::table(BYTE_2_HIGH))
+        , incompleteMax(V::load(INCOMPLETE_MAX + sizeof(INCOMPLETE_MAX) - V::SIZE))
+    {}
+
+    UTF8_INLINE void check(const vec& input)
+    {
+        vec prev1 = V::template prev<1>(input, prevInput);
+        vec special = V::and_(V::and_(V::lookup(byte1High, V::high_nibble(prev1)),
+                                      V::lookup(byte1Low, V::and_(prev1, V::splat(0x0f)))),
+                              V::lookup(byte2High, V::high_nibble(input)));
+        /* only bytes two or three after a E0..FF lead must be continuations */
+        vec third = V::subs(V::template prev<2>(input, prevInput), V::splat(0xe0 - 0x80));
+        vec fourth = V::subs(V::template prev<3>(input, prevInput), V::splat(0xf0 - 0x80));
+        vec must23 = V::and_(V::or_(third, fourth), V::splat(0x80));
+        error = V::or_(error, V::xor_(must23, special));
+        prevInput = input;
+    }
+
+    UTF8_INLINE void block(const uint8_t* p)
+    {
+        vec in[PER_BLOCK];
+        vec all = V::zero();
+        for (size_t i = 0; i < PER_BLOCK; ++i) {
+            in[i] = V::load(p + i * V::SIZE);
+            all = V::or_(all, in[i]);
+        }
+        if (LIKELY(V::is_ascii(all))) {
+            /* a sequence started in the previous block cannot end in ASCII */
+            error = V::or_(error, prevIncomplete);
+            prevIncomplete = V::zero();
+            prevInput = in[PER_BLOCK - 1];
+            return;
+        }
+        for (size_t i = 0; i < PER_BLOCK; ++i)
+            check(in[i]);
+        prevIncomplete = V::subs(prevInput, incompleteMax);
+    }
+
+    UTF8_INLINE bool validate(const uint8_t* data, size_t len)
+    {
+        size_t i = 0;
+        for (; i + BLOCK <= len; i += BLOCK)
+            block(data + i);
+        if (i < len) {
+            /* zero padding is ASCII, so a truncated sequence is still caught */
+            alignas(32) uint8_t tail[BLOCK] = {};
+            std::memcpy(tail, data + i, len - i);
+            block(tail);
+        }
+        return !V::any(V::or_(error, prevIncomplete));
+    }
+};
+
+#ifdef UTF8_SIMD_X86
+#ifdef UTF8_TARGET_SSE41
+UTF8_TARGET_SSE41 UTF8_FLATTEN static bool
+validate_sse41(const uint8_t* data, size_t len)
+{
+    return Validator<Sse41>().validate(data, len);
+}
+#endif
+
+UTF8_TARGET_AVX2 UTF8_FLATTEN static bool
+validate_avx2(const uint8_t* data, size_t len)
+{
+    return Validator<Avx2>().validate(data, len);
+}
+#else
+UTF8_FLATTEN static bool
+validate_neon(const uint8_t* data, size_t len)
+{
+    return Validator<Neon>().validate(data, len);
+}
+#endif
+
+using ValidateFn = bool (*)(const uint8_t*, size_t);
+
+/* nullptr when the CPU has no usable vector extension */
+static ValidateFn
+pick()
+{
+#if defined(UTF8_SIMD_X86) && defined(UTF8_TARGET_SSE41)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return &validate_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return &validate_sse41;
+    return nullptr;
+#elif defined(UTF8_SIMD_X86)
+    return &validate_avx2;
+#else
+    return &validate_neon;
+#endif
+}
+
+} // namespace simd
+
+#endif
+
+/*
+ * Validate exactly @len bytes, nul bytes included.
+ */
+static bool
+validate_len(const char* str, size_t len)
+{
+#if defined(UTF8_SIMD_X86) || defined(UTF8_SIMD_NEON)
+    static const simd::ValidateFn validate = simd::pick();
+    if (validate)
+        return validate(reinterpret_cast<const uint8_t*>(str), len);
+#endif
+    return fast_validate_len(str, len) == str + len;
+}
+
 /**
  * utf8_validate_c_str:
  * @str: a pointer to character data
@@ -238,59 +595,50 @@ utf8_validate_c_str(const char* str, ssize_t max_len, const char** end)
 
 bool
 utf8_validate(std::string_view str)
+{
+    /* as with C strings, validation stops at the first nul byte */
+    if (auto nul = std::memchr(str.data(), '\0', str.size()))
+        str = str.substr(0, static_cast<const char*>(nul) - str.data());
+
+    return validate_len(str.data(), str.size());
+}
+
+bool
+utf8_validate_fallback(std::string_view str)
 {
     const char* p = fast_validate_len(str.data(), str.size());
 
-    return (*p == '\0');
+    return p == str.data() + str.size() || *p == '\0';
 }
 
 std::string
 utf8_make_valid(std::string_view name)
 {
+    if (validate_len(name.data(), name.size())
+        && !std::memchr(name.data(), '\0', name.size()))
+        return std::string(name);
+
     ssize_t remaining_bytes = name.size();
-    ssize_t valid_bytes;
     const char* remainder = name.data();
     const char* invalid;
-    char* str = NULL;
-    char* pos;
+    std::string answer;
+    answer.reserve(name.size() + 8);
 
     while (remaining_bytes != 0) {
         if (utf8_validate_c_str(remainder, remaining_bytes, &invalid))
             break;
 
-        valid_bytes = invalid - remainder;
-
-        if (str == NULL)
-            // If every byte is replaced by U+FFFD, max(strlen(string)) == 3 * name.size()
-            str = new char[3 * remaining_bytes];
-
-        pos = str;
-
-        strncpy(pos, remainder, valid_bytes);
-        pos += valid_bytes;
-
+        answer.append(remainder, invalid - remainder);
         /* append U+FFFD REPLACEMENT CHARACTER */
-        pos[0] = '\357';
-        pos[1] = '\277';
-        pos[2] = '\275';
+        answer.append("\357\277\275");
 
-        pos += 3;
-
-        remaining_bytes -= valid_bytes + 1;
+        remaining_bytes -= invalid - remainder + 1;
         remainder = invalid + 1;
     }
 
-    if (str == NULL)
-        return std::string(name);
-
-    strncpy(pos, remainder, remaining_bytes);
-    pos += remaining_bytes;
-
-    std::string answer(str, pos - str);
+    answer.append(remainder, remaining_bytes);
     assert(utf8_validate(answer));
 
-    delete[] str;
-
     return answer;
 }
 
@@ -24,6 +24,7 @@
 
 #include <cstdlib>
 #include <string>
+#include <string_view>
 
 namespace jami {
 
@@ -37,11 +38,20 @@ namespace jami {
  * network should be checked with utf8_validate() before doing anything else
  * with it.
  *
+ * Validation stops at the first nul byte. Uses SSE4.1, AVX2 or NEON when
+ * the CPU supports them.
+ *
  * Returns: true if the text was valid UTF-8
  */
 
 bool utf8_validate(std::string_view str);
 
+/**
+ * Same as utf8_validate(), always using the scalar implementation.
+ * Exposed for tests and benchmarks.
+ */
+bool utf8_validate_fallback(std::string_view str);
+
 /**
  * utf8_make_valid:
  * @name: a pointer to a nul delimited string.
@@ -24,6 +24,7 @@
 #include "fileutils.h"
 #include "manager.h"
 #include "client/ring_signal.h"
+#include "vcard.h"
 
 #include <mutex>
 #include <cstdlib> // mkstemp
@@ -577,12 +578,14 @@ TransferManager::onIncomingProfile(const std::shared_ptr<dhtnet::ChannelSocket>&
                         std::lock_guard lock(dhtnet::fileutils::getFileLock(destPath));
                         dhtnet::fileutils::recursive_mkdir(destPath.parent_path());
                         std::filesystem::rename(path, destPath);
+                        vCard::utils::invalidateProfile(destPath);
                         if (!pimpl->accountUri_.empty() && uri == pimpl->accountUri_) {
                             // If this is the account profile, link or copy it to the account profile path
                             if (!fileutils::createFileLink(pimpl->accountProfilePath_, destPath)) {
                                 std::error_code ec;
                                 std::filesystem::copy_file(destPath, pimpl->accountProfilePath_, ec);
                             }
+                            vCard::utils::invalidateProfile(pimpl->accountProfilePath_);
                         }
                     } catch (const std::exception& e) {
                         JAMI_ERROR("{}", e.what());
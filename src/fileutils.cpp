@@ -37,6 +37,7 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 #include "string_utils.h"
 #endif
 
@@ -73,6 +74,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <limits>
+#include <climits>
 #include <array>
 
 #include <cstdlib>
@@ -308,6 +310,82 @@ saveFile(const std::filesystem::path& path,
 #endif
 }
 
+bool
+writeFileSync(const std::filesystem::path& path, std::string_view data, bool append)
+{
+#ifdef _WIN32
+    int fd = _wopen(path.c_str(),
+                    _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC),
+                    _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0600);
+#endif
+    if (fd < 0) {
+        JAMI_ERROR("Unable to open {}: {}", path, strerror(errno));
+        return false;
+    }
+    auto ok = true;
+    while (!data.empty()) {
+#ifdef _WIN32
+        auto n = _write(fd, data.data(), static_cast<unsigned>(std::min<size_t>(data.size(), INT_MAX)));
+#else
+        auto n = ::write(fd, data.data(), data.size());
+#endif
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        data.remove_prefix(n);
+    }
+#ifdef _WIN32
+    ok = ok && _commit(fd) == 0;
+    ok = _close(fd) == 0 && ok;
+#else
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+#endif
+    if (!ok)
+        JAMI_ERROR("Unable to write {}: {}", path, strerror(errno));
+    return ok;
+}
+
+bool
+syncDirectory(const std::filesystem::path& dir)
+{
+#ifdef _WIN32
+    // NTFS journals renames, directories can't be opened for flushing
+    return true;
+#else
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    auto ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool
+replaceFileSync(const std::filesystem::path& path, std::string_view data)
+{
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    if (!writeFileSync(tmpPath, data))
+        return false;
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        JAMI_ERROR("Unable to replace {}: {}", path, ec.message());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    if (!syncDirectory(path.parent_path()))
+        JAMI_WARNING("Unable to sync directory of {}", path);
+    return true;
+}
+
 std::vector<uint8_t>
 loadCacheFile(const std::filesystem::path& path, std::chrono::system_clock::duration maxAge)
 {
@@ -332,11 +410,37 @@ loadCacheTextFile(const std::filesystem::path& path, std::chrono::system_clock::
     return loadTextFile(path);
 }
 
+static std::vector<uint8_t>
+archiveKey(std::string_view scheme, const std::string& pwd, std::vector<uint8_t>& salt)
+{
+    if (scheme == ARCHIVE_AUTH_SCHEME_KEY)
+        return base64::decode(pwd);
+    if (scheme == ARCHIVE_AUTH_SCHEME_PASSWORD)
+        // Same derivation as dht::crypto::aesGetKey, generates the salt if empty
+        return dht::crypto::stretchKey(pwd, salt, 256 / 8);
+    throw std::runtime_error("Unsupported archive scheme");
+}
+
 ArchiveStorageData
 readArchive(const std::filesystem::path& path, std::string_view scheme, const std::string& pwd)
 {
     JAMI_LOG("Reading archive from {} with scheme '{}'", path, scheme);
 
+    if (!pwd.empty() && archiver::isStream(path)) {
+        ArchiveStorageData ret;
+        try {
+            ret.salt = archiver::streamSalt(path);
+            auto key = archiveKey(scheme, pwd, ret.salt);
+            archiver::readStream(path, key, [&](const uint8_t* data, size_t size) {
+                ret.data.insert(ret.data.end(), data, data + size);
+            });
+        } catch (const std::exception& e) {
+            JAMI_ERROR("Error decrypting archive: {}", e.what());
+            throw;
+        }
+        return ret;
+    }
+
     auto isUnencryptedGzip = [](const std::vector<uint8_t>& data) {
         // NOTE: some webserver modify gzip files and this can end with a gunzip in a gunzip
         // file. So, to make the readArchive more robust, we can support this case by detecting
@@ -398,8 +502,91 @@ readArchive(const std::filesystem::path& path, std::string_view scheme, const st
     return ret;
 }
 
-void
-writeArchive(const std::string& archive_str,
+namespace {
+/**
+ * Buffers what is written to an ostream and hands it to an archive stream.
+ */
+class ArchiveStreamBuf : public std::streambuf
+{
+public:
+    ArchiveStreamBuf(archiver::StreamWriter& writer)
+        : writer_(writer)
+        , buffer_(64 * 1024)
+    {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        flushBuffer();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        flushBuffer();
+        return 0;
+    }
+
+private:
+    void flushBuffer()
+    {
+        writer_.write(reinterpret_cast<const uint8_t*>(pbase()), pptr() - pbase());
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    archiver::StreamWriter& writer_;
+    std::vector<char> buffer_;
+};
+
+bool
+isEncryptedArchive(std::string_view scheme, const std::string& password)
+{
+    return scheme == ARCHIVE_AUTH_SCHEME_KEY
+           or (scheme == ARCHIVE_AUTH_SCHEME_PASSWORD and not password.empty());
+}
+} // namespace
+
+bool
+writeArchive(std::string_view archive_str,
+             const std::filesystem::path& path,
+             std::string_view scheme,
+             const std::string& password,
+             const std::vector<uint8_t>& password_salt,
+             bool legacy)
+{
+    if (legacy and isEncryptedArchive(scheme, password)) {
+        JAMI_LOG("Writing archive to {} (legacy format)", path);
+        try {
+            std::string str(archive_str);
+            if (scheme == ARCHIVE_AUTH_SCHEME_KEY) {
+                saveFile(path,
+                         dht::crypto::aesBuildEncrypted(
+                             dht::crypto::aesEncrypt(archiver::compress(str), base64::decode(password)),
+                             password_salt));
+            } else {
+                saveFile(path, dht::crypto::aesEncrypt(archiver::compress(str), password, password_salt));
+            }
+        } catch (const std::exception& ex) {
+            JAMI_ERROR("Export failed: {}", ex.what());
+            return false;
+        }
+        return true;
+    }
+    return writeArchive([&](std::ostream& os) { os.write(archive_str.data(), archive_str.size()); },
+                 path,
+                 scheme,
+                 password,
+                 password_salt);
+}
+
+bool
+writeArchive(const std::function<void(std::ostream&)>& writer,
              const std::filesystem::path& path,
              std::string_view scheme,
              const std::string& password,
@@ -407,28 +594,34 @@ writeArchive(const std::string& archive_str,
 {
     JAMI_LOG("Writing archive to {}", path);
 
-    if (scheme == ARCHIVE_AUTH_SCHEME_KEY) {
-        // Encrypt using provided key
+    if (isEncryptedArchive(scheme, password)) {
+        // Encrypt using provided key or password, chunk by chunk
         try {
-            auto key = base64::decode(password);
-            auto newArchive = dht::crypto::aesEncrypt(archiver::compress(archive_str), key);
-            saveFile(path, dht::crypto::aesBuildEncrypted(newArchive, password_salt));
-        } catch (const std::runtime_error& ex) {
+            auto salt = password_salt;
+            auto key = archiveKey(scheme, password, salt);
+            archiver::StreamWriter stream(path, std::move(key), salt);
+            ArchiveStreamBuf buf(stream);
+            std::ostream os(&buf);
+            os.exceptions(std::ios::badbit);
+            writer(os);
+            os.flush();
+            stream.close();
+        } catch (const std::exception& ex) {
             JAMI_ERROR("Export failed: {}", ex.what());
-            return;
+            return false;
         }
-    } else if (scheme == ARCHIVE_AUTH_SCHEME_PASSWORD and not password.empty()) {
-        // Encrypt using provided password
+    } else {
+        JAMI_WARNING("Unsecured archiving (no password)");
         try {
-            saveFile(path, dht::crypto::aesEncrypt(archiver::compress(archive_str), password, password_salt));
-        } catch (const std::runtime_error& ex) {
+            std::ostringstream os;
+            writer(os);
+            archiver::compressGzip(os.str(), path.string());
+        } catch (const std::exception& ex) {
             JAMI_ERROR("Export failed: {}", ex.what());
-            return;
+            return false;
         }
-    } else {
-        JAMI_WARNING("Unsecured archiving (no password)");
-        archiver::compressGzip(archive_str, path.string());
     }
+    return true;
 }
 
 std::filesystem::path
@@ -26,6 +26,8 @@
 #include <cstdio>
 #include <ios>
 #include <filesystem>
+#include <functional>
+#include <ostream>
 #include <string_view>
 
 #ifndef _WIN32
@@ -110,6 +112,27 @@ saveFile(const std::filesystem::path& path, const std::vector<uint8_t>& data, mo
     saveFile(path, data.data(), data.size(), mode);
 }
 
+/**
+ * Write data to path and flush it to the disk before returning
+ * @param append    Append to the file instead of replacing its content
+ * @return false on error
+ */
+bool writeFileSync(const std::filesystem::path& path, std::string_view data, bool append = false);
+
+/**
+ * Flush the entries of a directory (created, renamed files) to the disk.
+ * No-op where directories can't be synced.
+ */
+bool syncDirectory(const std::filesystem::path& dir);
+
+/**
+ * Replace the content of path with data, so that a crash leaves either the
+ * old or the new content: data is written and flushed to a temporary file,
+ * renamed over path, then the directory is flushed.
+ * @return false on error, path is then left untouched
+ */
+bool replaceFileSync(const std::filesystem::path& path, std::string_view data);
+
 std::vector<uint8_t> loadCacheFile(const std::filesystem::path& path,
                                    std::chrono::system_clock::duration maxAge);
 std::string loadCacheTextFile(const std::filesystem::path& path, std::chrono::system_clock::duration maxAge);
@@ -122,9 +145,30 @@ struct ArchiveStorageData {
     std::vector<uint8_t> data;
     std::vector<uint8_t> salt;
 };
+/**
+ * Read an archive in any format. The plain archive is returned as a whole,
+ * since it is parsed as a single JSON document.
+ */
 ArchiveStorageData readArchive(const std::filesystem::path& path, std::string_view scheme, const std::string& pwd);
 
-void writeArchive(const std::string& data,
+/**
+ * Write an archive. Encrypted archives are written as chunked streams
+ * (see archiver::StreamWriter), unless legacy is set: the archive is then
+ * written as a single encrypted block, readable by older versions.
+ * @return false on error
+ */
+bool writeArchive(std::string_view data,
+                  const std::filesystem::path& path,
+                  std::string_view scheme,
+                  const std::string& password = {}, const std::vector<uint8_t>& password_salt = {},
+                  bool legacy = false);
+
+/**
+ * Write an archive as a chunked stream, with the plain data produced by writer,
+ * so that it is encrypted chunk by chunk as it is serialized.
+ * @return false on error
+ */
+bool writeArchive(const std::function<void(std::ostream&)>& writer,
                   const std::filesystem::path& path,
                   std::string_view scheme,
                   const std::string& password = {}, const std::vector<uint8_t>& password_salt = {});
@@ -132,7 +176,12 @@ void writeArchive(const std::string& data,
 int64_t size(const std::filesystem::path& path);
 
 std::string sha3File(const std::filesystem::path& path);
-std::string sha3sum(const std::vector<uint8_t>& buffer);
+std::string sha3sum(const uint8_t* data, size_t size);
+inline std::string
+sha3sum(const std::vector<uint8_t>& buffer)
+{
+    return sha3sum(buffer.data(), buffer.size());
+}
 
 /**
  * Windows compatibility wrapper for checking read-only attribute
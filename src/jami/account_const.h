@@ -117,6 +117,7 @@ constexpr static const char SENDREADRECEIPT[] = "Account.sendReadReceipt";
 constexpr static const char SENDCOMPOSING[] = "Account.sendComposing";
 constexpr static const char ISRENDEZVOUS[] = "Account.rendezVous";
 constexpr static const char ACTIVE_CALL_LIMIT[] = "Account.activeCallLimit";
+constexpr static const char CONFERENCE_FORWARDING[] = "Account.conferenceForwarding";
 constexpr static const char HOSTNAME[] = "Account.hostname";
 constexpr static const char USERNAME[] = "Account.username";
 constexpr static const char BIND_ADDRESS[] = "Account.bindAddress";
@@ -121,6 +121,17 @@ LIBJAMI_PUBLIC std::vector<libjami::MediaMap> currentMediaList(const std::string
                                                            const std::string& callId);
 LIBJAMI_PUBLIC std::vector<std::map<std::string, std::string>> getConferenceInfos(
     const std::string& accountId, const std::string& confId);
+
+/**
+ * Media pipeline latency of a call, one map per stream and stage. Keys are
+ * "streamId", "mediaType", "stage", "count", "mean", "p50", "p90", "p99"
+ * and "max", durations are in microseconds.
+ * Send stages: "capture_to_encode", "encode", "capture_to_send"
+ * Receive stages: "decode", "decode_to_render", "receive_to_render"
+ */
+LIBJAMI_PUBLIC std::vector<std::map<std::string, std::string>> getCallLatencyStats(
+    const std::string& accountId, const std::string& callId);
+LIBJAMI_PUBLIC void resetCallLatencyStats(const std::string& accountId, const std::string& callId);
 LIBJAMI_PUBLIC void setModerator(const std::string& accountId,
                                const std::string& confId,
                                const std::string& accountUri,
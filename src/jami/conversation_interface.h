@@ -167,6 +167,14 @@ struct LIBJAMI_PUBLIC ConversationSignal
                              const std::string& /* conversationId */,
                              const SwarmMessage& /*message*/);
     };
+    // Batched SwarmMessageReceived, see setSignalBatchInterval
+    struct LIBJAMI_PUBLIC SwarmMessagesReceived
+    {
+        constexpr static const char* name = "SwarmMessagesReceived";
+        using cb_type = void(const std::string& /*accountId*/,
+                             const std::string& /* conversationId */,
+                             std::vector<SwarmMessage> /*messages*/);
+    };
     struct LIBJAMI_PUBLIC SwarmMessageUpdated
     {
         constexpr static const char* name = "SwarmMessageUpdated";
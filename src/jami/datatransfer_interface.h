@@ -173,6 +173,15 @@ struct LIBJAMI_PUBLIC DataTransferSignal
                              const std::string& fileId,
                              int eventCode);
     };
+    // Batched DataTransferEvent, see setSignalBatchInterval.
+    // Each event has the keys "interactionId", "fileId" and "eventCode".
+    struct LIBJAMI_PUBLIC DataTransferEvents
+    {
+        constexpr static const char* name = "DataTransferEvents";
+        using cb_type = void(const std::string& accountId,
+                             const std::string& conversationId,
+                             std::vector<std::map<std::string, std::string>> events);
+    };
 };
 
 } // namespace libjami
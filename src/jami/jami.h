@@ -24,6 +24,7 @@
 #include "def.h"
 
 #include <vector>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <map>
@@ -270,6 +271,18 @@ LIBJAMI_PUBLIC void registerSignalHandlers(
     const std::map<std::string, std::shared_ptr<CallbackWrapperBase>>&);
 LIBJAMI_PUBLIC void unregisterSignalHandlers();
 
+/**
+ * Enable batched delivery of high-frequency signals.
+ * Signals having a batched counterpart (e.g. SwarmMessageReceived and
+ * SwarmMessagesReceived) are coalesced and delivered at most once per
+ * interval, per account and conversation, if a handler is registered for
+ * the batched signal. A null interval (default) disables batching.
+ * Pending items of a conversation are delivered before any other signal
+ * about it (edition, reaction, member event...), when batching is disabled
+ * and when the daemon stops.
+ */
+LIBJAMI_PUBLIC void setSignalBatchInterval(std::chrono::milliseconds interval);
+
 using MediaMap = std::map<std::string, std::string>;
 
 } // namespace libjami
@@ -24,6 +24,8 @@
 
 #include <json/json.h>
 
+#include <sstream>
+
 namespace jami {
 
 void
@@ -110,6 +112,14 @@ AccountArchive::deserialize(const std::vector<uint8_t>& dat, const std::vector<u
 
 std::string
 AccountArchive::serialize() const
+{
+    std::ostringstream os;
+    serialize(os);
+    return os.str();
+}
+
+void
+AccountArchive::serialize(std::ostream& os) const
 {
     Json::Value root;
 
@@ -149,7 +159,8 @@ AccountArchive::serialize() const
     Json::StreamWriterBuilder wbuilder;
     wbuilder["commentStyle"] = "None";
     wbuilder["indentation"] = "";
-    return Json::writeString(wbuilder, root);
+    std::unique_ptr<Json::StreamWriter> writer(wbuilder.newStreamWriter());
+    writer->write(root, &os);
 }
 
 } // namespace jami
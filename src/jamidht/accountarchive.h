@@ -66,6 +66,7 @@ struct AccountArchive
 
     /** Serialize structured archive data to memory. */
     std::string serialize() const;
+    void serialize(std::ostream& os) const;
 
     /** Deserialize archive from memory. */
     void deserialize(const std::vector<uint8_t>& data, const std::vector<uint8_t>& salt);
@@ -76,9 +77,15 @@ struct AccountArchive
         deserialize(data.data, data.salt);
     }
 
-    /** Save archive to file, optionally encrypted with provided password. */
-    void save(const std::filesystem::path& path, std::string_view scheme, const std::string& password) const {
-        fileutils::writeArchive(serialize(), path, scheme, password, password_salt);
+    /**
+     * Save archive to file, optionally encrypted with provided password.
+     * @param legacy  use the single-block format readable by older versions (exports)
+     * @return false on error
+     */
+    bool save(const std::filesystem::path& path, std::string_view scheme, const std::string& password, bool legacy = false) const {
+        if (legacy)
+            return fileutils::writeArchive(serialize(), path, scheme, password, password_salt, true);
+        return fileutils::writeArchive([this](std::ostream& os) { serialize(os); }, path, scheme, password, password_salt);
     }
 };
 
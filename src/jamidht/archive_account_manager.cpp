@@ -655,11 +655,11 @@ std::vector<uint8_t>
 ArchiveAccountManager::getPasswordKey(const std::string& password)
 {
     try {
-        auto data = dhtnet::fileutils::loadFile(fileutils::getFullPath(path_, archivePath_));
         // Try to decrypt to check if password is valid
-        auto key = dht::crypto::aesGetKey(data, password);
-        auto decrypted = dht::crypto::aesDecrypt(dht::crypto::aesGetEncrypted(data), key);
-        return key;
+        auto data = fileutils::readArchive(fileutils::getFullPath(path_, archivePath_),
+                                           fileutils::ARCHIVE_AUTH_SCHEME_PASSWORD,
+                                           password);
+        return dht::crypto::stretchKey(password, data.salt, 256 / 8);
     } catch (const std::exception& e) {
         JAMI_ERR("Error loading archive: %s", e.what());
     }
@@ -789,10 +789,8 @@ ArchiveAccountManager::exportArchive(const std::string& destinationPath, std::st
         auto archivePath = fileutils::getFullPath(path_, archivePath_);
         archive.save(archivePath, scheme, password);
 
-        // Export the file
-        std::error_code ec;
-        std::filesystem::copy_file(archivePath, destinationPath, std::filesystem::copy_options::overwrite_existing, ec);
-        return !ec;
+        // Export in the legacy format, so that older versions can import it
+        return archive.save(destinationPath, scheme, password, true);
     } catch (const std::runtime_error& ex) {
         JAMI_ERR("[Auth] Can't export archive: %s", ex.what());
         return false;
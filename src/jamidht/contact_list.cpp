@@ -19,6 +19,7 @@
 #include "logger.h"
 #include "jamiaccount.h"
 #include "fileutils.h"
+#include "kv_store.h"
 
 #include "manager.h"
 #ifdef ENABLE_PLUGIN
@@ -36,7 +37,10 @@ ContactList::ContactList(const std::string& accountId,
                          const std::shared_ptr<crypto::Certificate>& cert,
                          const std::filesystem::path& path,
                          OnChangeCallback cb)
-    : path_(path)
+    : contactsStore_(KvStore::open(path / "contacts"))
+    , trustRequestsStore_(KvStore::open(path / "incomingTrustRequests"))
+    , knownDevicesStore_(KvStore::open(path / "knownDevices"))
+    , path_(path)
     , callbacks_(std::move(cb))
     , accountId_(accountId)
 {
@@ -101,7 +105,7 @@ ContactList::addContact(const dht::InfoHash& h, bool confirmed, const std::strin
     c->second.confirmed |= confirmed;
     auto hStr = h.toString();
     trust_->setCertificateStatus(hStr, dhtnet::tls::TrustStore::PermissionStatus::ALLOWED);
-    saveContacts();
+    saveContact(h);
     callbacks_.contactAdded(hStr, c->second.confirmed);
     return true;
 }
@@ -112,7 +116,7 @@ ContactList::updateConversation(const dht::InfoHash& h, const std::string& conve
     auto c = contacts_.find(h);
     if (c != contacts_.end() && c->second.conversationId != conversationId) {
         c->second.conversationId = conversationId;
-        saveContacts();
+        saveContact(h);
     }
 }
 
@@ -132,8 +136,8 @@ ContactList::removeContact(const dht::InfoHash& h, bool ban)
                                 ban ? dhtnet::tls::TrustStore::PermissionStatus::BANNED
                                     : dhtnet::tls::TrustStore::PermissionStatus::UNDEFINED);
     if (trustRequests_.erase(h) > 0)
-        saveTrustRequests();
-    saveContacts();
+        saveTrustRequest(h);
+    saveContact(h);
     lk.unlock();
 #ifdef ENABLE_PLUGIN
     auto filename = path_.filename().string();
@@ -153,7 +157,7 @@ ContactList::removeContactConversation(const dht::InfoHash& h)
     if (c == contacts_.end())
         return false;
     c->second.conversationId = "";
-    saveContacts();
+    saveContact(h);
     return true;
 }
 
@@ -211,7 +215,7 @@ ContactList::updateContact(const dht::InfoHash& id, const Contact& contact, bool
         {
             std::lock_guard lk(mutex_);
             if (trustRequests_.erase(id) > 0)
-                saveTrustRequests();
+                saveTrustRequest(id);
         }
         if (c->second.isActive()) {
             trust_->setCertificateStatus(id.toString(), dhtnet::tls::TrustStore::PermissionStatus::ALLOWED);
@@ -230,18 +234,7 @@ ContactList::updateContact(const dht::InfoHash& id, const Contact& contact, bool
 void
 ContactList::loadContacts()
 {
-    decltype(contacts_) contacts;
-    try {
-        // read file
-        auto file = fileutils::loadFile("contacts", path_);
-        // load values
-        msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
-        oh.get().convert(contacts);
-    } catch (const std::exception& e) {
-        JAMI_WARN("[Contacts] error loading contacts: %s", e.what());
-        return;
-    }
-
+    auto contacts = contactsStore_->load<dht::InfoHash, Contact>();
     for (auto& peer : contacts)
         updateContact(peer.first, peer.second, false);
 }
@@ -249,36 +242,41 @@ ContactList::loadContacts()
 void
 ContactList::saveContacts() const
 {
-    std::ofstream file(path_ / "contacts", std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, contacts_);
+    contactsStore_->assign(contacts_);
+}
+
+void
+ContactList::saveContact(const dht::InfoHash& h) const
+{
+    auto c = contacts_.find(h);
+    if (c != contacts_.end())
+        contactsStore_->put(h, c->second);
+    else
+        contactsStore_->erase(h);
 }
 
 void
 ContactList::saveTrustRequests() const
 {
     // mutex_ MUST BE locked
-    std::ofstream file(path_ / "incomingTrustRequests",
-                       std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, trustRequests_);
+    trustRequestsStore_->assign(trustRequests_);
 }
 
 void
-ContactList::loadTrustRequests()
+ContactList::saveTrustRequest(const dht::InfoHash& from) const
 {
-    if (!std::filesystem::is_regular_file(fileutils::getFullPath(path_, "incomingTrustRequests")))
-        return;
-    std::map<dht::InfoHash, TrustRequest> requests;
-    try {
-        // read file
-        auto file = fileutils::loadFile("incomingTrustRequests", path_);
-        // load values
-        msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
-        oh.get().convert(requests);
-    } catch (const std::exception& e) {
-        JAMI_WARN("[Contacts] error loading trust requests: %s", e.what());
-        return;
-    }
+    // mutex_ MUST BE locked
+    auto r = trustRequests_.find(from);
+    if (r != trustRequests_.end())
+        trustRequestsStore_->put(from, r->second);
+    else
+        trustRequestsStore_->erase(from);
+}
 
+void
+ContactList::loadTrustRequests()
+{
+    auto requests = trustRequestsStore_->load<dht::InfoHash, TrustRequest>();
     for (auto& tr : requests)
         onTrustRequest(tr.first,
                        tr.second.device,
@@ -337,7 +335,7 @@ ContactList::onTrustRequest(const dht::InfoHash& peer_account,
                          peer_account.toString().c_str());
             }
         }
-        saveTrustRequests();
+        saveTrustRequest(peer_account);
     }
     lk.unlock();
     // Note: call JamiAccount's callback to build ConversationRequest anyway
@@ -399,7 +397,7 @@ ContactList::acceptTrustRequest(const dht::InfoHash& from)
     auto convId =  i->second.conversationId;
     // Clear trust request
     trustRequests_.erase(i);
-    saveTrustRequests();
+    saveTrustRequest(from);
     lk.unlock();
     addContact(from, true, convId);
     return true;
@@ -417,7 +415,7 @@ ContactList::discardTrustRequest(const dht::InfoHash& from)
 {
     std::lock_guard lk(mutex_);
     if (trustRequests_.erase(from) > 0) {
-        saveTrustRequests();
+        saveTrustRequest(from);
         return true;
     }
     return false;
@@ -427,13 +425,9 @@ void
 ContactList::loadKnownDevices()
 {
     try {
-        // read file
-        auto file = fileutils::loadFile("knownDevices", path_);
-        // load values
-        msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
-
-        std::map<dht::PkId, std::pair<std::string, uint64_t>> knownDevices;
-        oh.get().convert(knownDevices);
+        if (knownDevicesStore_->empty())
+            throw std::runtime_error("no known devices");
+        auto knownDevices = knownDevicesStore_->load<dht::PkId, std::pair<std::string, uint64_t>>();
         for (const auto& d : knownDevices) {
             if (auto crt = jami::Manager::instance().certStore(accountId_).getCertificate(d.first.toString())) {
                 if (not foundAccountDevice(crt, d.second.first, clock::from_time_t(d.second.second)))
@@ -468,14 +462,25 @@ ContactList::loadKnownDevices()
 void
 ContactList::saveKnownDevices() const
 {
-    std::ofstream file(path_ / "knownDevices", std::ios::trunc | std::ios::binary);
-
     std::map<dht::PkId, std::pair<std::string, uint64_t>> devices;
     for (const auto& id : knownDevices_)
         devices.emplace(id.first,
                         std::make_pair(id.second.name, clock::to_time_t(id.second.last_sync)));
 
-    msgpack::pack(file, devices);
+    knownDevicesStore_->assign(devices);
+}
+
+void
+ContactList::saveKnownDevice(const dht::PkId& device) const
+{
+    auto dev = knownDevices_.find(device);
+    if (dev != knownDevices_.end())
+        knownDevicesStore_->put(device,
+                                std::make_pair(dev->second.name,
+                                               static_cast<uint64_t>(
+                                                   clock::to_time_t(dev->second.last_sync))));
+    else
+        knownDevicesStore_->erase(device);
 }
 
 void
@@ -487,7 +492,7 @@ ContactList::foundAccountDevice(const dht::PkId& device,
     auto it = knownDevices_.emplace(device, KnownDevice {{}, name, updated});
     if (it.second) {
         JAMI_DBG("[Contacts] Found account device: %s %s", name.c_str(), device.toString().c_str());
-        saveKnownDevices();
+        saveKnownDevice(device);
         callbacks_.devicesChanged(knownDevices_);
     } else {
         // update device name
@@ -496,7 +501,7 @@ ContactList::foundAccountDevice(const dht::PkId& device,
                      name.c_str(),
                      device.toString().c_str());
             it.first->second.name = name;
-            saveKnownDevices();
+            saveKnownDevice(device);
             callbacks_.devicesChanged(knownDevices_);
         }
     }
@@ -533,14 +538,14 @@ ContactList::foundAccountDevice(const std::shared_ptr<dht::crypto::Certificate>&
                 trust_->setCertificateStatus(crt, dhtnet::tls::TrustStore::PermissionStatus::BANNED, false);
             }
         }
-        saveKnownDevices();
+        saveKnownDevice(id);
         callbacks_.devicesChanged(knownDevices_);
     } else {
         // update device name
         if (not name.empty() and it.first->second.name != name) {
             JAMI_DBG("[Contacts] updating device name: %s %s", name.c_str(), id.to_c_str());
             it.first->second.name = name;
-            saveKnownDevices();
+            saveKnownDevice(id);
             callbacks_.devicesChanged(knownDevices_);
         }
     }
@@ -551,7 +556,7 @@ bool
 ContactList::removeAccountDevice(const dht::PkId& device)
 {
     if (knownDevices_.erase(device) > 0) {
-        saveKnownDevices();
+        saveKnownDevice(device);
         return true;
     }
     return false;
@@ -564,7 +569,7 @@ ContactList::setAccountDeviceName(const dht::PkId& device, const std::string& na
     if (dev != knownDevices_.end()) {
         if (dev->second.name != name) {
             dev->second.name = name;
-            saveKnownDevices();
+            saveKnownDevice(device);
             callbacks_.devicesChanged(knownDevices_);
         }
     }
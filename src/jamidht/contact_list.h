@@ -31,6 +31,8 @@
 
 namespace jami {
 
+class KvStore;
+
 class ContactList
 {
 public:
@@ -151,6 +153,11 @@ private:
 
     std::map<dht::PkId, KnownDevice> knownDevices_;
 
+    // Persistent storage of contacts_, trustRequests_ and knownDevices_
+    std::shared_ptr<KvStore> contactsStore_;
+    std::shared_ptr<KvStore> trustRequestsStore_;
+    std::shared_ptr<KvStore> knownDevicesStore_;
+
     // Trust store with account main certificate as the only CA
     dht::crypto::TrustList accountTrust_;
     // Trust store for to match peer certificates
@@ -166,9 +173,12 @@ private:
 
     void loadKnownDevices();
     void saveKnownDevices() const;
+    void saveKnownDevice(const dht::PkId& device) const;
 
     /** Should be called only after onTrustRequest */
     void saveTrustRequests() const;
+    void saveTrustRequest(const dht::InfoHash& from) const;
+    void saveContact(const dht::InfoHash& h) const;
 };
 
 } // namespace jami
@@ -23,6 +23,7 @@
 #include "fileutils.h"
 #include "jamiaccount.h"
 #include "client/ring_signal.h"
+#include "vcard.h"
 
 #include <charconv>
 #include <json/json.h>
@@ -1780,6 +1781,7 @@ Conversation::Impl::pull()
             auto changedFiles = repo->changedFiles(diffStats);
             if (find(changedFiles.begin(), changedFiles.end(), "profile.vcf")
                 != changedFiles.end()) {
+                vCard::utils::invalidateProfile(repoPath() / "profile.vcf");
                 emitSignal<libjami::ConversationSignal::ConversationProfileUpdated>(
                     accountId_, repo->id(), repo->infos());
             }
@@ -1894,9 +1896,9 @@ Conversation::updateInfos(const std::map<std::string, std::string>& map, const O
 }
 
 std::map<std::string, std::string>
-Conversation::infos() const
+Conversation::infos(bool includeAvatar) const
 {
-    return pimpl_->repository_->infos();
+    return pimpl_->repository_->infos(includeAvatar);
 }
 
 void
@@ -2537,7 +2539,7 @@ Conversation::hostConference(Json::Value&& message, OnDoneCb&& cb)
 bool
 Conversation::isHosting(const std::string& confId) const
 {
-    auto info = infos();
+    auto info = infos(false);
     if (info["rdvDevice"] == pimpl_->deviceId_ && info["rdvHost"] == pimpl_->userId_)
         return true; // We are the current device Host
     std::lock_guard lk(pimpl_->activeCallsMtx_);
@@ -393,9 +393,10 @@ public:
 
     /**
      * Retrieve current infos (title, description, avatar, mode)
+     * @param includeAvatar     false when the caller does not need the avatar
      * @return infos
      */
-    std::map<std::string, std::string> infos() const;
+    std::map<std::string, std::string> infos(bool includeAvatar = true) const;
     /**
      * Retrieve current preferences (color, notification, etc)
      * @param includeLastModified       If we want to know when the preferences were modified
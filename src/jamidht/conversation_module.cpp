@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <unordered_set>
 
 #include <opendht/thread_pool.h>
 
@@ -31,6 +32,7 @@
 #include "fileutils.h"
 #include "jamidht/account_manager.h"
 #include "jamidht/jamiaccount.h"
+#include "kv_store.h"
 #include "manager.h"
 #include "sip/sipcall.h"
 #include "vcard.h"
@@ -52,6 +54,18 @@ struct PendingConversationFetch
 };
 
 constexpr std::chrono::seconds MAX_FALLBACK {12 * 3600s};
+// Commits announced within this delay after a notification are announced together
+constexpr std::chrono::milliseconds ANNOUNCE_DELAY {300};
+
+struct PendingAnnouncement
+{
+    std::chrono::steady_clock::time_point lastSent {};
+    bool pending {false};
+    bool sync {false};
+    std::string commitId {};
+    std::string deviceId {};
+    std::unique_ptr<asio::steady_timer> timer {};
+};
 
 struct SyncedConversation
 {
@@ -227,6 +241,23 @@ public:
                                  bool sync,
                                  const std::string& commitId = "",
                                  const std::string& deviceId = "");
+    /**
+     * Same as sendMessageNotification, for frequent commits (messages, reactions, edits):
+     * the first commit is announced right away, the following ones, if close enough,
+     * are coalesced in a single notification announcing the last one.
+     */
+    void announceCommit(const std::string& conversationId,
+                        bool sync,
+                        const std::string& commitId,
+                        const std::string& deviceId = "");
+    /**
+     * Called ANNOUNCE_DELAY after a notification: send the coalesced one if any,
+     * else forget the conversation
+     */
+    void flushAnnouncement(const std::string& conversationId);
+    // announcementsMtx_ MUST BE locked
+    void scheduleAnnouncementFlush(const std::string& conversationId,
+                                   PendingAnnouncement& announcement);
 
     /**
      * @return if a convId is a valid conversation (repository cloned & usable)
@@ -242,7 +273,7 @@ public:
     {
         std::lock_guard lk(convInfosMtx_);
         convInfos_[info.id] = info;
-        saveConvInfos();
+        convInfosStore_->put(info.id, info);
     }
 
     std::string getOneToOneConversation(const std::string& uri) const noexcept;
@@ -325,16 +356,15 @@ public:
 
     // The following methods modify what is stored on the disk
     /**
+     * Write the changes made to convInfos_ (for bulk changes, use point updates otherwise)
      * @note convInfosMtx_ should be locked
      */
-    void saveConvInfos() const { ConversationModule::saveConvInfos(accountId_, convInfos_); }
+    void saveConvInfos() const { convInfosStore_->assign(convInfos_); }
     /**
+     * Write the changes made to conversationsRequests_
      * @note conversationsRequestsMtx_ should be locked
      */
-    void saveConvRequests() const
-    {
-        ConversationModule::saveConvRequests(accountId_, conversationsRequests_);
-    }
+    void saveConvRequests() const { convRequestsStore_->assign(conversationsRequests_); }
     void declineOtherConversationWith(const std::string& uri) noexcept;
     bool addConversationRequest(const std::string& id, const ConversationRequest& req)
     {
@@ -353,7 +383,7 @@ public:
         }
         JAMI_DEBUG("Adding conversation request from {} ({})", req.from, id);
         conversationsRequests_[id] = req;
-        saveConvRequests();
+        convRequestsStore_->put(id, req);
         return true;
     }
     void rmConversationRequest(const std::string& id)
@@ -367,8 +397,8 @@ public:
             md["created"] = std::to_string(it->second.received);
         }
         saveMetadatas();
-        conversationsRequests_.erase(id);
-        saveConvRequests();
+        if (conversationsRequests_.erase(id))
+            convRequestsStore_->erase(id);
     }
 
     std::weak_ptr<JamiAccount> account_;
@@ -386,6 +416,7 @@ public:
     // Requests
     mutable std::mutex conversationsRequestsMtx_;
     std::map<std::string, ConversationRequest> conversationsRequests_;
+    std::shared_ptr<KvStore> convRequestsStore_;
 
     // Conversations
     mutable std::mutex conversationsMtx_ {};
@@ -394,6 +425,7 @@ public:
     // The following informations are stored on the disk
     mutable std::mutex convInfosMtx_; // Note, should be locked after conversationsMtx_ if needed
     std::map<std::string, ConvInfo> convInfos_;
+    std::shared_ptr<KvStore> convInfosStore_;
 
     // When sending a new message, we need to send the notification to some peers of the
     // conversation However, the conversation may be not bootstraped, so the list will be empty.
@@ -402,6 +434,10 @@ public:
     std::mutex notSyncedNotificationMtx_;
     std::map<std::string, std::string> notSyncedNotification_;
 
+    std::mutex announcementsMtx_;
+    // Conversations notified less than ANNOUNCE_DELAY ago
+    std::map<std::string, PendingAnnouncement> announcements_;
+
     std::weak_ptr<Impl> weak() { return std::static_pointer_cast<Impl>(shared_from_this()); }
 
     // Replay conversations (after erasing/re-adding)
@@ -412,6 +448,7 @@ public:
 
 #ifdef LIBJAMI_TESTABLE
     std::function<void(std::string, Conversation::BootstrapStatus)> bootstrapCbTest_;
+    std::function<void(std::string, std::string)> commitAnnouncedCbTest_;
 #endif
 
     void fixStructures(
@@ -475,6 +512,9 @@ ConversationModule::Impl::Impl(std::shared_ptr<JamiAccount>&& account,
             deviceId_ = info->deviceId;
             username_ = info->accountId;
         }
+    auto path = fileutils::get_data_dir() / accountId_;
+    convInfosStore_ = KvStore::open(path / "convInfo");
+    convRequestsStore_ = KvStore::open(path / "convRequests");
     conversationsRequests_ = convRequests(accountId_);
     loadMetadatas();
 }
@@ -683,10 +723,10 @@ ConversationModule::Impl::fetchNewCommits(const std::string& peer,
                             conv->pending.reset();
                             // Notify peers that a new commit is there (DRT)
                             if (not commitId.empty() && ok) {
-                                shared->sendMessageNotification(*conv->conversation,
-                                                                false,
-                                                                commitId,
-                                                                deviceId);
+                                shared->announceCommit(conversationId,
+                                                       false,
+                                                       commitId,
+                                                       deviceId);
                             }
                         }
                         if (shared->syncCnt.fetch_sub(1) == 1) {
@@ -1073,6 +1113,88 @@ ConversationModule::Impl::sendMessageNotification(const std::string& conversatio
     }
 }
 
+void
+ConversationModule::Impl::announceCommit(const std::string& conversationId,
+                                         bool sync,
+                                         const std::string& commitId,
+                                         const std::string& deviceId)
+{
+    std::lock_guard lk(announcementsMtx_);
+    auto& announcement = announcements_[conversationId];
+    if (announcement.pending) {
+        // Already scheduled, just announce the latest commit
+        announcement.sync |= sync;
+        announcement.commitId = commitId;
+        if (announcement.deviceId != deviceId)
+            announcement.deviceId.clear();
+        return;
+    }
+    if (announcement.timer) {
+        // Notified less than ANNOUNCE_DELAY ago, wait for the timer
+        announcement.pending = true;
+        announcement.sync = sync;
+        announcement.commitId = commitId;
+        announcement.deviceId = deviceId;
+        return;
+    }
+    announcement.lastSent = std::chrono::steady_clock::now();
+    scheduleAnnouncementFlush(conversationId, announcement);
+#ifdef LIBJAMI_TESTABLE
+    if (commitAnnouncedCbTest_)
+        commitAnnouncedCbTest_(conversationId, commitId);
+#endif
+    dht::ThreadPool::io().run([w = weak(), conversationId, sync, commitId, deviceId] {
+        if (auto sthis = w.lock())
+            sthis->sendMessageNotification(conversationId, sync, commitId, deviceId);
+    });
+}
+
+void
+ConversationModule::Impl::scheduleAnnouncementFlush(const std::string& conversationId,
+                                                    PendingAnnouncement& announcement)
+{
+    if (!announcement.timer)
+        announcement.timer = std::make_unique<asio::steady_timer>(
+            *Manager::instance().ioContext());
+    announcement.timer->expires_at(announcement.lastSent + ANNOUNCE_DELAY);
+    announcement.timer->async_wait([w = weak(), conversationId](const asio::error_code& ec) {
+        if (ec == asio::error::operation_aborted)
+            return;
+        if (auto sthis = w.lock())
+            sthis->flushAnnouncement(conversationId);
+    });
+}
+
+void
+ConversationModule::Impl::flushAnnouncement(const std::string& conversationId)
+{
+    bool sync;
+    std::string commitId, deviceId;
+    {
+        std::lock_guard lk(announcementsMtx_);
+        auto it = announcements_.find(conversationId);
+        if (it == announcements_.end())
+            return;
+        auto& announcement = it->second;
+        if (!announcement.pending) {
+            // Nothing announced during the delay, the next commit is announced right away
+            announcements_.erase(it);
+            return;
+        }
+        announcement.pending = false;
+        announcement.lastSent = std::chrono::steady_clock::now();
+        sync = announcement.sync;
+        commitId = std::move(announcement.commitId);
+        deviceId = std::move(announcement.deviceId);
+        scheduleAnnouncementFlush(conversationId, announcement);
+    }
+#ifdef LIBJAMI_TESTABLE
+    if (commitAnnouncedCbTest_)
+        commitAnnouncedCbTest_(conversationId, commitId);
+#endif
+    sendMessageNotification(conversationId, sync, commitId, deviceId);
+}
+
 void
 ConversationModule::Impl::sendMessageNotification(Conversation& conversation,
                                                   bool sync,
@@ -1111,19 +1233,16 @@ ConversationModule::Impl::sendMessageNotification(Conversation& conversation,
         std::lock_guard lk(notSyncedNotificationMtx_);
         devices = conversation.peersToSyncWith();
         auto members = conversation.memberUris(username_, {MemberRole::BANNED});
-        std::vector<std::string> connectedMembers;
-        // print all members
+        std::unordered_set<std::string> connectedMembers;
+        connectedMembers.reserve(devices.size());
         for (const auto& device : devices) {
-            auto cert = acc->certStore().getCertificate(device.toString());
-            if (cert && cert->issuer)
-                connectedMembers.emplace_back(cert->issuer->getId().toString());
-        }
-        std::sort(std::begin(connectedMembers), std::end(connectedMembers));
-        std::set_difference(members.begin(),
-                            members.end(),
-                            connectedMembers.begin(),
-                            connectedMembers.end(),
-                            std::inserter(nonConnectedMembers, nonConnectedMembers.begin()));
+            auto uri = acc->uriFromDevice(device.toString());
+            if (!uri.empty())
+                connectedMembers.emplace(std::move(uri));
+        }
+        for (auto& member : members)
+            if (connectedMembers.find(member) == connectedMembers.end())
+                nonConnectedMembers.emplace_back(std::move(member));
         std::shuffle(nonConnectedMembers.begin(), nonConnectedMembers.end(), acc->rand);
         if (nonConnectedMembers.size() > 2)
             nonConnectedMembers.resize(2);
@@ -1202,7 +1321,7 @@ ConversationModule::Impl::sendMessage(const std::string& conversationId,
                                   if (!announce)
                                       return;
                                   if (ok)
-                                      sendMessageNotification(conversationId, true, commitId);
+                                      announceCommit(conversationId, true, commitId);
                                   else
                                       JAMI_ERR("Failed to send message to conversation %s",
                                                conversationId.c_str());
@@ -1487,10 +1606,9 @@ ConversationModule::saveConvRequestsToPath(
     const std::filesystem::path& path,
     const std::map<std::string, ConversationRequest>& conversationsRequests)
 {
-    auto p = path / "convRequests";
-    std::lock_guard lock(dhtnet::fileutils::getFileLock(p));
-    std::ofstream file(p, std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, conversationsRequests);
+    auto store = KvStore::open(path / "convRequests");
+    store->assign(conversationsRequests);
+    store->commit();
 }
 
 void
@@ -1504,8 +1622,9 @@ void
 ConversationModule::saveConvInfosToPath(const std::filesystem::path& path,
                                         const ConvInfoMap& conversations)
 {
-    std::ofstream file(path / "convInfo", std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, conversations);
+    auto store = KvStore::open(path / "convInfo");
+    store->assign(conversations);
+    store->commit();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -1547,6 +1666,12 @@ ConversationModule::onBootstrapStatus(
     for (auto& c : pimpl_->getConversations())
         c->onBootstrapStatus(pimpl_->bootstrapCbTest_);
 }
+
+void
+ConversationModule::onCommitAnnounced(const std::function<void(std::string, std::string)>& cb)
+{
+    pimpl_->commitAnnouncedCbTest_ = cb;
+}
 #endif
 
 void
@@ -1657,7 +1782,7 @@ ConversationModule::loadConversations()
                         JAMI_ERROR("Missing conv info for {}. This is a bug!", repository);
                         sconv->info.created = std::time(nullptr);
                         sconv->info.lastDisplayed
-                            = conv->infos()[ConversationMapKeys::LAST_DISPLAYED];
+                            = conv->infos(false)[ConversationMapKeys::LAST_DISPLAYED];
                     } else {
                         sconv->info = convInfo->second;
                         if (convInfo->second.isRemoved()) {
@@ -1916,8 +2041,8 @@ ConversationModule::onTrustRequest(const std::string& uri,
     req.from = uri;
     req.conversationId = conversationId;
     req.received = std::time(nullptr);
-    req.metadatas = ConversationRepository::infosFromVCard(vCard::utils::toMap(
-        std::string_view(reinterpret_cast<const char*>(payload.data()), payload.size())));
+    req.metadatas = ConversationRepository::infosFromVCard(
+        std::string_view(reinterpret_cast<const char*>(payload.data()), payload.size()));
     auto reqMap = req.toMap();
     if (pimpl_->addConversationRequest(conversationId, std::move(req))) {
         lk.unlock();
@@ -2987,7 +3112,7 @@ ConversationModule::call(const std::string& url,
     // So, if confId is specified or if there is some activeCalls
     // or if we are the default host.
     auto activeCalls = conv->conversation->currentCalls();
-    auto infos = conv->conversation->infos();
+    auto infos = conv->conversation->infos(false);
     auto itRdvAccount = infos.find("rdvAccount");
     auto itRdvDevice = infos.find("rdvDevice");
     auto sendCallRequest = false;
@@ -3177,19 +3302,7 @@ ConversationModule::convInfos(const std::string& accountId)
 std::map<std::string, ConvInfo>
 ConversationModule::convInfosFromPath(const std::filesystem::path& path)
 {
-    std::map<std::string, ConvInfo> convInfos;
-    try {
-        // read file
-        std::lock_guard lock(dhtnet::fileutils::getFileLock(path / "convInfo"));
-        auto file = fileutils::loadFile("convInfo", path);
-        // load values
-        msgpack::unpacked result;
-        msgpack::unpack(result, (const char*) file.data(), file.size());
-        result.get().convert(convInfos);
-    } catch (const std::exception& e) {
-        JAMI_WARN("[convInfo] error loading convInfo: %s", e.what());
-    }
-    return convInfos;
+    return KvStore::open(path / "convInfo")->load<std::string, ConvInfo>();
 }
 
 std::map<std::string, ConversationRequest>
@@ -3202,19 +3315,7 @@ ConversationModule::convRequests(const std::string& accountId)
 std::map<std::string, ConversationRequest>
 ConversationModule::convRequestsFromPath(const std::filesystem::path& path)
 {
-    std::map<std::string, ConversationRequest> convRequests;
-    try {
-        // read file
-        std::lock_guard lock(dhtnet::fileutils::getFileLock(path / "convRequests"));
-        auto file = fileutils::loadFile("convRequests", path);
-        // load values
-        msgpack::unpacked result;
-        msgpack::unpack(result, (const char*) file.data(), file.size(), 0);
-        result.get().convert(convRequests);
-    } catch (const std::exception& e) {
-        JAMI_WARN("[convInfo] error loading convInfo: %s", e.what());
-    }
-    return convRequests;
+    return KvStore::open(path / "convRequests")->load<std::string, ConversationRequest>();
 }
 
 void
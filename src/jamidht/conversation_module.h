@@ -35,6 +35,24 @@ static constexpr const char MIME_TYPE_GIT[] {"application/im-gitmessage-id"};
 
 class SIPCall;
 
+/**
+ * Anti-entropy summary of the synced state, used by SyncModule to only send
+ * what differs between two devices. Hashes are computed on the msgpack
+ * serialization of each item, keyed by category (the SyncMsg field name).
+ */
+struct SyncDigest
+{
+    // Protocol version, 0 if the peer does not support digests
+    uint8_t v {0};
+    // One hash per category, summarizing all its items
+    std::map<std::string, uint64_t> r;
+    // Hash of each item, for the categories whose root hash differed
+    std::map<std::string, std::map<std::string, uint64_t>> i;
+    // More item hashes follow in the next message
+    bool m {false};
+    MSGPACK_DEFINE_MAP(v, r, i, m)
+};
+
 struct SyncMsg
 {
     DeviceSync ds;
@@ -57,7 +75,9 @@ struct SyncMsg
      * }}
      */
     std::map<std::string, std::map<std::string, std::map<std::string, std::string>>> ms;
-    MSGPACK_DEFINE(ds, c, cr, p, ld, ms)
+    // Appended last, so older peers ignore it
+    SyncDigest dg;
+    MSGPACK_DEFINE(ds, c, cr, p, ld, ms, dg)
 };
 
 using ChannelCb = std::function<bool(const std::shared_ptr<dhtnet::ChannelSocket>&)>;
@@ -92,6 +112,11 @@ public:
 
 #ifdef LIBJAMI_TESTABLE
     void onBootstrapStatus(const std::function<void(std::string, Conversation::BootstrapStatus)>& cb);
+    /**
+     * Called with the conversation and commit IDs each time announceCommit
+     * sends a notification, right away or coalesced
+     */
+    void onCommitAnnounced(const std::function<void(std::string, std::string)>& cb);
 #endif
 
     void monitor();
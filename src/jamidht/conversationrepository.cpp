@@ -26,6 +26,10 @@
 #include "client/ring_signal.h"
 #include "vcard.h"
 
+#include <opendht/thread_pool.h>
+
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
 #include <fstream>
 #include <future>
@@ -33,10 +37,14 @@
 #include <regex>
 #include <exception>
 #include <optional>
+#include <thread>
+#include <unordered_set>
 
 using namespace std::string_view_literals;
 constexpr auto DIFF_REGEX = " +\\| +[0-9]+.*"sv;
 constexpr size_t MAX_FETCH_SIZE {256 * 1024 * 1024}; // 256Mb
+// Below this many commits, checking users on the fetch thread is cheaper than dispatching
+constexpr size_t PARALLEL_VALIDATION_MIN_COMMITS {32};
 
 namespace jami {
 
@@ -144,7 +152,22 @@ public:
                    const std::string& commitId,
                    const std::string& parentId) const;
     bool checkEdit(const std::string& userDevice, const ConversationCommit& commit) const;
-    bool isValidUserAtCommit(const std::string& userDevice, const std::string& commitId) const;
+    /**
+     * Check that userDevice and its member certificate are valid at commitId.
+     * @param repo  repository to read from, opened for the call if null
+     * @param usedPinnedCert  set to true if the result relied on the certificate store
+     */
+    bool isValidUserAtCommit(const std::string& userDevice,
+                             const std::string& commitId,
+                             git_repository* repo = nullptr,
+                             bool* usedPinnedCert = nullptr) const;
+    // Same as isValidUserAtCommit, but successful checks are remembered by commit id,
+    // unless they relied on the certificate store
+    bool isValidUserAtCommitCached(const std::string& userDevice,
+                                   const std::string& commitId,
+                                   git_repository* repo = nullptr) const;
+    // Run isValidUserAtCommitCached for every commit concurrently on the computation pool
+    void prevalidateUsers(const std::vector<ConversationCommit>& commits) const;
     bool checkInitialCommit(const std::string& userDevice,
                             const std::string& commitId,
                             const std::string& commitMsg) const;
@@ -208,6 +231,12 @@ public:
     const std::string deviceId_;
     mutable std::optional<ConversationMode> mode_ {};
 
+    // (commit id, device id) pairs already validated by isValidUserAtCommitCached.
+    // Commits are immutable, so a successful check never needs to be redone during
+    // a validation. Cleared when validCommits returns, so it doesn't grow with history.
+    mutable std::mutex validUsersMtx_ {};
+    mutable std::unordered_set<std::string> validUsers_ {};
+
     // Members utils
     mutable std::mutex membersMtx_ {};
     std::vector<ConversationMember> members_ {};
@@ -309,45 +338,51 @@ public:
 
     /**
      * Retrieve the user related to a device using the account's certificate store.
-     * @note deviceToUri_ is used to cache result and avoid always loading the certificate
+     * @note Devices known by the certificate store are cached account-wide, the ones only
+     * known from this repository's certificates are cached in deviceToUri_
      */
     std::string uriFromDevice(const std::string& deviceId, const std::string& commitId = "") const
     {
+        auto acc = account_.lock();
+        if (!acc)
+            return {};
+
         // Check if we have the device in cache.
+        auto uri = acc->deviceUriCache().get(deviceId);
+        if (!uri.empty())
+            return uri;
         std::lock_guard lk(deviceToUriMtx_);
         auto it = deviceToUri_.find(deviceId);
         if (it != deviceToUri_.end())
             return it->second;
 
-        auto acc = account_.lock();
-        if (!acc)
-            return {};
+        uri = acc->uriFromDevice(deviceId);
+        if (!uri.empty())
+            return uri;
 
-        auto cert = acc->certStore().getCertificate(deviceId);
-        if (!cert || !cert->issuer) {
-            if (!commitId.empty()) {
-                std::string uri = uriFromDeviceAtCommit(deviceId, commitId);
-                if (!uri.empty()) {
-                    deviceToUri_.insert({deviceId, uri});
-                    return uri;
-                }
-            }
-            // Not pinned, so load certificate from repo
-            auto repo = repository();
-            if (!repo)
-                return {};
-            auto deviceFile = std::filesystem::path(git_repository_workdir(repo.get())) / "devices"
-                              / fmt::format("{}.crt", deviceId);
-            if (!std::filesystem::is_regular_file(deviceFile))
-                return {};
-            try {
-                cert = std::make_shared<dht::crypto::Certificate>(fileutils::loadFile(deviceFile));
-            } catch (const std::exception&) {
-                JAMI_WARNING("Could not load certificate from {}", deviceFile);
+        if (!commitId.empty()) {
+            uri = uriFromDeviceAtCommit(deviceId, commitId);
+            if (!uri.empty()) {
+                deviceToUri_.insert({deviceId, uri});
+                return uri;
             }
-            if (!cert)
-                return {};
         }
+        // Not pinned, so load certificate from repo
+        auto repo = repository();
+        if (!repo)
+            return {};
+        auto deviceFile = std::filesystem::path(git_repository_workdir(repo.get())) / "devices"
+                          / fmt::format("{}.crt", deviceId);
+        if (!std::filesystem::is_regular_file(deviceFile))
+            return {};
+        std::shared_ptr<dht::crypto::Certificate> cert;
+        try {
+            cert = std::make_shared<dht::crypto::Certificate>(fileutils::loadFile(deviceFile));
+        } catch (const std::exception&) {
+            JAMI_WARNING("Could not load certificate from {}", deviceFile);
+        }
+        if (!cert)
+            return {};
         auto issuerUid = cert->issuer ? cert->issuer->getId().toString() : cert->getIssuerUID();
         if (issuerUid.empty())
             return {};
@@ -1593,19 +1628,25 @@ ConversationRepository::Impl::checkValidProfileUpdate(const std::string& userDev
 
 bool
 ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
-                                                  const std::string& commitId) const
+                                                  const std::string& commitId,
+                                                  git_repository* repo,
+                                                  bool* usedPinnedCert) const
 {
     auto acc = account_.lock();
     if (!acc)
         return false;
     auto cert = acc->certStore().getCertificate(userDevice);
     auto hasPinnedCert = cert and cert->issuer;
-    auto repo = repository();
+    GitRepository ownRepo {nullptr, git_repository_free};
+    if (not repo) {
+        ownRepo = repository();
+        repo = ownRepo.get();
+    }
     if (not repo)
         return false;
 
     // Retrieve tree for commit
-    auto tree = treeAtCommit(repo.get(), commitId);
+    auto tree = treeAtCommit(repo, commitId);
     if (not tree)
         return false;
 
@@ -1628,6 +1669,8 @@ ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
             // to get the userURI from this certificate.
             // Uses pinned certificate if one.
             userUri = cert->issuer->getId().toString();
+            if (usedPinnedCert)
+                *usedPinnedCert = true;
         }
     }
 
@@ -1644,7 +1687,7 @@ ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
     git_oid oid;
     git_commit* commit_ptr = nullptr;
     if (git_oid_fromstr(&oid, commitId.c_str()) < 0
-        || git_commit_lookup(&commit_ptr, repo.get(), &oid) < 0) {
+        || git_commit_lookup(&commit_ptr, repo, &oid) < 0) {
         JAMI_WARNING("Failed to look up commit {}", commitId);
         return false;
     }
@@ -1668,6 +1711,118 @@ ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
     return res;
 }
 
+bool
+ConversationRepository::Impl::isValidUserAtCommitCached(const std::string& userDevice,
+                                                        const std::string& commitId,
+                                                        git_repository* repo) const
+{
+    // Commit ids have a fixed length, so the concatenation is unambiguous
+    auto key = commitId + userDevice;
+    {
+        std::lock_guard lk(validUsersMtx_);
+        if (validUsers_.find(key) != validUsers_.end())
+            return true;
+    }
+    auto usedPinnedCert = false;
+    if (!isValidUserAtCommit(userDevice, commitId, repo, &usedPinnedCert))
+        return false;
+    // The certificate store may change, unlike the commit
+    if (usedPinnedCert)
+        return true;
+    std::lock_guard lk(validUsersMtx_);
+    validUsers_.emplace(std::move(key));
+    return true;
+}
+
+/**
+ * Commit at which the author of a commit must be a valid member: the commit
+ * itself, or its parent for a member removal, as the author may remove itself.
+ * Mirrors the choice made by validCommits.
+ */
+static const std::string&
+validUserCommit(const ConversationCommit& commit)
+{
+    if (commit.parents.size() == 1 && commit.commit_msg.find("remove") != std::string::npos) {
+        std::string err;
+        Json::Value cm;
+        Json::CharReaderBuilder rbuilder;
+        auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
+        const auto& msg = commit.commit_msg;
+        if (reader->parse(msg.data(), msg.data() + msg.size(), &cm, &err)
+            && cm["type"].asString() == "member" && cm["action"].asString() == "remove")
+            return commit.parents[0];
+    }
+    return commit.id;
+}
+
+void
+ConversationRepository::Impl::prevalidateUsers(const std::vector<ConversationCommit>& commits) const
+{
+    // Only the device and member certificates are checked here: they only depend
+    // on the commit itself, unlike the membership rules which stay sequential in
+    // validCommits. Failures are not remembered, so validCommits reports them.
+    auto workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                    commits.size() / PARALLEL_VALIDATION_MIN_COMMITS);
+    if (workers < 2)
+        return;
+
+    struct State
+    {
+        State(const std::vector<ConversationCommit>& c)
+            : commits(c)
+            , count(c.size())
+        {}
+        const std::vector<ConversationCommit>& commits;
+        const size_t count;
+        std::atomic_size_t next {0};
+        std::mutex mtx {};
+        std::condition_variable cv {};
+        unsigned running {0};
+    };
+    auto state = std::make_shared<State>(commits);
+
+    // libgit2 objects can't be shared across threads, so each participant opens
+    // the repository once and reuses it for every commit it claims.
+    auto work = [this](State& s) {
+        GitRepository repo {nullptr, git_repository_free};
+        for (size_t i; (i = s.next++) < s.count;) {
+            if (not repo and not (repo = repository()))
+                return;
+            const auto& commit = s.commits[i];
+            if (commit.parents.empty())
+                continue; // Initial commit, checked by checkInitialCommit
+            isValidUserAtCommitCached(commit.author.email, validUserCommit(commit), repo.get());
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < workers; ++i) {
+        dht::ThreadPool::computation().run([state, work] {
+            {
+                // Started after all work was claimed: the caller may already
+                // have returned, so neither commits nor this can be touched.
+                std::lock_guard lk(state->mtx);
+                if (state->next >= state->count)
+                    return;
+                ++state->running;
+            }
+            work(*state);
+            std::lock_guard lk(state->mtx);
+            if (--state->running == 0)
+                state->cv.notify_all();
+        });
+    }
+    // Also work from this thread, so progress never depends on the pool being free
+    work(*state);
+    std::unique_lock lk(state->mtx);
+    state->cv.wait(lk, [&] { return state->running == 0; });
+    JAMI_DEBUG("[conv {}] Checked authors of {} commits with {} workers in {}",
+               id_,
+               commits.size(),
+               workers,
+               dht::print_duration(std::chrono::steady_clock::now() - start));
+}
+
 bool
 ConversationRepository::Impl::checkInitialCommit(const std::string& userDevice,
                                                  const std::string& commitId,
@@ -2208,8 +2363,10 @@ ConversationRepository::Impl::forEachCommit(PreConditionCb&& preCondition,
             < 0) {
             JAMI_WARNING("[conv {}] Could not extract signature for commit {}", id_, id);
         } else {
-            cc.signature = base64::decode(
-                std::string(signature.ptr, signature.ptr + signature.size));
+            // decode in place, without an intermediate string
+            cc.signature.resize(base64::decodedMaxSize(signature.size));
+            cc.signature.resize(
+                base64::decode({signature.ptr, signature.size}, cc.signature.data()));
             cc.signed_content = std::vector<uint8_t>(signed_data.ptr,
                                                      signed_data.ptr + signed_data.size);
         }
@@ -2680,6 +2837,17 @@ bool
 ConversationRepository::Impl::validCommits(
     const std::vector<ConversationCommit>& commitsToValidate) const
 {
+    // Authors remembered by prevalidateUsers are only reused by this validation
+    struct ValidUsersReset
+    {
+        const Impl& impl;
+        ~ValidUsersReset()
+        {
+            std::lock_guard lk(impl.validUsersMtx_);
+            impl.validUsers_.clear();
+        }
+    } validUsersReset {*this};
+    prevalidateUsers(commitsToValidate);
     for (const auto& commit : commitsToValidate) {
         auto userDevice = commit.author.email;
         auto validUserAtCommit = commit.id;
@@ -2842,7 +3010,7 @@ ConversationRepository::Impl::validCommits(
             // For all commit, check that user is valid,
             // So that user certificate MUST be in /members or /admins
             // and device cert MUST be in /devices
-            if (!isValidUserAtCommit(userDevice, validUserAtCommit)) {
+            if (!isValidUserAtCommitCached(userDevice, validUserAtCommit)) {
                 JAMI_WARNING(
                     "[conv {}] Malformed commit {}. Please check you use the latest version of Jami, or "
                     "that your contact is not doing unwanted stuff. {}", id_,
@@ -2854,7 +3022,7 @@ ConversationRepository::Impl::validCommits(
             }
         } else {
             // Merge commit, for now, check user
-            if (!isValidUserAtCommit(userDevice, validUserAtCommit)) {
+            if (!isValidUserAtCommitCached(userDevice, validUserAtCommit)) {
                 JAMI_WARNING(
                     "[conv {}] Malformed merge commit {}. Please check you use the latest version of "
                     "Jami, or that your contact is not doing unwanted stuff.", id_,
@@ -3624,6 +3792,16 @@ ConversationRepository::Impl::resolveBan(const std::string_view type, const std:
         return false;
     }
 
+    if (type == "devices") {
+        // Banned device, same as a revocation
+        {
+            std::lock_guard lk(deviceToUriMtx_);
+            deviceToUri_.erase(uri);
+        }
+        if (auto acc = account_.lock())
+            acc->deviceUriCache().invalidate(uri);
+    }
+
     // If members, remove related devices and mark as banned
     if (type != "devices") {
         std::error_code ec;
@@ -3936,6 +4114,7 @@ ConversationRepository::updateInfos(const std::map<std::string, std::string>& pr
     file << vCard::Delimiter::END_LINE_TOKEN;
     file << vCard::Delimiter::END_TOKEN;
     file.close();
+    vCard::utils::invalidateProfile(profilePath);
 
     if (!pimpl_->add("profile.vcf"))
         return {};
@@ -3949,19 +4128,14 @@ ConversationRepository::updateInfos(const std::map<std::string, std::string>& pr
 }
 
 std::map<std::string, std::string>
-ConversationRepository::infos() const
+ConversationRepository::infos(bool includeAvatar) const
 {
     if (auto repo = pimpl_->repository()) {
         try {
             std::filesystem::path repoPath = git_repository_workdir(repo.get());
-            auto profilePath = repoPath / "profile.vcf";
             std::map<std::string, std::string> result;
-            std::error_code ec;
-            if (std::filesystem::is_regular_file(profilePath, ec)) {
-                auto content = fileutils::loadFile(profilePath);
-                result = ConversationRepository::infosFromVCard(vCard::utils::toMap(
-                    std::string_view {(const char*) content.data(), content.size()}));
-            }
+            if (auto profile = vCard::utils::loadProfile(repoPath / "profile.vcf"))
+                result = ConversationRepository::infosFromVCard(profile->content(), includeAvatar);
             result["mode"] = std::to_string(static_cast<int>(mode()));
             return result;
         } catch (...) {
@@ -3971,20 +4145,23 @@ ConversationRepository::infos() const
 }
 
 std::map<std::string, std::string>
-ConversationRepository::infosFromVCard(std::map<std::string, std::string>&& details)
+ConversationRepository::infosFromVCard(std::string_view content, bool includeAvatar)
 {
+    // Only the kept values are copied; the first occurrence of a property wins
     std::map<std::string, std::string> result;
-    for (auto&& [k, v] : details) {
+    std::string_view k, v;
+    while (vCard::utils::nextProperty(content, k, v)) {
         if (k == vCard::Property::FORMATTED_NAME) {
-            result["title"] = std::move(v);
+            result.try_emplace(vCard::Value::TITLE, v);
         } else if (k == vCard::Property::DESCRIPTION) {
-            result["description"] = std::move(v);
+            result.try_emplace(vCard::Value::DESCRIPTION, v);
         } else if (k.find(vCard::Property::PHOTO) == 0) {
-            result["avatar"] = std::move(v);
+            if (includeAvatar)
+                result.try_emplace(vCard::Value::AVATAR, v);
         } else if (k.find(vCard::Property::RDV_ACCOUNT) == 0) {
-            result["rdvAccount"] = std::move(v);
+            result.try_emplace(vCard::Value::RDV_ACCOUNT, v);
         } else if (k.find(vCard::Property::RDV_DEVICE) == 0) {
-            result["rdvDevice"] = std::move(v);
+            result.try_emplace(vCard::Value::RDV_DEVICE, v);
         }
     }
     return result;
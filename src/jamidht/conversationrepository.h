@@ -405,11 +405,12 @@ public:
 
     /**
      * Retrieve current infos (title, description, avatar, mode)
+     * @param includeAvatar     false to skip copying the (potentially large) avatar
      * @return infos
      */
-    std::map<std::string, std::string> infos() const;
-    static std::map<std::string, std::string> infosFromVCard(
-        std::map<std::string, std::string>&& details);
+    std::map<std::string, std::string> infos(bool includeAvatar = true) const;
+    static std::map<std::string, std::string> infosFromVCard(std::string_view content,
+                                                             bool includeAvatar = true);
 
     /**
      * Convert ConversationCommit to MapStringString for the client
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "device_uri_cache.h"
+
+#include <mutex>
+
+namespace jami {
+
+std::string
+DeviceUriCache::get(std::string_view device) const
+{
+    const auto& s = shard(device);
+    std::shared_lock lk(s.mutex);
+    auto it = s.uris.find(std::string(device));
+    return it != s.uris.end() ? it->second : std::string {};
+}
+
+std::string
+DeviceUriCache::resolve(std::string_view device,
+                        const std::function<std::string(const std::string&)>& resolver)
+{
+    auto uri = get(device);
+    if (!uri.empty())
+        return uri;
+    // Resolve without holding the lock, concurrent resolutions give the same result
+    std::string deviceStr(device);
+    uri = resolver(deviceStr);
+    if (!uri.empty())
+        set(deviceStr, uri);
+    return uri;
+}
+
+void
+DeviceUriCache::set(std::string_view device, std::string uri)
+{
+    auto& s = shard(device);
+    std::unique_lock lk(s.mutex);
+    s.uris.insert_or_assign(std::string(device), std::move(uri));
+}
+
+void
+DeviceUriCache::invalidate(std::string_view device)
+{
+    auto& s = shard(device);
+    std::unique_lock lk(s.mutex);
+    s.uris.erase(std::string(device));
+}
+
+void
+DeviceUriCache::invalidateUri(std::string_view uri)
+{
+    for (auto& s : shards_) {
+        std::unique_lock lk(s.mutex);
+        for (auto it = s.uris.begin(); it != s.uris.end();) {
+            if (it->second == uri)
+                it = s.uris.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void
+DeviceUriCache::clear()
+{
+    for (auto& s : shards_) {
+        std::unique_lock lk(s.mutex);
+        s.uris.clear();
+    }
+}
+
+} // namespace jami
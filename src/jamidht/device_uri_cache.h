@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace jami {
+
+/**
+ * Account-wide cache of the account URI owning each device.
+ *
+ * Resolving a device otherwise requires loading its certificate, which is
+ * done for every commit and every notification. The owner of a device
+ * certificate never changes, but entries are dropped when the device or
+ * its owner is revoked or banned, so that they are resolved again.
+ */
+class DeviceUriCache
+{
+public:
+    /**
+     * @return the cached URI of the device's owner, or an empty string
+     */
+    std::string get(std::string_view device) const;
+
+    /**
+     * Return the cached URI, or resolve it and cache the result if not empty
+     */
+    std::string resolve(std::string_view device,
+                        const std::function<std::string(const std::string&)>& resolver);
+
+    void set(std::string_view device, std::string uri);
+
+    /** Forget a device */
+    void invalidate(std::string_view device);
+    /** Forget all the devices of an account */
+    void invalidateUri(std::string_view uri);
+    void clear();
+
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::string> uris;
+    };
+
+    Shard& shard(std::string_view device)
+    {
+        return shards_[std::hash<std::string_view> {}(device) % SHARDS];
+    }
+    const Shard& shard(std::string_view device) const
+    {
+        return shards_[std::hash<std::string_view> {}(device) % SHARDS];
+    }
+
+    std::array<Shard, SHARDS> shards_;
+};
+
+} // namespace jami
@@ -31,6 +31,7 @@
 #include "server_account_manager.h"
 #include "jamidht/channeled_transport.h"
 #include "conversation_channel_handler.h"
+#include "message_channel_handler.h"
 #include "sync_channel_handler.h"
 #include "transfer_channel_handler.h"
 #include "swarm/swarm_channel_handler.h"
@@ -51,6 +52,7 @@
 #include "system_codec_container.h"
 
 #include "account_schema.h"
+#include "config/config_writer.h"
 #include "manager.h"
 #include "connectivity/utf8_utils.h"
 #include "connectivity/ip_utils.h"
@@ -160,22 +162,6 @@ setState(const std::string& accountID, const State migrationState)
 
 } // namespace Migration
 
-struct JamiAccount::BuddyInfo
-{
-    /* the buddy id */
-    dht::InfoHash id;
-
-    /* number of devices connected on the DHT */
-    uint32_t devices_cnt {};
-
-    /* The disposable object to update buddy info */
-    std::future<size_t> listenToken;
-
-    BuddyInfo(dht::InfoHash id)
-        : id(id)
-    {}
-};
-
 struct JamiAccount::PendingCall
 {
     std::chrono::steady_clock::time_point start;
@@ -262,15 +248,47 @@ JamiAccount::JamiAccount(const std::string& accountId)
     , idPath_(fileutils::get_data_dir() / accountId)
     , cachePath_(fileutils::get_cache_dir() / accountId)
     , dataPath_(cachePath_ / "values")
+    , configWriter_(std::make_unique<ConfigWriter>(Manager::instance().scheduler()))
     , certStore_ {std::make_unique<dhtnet::tls::CertificateStore>(idPath_, Logger::dhtLogger())}
     , dht_(new dht::DhtRunner)
     , treatedMessages_(cachePath_ / TREATED_PATH)
     , connectionManager_ {}
     , nonSwarmTransferManager_()
-{}
+{
+    presenceEngine_ = std::make_unique<PresenceEngine>(PresenceEngine::Callbacks {
+        [this](const dht::InfoHash& h) { return listenPresence(h); },
+        [this](const dht::InfoHash& h, std::future<size_t>&& token) {
+            if (auto dht = dht_)
+                if (dht->isRunning())
+                    dht->cancelListen(h, std::move(token));
+        },
+        [this](const DeviceId& device) { return isConnectedWith(device); },
+        [this](std::chrono::steady_clock::duration delay) {
+            Manager::instance().scheduler().scheduleIn(
+                [w = weak()] {
+                    if (auto sthis = w.lock())
+                        sthis->presenceEngine_->process();
+                },
+                delay);
+        },
+        [this](const dht::InfoHash& h, bool online) {
+            // NOTE: the rest can use configurationMtx_, that can be locked during unregister so
+            // do not retrigger on dht
+            runOnMainThread([w = weak(), h, online] {
+                if (auto sthis = w.lock()) {
+                    if (online)
+                        sthis->onTrackedBuddyOnline(h);
+                    else
+                        sthis->onTrackedBuddyOffline(h);
+                }
+            });
+        }});
+}
 
 JamiAccount::~JamiAccount() noexcept
 {
+    // Write pending changes while the configuration is still there
+    configWriter_.reset();
     if (dht_)
         dht_->join();
 }
@@ -309,6 +327,7 @@ JamiAccount::flush()
     // Class base method
     SIPAccountBase::flush();
 
+    configWriter_->cancel();
     dhtnet::fileutils::removeAll(cachePath_);
     dhtnet::fileutils::removeAll(dataPath_);
     dhtnet::fileutils::removeAll(idPath_, true);
@@ -887,13 +906,11 @@ void
 JamiAccount::saveConfig() const
 {
     try {
-        YAML::Emitter accountOut;
-        config().serialize(accountOut);
-        auto accountConfig = config().path / "config.yml";
-        std::lock_guard lock(dhtnet::fileutils::getFileLock(accountConfig));
-        std::ofstream fout(accountConfig);
-        fout.write(accountOut.c_str(), accountOut.size());
-        JAMI_DBG("Saved account config to %s", accountConfig.c_str());
+        configWriter_->save(config().path / "config.yml", "account", [this] {
+            YAML::Emitter accountOut;
+            serializeConfig(accountOut);
+            return std::string(accountOut.c_str(), accountOut.size());
+        });
     } catch (const std::exception& e) {
         JAMI_ERR("Error saving account config: %s", e.what());
     }
@@ -1082,6 +1099,8 @@ JamiAccount::revokeDevice(const std::string& device,
         return false;
     return accountManager_->revokeDevice(
         device, scheme, password, [this, device](AccountManager::RevokeDeviceResult result) {
+            if (result == AccountManager::RevokeDeviceResult::SUCCESS)
+                deviceUriCache_.invalidate(device);
             emitSignal<libjami::ConfigurationSignal::DeviceRevocationEnded>(getAccountID(),
                                                                             device,
                                                                             static_cast<int>(
@@ -1090,6 +1109,17 @@ JamiAccount::revokeDevice(const std::string& device,
     return true;
 }
 
+std::string
+JamiAccount::uriFromDevice(const std::string& deviceId)
+{
+    return deviceUriCache_.resolve(deviceId, [this](const std::string& device) -> std::string {
+        auto cert = certStore().getCertificate(device);
+        if (cert && cert->issuer)
+            return cert->issuer->getId().toString();
+        return {};
+    });
+}
+
 std::pair<std::string, std::string>
 JamiAccount::saveIdentity(const dht::crypto::Identity id,
                           const std::filesystem::path& path,
@@ -1138,6 +1168,8 @@ JamiAccount::loadAccount(const std::string& archive_password_scheme,
                 return;
             dht::ThreadPool::io().run([w = weak(), uri, banned] {
                 if (auto shared = w.lock()) {
+                    if (banned)
+                        shared->deviceUriCache_.invalidateUri(uri);
                     // Erase linked conversation's requests
                     if (auto convModule = shared->convModule(true))
                         convModule->removeContact(uri, banned);
@@ -1676,80 +1708,47 @@ JamiAccount::trackBuddyPresence(const std::string& buddy_id, bool track)
              buddy_id.c_str());
 
     auto h = dht::InfoHash(buddyUri);
-    std::unique_lock lock(buddyInfoMtx);
     if (track) {
-        auto buddy = trackedBuddies_.emplace(h, BuddyInfo {h});
-        if (buddy.second) {
-            trackPresence(buddy.first->first, buddy.first->second);
-        }
+        // Listens are issued in batches by the presence engine
+        presenceEngine_->track(h);
         auto it = presenceState_.find(buddyUri);
         if (it != presenceState_.end() && it->second != PresenceState::DISCONNECTED) {
-            lock.unlock();
             emitSignal<libjami::PresenceSignal::NewBuddyNotification>(
                 getAccountID(), buddyUri, static_cast<int>(it->second), "");
         }
     } else {
-        auto buddy = trackedBuddies_.find(h);
-        if (buddy != trackedBuddies_.end()) {
-            if (auto dht = dht_)
-                if (dht->isRunning())
-                    dht->cancelListen(h, std::move(buddy->second.listenToken));
-            trackedBuddies_.erase(buddy);
-        }
+        presenceEngine_->untrack(h);
     }
 }
 
-void
-JamiAccount::trackPresence(const dht::InfoHash& h, BuddyInfo& buddy)
+std::future<size_t>
+JamiAccount::listenPresence(const dht::InfoHash& h)
 {
     auto dht = dht_;
     if (not dht or not dht->isRunning()) {
-        return;
+        return {};
     }
-    buddy.listenToken
-        = dht->listen<DeviceAnnouncement>(h, [this, h](DeviceAnnouncement&& dev, bool expired) {
-              bool wasConnected, isConnected;
-              {
-                  std::lock_guard lock(buddyInfoMtx);
-                  auto buddy = trackedBuddies_.find(h);
-                  if (buddy == trackedBuddies_.end())
-                      return true;
-                  wasConnected = buddy->second.devices_cnt > 0;
-                  if (expired)
-                      --buddy->second.devices_cnt;
-                  else
-                      ++buddy->second.devices_cnt;
-                  isConnected = buddy->second.devices_cnt > 0;
-              }
-              // NOTE: the rest can use configurationMtx_, that can be locked during unregister so
-              // do not retrigger on dht
-              runOnMainThread([w = weak(), h, dev, expired, isConnected, wasConnected]() {
-                  auto sthis = w.lock();
-                  if (!sthis)
-                      return;
-                  if (not expired) {
-                      // Retry messages every time a new device announce its presence
-                      sthis->messageEngine_.onPeerOnline(h.toString());
-                  }
-                  if (isConnected and not wasConnected) {
-                      sthis->onTrackedBuddyOnline(h);
-                  } else if (not isConnected and wasConnected) {
-                      sthis->onTrackedBuddyOffline(h);
-                  }
-              });
-
-              return true;
-          });
+    return dht->listen<DeviceAnnouncement>(h, [this, h](DeviceAnnouncement&& dev, bool expired) {
+        if (not presenceEngine_->onAnnouncement(h,
+                                                dev.dev,
+                                                dev.pk ? dev.pk->getLongId() : DeviceId {},
+                                                expired))
+            return true;
+        if (not expired) {
+            // Retry messages every time a new device announce its presence
+            runOnMainThread([w = weak(), h] {
+                if (auto sthis = w.lock())
+                    sthis->messageEngine_.onPeerOnline(h.toString());
+            });
+        }
+        return true;
+    });
 }
 
 std::map<std::string, bool>
 JamiAccount::getTrackedBuddyPresence() const
 {
-    std::lock_guard lock(buddyInfoMtx);
-    std::map<std::string, bool> presence_info;
-    for (const auto& buddy_info_p : trackedBuddies_)
-        presence_info.emplace(buddy_info_p.first.toString(), buddy_info_p.second.devices_cnt > 0);
-    return presence_info;
+    return presenceEngine_->presence();
 }
 
 void
@@ -2141,11 +2140,14 @@ JamiAccount::doRegister_()
                 });
         }
 
-        std::lock_guard lock(buddyInfoMtx);
-        for (auto& buddy : trackedBuddies_) {
-            buddy.second.devices_cnt = 0;
-            trackPresence(buddy.first, buddy.second);
-        }
+        // Listens died with the previous DHT instance
+        auto stats = presenceEngine_->getStats();
+        JAMI_LOG("[Account {}] Restarting presence tracking of {} buddies ({} online, {} connected)",
+                 getAccountID(),
+                 stats.tracked,
+                 stats.online,
+                 stats.inferred);
+        presenceEngine_->restart();
     } catch (const std::exception& e) {
         JAMI_ERR("Error registering DHT account: %s", e.what());
         setRegistrationState(RegistrationState::ERROR_GENERIC);
@@ -3003,6 +3005,47 @@ JamiAccount::sendMessage(const std::string& to,
     }
 
     std::shared_ptr<std::set<DeviceId>> devices = std::make_shared<std::set<DeviceId>>();
+
+    // Prefer message channels, SIP is only used for peers not supporting them
+    std::vector<std::shared_ptr<MessageChannelHandler::Connection>> msgConns;
+    {
+        std::lock_guard lkCM(connManagerMtx_);
+        auto itHandler = channelHandlers_.find(Uri::Scheme::MESSAGE);
+        if (itHandler != channelHandlers_.end() && itHandler->second)
+            msgConns = static_cast<MessageChannelHandler*>(itHandler->second.get())
+                           ->getConnections(to, deviceId.empty() ? DeviceId() : DeviceId(deviceId));
+    }
+    if (!msgConns.empty()) {
+        MessageChannelHandler::Message msg;
+        msg.id = token;
+        msg.t = payloads.cbegin()->first;
+        msg.c = payloads.cbegin()->second;
+        auto sent = MessageChannelHandler::sendMessage(
+            msgConns,
+            msg,
+            [w = weak(), to, token, deviceId, retryOnTimeout, onlyConnected](const DeviceId&,
+                                                                             bool ok) {
+                auto acc = w.lock();
+                if (!acc)
+                    return;
+                if (!onlyConnected)
+                    acc->messageEngine_.onMessageSent(to, token, ok, deviceId);
+                // The channel was closed before the message was acknowledged,
+                // the peer typically changed its connectivity. This can be
+                // called while channels are closed under connManagerMtx_.
+                if (!ok && retryOnTimeout)
+                    dht::ThreadPool::io().run([w, to, deviceId] {
+                        if (auto acc = w.lock())
+                            acc->messageEngine_.onPeerOnline(to, deviceId);
+                    });
+            });
+        for (const auto& device : sent) {
+            devices->emplace(device);
+            if (device.toString() == deviceId)
+                return;
+        }
+    }
+
     std::unique_lock lk(sipConnsMtx_);
 
     for (auto it = sipConns_.begin(); it != sipConns_.end();) {
@@ -3015,6 +3058,10 @@ JamiAccount::sendMessage(const std::string& to,
             ++it;
             continue;
         }
+        if (devices->find(key.second) != devices->end()) {
+            ++it;
+            continue;
+        }
         auto& conn = value.back();
         auto& channel = conn.channel;
 
@@ -3115,13 +3162,53 @@ JamiAccount::sendMessage(const std::string& to,
                 }
 
                 // Else, ask for a channel to send the message
-                requestSIPConnection(to, deviceId, payload_type);
+                requestMessageConnection(to, deviceId, payload_type);
             });
     } else {
-        requestSIPConnection(to, DeviceId(deviceId), payload_type);
+        requestMessageConnection(to, DeviceId(deviceId), payload_type);
     }
 }
 
+void
+JamiAccount::requestMessageConnection(const std::string& peerId,
+                                      const DeviceId& deviceId,
+                                      const std::string& connectionType)
+{
+    std::lock_guard lkCM(connManagerMtx_);
+    auto itHandler = channelHandlers_.find(Uri::Scheme::MESSAGE);
+    if (itHandler == channelHandlers_.end() || !itHandler->second)
+        return;
+    itHandler->second->connect(
+        deviceId,
+        connectionType,
+        [w = weak(), peerId, connectionType](std::shared_ptr<dhtnet::ChannelSocket> socket,
+                                             const DeviceId& deviceId) {
+            if (socket)
+                return;
+            // The channel was refused (old peer) or the device is unreachable
+            dht::ThreadPool::io().run([w, peerId, deviceId, connectionType] {
+                if (auto shared = w.lock())
+                    shared->requestSIPConnection(peerId, deviceId, connectionType);
+            });
+        });
+}
+
+void
+JamiAccount::onMessageChannelReady(const std::string& peerId, const DeviceId& deviceId)
+{
+    JAMI_LOG("[Account {:s}] New message channel opened with {:s}", getAccountID(), deviceId);
+    // Called from onReady, under connManagerMtx_, which sending messages locks
+    dht::ThreadPool::io().run([w = weak(), peerId, deviceId] {
+        auto shared = w.lock();
+        if (!shared)
+            return;
+        shared->convModule()->syncConversations(peerId, deviceId.toString());
+        // Retry messages
+        shared->messageEngine_.onPeerOnline(peerId);
+        shared->messageEngine_.onPeerOnline(peerId, deviceId.toString(), true);
+    });
+}
+
 void
 JamiAccount::onSIPMessageSent(const std::shared_ptr<TextMessageCtx>& ctx, int code)
 {
@@ -3579,9 +3666,11 @@ JamiAccount::sendProfile(const std::string& convId,
                          const std::string& deviceId)
 {
     auto accProfilePath = profilePath();
-    if (not std::filesystem::is_regular_file(accProfilePath))
+    // Cached while the file is unchanged, so the sha3 is only computed once per edit
+    auto profile = vCard::utils::loadProfile(accProfilePath);
+    if (not profile)
         return;
-    auto currentSha3 = fileutils::sha3File(accProfilePath);
+    const auto& currentSha3 = profile->sha3();
     // VCard sync for peerUri
     if (not needToSendProfile(peerUri, deviceId, currentSha3)) {
         JAMI_DEBUG("Peer {} already got an up-to-date vcard", peerUri);
@@ -3849,13 +3938,12 @@ JamiAccount::shutdownSIPConnection(const std::shared_ptr<dhtnet::ChannelSocket>&
                          [&](const auto& v) { return v.first.first == peerId; });
             if (it == sipConns_.end()) {
                 auto& state = presenceState_[peerId];
+                dht::InfoHash peerH(peerId);
+                // Presence was inferred from the connection, go back to the DHT
+                presenceEngine_->onConnectionClosed(peerH);
                 if (state == PresenceState::CONNECTED) {
-                    std::lock_guard lock(buddyInfoMtx);
-                    auto buddy = trackedBuddies_.find(dht::InfoHash(peerId));
-                    if (buddy == trackedBuddies_.end())
-                        state = PresenceState::DISCONNECTED;
-                    else
-                        state = buddy->second.devices_cnt > 0 ? PresenceState::AVAILABLE : PresenceState::DISCONNECTED;
+                    state = presenceEngine_->isOnline(peerH) ? PresenceState::AVAILABLE
+                                                             : PresenceState::DISCONNECTED;
                     emitSignal<libjami::PresenceSignal::NewBuddyNotification>(
                         getAccountID(),
                         peerId,
@@ -4184,6 +4272,8 @@ JamiAccount::initConnectionManager()
             = std::make_unique<SyncChannelHandler>(shared(), *connectionManager_.get());
         channelHandlers_[Uri::Scheme::DATA_TRANSFER]
             = std::make_unique<TransferChannelHandler>(shared(), *connectionManager_.get());
+        channelHandlers_[Uri::Scheme::MESSAGE]
+            = std::make_unique<MessageChannelHandler>(shared(), *connectionManager_.get());
 
 #if TARGET_OS_IOS
         connectionManager_->oniOSConnected([&](const std::string& connType, dht::InfoHash peer_h) {
@@ -43,6 +43,8 @@
 #include "conversation_module.h"
 #include "sync_module.h"
 #include "conversationrepository.h"
+#include "device_uri_cache.h"
+#include "presence_engine.h"
 
 #include <dhtnet/diffie-hellman.h>
 #include <dhtnet/tls_session.h>
@@ -82,6 +84,7 @@ using Address = h160;
 namespace jami {
 
 class IceTransport;
+class ConfigWriter;
 struct Contact;
 struct AccountArchive;
 class DhtPeerConnector;
@@ -176,6 +179,11 @@ public:
      */
     std::map<std::string, bool> getTrackedBuddyPresence() const;
 
+    /**
+     * Aggregate counters of the buddy presence tracking
+     */
+    PresenceEngine::Stats getPresenceStats() const { return presenceEngine_->getStats(); }
+
     void setActiveCodecs(const std::vector<unsigned>& list) override;
 
     /**
@@ -579,6 +587,14 @@ public:
 #endif
 
     dhtnet::tls::CertificateStore& certStore() const { return *certStore_; }
+
+    /**
+     * Retrieve the account owning a device, from the certificate store
+     * @return the account URI, or an empty string if the device is unknown
+     * @note results are cached in deviceUriCache()
+     */
+    std::string uriFromDevice(const std::string& deviceId);
+    DeviceUriCache& deviceUriCache() { return deviceUriCache_; }
     /**
      * Check if a Device is connected
      * @param deviceId
@@ -592,6 +608,14 @@ public:
      */
     void sendPresenceNote(const std::string& note);
 
+    /**
+     * Called when a message channel is ready with a peer's device:
+     * pending messages are retried through it
+     * @param peerId    The contact who owns the device
+     * @param deviceId  The connected device
+     */
+    void onMessageChannelReady(const std::string& peerId, const DeviceId& deviceId);
+
 private:
     NON_COPYABLE(JamiAccount);
 
@@ -603,7 +627,6 @@ private:
      */
     struct PendingCall;
     struct PendingMessage;
-    struct BuddyInfo;
     struct DiscoveredPeer;
 
     inline std::string getProxyConfigKey() const
@@ -619,7 +642,7 @@ private:
                                                                       const std::string& pin,
                                                                       bool previous = false);
 
-    void trackPresence(const dht::InfoHash& h, BuddyInfo& buddy);
+    std::future<size_t> listenPresence(const dht::InfoHash& h);
 
     void doRegister_();
 
@@ -699,6 +722,9 @@ private:
     std::filesystem::path cachePath_ {};
     std::filesystem::path dataPath_ {};
 
+    /** Debounced writes of config.yml */
+    std::unique_ptr<ConfigWriter> configWriter_;
+
 #if HAVE_RINGNS
     mutable std::mutex registeredNameMutex_;
     std::string registeredName_;
@@ -728,8 +754,7 @@ private:
     dhtnet::fileutils::IdList treatedMessages_;
 
     /* tracked buddies presence */
-    mutable std::mutex buddyInfoMtx;
-    std::map<dht::InfoHash, BuddyInfo> trackedBuddies_;
+    std::unique_ptr<PresenceEngine> presenceEngine_;
 
     mutable std::mutex dhtValuesMtx_;
 
@@ -812,6 +837,17 @@ private:
                               const std::string& connectionType,
                               bool forceNewConnection = false,
                               const std::shared_ptr<SIPCall>& pc = {});
+    /**
+     * Ask a device to open a message channel, falling back to a SIP
+     * channel if the device does not support it
+     * @param peerId             The contact who owns the device
+     * @param deviceId           The device to ask
+     * @param connectionType     The type of connection, for push notifications
+     * @note triggers onMessageChannelReady or cacheSIPConnection
+     */
+    void requestMessageConnection(const std::string& peerId,
+                                  const DeviceId& deviceId,
+                                  const std::string& connectionType);
     /**
      * Store a new SIP connection into sipConnections_
      * @param channel   The new sip channel
@@ -871,6 +907,8 @@ private:
     std::mutex moduleMtx_;
     std::unique_ptr<SyncModule> syncModule_;
 
+    DeviceUriCache deviceUriCache_;
+
     std::mutex rdvMtx_;
 
     int dhtBoundPort_ {0};
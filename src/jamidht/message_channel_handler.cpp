@@ -0,0 +1,290 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "jamidht/message_channel_handler.h"
+#include "string_utils.h"
+
+#include <opendht/thread_pool.h>
+
+static constexpr const char MESSAGE_URI[] {"msg://"};
+// Bytes buffered for a message not fully received yet
+static constexpr size_t MAX_MESSAGE_SIZE {1024 * 1024};
+
+namespace jami {
+
+struct MessageChannelHandler::Connection
+{
+    std::shared_ptr<dhtnet::ChannelSocket> socket;
+    std::mutex mutex;
+    // Messages written but not acknowledged yet
+    std::map<uint64_t, OnSentCb> pending;
+};
+
+class MessageChannelHandler::Impl : public std::enable_shared_from_this<Impl>
+{
+public:
+    Impl(const std::shared_ptr<JamiAccount>& acc, dhtnet::ConnectionManager& cm)
+        : account_(acc)
+        , connectionManager_(cm)
+    {}
+
+    std::weak_ptr<Impl> weak() { return std::static_pointer_cast<Impl>(shared_from_this()); }
+
+    void cacheConnection(const std::string& peerId,
+                         const DeviceId& deviceId,
+                         const std::shared_ptr<dhtnet::ChannelSocket>& socket);
+    void removeConnection(const std::string& peerId,
+                          const DeviceId& deviceId,
+                          const std::shared_ptr<Connection>& conn);
+    void onMessage(const std::string& peerId,
+                   const std::shared_ptr<Connection>& conn,
+                   Message&& msg);
+    static bool write(dhtnet::ChannelSocket& socket, const Message& msg);
+
+    std::weak_ptr<JamiAccount> account_;
+    dhtnet::ConnectionManager& connectionManager_;
+
+    std::mutex connectionsMtx_;
+    std::map<std::pair<std::string, DeviceId>, std::vector<std::shared_ptr<Connection>>> connections_;
+};
+
+bool
+MessageChannelHandler::Impl::write(dhtnet::ChannelSocket& socket, const Message& msg)
+{
+    msgpack::sbuffer buffer(64 + msg.t.size() + msg.c.size());
+    msgpack::pack(buffer, msg);
+    std::error_code ec;
+    socket.write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
+    if (ec) {
+        JAMI_WARNING("Unable to write message: {}", ec.message());
+        return false;
+    }
+    return true;
+}
+
+void
+MessageChannelHandler::Impl::cacheConnection(const std::string& peerId,
+                                             const DeviceId& deviceId,
+                                             const std::shared_ptr<dhtnet::ChannelSocket>& socket)
+{
+    auto conn = std::make_shared<Connection>();
+    conn->socket = socket;
+    {
+        std::lock_guard lk(connectionsMtx_);
+        connections_[{peerId, deviceId}].emplace_back(conn);
+    }
+
+    socket->onShutdown([w = weak(), peerId, deviceId, wconn = std::weak_ptr<Connection>(conn)]() {
+        auto conn = wconn.lock();
+        if (!conn)
+            return;
+        if (auto shared = w.lock())
+            shared->removeConnection(peerId, deviceId, conn);
+    });
+
+    struct DecodingContext
+    {
+        // A message is a map of 4 scalars
+        msgpack::unpacker pac {[](msgpack::type::object_type, std::size_t, void*) { return true; },
+                               nullptr,
+                               512,
+                               msgpack::unpack_limit(0, 8, MAX_MESSAGE_SIZE, 0, 0, 2)};
+    };
+
+    socket->setOnRecv([w = weak(),
+                       peerId,
+                       wconn = std::weak_ptr<Connection>(conn),
+                       ctx = std::make_shared<DecodingContext>()](const uint8_t* buf, size_t len) {
+        auto shared = w.lock();
+        auto conn = wconn.lock();
+        if (!buf || !shared || !conn)
+            return len;
+
+        if (ctx->pac.nonparsed_size() + len > MAX_MESSAGE_SIZE) {
+            JAMI_WARNING("[msg] Message from {} too big, closing channel", peerId);
+            dht::ThreadPool::io().run([conn] { conn->socket->shutdown(); });
+            return len;
+        }
+        ctx->pac.reserve_buffer(len);
+        std::copy_n(buf, len, ctx->pac.buffer());
+        ctx->pac.buffer_consumed(len);
+
+        msgpack::object_handle oh;
+        try {
+            while (ctx->pac.next(oh)) {
+                Message msg;
+                oh.get().convert(msg);
+                shared->onMessage(peerId, conn, std::move(msg));
+            }
+        } catch (const std::exception& e) {
+            // The stream can't be resynchronized
+            JAMI_WARNING("[msg] Error parsing message: {:s}, closing channel", e.what());
+            dht::ThreadPool::io().run([conn] { conn->socket->shutdown(); });
+        }
+        return len;
+    });
+}
+
+void
+MessageChannelHandler::Impl::removeConnection(const std::string& peerId,
+                                              const DeviceId& deviceId,
+                                              const std::shared_ptr<Connection>& conn)
+{
+    {
+        std::lock_guard lk(connectionsMtx_);
+        auto it = connections_.find({peerId, deviceId});
+        if (it != connections_.end()) {
+            auto& conns = it->second;
+            conns.erase(std::remove(conns.begin(), conns.end(), conn), conns.end());
+            if (conns.empty())
+                connections_.erase(it);
+        }
+    }
+    // Messages not acknowledged are considered as failed so they can be retried
+    std::map<uint64_t, OnSentCb> pending;
+    {
+        std::lock_guard lk(conn->mutex);
+        pending.swap(conn->pending);
+    }
+    for (auto& [id, cb] : pending)
+        if (cb)
+            cb(deviceId, false);
+}
+
+void
+MessageChannelHandler::Impl::onMessage(const std::string& peerId,
+                                       const std::shared_ptr<Connection>& conn,
+                                       Message&& msg)
+{
+    auto deviceId = conn->socket->deviceId();
+    if (msg.ack) {
+        OnSentCb cb;
+        {
+            std::lock_guard lk(conn->mutex);
+            auto it = conn->pending.find(msg.id);
+            if (it == conn->pending.end())
+                return;
+            cb = std::move(it->second);
+            conn->pending.erase(it);
+        }
+        if (cb)
+            cb(deviceId, true);
+        return;
+    }
+
+    Message ack;
+    ack.id = msg.id;
+    ack.ack = true;
+    write(*conn->socket, ack);
+
+    auto acc = account_.lock();
+    if (!acc || acc->isMessageTreated(msg.id))
+        return;
+    acc->onTextMessage(to_hex_string(msg.id),
+                       peerId,
+                       deviceId.toString(),
+                       {{std::move(msg.t), std::move(msg.c)}});
+}
+
+////////////////////////////////////////////////////////////////
+
+MessageChannelHandler::MessageChannelHandler(const std::shared_ptr<JamiAccount>& acc,
+                                             dhtnet::ConnectionManager& cm)
+    : ChannelHandlerInterface()
+    , pimpl_(std::make_shared<Impl>(acc, cm))
+{}
+
+MessageChannelHandler::~MessageChannelHandler() {}
+
+void
+MessageChannelHandler::connect(const DeviceId& deviceId,
+                               const std::string& connectionType,
+                               ConnectCb&& cb)
+{
+    auto channelName = MESSAGE_URI + deviceId.toString();
+    if (pimpl_->connectionManager_.isConnecting(deviceId, channelName)) {
+        JAMI_LOG("Already connecting to {}", deviceId);
+        return;
+    }
+    pimpl_->connectionManager_.connectDevice(deviceId,
+                                             channelName,
+                                             std::move(cb),
+                                             false,
+                                             false,
+                                             connectionType);
+}
+
+bool
+MessageChannelHandler::onRequest(const std::shared_ptr<dht::crypto::Certificate>& cert,
+                                 const std::string& /* name */)
+{
+    auto acc = pimpl_->account_.lock();
+    return cert && cert->issuer && acc;
+}
+
+void
+MessageChannelHandler::onReady(const std::shared_ptr<dht::crypto::Certificate>& cert,
+                               const std::string&,
+                               std::shared_ptr<dhtnet::ChannelSocket> channel)
+{
+    auto acc = pimpl_->account_.lock();
+    if (!cert || !cert->issuer || !acc)
+        return;
+    auto peerId = cert->issuer->getId().toString();
+    auto deviceId = channel->deviceId();
+    pimpl_->cacheConnection(peerId, deviceId, channel);
+    acc->onMessageChannelReady(peerId, deviceId);
+}
+
+std::vector<std::shared_ptr<MessageChannelHandler::Connection>>
+MessageChannelHandler::getConnections(const std::string& peerId, const DeviceId& deviceId)
+{
+    std::vector<std::shared_ptr<Connection>> conns;
+    std::lock_guard lk(pimpl_->connectionsMtx_);
+    for (auto it = pimpl_->connections_.lower_bound({peerId, DeviceId()});
+         it != pimpl_->connections_.end() && it->first.first == peerId;
+         ++it) {
+        if ((deviceId && it->first.second != deviceId) || it->second.empty())
+            continue;
+        conns.emplace_back(it->second.back());
+    }
+    return conns;
+}
+
+std::vector<DeviceId>
+MessageChannelHandler::sendMessage(const std::vector<std::shared_ptr<Connection>>& conns,
+                                   const Message& message,
+                                   const OnSentCb& onSent)
+{
+    std::vector<DeviceId> devices;
+    for (const auto& conn : conns) {
+        {
+            std::lock_guard lk(conn->mutex);
+            conn->pending[message.id] = onSent;
+        }
+        if (Impl::write(*conn->socket, message)) {
+            devices.emplace_back(conn->socket->deviceId());
+        } else {
+            std::lock_guard lk(conn->mutex);
+            conn->pending.erase(message.id);
+        }
+    }
+    return devices;
+}
+
+} // namespace jami
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "jamidht/channel_handler.h"
+#include "jamidht/jamiaccount.h"
+#include <dhtnet/connectionmanager.h>
+
+namespace jami {
+
+/**
+ * Manages channels used to exchange text messages and swarm notifications
+ * with other devices, without going through the SIP stack.
+ * Messages are framed with msgpack, can be pipelined and are acknowledged
+ * one by one. Peers not supporting this channel refuse it, in which case
+ * the account falls back to a SIP channel.
+ */
+class MessageChannelHandler : public ChannelHandlerInterface
+{
+public:
+    struct Message
+    {
+        uint64_t id {0}; /* Message token, echoed back in the acknowledgement */
+        std::string t;   /* Message type (MIME) */
+        std::string c;   /* Message content */
+        bool ack {false};
+        MSGPACK_DEFINE_MAP(id, t, c, ack)
+    };
+
+    /**
+     * Called once per device when a message is acknowledged (true) or when
+     * the channel is closed before it was (false)
+     */
+    using OnSentCb = std::function<void(const DeviceId&, bool)>;
+
+    MessageChannelHandler(const std::shared_ptr<JamiAccount>& acc, dhtnet::ConnectionManager& cm);
+    ~MessageChannelHandler();
+
+    /**
+     * Ask for a new message channel
+     * @param deviceId          The device to connect
+     * @param connectionType    Type of the connection, used for push notifications
+     * @param cb                The callback to call when connected or on failure
+     */
+    void connect(const DeviceId& deviceId, const std::string& connectionType, ConnectCb&& cb) override;
+
+    /**
+     * Accept message channels from any peer, bans are checked by the account
+     */
+    bool onRequest(const std::shared_ptr<dht::crypto::Certificate>& peer, const std::string& name) override;
+
+    /**
+     * Store the channel and start reading messages from it
+     */
+    void onReady(const std::shared_ptr<dht::crypto::Certificate>& peer,
+                 const std::string& name,
+                 std::shared_ptr<dhtnet::ChannelSocket> channel) override;
+
+    struct Connection;
+
+    /**
+     * Get the opened channels with a peer, last opened first per device
+     * @param peerId        The contact
+     * @param deviceId      If set, only return the channel of this device
+     */
+    std::vector<std::shared_ptr<Connection>> getConnections(const std::string& peerId,
+                                                            const DeviceId& deviceId = {});
+
+    /**
+     * Send a message on channels returned by getConnections.
+     * Writes may block, so no account lock should be held.
+     * @param conns         The channels to write to
+     * @param message       The message to send
+     * @param onSent        Called once the message is acknowledged by a device
+     * @return the devices the message was written to
+     */
+    static std::vector<DeviceId> sendMessage(const std::vector<std::shared_ptr<Connection>>& conns,
+                                             const Message& message,
+                                             const OnSentCb& onSent);
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} // namespace jami
@@ -0,0 +1,342 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "presence_engine.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace jami {
+
+PresenceEngine::PresenceEngine(Callbacks callbacks)
+    : cb_(std::move(callbacks))
+{}
+
+std::optional<PresenceEngine::clock::duration>
+PresenceEngine::reschedule(time_point at, time_point now)
+{
+    if (at >= scheduledAt_)
+        return std::nullopt;
+    scheduledAt_ = at;
+    return std::max(at - now, clock::duration::zero());
+}
+
+void
+PresenceEngine::backoff(Buddy& buddy, time_point now)
+{
+    buddy.backoff = buddy.backoff == clock::duration::zero()
+                        ? std::chrono::duration_cast<clock::duration>(MIN_BACKOFF)
+                        : std::min<clock::duration>(buddy.backoff * 2, MAX_BACKOFF);
+    buddy.nextAttempt = now + buddy.backoff;
+}
+
+bool
+PresenceEngine::track(const dht::InfoHash& h)
+{
+    auto now = clock::now();
+    std::optional<clock::duration> delay;
+    {
+        std::lock_guard lk(mutex_);
+        if (not buddies_.emplace(h, Buddy {}).second)
+            return false;
+        delay = reschedule(now, now);
+    }
+    if (delay and cb_.schedule)
+        cb_.schedule(*delay);
+    return true;
+}
+
+void
+PresenceEngine::untrack(const dht::InfoHash& h)
+{
+    std::future<size_t> token;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = buddies_.find(h);
+        if (it == buddies_.end())
+            return;
+        token = std::move(it->second.listenToken);
+        buddies_.erase(it);
+    }
+    if (token.valid() and cb_.cancelListen)
+        cb_.cancelListen(h, std::move(token));
+}
+
+bool
+PresenceEngine::isTracked(const dht::InfoHash& h) const
+{
+    std::lock_guard lk(mutex_);
+    return buddies_.find(h) != buddies_.end();
+}
+
+bool
+PresenceEngine::onAnnouncement(const dht::InfoHash& h,
+                               const dht::InfoHash& device,
+                               const DeviceId& deviceId,
+                               bool expired)
+{
+    bool changed, online;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = buddies_.find(h);
+        if (it == buddies_.end())
+            return false;
+        auto& buddy = it->second;
+        ++stats_.announcements;
+        auto wasOnline = PresenceEngine::online(buddy);
+        if (expired) {
+            buddy.devices.erase(device);
+        } else {
+            buddy.devices.emplace(device);
+            if (deviceId)
+                buddy.knownDevices.emplace(deviceId);
+            buddy.seen = true;
+            buddy.backoff = {};
+            // Confirmed by the DHT
+            buddy.inferred = false;
+            buddy.inferredUntil.reset();
+        }
+        online = PresenceEngine::online(buddy);
+        changed = online != wasOnline;
+    }
+    if (changed and cb_.onPresenceChanged)
+        cb_.onPresenceChanged(h, online);
+    return true;
+}
+
+void
+PresenceEngine::onConnectionClosed(const dht::InfoHash& h)
+{
+    auto now = clock::now();
+    std::optional<clock::duration> delay;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = buddies_.find(h);
+        if (it == buddies_.end() or not it->second.inferred)
+            return;
+        auto& buddy = it->second;
+        // Still online until the DHT had a chance to tell otherwise
+        if (buddy.listening) {
+            if (not buddy.inferredUntil)
+                buddy.inferredUntil = now + INFERRED_GRACE;
+            delay = reschedule(*buddy.inferredUntil, now);
+        } else {
+            buddy.recheck = false;
+            buddy.backoff = {};
+            buddy.nextAttempt = now;
+            delay = reschedule(now, now);
+        }
+    }
+    if (delay and cb_.schedule)
+        cb_.schedule(*delay);
+}
+
+void
+PresenceEngine::restart(time_point now)
+{
+    std::optional<clock::duration> delay;
+    {
+        std::lock_guard lk(mutex_);
+        ++stats_.restarts;
+        for (auto& [h, buddy] : buddies_) {
+            if (buddy.seen or buddy.inferred) {
+                // Likely still online, check first
+                buddy.backoff = {};
+                buddy.nextAttempt = now;
+            } else if (buddy.listening) {
+                // Offline for a whole session
+                backoff(buddy, now);
+            }
+            // Previous listens died with the DHT, don't cancel them.
+            // Inferred buddies stay online while their connection is checked
+            buddy.listenToken = {};
+            buddy.listening = false;
+            buddy.recheck = false;
+            buddy.seen = false;
+            buddy.devices.clear();
+            ++buddy.attempt;
+        }
+        scheduledAt_ = time_point::max();
+        delay = reschedule(now, now);
+    }
+    if (delay and cb_.schedule)
+        cb_.schedule(*delay);
+}
+
+void
+PresenceEngine::process(time_point now)
+{
+    struct Pending
+    {
+        dht::InfoHash id;
+        unsigned attempt;
+        // Empty to listen even if connected
+        std::vector<DeviceId> knownDevices;
+    };
+    std::vector<Pending> batch;
+    std::vector<dht::InfoHash> offline;
+    std::optional<clock::duration> delay;
+    {
+        std::lock_guard lk(mutex_);
+        scheduledAt_ = time_point::max();
+
+        std::vector<std::pair<time_point, decltype(buddies_)::iterator>> due;
+        auto next = time_point::max();
+        for (auto it = buddies_.begin(); it != buddies_.end(); ++it) {
+            auto& buddy = it->second;
+            if (buddy.inferredUntil) {
+                if (*buddy.inferredUntil <= now) {
+                    // Not announced on the DHT since the connection closed
+                    buddy.inferred = false;
+                    buddy.inferredUntil.reset();
+                    if (buddy.devices.empty())
+                        offline.emplace_back(it->first);
+                } else {
+                    next = std::min(next, *buddy.inferredUntil);
+                }
+            }
+            if (buddy.listening)
+                continue;
+            if (buddy.nextAttempt <= now)
+                due.emplace_back(buddy.nextAttempt, it);
+            else
+                next = std::min(next, buddy.nextAttempt);
+        }
+        if (due.size() > BATCH_SIZE) {
+            std::partial_sort(due.begin(),
+                              due.begin() + BATCH_SIZE,
+                              due.end(),
+                              [](const auto& a, const auto& b) { return a.first < b.first; });
+            due.resize(BATCH_SIZE);
+            next = now + BATCH_INTERVAL;
+        }
+
+        batch.reserve(due.size());
+        for (auto& [t, it] : due) {
+            auto& buddy = it->second;
+            buddy.listening = true;
+            Pending pending {it->first, ++buddy.attempt, {}};
+            if (not buddy.recheck)
+                pending.knownDevices.assign(buddy.knownDevices.begin(), buddy.knownDevices.end());
+            batch.emplace_back(std::move(pending));
+        }
+        if (next != time_point::max())
+            delay = reschedule(next, now);
+    }
+    if (delay and cb_.schedule)
+        cb_.schedule(*delay);
+    if (cb_.onPresenceChanged)
+        for (const auto& h : offline)
+            cb_.onPresenceChanged(h, false);
+
+    for (auto& pending : batch) {
+        // A connected device means the buddy is online, no need to ask the DHT
+        auto connected = cb_.isConnected
+                         and std::any_of(pending.knownDevices.begin(),
+                                         pending.knownDevices.end(),
+                                         cb_.isConnected);
+        std::future<size_t> token;
+        if (not connected and cb_.listen)
+            token = cb_.listen(pending.id);
+
+        std::optional<clock::duration> retry;
+        bool wentOnline = false;
+        {
+            std::lock_guard lk(mutex_);
+            auto it = buddies_.find(pending.id);
+            if (it != buddies_.end() and it->second.attempt == pending.attempt) {
+                auto& buddy = it->second;
+                if (connected) {
+                    wentOnline = not online(buddy);
+                    buddy.inferred = true;
+                    buddy.inferredUntil.reset();
+                    // Listen later anyway, to notice the devices the buddy
+                    // adds and connections closing unnoticed
+                    ++stats_.skippedListens;
+                    buddy.listening = false;
+                    buddy.recheck = true;
+                    buddy.nextAttempt = now + INFERRED_RECHECK;
+                    retry = reschedule(buddy.nextAttempt, now);
+                } else {
+                    buddy.recheck = false;
+                    if (not token.valid()) {
+                        ++stats_.failedListens;
+                        buddy.listening = false;
+                        backoff(buddy, now);
+                        retry = reschedule(buddy.nextAttempt, now);
+                    } else {
+                        ++stats_.listens;
+                        buddy.listenToken = std::move(token);
+                    }
+                    // Inferred until the DHT had a chance to answer
+                    if (buddy.inferred and not buddy.inferredUntil) {
+                        buddy.inferredUntil = now + INFERRED_GRACE;
+                        if (auto d = reschedule(*buddy.inferredUntil, now))
+                            retry = d;
+                    }
+                }
+            }
+        }
+        // Untracked or restarted in the meantime
+        if (token.valid() and cb_.cancelListen)
+            cb_.cancelListen(pending.id, std::move(token));
+        if (retry and cb_.schedule)
+            cb_.schedule(*retry);
+        if (wentOnline and cb_.onPresenceChanged)
+            cb_.onPresenceChanged(pending.id, true);
+    }
+}
+
+bool
+PresenceEngine::isOnline(const dht::InfoHash& h) const
+{
+    std::lock_guard lk(mutex_);
+    auto it = buddies_.find(h);
+    return it != buddies_.end() and online(it->second);
+}
+
+std::map<std::string, bool>
+PresenceEngine::presence() const
+{
+    std::lock_guard lk(mutex_);
+    std::map<std::string, bool> presence;
+    for (const auto& [h, buddy] : buddies_)
+        presence.emplace(h.toString(), online(buddy));
+    return presence;
+}
+
+PresenceEngine::Stats
+PresenceEngine::getStats() const
+{
+    std::lock_guard lk(mutex_);
+    auto stats = stats_;
+    stats.tracked = buddies_.size();
+    for (const auto& [h, buddy] : buddies_) {
+        if (buddy.listening)
+            ++stats.listening;
+        else if (buddy.inferred)
+            ++stats.inferred;
+        else
+            ++stats.pending;
+        if (online(buddy))
+            ++stats.online;
+    }
+    return stats;
+}
+
+} // namespace jami
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+
+#include <opendht/infohash.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace jami {
+
+using DeviceId = dht::PkId;
+
+/**
+ * Tracks the presence of the contacts of an account on the DHT.
+ *
+ * Listening to thousands of contacts at once floods the DHT, and so does
+ * re-listening to all of them each time the DHT is restarted. Instead:
+ *  - listens are issued in batches of BATCH_SIZE every BATCH_INTERVAL;
+ *  - contacts with a device connected through the connection manager are
+ *    known to be online (inferred) and are not listened to until that
+ *    connection closes, or INFERRED_RECHECK elapses so that devices they
+ *    add are noticed. Once listened to again, they stay online for
+ *    INFERRED_GRACE, the time for their announcements to come back;
+ *  - contacts that were offline for a whole session are re-listened after
+ *    an exponential back-off (MIN_BACKOFF to MAX_BACKOFF), while those
+ *    seen online recently go first. Failed listens back-off the same way.
+ *
+ * All the callbacks are called without the engine lock held.
+ */
+class PresenceEngine
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    static constexpr size_t BATCH_SIZE {32};
+    static constexpr auto BATCH_INTERVAL = std::chrono::milliseconds(200);
+    static constexpr auto MIN_BACKOFF = std::chrono::seconds(2);
+    static constexpr auto MAX_BACKOFF = std::chrono::minutes(10);
+    static constexpr auto INFERRED_RECHECK = std::chrono::minutes(1);
+    static constexpr auto INFERRED_GRACE = std::chrono::seconds(30);
+
+    struct Callbacks
+    {
+        // Listen to the device announcements of a buddy, which must be
+        // passed to onAnnouncement(). Returns an invalid future on failure.
+        std::function<std::future<size_t>(const dht::InfoHash&)> listen;
+        std::function<void(const dht::InfoHash&, std::future<size_t>&&)> cancelListen;
+        // Whether a device is connected through the connection manager
+        std::function<bool(const DeviceId&)> isConnected;
+        // Call process() after the delay
+        std::function<void(clock::duration)> schedule;
+        // A buddy has its first device announced or connected, or its last
+        // one expired
+        std::function<void(const dht::InfoHash&, bool online)> onPresenceChanged;
+    };
+
+    struct Stats
+    {
+        size_t tracked {0};
+        // Buddies with an active listen
+        size_t listening {0};
+        // Buddies online from a connection, not listened to
+        size_t inferred {0};
+        // Buddies waiting for their batch or back-off
+        size_t pending {0};
+        // Buddies with at least one device announced or connected
+        size_t online {0};
+        uint64_t listens {0};
+        uint64_t failedListens {0};
+        uint64_t skippedListens {0};
+        uint64_t announcements {0};
+        uint64_t restarts {0};
+    };
+
+    explicit PresenceEngine(Callbacks callbacks);
+
+    /**
+     * @return false if the buddy was already tracked
+     */
+    bool track(const dht::InfoHash& buddy);
+    void untrack(const dht::InfoHash& buddy);
+    bool isTracked(const dht::InfoHash& buddy) const;
+
+    /**
+     * Device announcement (or expiration) received for a buddy.
+     * @param deviceId  long identifier of the device, if known
+     * @return false if the buddy is not tracked anymore
+     */
+    bool onAnnouncement(const dht::InfoHash& buddy,
+                        const dht::InfoHash& device,
+                        const DeviceId& deviceId,
+                        bool expired);
+
+    /**
+     * Every connection with the buddy closed: it must be listened to again.
+     * The buddy stays online until INFERRED_GRACE after the listen.
+     */
+    void onConnectionClosed(const dht::InfoHash& buddy);
+
+    /**
+     * The DHT was (re)started and previous listens are lost.
+     */
+    void restart(time_point now = clock::now());
+
+    /**
+     * Issue the next batch of listens.
+     */
+    void process(time_point now = clock::now());
+
+    bool isOnline(const dht::InfoHash& buddy) const;
+    std::map<std::string, bool> presence() const;
+    Stats getStats() const;
+
+private:
+    NON_COPYABLE(PresenceEngine);
+
+    struct Buddy
+    {
+        // Devices currently announced on the DHT
+        std::set<dht::InfoHash> devices;
+        // Devices seen online, kept across restarts to look for connections
+        std::set<DeviceId> knownDevices;
+        std::future<size_t> listenToken;
+        bool listening {false};
+        // Online from a connection
+        bool inferred {false};
+        // When inferred expires, set once the buddy is listened to again
+        std::optional<time_point> inferredUntil;
+        // Next attempt must listen, even if connected
+        bool recheck {false};
+        // Seen online since the last restart
+        bool seen {false};
+        clock::duration backoff {};
+        time_point nextAttempt {};
+        // Incremented for each listen, to detect outdated results
+        unsigned attempt {0};
+    };
+
+    static void backoff(Buddy& buddy, time_point now);
+    static bool online(const Buddy& buddy) { return buddy.inferred or not buddy.devices.empty(); }
+    // Must be called with mutex_ held, returns the delay to pass to
+    // cb_.schedule() if the next run needs to be moved earlier
+    std::optional<clock::duration> reschedule(time_point at, time_point now);
+
+    Callbacks cb_;
+    mutable std::mutex mutex_;
+    std::map<dht::InfoHash, Buddy> buddies_;
+    time_point scheduledAt_ {time_point::max()};
+    Stats stats_;
+};
+
+} // namespace jami
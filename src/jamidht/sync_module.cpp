@@ -23,9 +23,175 @@
 #include "jamidht/conversation_module.h"
 #include "jamidht/archive_account_manager.h"
 #include <dhtnet/multiplexed_socket.h>
+#include <opendht/thread_pool.h>
 
 namespace jami {
 
+// Sync categories, named after the related SyncMsg fields
+static constexpr const char SYNC_DS[] {"ds"};
+static constexpr const char SYNC_CONVS[] {"c"};
+static constexpr const char SYNC_REQUESTS[] {"cr"};
+static constexpr const char SYNC_PREFS[] {"p"};
+static constexpr const char SYNC_STATUS[] {"ms"};
+
+static constexpr uint8_t SYNC_DIGEST_VERSION {1};
+// Keep messages under the max packet size
+static constexpr size_t SYNC_CHUNK_SIZE {UINT16_MAX - 1024};
+
+struct SyncItem
+{
+    uint64_t hash;
+    size_t size;
+};
+using SyncItems = std::map<std::string /* category */, std::map<std::string /* key */, SyncItem>>;
+
+static uint64_t
+hashBytes(const char* data, size_t size)
+{
+    auto h = dht::InfoHash::get(reinterpret_cast<const uint8_t*>(data), size);
+    uint64_t ret = 0;
+    for (size_t i = 0; i < sizeof(ret); ++i)
+        ret = (ret << 8) | h[i];
+    return ret;
+}
+
+template<typename Map>
+static void
+hashItems(const Map& items, std::map<std::string, SyncItem>& out)
+{
+    msgpack::sbuffer buffer;
+    for (const auto& [key, value] : items) {
+        buffer.clear();
+        msgpack::pack(buffer, value);
+        out[key] = {hashBytes(buffer.data(), buffer.size()), buffer.size()};
+    }
+}
+
+/**
+ * Hash every item carried by msg. Device sync data is hashed without its
+ * date, as it changes each time it's generated.
+ */
+static SyncItems
+hashItems(const SyncMsg& msg)
+{
+    SyncItems ret;
+    auto& ds = ret[SYNC_DS];
+    if (msg.ds.date) {
+        auto data = msg.ds;
+        data.date = 0;
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, data);
+        ds[SYNC_DS] = {hashBytes(buffer.data(), buffer.size()), buffer.size()};
+    }
+    hashItems(msg.c, ret[SYNC_CONVS]);
+    hashItems(msg.cr, ret[SYNC_REQUESTS]);
+    hashItems(msg.p, ret[SYNC_PREFS]);
+    hashItems(msg.ms, ret[SYNC_STATUS]);
+    return ret;
+}
+
+static uint64_t
+rootHash(const std::map<std::string, SyncItem>& items)
+{
+    if (items.empty())
+        return 0;
+    std::string summary;
+    summary.reserve(items.size() * 50);
+    for (const auto& [key, item] : items) {
+        summary += key;
+        summary += '\0';
+        for (int shift = 56; shift >= 0; shift -= 8)
+            summary += static_cast<char>(item.hash >> shift);
+    }
+    return hashBytes(summary.data(), summary.size());
+}
+
+/**
+ * Everything we sync, with the hash of each item
+ */
+struct SyncSnapshot
+{
+    SyncMsg msg;
+    SyncItems items;
+};
+
+/**
+ * Sync state of a channel.
+ * Peers announcing a digest only get what differs from what they already
+ * have. Older peers get the whole state each time.
+ */
+struct SyncState
+{
+    enum class Protocol { Unknown, Legacy, Digest };
+    Protocol protocol {Protocol::Unknown};
+    // A full sync was requested before the protocol was known
+    bool pendingFull {false};
+    // Hashes of the items the peer has, per category. A category is
+    // missing until its digest is known.
+    std::map<std::string, std::map<std::string, uint64_t>> known;
+    // Item hashes of a digest split in several messages, until the last one
+    std::map<std::string, std::map<std::string, uint64_t>> receiving;
+};
+
+/**
+ * Pack sync data in messages of at most SYNC_CHUNK_SIZE bytes
+ * (unless a single item is bigger)
+ */
+class SyncChunkWriter
+{
+public:
+    SyncChunkWriter(const std::shared_ptr<dhtnet::ChannelSocket>& socket)
+        : socket_(socket)
+    {}
+
+    template<typename Map>
+    bool add(Map SyncMsg::*field, const std::string& key, const typename Map::mapped_type& value, size_t size)
+    {
+        if (!reserve(size))
+            return false;
+        (msg_.*field).emplace(key, value);
+        return true;
+    }
+
+    bool add(const DeviceSync& ds, size_t size)
+    {
+        if (!reserve(size))
+            return false;
+        msg_.ds = ds;
+        return true;
+    }
+
+    bool flush()
+    {
+        if (!size_)
+            return true;
+        msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
+        msgpack::pack(buffer, msg_);
+        msg_ = {};
+        size_ = 0;
+        std::error_code ec;
+        socket_->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
+        if (ec) {
+            JAMI_ERROR("{:s}", ec.message());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool reserve(size_t size)
+    {
+        if (size_ && size_ + size > SYNC_CHUNK_SIZE && !flush())
+            return false;
+        size_ += size;
+        return true;
+    }
+
+    std::shared_ptr<dhtnet::ChannelSocket> socket_;
+    SyncMsg msg_;
+    size_t size_ {0};
+};
+
 class SyncModule::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
@@ -36,142 +202,229 @@ public:
     // Sync connections
     std::recursive_mutex syncConnectionsMtx_;
     std::map<DeviceId /* deviceId */, std::vector<std::shared_ptr<dhtnet::ChannelSocket>>> syncConnections_;
+    // Protected by syncConnectionsMtx_
+    std::map<const dhtnet::ChannelSocket*, SyncState> syncStates_;
 
     std::weak_ptr<Impl> weak() { return std::static_pointer_cast<Impl>(shared_from_this()); }
 
+    /**
+     * Register a new sync channel: handle incoming messages and announce
+     * our digest
+     */
+    void onChannel(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                   const std::string& peerId,
+                   const DeviceId& device);
+
     /**
      * Build SyncMsg and send it on socket
      * @param socket
+     * @param syncMsg   Message to send, or nullptr to send the whole state
+     * @param snapshot  Whole state, if already built
      */
     void syncInfos(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
-                   const std::shared_ptr<SyncMsg>& syncMsg);
+                   const std::shared_ptr<SyncMsg>& syncMsg,
+                   std::shared_ptr<const SyncSnapshot> snapshot = {});
+
+    std::shared_ptr<const SyncSnapshot> snapshot() const;
+
+private:
+    /**
+     * Send the items of snapshot accepted by filter
+     * @return false on socket error
+     */
+    bool sendItems(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                   const SyncSnapshot& snapshot,
+                   const std::function<bool(const std::string& category, const std::string& key, uint64_t hash)>& filter);
+    bool sendDelta(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                   SyncState& state,
+                   const SyncSnapshot& snapshot);
+    /**
+     * Send item hashes in digests of at most SYNC_CHUNK_SIZE bytes
+     * @return false on socket error
+     */
+    bool sendItemHashes(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                        const std::map<std::string, std::map<std::string, uint64_t>>& hashes);
+
+    void onShutdown(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const DeviceId& device);
+    void onSyncMsg(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const SyncMsg& msg);
+    void onDigest(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const SyncDigest& digest);
 };
 
 SyncModule::Impl::Impl(std::weak_ptr<JamiAccount>&& account)
     : account_(account)
 {}
 
-void
-SyncModule::Impl::syncInfos(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
-                            const std::shared_ptr<SyncMsg>& syncMsg)
+std::shared_ptr<const SyncSnapshot>
+SyncModule::Impl::snapshot() const
 {
     auto acc = account_.lock();
     if (!acc)
-        return;
-    msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
-    std::error_code ec;
-    if (!syncMsg) {
-        // Send contacts infos
-        // This message can be big. TODO rewrite to only take UINT16_MAX bytes max or split it multiple
-        // messages. For now, write 3 messages (UINT16_MAX*3 should be enough for all informations).
-        if (auto info = acc->accountManager()->getInfo()) {
-            if (info->contacts) {
-                SyncMsg msg;
-                msg.ds = info->contacts->getSyncData();
-                msgpack::pack(buffer, msg);
-                socket->write(reinterpret_cast<const unsigned char*>(buffer.data()),
-                              buffer.size(),
-                              ec);
-                if (ec) {
-                    JAMI_ERROR("{:s}", ec.message());
-                    return;
-                }
-            }
-        }
-        buffer.clear();
-        // Sync conversations
-        auto c = ConversationModule::convInfos(acc->getAccountID());
-        if (!c.empty()) {
-            SyncMsg msg;
-            msg.c = std::move(c);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
-            }
-        }
-        buffer.clear();
-        // Sync requests
-        auto cr = ConversationModule::convRequests(acc->getAccountID());
-        if (!cr.empty()) {
-            SyncMsg msg;
-            msg.cr = std::move(cr);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
-            }
+        return {};
+    auto snapshot = std::make_shared<SyncSnapshot>();
+    auto& msg = snapshot->msg;
+    if (auto info = acc->accountManager()->getInfo())
+        if (info->contacts)
+            msg.ds = info->contacts->getSyncData();
+    msg.c = ConversationModule::convInfos(acc->getAccountID());
+    msg.cr = ConversationModule::convRequests(acc->getAccountID());
+    if (auto convModule = acc->convModule(true)) {
+        msg.p = convModule->convPreferences();
+        msg.ms = convModule->convMessageStatus();
+    }
+    snapshot->items = hashItems(msg);
+    return snapshot;
+}
+
+bool
+SyncModule::Impl::sendItems(
+    const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+    const SyncSnapshot& snapshot,
+    const std::function<bool(const std::string& category, const std::string& key, uint64_t hash)>& filter)
+{
+    SyncChunkWriter writer(socket);
+    auto sendCategory = [&](auto field, const char* category) {
+        const auto& items = snapshot.items.at(category);
+        for (const auto& [key, value] : snapshot.msg.*field) {
+            const auto& item = items.at(key);
+            if (filter(category, key, item.hash) && !writer.add(field, key, value, item.size))
+                return false;
         }
+        return true;
+    };
 
-        auto convModule = acc->convModule(true);
-        if (!convModule)
-            return;
-        // Sync conversation's preferences
-        auto p = convModule->convPreferences();
-        if (!p.empty()) {
-            SyncMsg msg;
-            msg.p = std::move(p);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
+    const auto& ds = snapshot.items.at(SYNC_DS);
+    auto it = ds.find(SYNC_DS);
+    if (it != ds.end() && filter(SYNC_DS, SYNC_DS, it->second.hash)
+        && !writer.add(snapshot.msg.ds, it->second.size))
+        return false;
+    return sendCategory(&SyncMsg::c, SYNC_CONVS) && sendCategory(&SyncMsg::cr, SYNC_REQUESTS)
+           && sendCategory(&SyncMsg::p, SYNC_PREFS) && sendCategory(&SyncMsg::ms, SYNC_STATUS)
+           && writer.flush();
+}
+
+bool
+SyncModule::Impl::sendDelta(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                            SyncState& state,
+                            const SyncSnapshot& snapshot)
+{
+    return sendItems(socket, snapshot, [&](const auto& category, const auto& key, uint64_t hash) {
+        auto known = state.known.find(category);
+        if (known == state.known.end())
+            return false; // Wait for the peer's digest
+        auto [it, inserted] = known->second.emplace(key, hash);
+        if (!inserted && it->second == hash)
+            return false;
+        it->second = hash;
+        return true;
+    });
+}
+
+bool
+SyncModule::Impl::sendItemHashes(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                                 const std::map<std::string, std::map<std::string, uint64_t>>& hashes)
+{
+    std::vector<SyncMsg> chunks(1);
+    size_t size = 0;
+    for (const auto& [category, items] : hashes) {
+        // Categories without items are sent too, the peer has to know it lacks them
+        chunks.back().dg.i[category];
+        for (const auto& [key, hash] : items) {
+            // Key, hash and msgpack overhead
+            auto itemSize = key.size() + category.size() + 16;
+            if (size && size + itemSize > SYNC_CHUNK_SIZE) {
+                chunks.emplace_back();
+                size = 0;
             }
+            size += itemSize;
+            chunks.back().dg.i[category].emplace(key, hash);
         }
-        buffer.clear();
-        // Sync read's status
-        auto ms = convModule->convMessageStatus();
-        if (!ms.empty()) {
-            SyncMsg msg;
-            msg.ms = std::move(ms);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
-            }
+    }
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        auto& chunk = chunks[i];
+        chunk.dg.v = SYNC_DIGEST_VERSION;
+        chunk.dg.m = i + 1 < chunks.size();
+        msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
+        msgpack::pack(buffer, chunk);
+        std::error_code ec;
+        socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
+        if (ec) {
+            JAMI_ERROR("{:s}", ec.message());
+            return false;
         }
-        buffer.clear();
+    }
+    return true;
+}
 
-    } else {
+void
+SyncModule::Impl::syncInfos(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                            const std::shared_ptr<SyncMsg>& syncMsg,
+                            std::shared_ptr<const SyncSnapshot> snapshot)
+{
+    if (syncMsg) {
+        msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
         msgpack::pack(buffer, *syncMsg);
+        std::error_code ec;
         socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-        if (ec)
+        if (ec) {
             JAMI_ERROR("{:s}", ec.message());
+            return;
+        }
+        // Avoid sending those items again with the next delta
+        std::lock_guard lk(syncConnectionsMtx_);
+        auto it = syncStates_.find(socket.get());
+        if (it != syncStates_.end() && it->second.protocol == SyncState::Protocol::Digest) {
+            for (const auto& [category, items] : hashItems(*syncMsg)) {
+                auto known = it->second.known.find(category);
+                if (known != it->second.known.end())
+                    for (const auto& [key, item] : items)
+                        known->second[key] = item.hash;
+            }
+        }
+        return;
     }
-}
 
-////////////////////////////////////////////////////////////////
+    {
+        std::lock_guard lk(syncConnectionsMtx_);
+        auto it = syncStates_.find(socket.get());
+        if (it != syncStates_.end() && it->second.protocol == SyncState::Protocol::Unknown) {
+            // Wait for the first message of the peer
+            it->second.pendingFull = true;
+            return;
+        }
+    }
+    if (!snapshot)
+        snapshot = this->snapshot();
+    if (!snapshot)
+        return;
 
-SyncModule::SyncModule(std::weak_ptr<JamiAccount>&& account)
-    : pimpl_ {std::make_shared<Impl>(std::move(account))}
-{}
+    std::lock_guard lk(syncConnectionsMtx_);
+    auto it = syncStates_.find(socket.get());
+    if (it != syncStates_.end() && it->second.protocol == SyncState::Protocol::Digest)
+        sendDelta(socket, it->second, *snapshot);
+    else
+        sendItems(socket, *snapshot, [](const auto&, const auto&, uint64_t) { return true; });
+}
 
 void
-SyncModule::cacheSyncConnection(std::shared_ptr<dhtnet::ChannelSocket>&& socket,
-                                const std::string& peerId,
-                                const DeviceId& device)
+SyncModule::Impl::onChannel(const std::shared_ptr<dhtnet::ChannelSocket>& socket,
+                            const std::string& peerId,
+                            const DeviceId& device)
 {
-    std::lock_guard lk(pimpl_->syncConnectionsMtx_);
-    pimpl_->syncConnections_[device].emplace_back(socket);
+    auto snapshot = this->snapshot();
+    if (!snapshot)
+        return;
 
-    socket->onShutdown([w = pimpl_->weak(), peerId, device, socket]() {
-        auto shared = w.lock();
-        if (!shared)
-            return;
-        std::lock_guard lk(shared->syncConnectionsMtx_);
-        auto& connections = shared->syncConnections_[device];
-        auto conn = connections.begin();
-        while (conn != connections.end()) {
-            if (*conn == socket)
-                conn = connections.erase(conn);
-            else
-                conn++;
-        }
-    });
+    std::lock_guard lk(syncConnectionsMtx_);
+    // The initiator gets the channel both from its connect callback and from
+    // onReady, only the first one registers it
+    if (!syncStates_.emplace(socket.get(), SyncState {}).second)
+        return;
+    syncConnections_[device].emplace_back(socket);
 
+    socket->onShutdown([w = weak(), device, socket]() {
+        if (auto shared = w.lock())
+            shared->onShutdown(socket, device);
+    });
 
     struct DecodingContext
     {
@@ -180,7 +433,7 @@ SyncModule::cacheSyncConnection(std::shared_ptr<dhtnet::ChannelSocket>&& socket,
                                512};
     };
 
-    socket->setOnRecv([acc = pimpl_->account_.lock(), device, peerId,
+    socket->setOnRecv([w = weak(), wsocket = std::weak_ptr(socket), acc = account_.lock(), device, peerId,
                        ctx = std::make_shared<DecodingContext>()
     ](const uint8_t* buf, size_t len) {
         if (!buf || !acc)
@@ -191,11 +444,15 @@ SyncModule::cacheSyncConnection(std::shared_ptr<dhtnet::ChannelSocket>&& socket,
         ctx->pac.buffer_consumed(len);
 
         msgpack::object_handle oh;
-        SyncMsg msg;
 
         try {
             while (ctx->pac.next(oh)) {
+                SyncMsg msg;
                 oh.get().convert(msg);
+                if (auto shared = w.lock())
+                    if (auto socket = wsocket.lock())
+                        shared->onSyncMsg(socket, msg);
+
                 if (auto manager = acc->accountManager())
                     manager->onSyncData(std::move(msg.ds), false);
 
@@ -210,7 +467,139 @@ SyncModule::cacheSyncConnection(std::shared_ptr<dhtnet::ChannelSocket>&& socket,
         return len;
     });
 
-    pimpl_->syncInfos(socket, nullptr);
+    // Announce what we have. The peer will reply with the details of the
+    // categories that differ, or, if too old to know about digests, with its
+    // whole state (and ignore this message).
+    SyncMsg hello;
+    hello.dg.v = SYNC_DIGEST_VERSION;
+    for (const auto& [category, items] : snapshot->items)
+        hello.dg.r[category] = rootHash(items);
+    syncInfos(socket, std::make_shared<SyncMsg>(std::move(hello)));
+}
+
+void
+SyncModule::Impl::onShutdown(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const DeviceId& device)
+{
+    // When sock is shutdown update syncConnections_ to be able to resync asap
+    std::lock_guard lk(syncConnectionsMtx_);
+    syncStates_.erase(socket.get());
+    auto& connections = syncConnections_[device];
+    auto conn = connections.begin();
+    while (conn != connections.end()) {
+        if (*conn == socket)
+            conn = connections.erase(conn);
+        else
+            conn++;
+    }
+    if (connections.empty())
+        syncConnections_.erase(device);
+}
+
+void
+SyncModule::Impl::onSyncMsg(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const SyncMsg& msg)
+{
+    std::lock_guard lk(syncConnectionsMtx_);
+    auto it = syncStates_.find(socket.get());
+    if (it == syncStates_.end())
+        return;
+    auto& state = it->second;
+    if (state.protocol == SyncState::Protocol::Unknown) {
+        if (msg.dg.v == 0) {
+            // The peer doesn't announce digests, it expects the whole state
+            state.protocol = SyncState::Protocol::Legacy;
+            state.pendingFull = false;
+            dht::ThreadPool::io().run([w = weak(), socket] {
+                if (auto shared = w.lock())
+                    shared->syncInfos(socket, nullptr);
+            });
+            return;
+        }
+        state.protocol = SyncState::Protocol::Digest;
+    }
+    if (state.protocol != SyncState::Protocol::Digest)
+        return;
+
+    // The peer has what it sent us
+    for (const auto& [category, items] : hashItems(msg)) {
+        auto known = state.known.find(category);
+        if (known != state.known.end())
+            for (const auto& [key, item] : items)
+                known->second[key] = item.hash;
+    }
+
+    // Only digests are of interest past this point. Item hashes can span
+    // several of them, handle them once the last part is received.
+    if (msg.dg.v == 0)
+        return;
+    for (const auto& [category, hashes] : msg.dg.i)
+        state.receiving[category].insert(hashes.begin(), hashes.end());
+    if (msg.dg.m)
+        return;
+    auto digest = msg.dg;
+    digest.i = std::move(state.receiving);
+    state.receiving.clear();
+
+    if (!digest.r.empty() || !digest.i.empty())
+        dht::ThreadPool::io().run([w = weak(), socket, digest = std::move(digest)] {
+            if (auto shared = w.lock())
+                shared->onDigest(socket, digest);
+        });
+}
+
+void
+SyncModule::Impl::onDigest(const std::shared_ptr<dhtnet::ChannelSocket>& socket, const SyncDigest& digest)
+{
+    auto snapshot = this->snapshot();
+    if (!snapshot)
+        return;
+
+    std::lock_guard lk(syncConnectionsMtx_);
+    auto it = syncStates_.find(socket.get());
+    if (it == syncStates_.end())
+        return;
+    auto& state = it->second;
+
+    if (!digest.r.empty()) {
+        // Categories with the same root are in sync. Send the item hashes
+        // of the others, so the peer sends us what we lack.
+        SyncMsg reply;
+        reply.dg.v = SYNC_DIGEST_VERSION;
+        for (const auto& [category, items] : snapshot->items) {
+            auto root = digest.r.find(category);
+            auto& target = root != digest.r.end() && root->second == rootHash(items)
+                               ? state.known[category]
+                               : reply.dg.i[category];
+            target.clear();
+            for (const auto& [key, item] : items)
+                target.emplace(key, item.hash);
+        }
+        if (!reply.dg.i.empty() && !sendItemHashes(socket, reply.dg.i))
+            return;
+    }
+
+    // Item hashes of the peer for the categories that differ
+    for (const auto& [category, hashes] : digest.i)
+        if (snapshot->items.find(category) != snapshot->items.end())
+            state.known[category] = hashes;
+
+    if (!digest.i.empty() || state.pendingFull) {
+        state.pendingFull = false;
+        sendDelta(socket, state, *snapshot);
+    }
+}
+
+////////////////////////////////////////////////////////////////
+
+SyncModule::SyncModule(std::weak_ptr<JamiAccount>&& account)
+    : pimpl_ {std::make_shared<Impl>(std::move(account))}
+{}
+
+void
+SyncModule::cacheSyncConnection(std::shared_ptr<dhtnet::ChannelSocket>&& socket,
+                                const std::string& peerId,
+                                const DeviceId& device)
+{
+    pimpl_->onChannel(socket, peerId, device);
 }
 
 void
@@ -220,41 +609,29 @@ SyncModule::syncWith(const DeviceId& deviceId,
 {
     if (!socket)
         return;
-    {
-        std::lock_guard lk(pimpl_->syncConnectionsMtx_);
-        socket->onShutdown([w = pimpl_->weak(), socket, deviceId]() {
-            // When sock is shutdown update syncConnections_ to be able to resync asap
-            auto shared = w.lock();
-            if (!shared)
-                return;
-            std::lock_guard lk(shared->syncConnectionsMtx_);
-            auto& connections = shared->syncConnections_[deviceId];
-            auto conn = connections.begin();
-            while (conn != connections.end()) {
-                if (*conn == socket)
-                    conn = connections.erase(conn);
-                else
-                    conn++;
-            }
-            if (connections.empty()) {
-                shared->syncConnections_.erase(deviceId);
-            }
-        });
-        pimpl_->syncConnections_[deviceId].emplace_back(socket);
-    }
-    pimpl_->syncInfos(socket, syncMsg);
+    auto cert = socket->peerCertificate();
+    if (!cert || !cert->issuer)
+        return;
+    // The whole state is exchanged from the digests announced by onChannel
+    pimpl_->onChannel(socket, cert->issuer->getId().toString(), deviceId);
+    if (syncMsg)
+        pimpl_->syncInfos(socket, syncMsg);
 }
 
 void
 SyncModule::syncWithConnected(const std::shared_ptr<SyncMsg>& syncMsg, const DeviceId& deviceId)
 {
+    // Built once for all devices
+    std::shared_ptr<const SyncSnapshot> snapshot;
     std::lock_guard lk(pimpl_->syncConnectionsMtx_);
     for (auto& [did, sockets] : pimpl_->syncConnections_) {
         if (not sockets.empty()) {
             if (!deviceId || deviceId == did) {
-                pimpl_->syncInfos(sockets[0], syncMsg);
+                if (!syncMsg && !snapshot)
+                    snapshot = pimpl_->snapshot();
+                pimpl_->syncInfos(sockets[0], syncMsg, snapshot);
             }
         }
     }
 }
-} // namespace jami
\ No newline at end of file
+} // namespace jami
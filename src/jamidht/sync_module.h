@@ -41,10 +41,11 @@ public:
                              const DeviceId& deviceId);
 
     /**
-     * Send sync informations to connected device
+     * Sync with a connected device. The channel is registered like with
+     * cacheSyncConnection if not already, which syncs the whole state.
      * @param deviceId      Connected device
      * @param socket        Related socket
-     * @param syncMsg       Default message
+     * @param syncMsg       Message to send in addition, if any
      */
     void syncWith(const DeviceId& deviceId,
                   const std::shared_ptr<dhtnet::ChannelSocket>& socket,
@@ -0,0 +1,280 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "kv_store.h"
+
+#include "fileutils.h"
+#include "logger.h"
+
+#include <opendht/thread_pool.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <vector>
+
+namespace jami {
+
+// The log is folded into the snapshot once bigger than both this and the snapshot
+static constexpr size_t MIN_COMPACT_SIZE {64 * 1024};
+
+// Log records are msgpack arrays: [key, value] to put, [key] to erase
+static constexpr char RECORD_PUT {'\x92'};
+static constexpr char RECORD_ERASE {'\x91'};
+
+std::shared_ptr<KvStore>
+KvStore::open(const std::filesystem::path& path)
+{
+    static std::mutex storesMtx;
+    static std::condition_variable storesCv;
+    static std::map<std::filesystem::path, std::weak_ptr<KvStore>> stores;
+
+    auto p = path.lexically_normal();
+    std::unique_lock lk(storesMtx);
+    for (auto it = stores.find(p); it != stores.end(); it = stores.find(p)) {
+        if (auto store = it->second.lock())
+            return store;
+        // Being closed, wait for its last commit
+        storesCv.wait(lk);
+    }
+    auto store = std::shared_ptr<KvStore>(new KvStore(p), [p](KvStore* store) {
+        delete store;
+        std::lock_guard lk(storesMtx);
+        stores.erase(p);
+        storesCv.notify_all();
+    });
+    stores.emplace(p, store);
+    return store;
+}
+
+KvStore::KvStore(const std::filesystem::path& path)
+    : path_(path)
+    , logPath_(path.string() + ".log")
+{
+    loadFromDisk();
+}
+
+KvStore::~KvStore()
+{
+    commit();
+}
+
+void
+KvStore::loadFromDisk()
+{
+    std::error_code ec;
+    try {
+        if (std::filesystem::is_regular_file(path_, ec)) {
+            auto file = fileutils::loadFile(path_);
+            snapshotSize_ = file.size();
+            auto oh = msgpack::unpack((const char*) file.data(), file.size());
+            const auto& map = oh.get();
+            if (map.type != msgpack::type::MAP)
+                throw msgpack::type_error();
+            for (uint32_t i = 0; i < map.via.map.size; ++i)
+                data_[pack(map.via.map.ptr[i].key)] = pack(map.via.map.ptr[i].val);
+        }
+    } catch (const std::exception& e) {
+        JAMI_WARNING("[KvStore] {}: unable to load snapshot: {}", path_.string(), e.what());
+    }
+
+    if (!std::filesystem::is_regular_file(logPath_, ec))
+        return;
+    std::vector<uint8_t> log;
+    try {
+        log = fileutils::loadFile(logPath_);
+        size_t offset = 0;
+        while (offset < log.size()) {
+            auto oh = msgpack::unpack((const char*) log.data(), log.size(), offset);
+            const auto& record = oh.get();
+            if (record.type != msgpack::type::ARRAY || record.via.array.size == 0
+                || record.via.array.size > 2)
+                throw msgpack::type_error();
+            auto key = pack(record.via.array.ptr[0]);
+            if (record.via.array.size == 2)
+                data_[std::move(key)] = pack(record.via.array.ptr[1]);
+            else
+                data_.erase(key);
+        }
+    } catch (const std::exception& e) {
+        // Most likely a record interrupted by a crash
+        JAMI_WARNING("[KvStore] {}: ignoring end of log: {}", logPath_.string(), e.what());
+    }
+    if (!log.empty())
+        compact();
+}
+
+size_t
+KvStore::size() const
+{
+    std::lock_guard lk(mutex_);
+    return data_.size();
+}
+
+void
+KvStore::appendRecord(const std::string& key, const std::string* value)
+{
+    // mutex_ MUST BE locked
+    pending_ += value ? RECORD_PUT : RECORD_ERASE;
+    pending_ += key;
+    if (value)
+        pending_ += *value;
+    if (!commitScheduled_) {
+        commitScheduled_ = true;
+        dht::ThreadPool::io().run([w = weak_from_this()] {
+            if (auto shared = w.lock())
+                shared->commit();
+        });
+    }
+}
+
+void
+KvStore::putRaw(std::string&& key, std::string&& value)
+{
+    std::lock_guard lk(mutex_);
+    auto it = data_.find(key);
+    if (it == data_.end()) {
+        appendRecord(key, &value);
+        data_.emplace(std::move(key), std::move(value));
+    } else if (it->second != value) {
+        appendRecord(key, &value);
+        it->second = std::move(value);
+    }
+}
+
+void
+KvStore::eraseRaw(std::string&& key)
+{
+    std::lock_guard lk(mutex_);
+    if (data_.erase(key))
+        appendRecord(key, nullptr);
+}
+
+void
+KvStore::assignRaw(std::map<std::string, std::string>&& entries)
+{
+    std::lock_guard lk(mutex_);
+    for (auto it = data_.begin(); it != data_.end();) {
+        if (entries.find(it->first) == entries.end()) {
+            appendRecord(it->first, nullptr);
+            it = data_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto& [key, value] : entries) {
+        auto& current = data_[key];
+        if (current != value) {
+            appendRecord(key, &value);
+            current = std::move(value);
+        }
+    }
+}
+
+std::optional<std::string>
+KvStore::getRaw(const std::string& key) const
+{
+    std::lock_guard lk(mutex_);
+    auto it = data_.find(key);
+    if (it == data_.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void
+KvStore::scanRaw(const std::string& from,
+                 const std::string& to,
+                 const std::function<bool(const std::string&, const std::string&)>& cb) const
+{
+    // Copy the range, so that cb can use the store
+    std::vector<std::pair<std::string, std::string>> entries;
+    {
+        std::lock_guard lk(mutex_);
+        auto begin = from.empty() ? data_.begin() : data_.lower_bound(from);
+        auto end = to.empty() ? data_.end() : data_.lower_bound(to);
+        for (auto it = begin; it != end && (to.empty() || it->first < to); ++it)
+            entries.emplace_back(*it);
+    }
+    for (const auto& [key, value] : entries)
+        if (!cb(key, value))
+            break;
+}
+
+void
+KvStore::onDecodeError(const std::exception& e) const
+{
+    JAMI_WARNING("[KvStore] {}: unable to decode entry: {}", path_.string(), e.what());
+}
+
+void
+KvStore::commit()
+{
+    std::lock_guard fk(fileMutex_);
+    std::string batch;
+    {
+        std::lock_guard lk(mutex_);
+        batch.swap(pending_);
+        commitScheduled_ = false;
+    }
+    if (batch.empty())
+        return;
+
+    // Flushed to the disk before returning: committed updates survive a crash
+    if (!fileutils::writeFileSync(logPath_, batch, true)) {
+        JAMI_ERROR("[KvStore] {}: unable to write log", logPath_.string());
+        // The snapshot contains everything
+        compact();
+        return;
+    }
+    logSize_ += batch.size();
+    if (logSize_ > std::max(snapshotSize_, MIN_COMPACT_SIZE))
+        compact();
+}
+
+void
+KvStore::compact()
+{
+    // fileMutex_ MUST BE locked, or the store not shared yet
+    std::string snapshot;
+    {
+        std::lock_guard lk(mutex_);
+        msgpack::sbuffer header;
+        msgpack::packer<msgpack::sbuffer> pk(&header);
+        pk.pack_map(data_.size());
+        size_t size = header.size();
+        for (const auto& [key, value] : data_)
+            size += key.size() + value.size();
+        snapshot.reserve(size);
+        snapshot.append(header.data(), header.size());
+        for (const auto& [key, value] : data_) {
+            snapshot += key;
+            snapshot += value;
+        }
+    }
+
+    // The log is only dropped once the new snapshot is on the disk
+    if (!fileutils::replaceFileSync(path_, snapshot)) {
+        JAMI_ERROR("[KvStore] {}: unable to replace snapshot", path_.string());
+        return;
+    }
+    // Records still pending are in the snapshot too: replaying them later is harmless
+    std::ofstream log(logPath_, std::ios::trunc | std::ios::binary);
+    snapshotSize_ = snapshot.size();
+    logSize_ = 0;
+}
+
+} // namespace jami
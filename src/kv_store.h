@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+
+#include <msgpack.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace jami {
+
+/**
+ * Small embedded key-value store, persisting a map without rewriting it on
+ * every change.
+ *
+ * Keys and values are stored msgpack-serialized. On disk, the store is a
+ * snapshot, laid out like msgpack::pack() of a std::map (so existing files
+ * can be opened as is), and a write-ahead log of the updates made since,
+ * next to it (path + ".log").
+ *
+ * Updates are applied in memory and queued; a single background commit
+ * appends all the updates queued meanwhile to the log and flushes it to the
+ * disk (group commit), so callers never wait for the disk. The log is folded
+ * into the snapshot once it outgrows it; the new snapshot is flushed before
+ * the log is dropped.
+ *
+ * Entries are ordered by serialized key. For keys of the same type and
+ * length (ids, hashes) it is their natural order.
+ */
+class KvStore : public std::enable_shared_from_this<KvStore>
+{
+public:
+    /**
+     * Open the store saved at path, creating it if needed.
+     * Stores are shared: opening a path already opened returns the same instance.
+     */
+    static std::shared_ptr<KvStore> open(const std::filesystem::path& path);
+
+    /** Commit pending updates */
+    ~KvStore();
+
+    const std::filesystem::path& path() const { return path_; }
+
+    template<typename K, typename V>
+    void put(const K& key, const V& value)
+    {
+        putRaw(pack(key), pack(value));
+    }
+
+    template<typename K>
+    void erase(const K& key)
+    {
+        eraseRaw(pack(key));
+    }
+
+    template<typename V, typename K>
+    std::optional<V> get(const K& key) const
+    {
+        auto value = getRaw(pack(key));
+        if (!value)
+            return std::nullopt;
+        return unpack<V>(*value);
+    }
+
+    /**
+     * Call cb for every entry with from <= key < to, in key order,
+     * until it returns false.
+     */
+    template<typename K, typename V>
+    void scan(const K& from, const K& to, const std::function<bool(K&&, V&&)>& cb) const
+    {
+        scanRaw(pack(from), pack(to), [&](const std::string& key, const std::string& value) {
+            return cb(unpack<K>(key), unpack<V>(value));
+        });
+    }
+
+    /**
+     * Decode all entries. Entries that can't be decoded are skipped.
+     */
+    template<typename K, typename V>
+    std::map<K, V> load() const
+    {
+        std::map<K, V> ret;
+        scanRaw({}, {}, [&](const std::string& key, const std::string& value) {
+            try {
+                ret.emplace(unpack<K>(key), unpack<V>(value));
+            } catch (const std::exception& e) {
+                onDecodeError(e);
+            }
+            return true;
+        });
+        return ret;
+    }
+
+    /**
+     * Replace the whole content by entries. Only the entries that
+     * changed are written.
+     */
+    template<typename Map>
+    void assign(const Map& entries)
+    {
+        std::map<std::string, std::string> raw;
+        for (const auto& [key, value] : entries)
+            raw.emplace(pack(key), pack(value));
+        assignRaw(std::move(raw));
+    }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Write pending updates to the disk now, returns once they are flushed
+     */
+    void commit();
+
+private:
+    NON_COPYABLE(KvStore);
+    explicit KvStore(const std::filesystem::path& path);
+
+    template<typename T>
+    static std::string pack(const T& v)
+    {
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, v);
+        return {buffer.data(), buffer.size()};
+    }
+
+    template<typename T>
+    static T unpack(const std::string& data)
+    {
+        auto oh = msgpack::unpack(data.data(), data.size());
+        return oh.get().as<T>();
+    }
+
+    void putRaw(std::string&& key, std::string&& value);
+    void eraseRaw(std::string&& key);
+    std::optional<std::string> getRaw(const std::string& key) const;
+    /** Empty bounds are unbounded */
+    void scanRaw(const std::string& from,
+                 const std::string& to,
+                 const std::function<bool(const std::string&, const std::string&)>& cb) const;
+    void assignRaw(std::map<std::string, std::string>&& entries);
+    void onDecodeError(const std::exception& e) const;
+
+    void loadFromDisk();
+    void appendRecord(const std::string& key, const std::string* value);
+    void compact();
+
+    const std::filesystem::path path_;
+    const std::filesystem::path logPath_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::string> data_;
+    // Log records not yet committed
+    std::string pending_;
+    bool commitScheduled_ {false};
+
+    // Serializes disk writes
+    std::mutex fileMutex_;
+    size_t snapshotSize_ {0};
+    size_t logSize_ {0};
+};
+
+} // namespace jami
@@ -55,6 +55,7 @@
 #include "im/instant_messaging.h"
 
 #include "config/yamlparser.h"
+#include "config/config_writer.h"
 
 #if HAVE_ALSA
 #include "audio/alsa/alsalayer.h"
@@ -81,6 +82,9 @@
 #include "libav_utils.h"
 #ifdef ENABLE_VIDEO
 #include "video/video_scaler.h"
+#ifdef RING_ACCEL
+#include "video/accel.h"
+#endif
 #include "video/sinkclient.h"
 #include "video/video_base.h"
 #include "media/video/video_mixer.h"
@@ -122,6 +126,7 @@
 #include <memory>
 #include <mutex>
 #include <list>
+#include <set>
 #include <random>
 
 #ifndef JAMI_DATADIR
@@ -298,6 +303,15 @@ struct Manager::ManagerPimpl
 
     bool parseConfiguration();
 
+#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+    /**
+     * Open the hardware devices and codecs usable by the enabled accounts'
+     * video codecs in the background, so that the first call does not wait
+     * for them.
+     */
+    void prewarmHardwareAccel();
+#endif
+
     /*
      * Play one tone
      * @return false if the driver is uninitialize
@@ -365,6 +379,14 @@ struct Manager::ManagerPimpl
     /** Main scheduler */
     ScheduledExecutor scheduler_ {"manager"};
 
+    /** Serialize the accounts section of the configuration to YAML */
+    std::string serializeAccounts();
+
+    /** Debounced writes of the configuration file, on the scheduler */
+    ConfigWriter configWriter_ {scheduler_};
+    /** Set once every section was given to configWriter_ */
+    std::atomic_bool configSaved_ {false};
+
     std::atomic_bool autoAnswer_ {false};
 
     /** Application wide tone controller */
@@ -468,6 +490,30 @@ Manager::ManagerPimpl::ManagerPimpl(Manager& base)
     });
 }
 
+#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+void
+Manager::ManagerPimpl::prewarmHardwareAccel()
+{
+    bool decoding = base_.videoPreferences.getDecodingAccelerated();
+    bool encoding = base_.videoPreferences.getEncodingAccelerated();
+    if (not decoding and not encoding)
+        return;
+
+    std::set<AVCodecID> codecs;
+    for (const auto& account : base_.getAllAccounts()) {
+        if (not account->isEnabled() or not account->isVideoEnabled())
+            continue;
+        for (const auto& codec : account->getActiveAccountCodecInfoList(MEDIA_VIDEO))
+            codecs.emplace(static_cast<AVCodecID>(codec->avcodecId));
+    }
+
+    // An empty set releases the devices kept by a previous prewarm
+    dht::ThreadPool::io().run([codecs = std::move(codecs), decoding, encoding] {
+        video::HardwareAccel::prewarm(codecs, decoding, encoding, 1280, 720);
+    });
+}
+#endif
+
 bool
 Manager::ManagerPimpl::parseConfiguration()
 {
@@ -912,10 +958,13 @@ Manager::finish() noexcept
         }
 
         saveConfig();
+        pimpl_->configWriter_.flush();
 
         // Disconnect accounts, close link stacks and free allocated ressources
         unregisterAccounts();
         accountFactory.clear();
+        // Nothing to save past this point, accounts are gone
+        pimpl_->configWriter_.cancel();
 
         {
             std::lock_guard lock(pimpl_->audioLayerMutex_);
@@ -928,12 +977,19 @@ Manager::finish() noexcept
         pimpl_->scheduler_.stop();
         dht::ThreadPool::io().join();
         dht::ThreadPool::computation().join();
+        // Deliver the batched signals whose flush was scheduled
+        flushSignalBatches();
 
         // IceTransportFactory should be stopped after the io pool
         // as some ICE are destroyed in a ioPool (see ConnectionManager)
         // Also, it must be called before pj_shutdown to avoid any problem
         pimpl_->ice_tf_.reset();
 
+#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+        // No codec left past the thread pools, drop the shared devices
+        video::HardwareAccel::releaseDevices();
+#endif
+
         // NOTE: sipLink_->shutdown() is needed because this will perform
         // sipTransportBroker->shutdown(); which will call Manager::instance().sipVoIPLink()
         // so the pointer MUST NOT be resetted at this point
@@ -1784,60 +1840,91 @@ Manager::saveConfig(const std::shared_ptr<Account>& acc)
     if (auto ringAcc = std::dynamic_pointer_cast<JamiAccount>(acc))
         ringAcc->saveConfig();
     else
-        saveConfig();
+        saveConfig(CONFIG_ACCOUNTS);
 }
 
-void
-Manager::saveConfig()
+/**
+ * Serializer of a preference section, working on a copy taken by the caller
+ */
+template<typename Preference>
+static ConfigWriter::Serializer
+preferenceSerializer(const Preference& preference)
 {
-    JAMI_DBG("Saving Configuration to XDG directory %s", pimpl_->path_.c_str());
-
-    if (pimpl_->audiodriver_) {
-        audioPreference.setVolumemic(pimpl_->audiodriver_->getCaptureGain());
-        audioPreference.setVolumespkr(pimpl_->audiodriver_->getPlaybackGain());
-        audioPreference.setCaptureMuted(pimpl_->audiodriver_->isCaptureMuted());
-        audioPreference.setPlaybackMuted(pimpl_->audiodriver_->isPlaybackMuted());
-    }
-
-    try {
+    return [preference] {
         YAML::Emitter out;
+        out << YAML::BeginMap;
+        preference.serialize(out);
+        out << YAML::EndMap;
+        return std::string(out.c_str(), out.size()) + '\n';
+    };
+}
 
-        // FIXME maybe move this into accountFactory?
-        out << YAML::BeginMap << YAML::Key << "accounts";
-        out << YAML::Value << YAML::BeginSeq;
+void
+Manager::saveConfig(unsigned sections)
+{
+    auto& writer = pimpl_->configWriter_;
+    const auto& path = pimpl_->path_;
 
-        for (const auto& account : accountFactory.getAllAccounts()) {
-            if (auto jamiAccount = std::dynamic_pointer_cast<JamiAccount>(account)) {
-                auto accountConfig = jamiAccount->getPath() / "config.yml";
-                if (not std::filesystem::is_regular_file(accountConfig)) {
-                    saveConfig(jamiAccount);
-                }
-            } else {
-                account->config().serialize(out);
-            }
-        }
-        out << YAML::EndSeq;
+    // The first write must hold every section
+    if (not pimpl_->configSaved_.exchange(true))
+        sections = CONFIG_ALL;
 
+    // Setters change the preferences without lock: they are copied here, on
+    // the thread that changed them, and only the copies are serialized later
+    if (sections & CONFIG_ACCOUNTS) {
+        // Account configurations are serialized under their own lock
+        writer.save(path, "accounts", [this] { return pimpl_->serializeAccounts(); });
+    }
+    if (sections & CONFIG_PREFERENCES) {
         // FIXME: this is a hack until we get rid of accountOrder
         preferences.verifyAccountOrder(getAccountList());
-        preferences.serialize(out);
-        voipPreferences.serialize(out);
-        audioPreference.serialize(out);
+        writer.save(path, "preferences", preferenceSerializer(preferences));
+    }
+    if (sections & CONFIG_VOIP)
+        writer.save(path, "voip", preferenceSerializer(voipPreferences));
+    if (sections & CONFIG_AUDIO) {
+        if (auto& driver = pimpl_->audiodriver_) {
+            audioPreference.setVolumemic(driver->getCaptureGain());
+            audioPreference.setVolumespkr(driver->getPlaybackGain());
+            audioPreference.setCaptureMuted(driver->isCaptureMuted());
+            audioPreference.setPlaybackMuted(driver->isPlaybackMuted());
+        }
+        writer.save(path, "audio", preferenceSerializer(audioPreference));
+    }
 #ifdef ENABLE_VIDEO
-        videoPreferences.serialize(out);
+    if (sections & CONFIG_VIDEO)
+        writer.save(path, "video", preferenceSerializer(videoPreferences));
 #endif
 #ifdef ENABLE_PLUGIN
-        pluginPreferences.serialize(out);
+    if (sections & CONFIG_PLUGINS)
+        writer.save(path, "plugins", preferenceSerializer(pluginPreferences));
 #endif
+}
 
-        std::lock_guard lock(dhtnet::fileutils::getFileLock(pimpl_->path_));
-        std::ofstream fout(pimpl_->path_);
-        fout.write(out.c_str(), out.size());
-    } catch (const YAML::Exception& e) {
-        JAMI_ERR("%s", e.what());
-    } catch (const std::runtime_error& e) {
-        JAMI_ERR("%s", e.what());
+std::string
+Manager::ManagerPimpl::serializeAccounts()
+{
+    JAMI_DBG("Saving Configuration to XDG directory %s", path_.c_str());
+
+    YAML::Emitter out;
+
+    // FIXME maybe move this into accountFactory?
+    out << YAML::BeginMap << YAML::Key << "accounts";
+    out << YAML::Value << YAML::BeginSeq;
+
+    for (const auto& account : base_.accountFactory.getAllAccounts()) {
+        if (auto jamiAccount = std::dynamic_pointer_cast<JamiAccount>(account)) {
+            auto accountConfig = jamiAccount->getPath() / "config.yml";
+            if (not std::filesystem::is_regular_file(accountConfig)) {
+                base_.saveConfig(jamiAccount);
+            }
+        } else {
+            account->serializeConfig(out);
+        }
     }
+    out << YAML::EndSeq << YAML::EndMap;
+
+    return std::string(out.c_str(), out.size()) + '\n';
 }
 
 // THREAD=Main | VoIPLink
@@ -2213,7 +2300,7 @@ Manager::setAudioPlugin(const std::string& audioPlugin)
         pimpl_->initAudioDriver();
     }
     // Recreate audio driver with new settings
-    saveConfig();
+    saveConfig(CONFIG_AUDIO);
 }
 
 /**
@@ -2238,7 +2325,7 @@ Manager::setAudioDevice(int index, AudioDeviceType type)
     // Recreate audio driver with new settings
     pimpl_->audiodriver_.reset();
     pimpl_->initAudioDriver();
-    saveConfig();
+    saveConfig(CONFIG_AUDIO);
 }
 
 /**
@@ -2335,7 +2422,7 @@ void
 Manager::setIsAlwaysRecording(bool isAlwaysRec)
 {
     audioPreference.setIsAlwaysRecording(isAlwaysRec);
-    saveConfig();
+    saveConfig(CONFIG_AUDIO);
 }
 
 bool
@@ -2403,7 +2490,7 @@ Manager::setHistoryLimit(int days)
 {
     JAMI_DBG("Set history limit");
     preferences.setHistoryLimit(days);
-    saveConfig();
+    saveConfig(CONFIG_PREFERENCES);
 }
 
 int
@@ -2417,7 +2504,7 @@ Manager::setRingingTimeout(int timeout)
 {
     JAMI_DBG("Set ringing timeout");
     preferences.setRingingTimeout(timeout);
-    saveConfig();
+    saveConfig(CONFIG_PREFERENCES);
 }
 
 int
@@ -2448,7 +2535,7 @@ Manager::setAudioManager(const std::string& api)
         pimpl_->initAudioDriver();
     }
 
-    saveConfig();
+    saveConfig(CONFIG_AUDIO);
 
     // ensure that we completed the transition (i.e. no fallback was used)
     return api == audioPreference.getAudioApi();
@@ -2701,7 +2788,7 @@ Manager::setAccountsOrder(const std::string& order)
 
     preferences.setAccountOrder(order);
 
-    saveConfig();
+    saveConfig(CONFIG_PREFERENCES);
 
     emitSignal<libjami::ConfigurationSignal::AccountsChanged>();
 }
@@ -2970,6 +3057,9 @@ Manager::registerAccounts()
         if (a->isUsable())
             a->doRegister();
     }
+#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+    pimpl_->prewarmHardwareAccel();
+#endif
 }
 
 void
@@ -2986,6 +3076,9 @@ Manager::sendRegister(const std::string& accountID, bool enable)
         acc->doRegister();
     } else
         acc->doUnregister();
+#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+    pimpl_->prewarmHardwareAccel();
+#endif
 }
 
 uint64_t
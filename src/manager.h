@@ -321,9 +321,23 @@ public:
     void removeAudio(Call& call);
 
     /**
-     * Save config to file
+     * Sections of the main configuration file, saved independently
      */
-    void saveConfig();
+    enum ConfigSection : unsigned {
+        CONFIG_ACCOUNTS = 1 << 0,
+        CONFIG_PREFERENCES = 1 << 1,
+        CONFIG_VOIP = 1 << 2,
+        CONFIG_AUDIO = 1 << 3,
+        CONFIG_VIDEO = 1 << 4,
+        CONFIG_PLUGINS = 1 << 5,
+        CONFIG_ALL = (1 << 6) - 1,
+    };
+
+    /**
+     * Save config to file. Preferences of the given sections are copied on the
+     * calling thread; the file is written later, on the scheduler.
+     */
+    void saveConfig(unsigned sections = CONFIG_ALL);
     void saveConfig(const std::shared_ptr<Account>& acc);
 
     /**
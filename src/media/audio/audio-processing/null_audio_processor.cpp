@@ -38,7 +38,7 @@ NullAudioProcessor::getProcessed()
         return {};
     }
 
-    playbackQueue_.dequeue();
+    playbackQueue_.discard(playbackQueue_.frameSize());
     return recordQueue_.dequeue();
 };
 
@@ -52,6 +52,7 @@ SpeexAudioProcessor::SpeexAudioProcessor(AudioFormat format, unsigned frameSize)
                                          (int) format_.nb_channels),
                 &speex_echo_state_destroy)
     , procBuffer(std::make_unique<AudioFrame>(format.withSampleFormat(AV_SAMPLE_FMT_S16P), frameSize_))
+    , playbackBuffer(std::make_unique<AudioFrame>(format_, frameSize_))
 {
     JAMI_DBG("[speex-dsp] SpeexAudioProcessor, frame size = %d (=%d ms), channels = %d",
              frameSize,
@@ -187,10 +188,16 @@ SpeexAudioProcessor::getProcessed()
         return {};
     }
 
-    auto playback = playbackQueue_.dequeue();
-    auto record = recordQueue_.dequeue();
+    if (shouldAEC) {
+        if (!playbackQueue_.dequeue(*playbackBuffer, frameSize_))
+            return {};
+    } else {
+        // playback is only needed as the echo reference
+        playbackQueue_.discard(frameSize_);
+    }
 
-    if (!playback || !record) {
+    auto record = recordQueue_.dequeue();
+    if (!record) {
         return {};
     }
 
@@ -201,7 +208,7 @@ SpeexAudioProcessor::getProcessed()
         processed = std::make_shared<AudioFrame>(record->getFormat(), record->getFrameSize());
         speex_echo_cancellation(echoState.get(),
                                 (int16_t*) record->pointer()->data[0],
-                                (int16_t*) playback->pointer()->data[0],
+                                (int16_t*) playbackBuffer->pointer()->data[0],
                                 (int16_t*) processed->pointer()->data[0]);
     } else {
         // don't want to echo cancel, so just use record frame instead
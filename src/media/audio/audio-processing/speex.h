@@ -57,6 +57,8 @@ private:
     std::vector<SpeexPreprocessStatePtr> preprocessorStates;
 
     std::unique_ptr<AudioFrame> procBuffer {};
+    // echo reference, reused for every frame
+    std::unique_ptr<AudioFrame> playbackBuffer {};
     Resampler deinterleaveResampler;
     Resampler interleaveResampler;
 
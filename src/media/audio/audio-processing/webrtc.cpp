@@ -21,6 +21,8 @@
 
 #include <webrtc/modules/audio_processing/include/audio_processing.h>
 
+#include <algorithm>
+
 namespace jami {
 
 inline size_t
@@ -33,6 +35,9 @@ constexpr int webrtcNoError = webrtc::AudioProcessing::kNoError;
 
 WebRTCAudioProcessor::WebRTCAudioProcessor(AudioFormat format, unsigned /* frameSize */)
     : AudioProcessor(format.withSampleFormat(AV_SAMPLE_FMT_FLTP), webrtcFrameSize(format))
+    , playbackBuffer_(format_, frameSize_ * MAX_BATCH_BLOCKS)
+    , playbackChannels_(format_.nb_channels)
+    , recordChannels_(format_.nb_channels)
 {
     JAMI_LOG("[webrtc-ap] WebRTCAudioProcessor, frame size = {:d} (={:d} ms), channels = {:d}",
              frameSize_,
@@ -131,41 +136,62 @@ WebRTCAudioProcessor::getProcessed()
 
     int driftSamples = playbackQueue_.samples() - recordQueue_.samples();
 
-    auto playback = playbackQueue_.dequeue();
-    auto record = recordQueue_.dequeue();
-    if (!playback || !record) {
+    // Process every complete 10 ms block available in both queues at once,
+    // so that the output follows the device period instead of the
+    // processor's fixed block size.
+    int blocks = std::min({recordQueue_.samples() / (int) frameSize_,
+                           playbackQueue_.samples() / (int) frameSize_,
+                           MAX_BATCH_BLOCKS});
+    int nbSamples = blocks * (int) frameSize_;
+
+    auto record = std::make_shared<AudioFrame>(format_, nbSamples);
+    if (!playbackQueue_.dequeue(playbackBuffer_, nbSamples)
+        || !recordQueue_.dequeue(*record, nbSamples)) {
         return {};
     }
     webrtc::StreamConfig sc((int) format_.sample_rate, (int) format_.nb_channels);
 
-    // process reverse in place
-    float** playData = (float**) playback->pointer()->extended_data;
-    if (apm->ProcessReverseStream(playData, sc, sc, playData) != webrtcNoError) {
-        JAMI_ERR("[webrtc-ap] ProcessReverseStream failed");
-    }
-
-    // process deinterleaved float recorded data
-    // TODO: maybe implement this to see if it's better than automatic drift compensation
-    // (it MUST be called prior to ProcessStream)
-    // delay = (t_render - t_analyze) + (t_process - t_capture)
-    if (apm->set_stream_delay_ms(0) != webrtcNoError) {
-        JAMI_ERR("[webrtc-ap] set_stream_delay_ms failed");
-    }
-
-    if (apm->gain_control()->set_stream_analog_level(analogLevel_) != webrtcNoError) {
-        JAMI_ERR("[webrtc-ap] set_stream_analog_level failed");
-    }
-    apm->echo_cancellation()->set_stream_drift_samples(driftSamples);
-
-    // process in place
-    float** recData = (float**) record->pointer()->extended_data;
-    if (apm->ProcessStream(recData, sc, sc, recData) != webrtcNoError) {
-        JAMI_ERR("[webrtc-ap] ProcessStream failed");
-    }
-
-    analogLevel_ = apm->gain_control()->stream_analog_level();
-    record->has_voice = apm->voice_detection()->is_enabled()
-                           && getStabilizedVoiceActivity(apm->voice_detection()->stream_has_voice());
+    auto playData = (float**) playbackBuffer_.pointer()->extended_data;
+    auto recData = (float**) record->pointer()->extended_data;
+    bool hasVoice = false;
+    for (int block = 0; block < blocks; ++block) {
+        auto offset = block * frameSize_;
+        for (unsigned c = 0; c < format_.nb_channels; ++c) {
+            playbackChannels_[c] = playData[c] + offset;
+            recordChannels_[c] = recData[c] + offset;
+        }
+
+        // process reverse in place
+        if (apm->ProcessReverseStream(playbackChannels_.data(), sc, sc, playbackChannels_.data())
+            != webrtcNoError) {
+            JAMI_ERR("[webrtc-ap] ProcessReverseStream failed");
+        }
+
+        // process deinterleaved float recorded data
+        // TODO: maybe implement this to see if it's better than automatic drift compensation
+        // (it MUST be called prior to ProcessStream)
+        // delay = (t_render - t_analyze) + (t_process - t_capture)
+        if (apm->set_stream_delay_ms(0) != webrtcNoError) {
+            JAMI_ERR("[webrtc-ap] set_stream_delay_ms failed");
+        }
+
+        if (apm->gain_control()->set_stream_analog_level(analogLevel_) != webrtcNoError) {
+            JAMI_ERR("[webrtc-ap] set_stream_analog_level failed");
+        }
+        apm->echo_cancellation()->set_stream_drift_samples(driftSamples);
+
+        // process in place
+        if (apm->ProcessStream(recordChannels_.data(), sc, sc, recordChannels_.data())
+            != webrtcNoError) {
+            JAMI_ERR("[webrtc-ap] ProcessStream failed");
+        }
+
+        analogLevel_ = apm->gain_control()->stream_analog_level();
+        // voice activity is stabilized per 10 ms block
+        hasVoice |= apm->voice_detection()->is_enabled()
+                    && getStabilizedVoiceActivity(apm->voice_detection()->stream_has_voice());
+    }
+    record->has_voice = hasVoice;
     return record;
 }
 
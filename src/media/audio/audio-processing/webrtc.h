@@ -20,6 +20,8 @@
 
 #include "audio_processor.h"
 
+#include <vector>
+
 namespace webrtc {
 class AudioProcessing;
 }
@@ -41,7 +43,18 @@ public:
     void enableVoiceActivityDetection(bool enabled) override;
 
 private:
+    /**
+     * Maximum number of 10 ms blocks processed by a single getProcessed()
+     * call, when the device delivers larger periods.
+     */
+    static constexpr int MAX_BATCH_BLOCKS = 8;
+
     std::unique_ptr<webrtc::AudioProcessing> apm;
     int analogLevel_ {0};
+
+    // reused for every call, playback is only analyzed and never returned
+    AudioFrame playbackBuffer_;
+    std::vector<float*> playbackChannels_;
+    std::vector<float*> recordChannels_;
 };
 } // namespace jami
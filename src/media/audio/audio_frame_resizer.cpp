@@ -26,7 +26,9 @@ extern "C" {
 #include <libavutil/audio_fifo.h>
 }
 
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
 
 namespace jami {
 
@@ -47,7 +49,7 @@ AudioFrameResizer::~AudioFrameResizer()
 int
 AudioFrameResizer::samples() const
 {
-    return av_audio_fifo_size(queue_);
+    return framesSamples_ + av_audio_fifo_size(queue_);
 }
 
 int
@@ -71,6 +73,9 @@ AudioFrameResizer::setFormat(const AudioFormat& format, int size)
         if (auto discarded = samples())
             JAMI_WARN("Discarding %d samples", discarded);
         av_audio_fifo_free(queue_);
+        frames_.clear();
+        framesOffset_ = 0;
+        framesSamples_ = 0;
         format_ = format;
         queue_ = av_audio_fifo_alloc(format.sampleFormat, format.nb_channels, frameSize_);
     }
@@ -88,21 +93,41 @@ AudioFrameResizer::setFrameSize(int frameSize)
 }
 
 void
-AudioFrameResizer::enqueue(std::shared_ptr<AudioFrame>&& frame)
+AudioFrameResizer::checkFormat(const AVFrame* f)
 {
-    if (not frame or frame->pointer() == nullptr)
-        return;
-
-    int ret = 0;
-    auto f = frame->pointer();
     AudioFormat format(f->sample_rate, f->ch_layout.nb_channels, (AVSampleFormat) f->format);
     if (format != format_) {
         JAMI_WARNING("Expected {} but got {}", format_.toString(), format.toString());
         setFormat(format, frameSize_);
     }
+}
 
+void
+AudioFrameResizer::write(const AVFrame* f)
+{
+    int ret = 0;
     auto nb_samples = samples();
-    if (cb_ && nb_samples == 0 && f->nb_samples == frameSize_) {
+
+    // queue reallocates itself if need be
+    if ((ret = av_audio_fifo_write(queue_, reinterpret_cast<void**>(f->extended_data), f->nb_samples)) < 0) {
+        JAMI_ERR() << "Audio resizer error: " << libav_utils::getError(ret);
+        throw std::runtime_error("Failed to add audio to frame resizer");
+    }
+
+    if (nextOutputPts_ == 0)
+        nextOutputPts_ = f->pts - nb_samples;
+}
+
+void
+AudioFrameResizer::enqueue(std::shared_ptr<AudioFrame>&& frame)
+{
+    if (not frame or frame->pointer() == nullptr)
+        return;
+
+    auto f = frame->pointer();
+    checkFormat(f);
+
+    if (cb_ && samples() == 0 && f->nb_samples == frameSize_) {
         nextOutputPts_ = frame->pointer()->pts + frameSize_;
         cb_(std::move(frame));
         return; // return if frame was just passed through
@@ -110,40 +135,138 @@ AudioFrameResizer::enqueue(std::shared_ptr<AudioFrame>&& frame)
 
     // voice activity
     hasVoice_ = frame->has_voice;
-
-    // queue reallocates itself if need be
-    if ((ret = av_audio_fifo_write(queue_, reinterpret_cast<void**>(f->data), f->nb_samples)) < 0) {
-        JAMI_ERR() << "Audio resizer error: " << libav_utils::getError(ret);
-        throw std::runtime_error("Failed to add audio to frame resizer");
+    if (not cb_ and av_audio_fifo_size(queue_) == 0) {
+        // Nothing copied after it yet: keep the frame instead of copying its samples
+        if (nextOutputPts_ == 0)
+            nextOutputPts_ = f->pts - samples();
+        framesSamples_ += f->nb_samples;
+        frames_.emplace_back(std::move(frame));
+        return;
     }
+    write(f);
 
-    if (nextOutputPts_ == 0)
-        nextOutputPts_ = frame->pointer()->pts - nb_samples;
+    if (cb_)
+        while (auto frame = dequeue())
+            cb_(std::move(frame));
+}
+
+void
+AudioFrameResizer::enqueue(const AudioFrame& frame)
+{
+    auto f = frame.pointer();
+    if (f == nullptr)
+        return;
+
+    checkFormat(f);
+    hasVoice_ = frame.has_voice;
+    write(f);
 
     if (cb_)
         while (auto frame = dequeue())
             cb_(std::move(frame));
 }
 
+bool
+AudioFrameResizer::read(uint8_t** data, int nbSamples)
+{
+    if (samples() < nbSamples)
+        return false;
+
+    // Frames kept by reference come first
+    int offset = 0;
+    while (offset < nbSamples and not frames_.empty()) {
+        auto f = frames_.front()->pointer();
+        auto n = std::min(nbSamples - offset, f->nb_samples - framesOffset_);
+        av_samples_copy(data,
+                        f->extended_data,
+                        offset,
+                        framesOffset_,
+                        n,
+                        format_.nb_channels,
+                        format_.sampleFormat);
+        offset += n;
+        framesOffset_ += n;
+        framesSamples_ -= n;
+        if (framesOffset_ == f->nb_samples) {
+            frames_.pop_front();
+            framesOffset_ = 0;
+        }
+    }
+    if (offset == nbSamples)
+        return true;
+
+    std::vector<uint8_t*> planes;
+    if (offset) {
+        auto planar = av_sample_fmt_is_planar(format_.sampleFormat);
+        auto step = av_get_bytes_per_sample(format_.sampleFormat)
+                    * (planar ? 1 : format_.nb_channels);
+        planes.resize(planar ? format_.nb_channels : 1);
+        for (size_t i = 0; i < planes.size(); ++i)
+            planes[i] = data[i] + offset * step;
+        data = planes.data();
+    }
+    int ret;
+    if ((ret = av_audio_fifo_read(queue_, reinterpret_cast<void**>(data), nbSamples - offset))
+        < 0) {
+        JAMI_ERR() << "Could not read samples from queue: " << libav_utils::getError(ret);
+        return false;
+    }
+    return true;
+}
+
 std::shared_ptr<AudioFrame>
 AudioFrameResizer::dequeue()
 {
     if (samples() < frameSize_)
         return {};
 
+    if (not frames_.empty() and framesOffset_ == 0
+        and frames_.front()->pointer()->nb_samples == frameSize_) {
+        // Already the right size, hand it over as is
+        auto frame = std::move(frames_.front());
+        frames_.pop_front();
+        framesSamples_ -= frameSize_;
+        nextOutputPts_ = frame->pointer()->pts + frameSize_;
+        return frame;
+    }
+
     auto frame = std::make_shared<AudioFrame>(format_, frameSize_);
-    int ret;
-    if ((ret = av_audio_fifo_read(queue_,
-                                  reinterpret_cast<void**>(frame->pointer()->data),
-                                  frameSize_))
-        < 0) {
-        JAMI_ERR() << "Could not read samples from queue: " << libav_utils::getError(ret);
+    if (not read(frame->pointer()->extended_data, frameSize_))
         return {};
-    }
     frame->pointer()->pts = nextOutputPts_;
     frame->has_voice = hasVoice_;
     nextOutputPts_ += frameSize_;
     return frame;
 }
 
+bool
+AudioFrameResizer::dequeue(AudioFrame& frame, int nbSamples)
+{
+    if (not read(frame.pointer()->extended_data, nbSamples))
+        return false;
+    frame.pointer()->pts = nextOutputPts_;
+    frame.has_voice = hasVoice_;
+    nextOutputPts_ += nbSamples;
+    return true;
+}
+
+void
+AudioFrameResizer::discard(int nbSamples)
+{
+    nbSamples = std::min(nbSamples, samples());
+    nextOutputPts_ += nbSamples;
+    while (nbSamples > 0 and not frames_.empty()) {
+        auto size = frames_.front()->pointer()->nb_samples;
+        auto n = std::min(nbSamples, size - framesOffset_);
+        framesOffset_ += n;
+        framesSamples_ -= n;
+        nbSamples -= n;
+        if (framesOffset_ == size) {
+            frames_.pop_front();
+            framesOffset_ = 0;
+        }
+    }
+    av_audio_fifo_drain(queue_, nbSamples);
+}
+
 } // namespace jami
@@ -24,10 +24,12 @@
 #include "media/media_buffer.h"
 #include "noncopyable.h"
 
+#include <deque>
 #include <mutex>
 
 extern "C" {
 struct AVAudioFifo;
+struct AVFrame;
 }
 
 namespace jami {
@@ -70,20 +72,45 @@ public:
      * Write @frame's data to the queue. The internal buffer will be reallocated if
      * there's not enough space for @frame's samples.
      *
-     * Returns the number of samples written, or negative on error.
+     * Without a callback, @frame is kept as is while no copied samples are queued
+     * after it, and dequeue() returns it without copying if it has @frameSize_ samples.
      *
      * NOTE @frame's format must match @format_, or this will fail.
      */
     void enqueue(std::shared_ptr<AudioFrame>&& frame);
 
+    /**
+     * Copy @frame's samples to the queue without taking a reference on it.
+     * Frames are never passed through to the callback.
+     */
+    void enqueue(const AudioFrame& frame);
+
     /**
      * Notifies owner of a new frame.
      */
     std::shared_ptr<AudioFrame> dequeue();
 
+    /**
+     * Read @nbSamples samples into @frame, which must already be allocated
+     * in @format_ and large enough to hold them. Allows callers to reuse
+     * their buffers instead of allocating a new frame each time.
+     *
+     * Returns false if fewer than @nbSamples samples are available.
+     */
+    bool dequeue(AudioFrame& frame, int nbSamples);
+
+    /**
+     * Drop up to @nbSamples samples from the queue.
+     */
+    void discard(int nbSamples);
+
 private:
     NON_COPYABLE(AudioFrameResizer);
 
+    void checkFormat(const AVFrame* f);
+    void write(const AVFrame* f);
+    bool read(uint8_t** data, int nbSamples);
+
     /**
      * Format used for input and output audio frames.
      */
@@ -103,6 +130,15 @@ private:
      * Audio queue operating on the sample level instead of byte level.
      */
     AVAudioFifo* queue_;
+
+    /**
+     * Frames queued by reference, older than the samples of @queue_.
+     * @framesOffset_ samples of the first one were already read.
+     */
+    std::deque<std::shared_ptr<AudioFrame>> frames_;
+    int framesOffset_ {0};
+    int framesSamples_ {0};
+
     int64_t nextOutputPts_ {0};
     bool hasVoice_ {false};
 };
@@ -25,6 +25,7 @@
 #include "fileutils.h" // access
 #include "manager.h"
 #include "media_decoder.h"
+#include "media_latency.h"
 #include "resampler.h"
 #include "ringbuffer.h"
 #include "ringbufferpool.h"
@@ -92,6 +93,7 @@ AudioInput::frameResized(std::shared_ptr<AudioFrame>&& ptr)
     std::shared_ptr<AudioFrame> frame = std::move(ptr);
     frame->pointer()->pts = sent_samples;
     sent_samples += frame->pointer()->nb_samples;
+    latency::stamp(frame->pointer());
 
     notify(std::static_pointer_cast<MediaFrame>(frame));
 }
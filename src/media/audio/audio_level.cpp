@@ -0,0 +1,230 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "audio_level.h"
+#include "media/rtp_header_extension.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace jami {
+
+// Level smoothing, per update (one packet, usually 20ms)
+static constexpr double ATTACK = 0.6;
+static constexpr double RELEASE = 0.15;
+// Long-term energy used to select the dominant speaker (~400ms)
+static constexpr double SCORE_SMOOTHING = 0.05;
+
+uint8_t
+audioLevelFromRms(float rms)
+{
+    if (not(rms > 0.f))
+        return AUDIO_LEVEL_SILENCE;
+    auto dBov = 20. * std::log10(rms);
+    return static_cast<uint8_t>(std::clamp(std::lround(-dBov), 0L, long(AUDIO_LEVEL_SILENCE)));
+}
+
+//     0                   1
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |  ID   | len=0 |V| level       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+int
+addAudioLevel(uint8_t* dst, size_t capacity, const uint8_t* src, size_t len, AudioLevel level)
+{
+    const uint8_t data = (level.voice ? 0x80 : 0) | std::min(level.level, AUDIO_LEVEL_SILENCE);
+    return addHeaderExtension(dst, capacity, src, len, AUDIO_LEVEL_EXTENSION_ID, &data, 1);
+}
+
+std::optional<AudioLevel>
+readAudioLevel(const uint8_t* buf, size_t len)
+{
+    size_t dataLen;
+    auto data = findHeaderExtension(buf, len, AUDIO_LEVEL_EXTENSION_ID, dataLen);
+    if (not data or dataLen != 1)
+        return {};
+    return AudioLevel {static_cast<uint8_t>(data[0] & 0x7f), (data[0] & 0x80) != 0};
+}
+
+bool
+ActiveSpeakerDetector::onLevel(const std::string& streamId,
+                               AudioLevel level,
+                               clock::time_point now)
+{
+    auto& speaker = speakers_[streamId];
+    double energy = -std::min(level.level, AUDIO_LEVEL_SILENCE);
+    if (not speaker.hasLevels or now - speaker.lastUpdate > STALE_AFTER) {
+        // (Re)starting: the long-term energy has to build up
+        speaker.energy = energy;
+        speaker.score = -AUDIO_LEVEL_SILENCE;
+    }
+    speaker.energy += (energy > speaker.energy ? ATTACK : RELEASE) * (energy - speaker.energy);
+    speaker.score += SCORE_SMOOTHING * (speaker.energy - speaker.score);
+    speaker.hasLevels = true;
+    speaker.lastUpdate = now;
+
+    // Hysteresis: once speaking, only the lower threshold applies
+    bool voice = speaker.energy >= -VOICE_OFF_LEVEL
+                 and (speaker.speaking or level.voice or speaker.energy >= -VOICE_ON_LEVEL);
+    auto changed = updateSpeaking(speaker, voice, now);
+    if (changed or now - lastEvaluation_ >= EVALUATION_INTERVAL)
+        changed |= evaluate(now);
+    return changed;
+}
+
+bool
+ActiveSpeakerDetector::onVoice(const std::string& streamId, bool voice, clock::time_point now)
+{
+    auto it = speakers_.find(streamId);
+    if (it != speakers_.end() and it->second.hasLevels
+        and now - it->second.lastUpdate <= STALE_AFTER)
+        return false;
+
+    auto& speaker = it != speakers_.end() ? it->second : speakers_[streamId];
+    speaker.hasLevels = false;
+    speaker.lastUpdate = now;
+    speaker.energy = speaker.score = -(voice ? FLAGGED_VOICE_LEVEL : AUDIO_LEVEL_SILENCE);
+    // The voice flag is already stabilized by the sender
+    auto changed = speaker.speaking != voice;
+    speaker.speaking = voice;
+    if (voice)
+        speaker.lastVoice = now;
+    if (changed or now - lastEvaluation_ >= EVALUATION_INTERVAL)
+        changed |= evaluate(now);
+    return changed;
+}
+
+bool
+ActiveSpeakerDetector::process(clock::time_point now)
+{
+    return evaluate(now);
+}
+
+bool
+ActiveSpeakerDetector::updateSpeaking(Speaker& speaker, bool voice, clock::time_point now)
+{
+    if (voice) {
+        speaker.lastVoice = now;
+        if (speaker.speaking)
+            return false;
+        speaker.speaking = true;
+        return true;
+    }
+    if (speaker.speaking and now - speaker.lastVoice >= HANGOVER) {
+        speaker.speaking = false;
+        return true;
+    }
+    return false;
+}
+
+bool
+ActiveSpeakerDetector::evaluate(clock::time_point now)
+{
+    lastEvaluation_ = now;
+    bool changed = false;
+
+    const std::string* best = nullptr;
+    double bestScore = -AUDIO_LEVEL_SILENCE;
+    for (auto& [id, speaker] : speakers_) {
+        if (speaker.hasLevels and now - speaker.lastUpdate > STALE_AFTER) {
+            speaker.energy = speaker.score = -AUDIO_LEVEL_SILENCE;
+            changed |= updateSpeaking(speaker, false, now);
+        }
+        if (speaker.speaking and (not best or speaker.score > bestScore)) {
+            best = &id;
+            bestScore = speaker.score;
+        }
+    }
+
+    // Keep the current dominant speaker when nobody speaks
+    if (not best or *best == dominant_)
+        return changed;
+    if (not dominant_.empty()) {
+        if (now - dominantSince_ < MIN_DWELL)
+            return changed;
+        auto current = speakers_.find(dominant_);
+        if (current != speakers_.end() and current->second.speaking
+            and bestScore < current->second.score + SWITCH_MARGIN)
+            return changed;
+    }
+    dominant_ = *best;
+    dominantSince_ = now;
+    return true;
+}
+
+bool
+ActiveSpeakerDetector::remove(std::string_view streamId)
+{
+    auto it = speakers_.find(streamId);
+    if (it == speakers_.end())
+        return false;
+    auto changed = it->second.speaking;
+    speakers_.erase(it);
+    if (dominant_ == streamId) {
+        dominant_.clear();
+        changed = true;
+    }
+    return changed;
+}
+
+bool
+ActiveSpeakerDetector::retainVoiceStreams(const std::vector<std::string_view>& streamIds)
+{
+    bool changed = false;
+    for (auto it = speakers_.begin(); it != speakers_.end();) {
+        if (it->second.hasLevels
+            or std::find(streamIds.begin(), streamIds.end(), it->first) != streamIds.end()) {
+            ++it;
+            continue;
+        }
+        changed |= it->second.speaking;
+        if (dominant_ == it->first) {
+            dominant_.clear();
+            changed = true;
+        }
+        it = speakers_.erase(it);
+    }
+    return changed;
+}
+
+std::optional<bool>
+ActiveSpeakerDetector::isSpeaking(std::string_view streamId) const
+{
+    auto it = speakers_.find(streamId);
+    if (it == speakers_.end())
+        return {};
+    return it->second.speaking;
+}
+
+bool
+ActiveSpeakerDetector::reportsLevels(std::string_view streamId) const
+{
+    auto it = speakers_.find(streamId);
+    return it != speakers_.end() and it->second.hasLevels;
+}
+
+std::optional<uint8_t>
+ActiveSpeakerDetector::level(std::string_view streamId) const
+{
+    auto it = speakers_.find(streamId);
+    if (it == speakers_.end())
+        return {};
+    return static_cast<uint8_t>(std::lround(std::clamp(-it->second.energy, 0., double(AUDIO_LEVEL_SILENCE))));
+}
+
+} // namespace jami
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Client-to-mixer audio level (RFC 6464).
+ *
+ * The level of the audio carried by each outgoing packet is added to its
+ * RTP header, in -dBov (0 is the loudest, 127 silence), along with the
+ * voice activity flag of the sender. A conference host reads it before
+ * decryption, so that it knows who speaks without decoding every stream.
+ *
+ * As for the other header extensions, the identifier is fixed instead of
+ * negotiated in the SDP.
+ */
+static constexpr uint8_t AUDIO_LEVEL_EXTENSION_ID {1};
+// Size of the element, the extension header (RTP_EXTENSION_HEADER_SIZE)
+// comes on top for the first element of a packet
+static constexpr unsigned AUDIO_LEVEL_EXTENSION_SIZE {4};
+static constexpr uint8_t AUDIO_LEVEL_SILENCE {127};
+
+struct AudioLevel
+{
+    uint8_t level {AUDIO_LEVEL_SILENCE};
+    bool voice {false};
+};
+
+/**
+ * Level of a signal from its RMS value (1.0 being the full scale).
+ */
+uint8_t audioLevelFromRms(float rms);
+
+/**
+ * Copy an RTP packet, adding the audio level element to its header extension.
+ * @return the size of the new packet, -1 on failure
+ */
+int addAudioLevel(uint8_t* dst, size_t capacity, const uint8_t* src, size_t len, AudioLevel level);
+
+std::optional<AudioLevel> readAudioLevel(const uint8_t* buf, size_t len);
+
+/**
+ * Follows the energy of each stream of a conference to tell who is speaking
+ * and who is the dominant speaker.
+ *
+ * Levels are smoothed, with a fast attack and a slow release. A stream
+ * starts speaking above VOICE_ON_LEVEL (or above VOICE_OFF_LEVEL if the
+ * sender flagged voice), and stops once below VOICE_OFF_LEVEL for longer
+ * than HANGOVER. The dominant speaker is the speaking stream with the
+ * highest long-term energy: it only changes after MIN_DWELL, and for a
+ * stream at least SWITCH_MARGIN louder, so that short interjections or
+ * noises don't make the layout flicker.
+ *
+ * Streams only known by a voice flag (peers not sending levels) are given
+ * a nominal level while speaking.
+ *
+ * Not thread-safe.
+ */
+class ActiveSpeakerDetector
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint8_t VOICE_ON_LEVEL {45};
+    static constexpr uint8_t VOICE_OFF_LEVEL {55};
+    static constexpr uint8_t FLAGGED_VOICE_LEVEL {30};
+    static constexpr double SWITCH_MARGIN {6.};
+    static constexpr clock::duration HANGOVER {std::chrono::milliseconds(400)};
+    static constexpr clock::duration MIN_DWELL {std::chrono::milliseconds(1500)};
+    // Streams not reporting levels anymore (discontinuous transmission) are silent
+    static constexpr clock::duration STALE_AFTER {std::chrono::milliseconds(500)};
+    static constexpr clock::duration EVALUATION_INTERVAL {std::chrono::milliseconds(100)};
+
+    /**
+     * @return true if a stream started or stopped speaking,
+     * or if the dominant speaker changed
+     */
+    bool onLevel(const std::string& streamId, AudioLevel level, clock::time_point now);
+
+    /**
+     * Voice activity of a stream without levels. Ignored for streams
+     * currently reporting levels.
+     * @return same as onLevel()
+     */
+    bool onVoice(const std::string& streamId, bool voice, clock::time_point now);
+
+    /**
+     * Expire stale streams and select the dominant speaker.
+     * Called by onLevel() and onVoice() every EVALUATION_INTERVAL.
+     * @return same as onLevel()
+     */
+    bool process(clock::time_point now);
+
+    bool remove(std::string_view streamId);
+    /**
+     * Forget the streams only known by a voice flag which are not listed
+     * (participants who left).
+     * @return same as onLevel()
+     */
+    bool retainVoiceStreams(const std::vector<std::string_view>& streamIds);
+
+    /**
+     * @return whether the stream speaks, nothing if it is not tracked
+     */
+    std::optional<bool> isSpeaking(std::string_view streamId) const;
+
+    /**
+     * @return whether the stream reported levels, rather than a voice flag
+     */
+    bool reportsLevels(std::string_view streamId) const;
+
+    /**
+     * @return the smoothed level of the stream, in -dBov
+     */
+    std::optional<uint8_t> level(std::string_view streamId) const;
+
+    /**
+     * @return the dominant speaker, empty if nobody spoke yet
+     */
+    const std::string& dominant() const { return dominant_; }
+
+private:
+    struct Speaker
+    {
+        double energy {-AUDIO_LEVEL_SILENCE};
+        double score {-AUDIO_LEVEL_SILENCE};
+        bool speaking {false};
+        bool hasLevels {false};
+        clock::time_point lastUpdate {};
+        clock::time_point lastVoice {};
+    };
+
+    bool updateSpeaking(Speaker& speaker, bool voice, clock::time_point now);
+    bool evaluate(clock::time_point now);
+
+    std::map<std::string, Speaker, std::less<>> speakers_;
+    std::string dominant_;
+    clock::time_point dominantSince_ {};
+    clock::time_point lastEvaluation_ {};
+};
+
+} // namespace jami
@@ -57,8 +57,17 @@ AudioReceiveThread::setup()
 {
     std::lock_guard lk(mutex_);
     audioDecoder_.reset(new MediaDecoder([this](std::shared_ptr<MediaFrame>&& frame) mutable {
+        auto decode = latency::elapsedUs(frame->pointer());
         notify(frame);
-        ringbuffer_->put(std::static_pointer_cast<AudioFrame>(frame));
+        auto audioFrame = std::static_pointer_cast<AudioFrame>(frame);
+        {
+            std::lock_guard lk(audioLevelMutex_);
+            if (audioLevelCallback_)
+                audioLevelCallback_({audioLevelFromRms(audioFrame->calcRMS()), false});
+        }
+        ringbuffer_->put(std::move(audioFrame));
+        if (latencyStats_)
+            latencyStats_->recordReceive(decode, latency::elapsedUs(frame->pointer()));
     }));
     audioDecoder_->setContextCallback([this]() {
         if (recorderCallback_)
@@ -85,6 +94,7 @@ AudioReceiveThread::setup()
 
     // Now replace our custom AVIOContext with one that will read packets
     audioDecoder_->setIOContext(demuxContext_.get());
+    audioDecoder_->setPacketArrivalCallback(packetArrival_);
     if (audioDecoder_->setupAudio()) {
         JAMI_ERR("decoder IO startup failed");
         return false;
@@ -134,6 +144,8 @@ void
 AudioReceiveThread::addIOContext(SocketPair& socketPair)
 {
     demuxContext_.reset(socketPair.createIOContext(mtu_));
+    // Same lifetime as demuxContext_, which already refers to socketPair
+    packetArrival_ = [&socketPair] { return socketPair.takeFrameArrival(); };
 }
 
 void
@@ -24,6 +24,7 @@
 #include "media/media_buffer.h"
 #include "media/media_device.h"
 #include "media/media_codec.h"
+#include "media/media_latency.h"
 #include "noncopyable.h"
 #include "observer.h"
 #include "media/socket_pair.h"
@@ -61,6 +62,18 @@ public:
 
     void setRecorderCallback(const std::function<void(const MediaStream& ms)>& cb);
 
+    void setLatencyStats(std::shared_ptr<MediaLatencyStats> stats) { latencyStats_ = std::move(stats); }
+
+    /**
+     * Called with the level of each decoded frame, measured here for peers
+     * not sending it in the audio level header extension.
+     */
+    void setAudioLevelCallback(SocketPair::AudioLevelCallback cb)
+    {
+        std::lock_guard lk(audioLevelMutex_);
+        audioLevelCallback_ = std::move(cb);
+    }
+
 private:
     NON_COPYABLE(AudioReceiveThread);
 
@@ -82,6 +95,7 @@ private:
     std::unique_ptr<MediaDecoder> audioDecoder_;
     std::unique_ptr<MediaIOHandle> sdpContext_;
     std::unique_ptr<MediaIOHandle> demuxContext_;
+    std::function<std::optional<uint32_t>()> packetArrival_;
 
     std::shared_ptr<RingBuffer> ringbuffer_;
 
@@ -94,6 +108,9 @@ private:
 
     std::function<void(MediaType, bool)> onSuccessfulSetup_;
     std::function<void(const MediaStream& ms)> recorderCallback_;
+    std::shared_ptr<MediaLatencyStats> latencyStats_;
+    std::mutex audioLevelMutex_;
+    SocketPair::AudioLevelCallback audioLevelCallback_;
 };
 
 } // namespace jami
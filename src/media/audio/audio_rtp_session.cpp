@@ -45,6 +45,7 @@
 #include "observer.h"
 
 #include <asio/io_context.hpp>
+#include <atomic>
 #include <sstream>
 
 namespace jami {
@@ -153,6 +154,7 @@ AudioRtpSession::startSender()
 
     if (voiceCallback_)
         sender_->setVoiceCallback(voiceCallback_);
+    sender_->setLatencyStats(latencyStats_);
 
     // NOTE do after sender/encoder are ready
     auto codec = std::static_pointer_cast<SystemAudioCodecInfo>(send_.codec);
@@ -202,6 +204,8 @@ AudioRtpSession::startReceiver()
                 shared->attachRemoteRecorder(ms);
         });
     });
+    receiveThread_->setLatencyStats(latencyStats_);
+    updateAudioLevelCallbacks();
     receiveThread_->addIOContext(*socketPair_);
     receiveThread_->setSuccessfulSetupCb(onSuccessfulSetup_);
     receiveThread_->startReceiver();
@@ -232,6 +236,7 @@ AudioRtpSession::start(std::unique_ptr<dhtnet::IceSocket> rtp_sock, std::unique_
         } else {
             socketPair_.reset(new SocketPair(getRemoteRtpUri().c_str(), receive_.addr.getPort()));
         }
+        socketPair_->enableAudioLevel(audioLevelEnabled_);
 
         if (send_.crypto and receive_.crypto) {
             socketPair_->createSRTP(receive_.crypto.getCryptoSuite().c_str(),
@@ -318,6 +323,52 @@ AudioRtpSession::setVoiceCallback(std::function<void(bool)> cb)
     }
 }
 
+void
+AudioRtpSession::setAudioLevelCallback(SocketPair::AudioLevelCallback cb)
+{
+    std::lock_guard lock(mutex_);
+    audioLevelCallback_ = std::move(cb);
+    updateAudioLevelCallbacks();
+}
+
+void
+AudioRtpSession::updateAudioLevelCallbacks()
+{
+    if (not audioLevelCallback_) {
+        if (socketPair_)
+            socketPair_->setAudioLevelCallback({});
+        if (receiveThread_)
+            receiveThread_->setAudioLevelCallback({});
+        return;
+    }
+
+    // The levels sent by the peer are used as long as it sends them,
+    // those of the decoded frames otherwise
+    using clock = std::chrono::steady_clock;
+    auto lastReported = std::make_shared<std::atomic<clock::rep>>(
+        (clock::now() - ActiveSpeakerDetector::STALE_AFTER).time_since_epoch().count());
+    if (socketPair_)
+        socketPair_->setAudioLevelCallback([cb = audioLevelCallback_, lastReported](AudioLevel level) {
+            lastReported->store(clock::now().time_since_epoch().count());
+            cb(level);
+        });
+    if (receiveThread_)
+        receiveThread_->setAudioLevelCallback([cb = audioLevelCallback_, lastReported](AudioLevel level) {
+            auto reported = clock::time_point(clock::duration(lastReported->load()));
+            if (clock::now() - reported >= ActiveSpeakerDetector::STALE_AFTER)
+                cb(level);
+        });
+}
+
+void
+AudioRtpSession::enableAudioLevel(bool enable)
+{
+    std::lock_guard lock(mutex_);
+    audioLevelEnabled_ = enable;
+    if (socketPair_)
+        socketPair_->enableAudioLevel(audioLevelEnabled_);
+}
+
 bool
 AudioRtpSession::check_RCTP_Info_RR(RTCPInfo& rtcpi)
 {
@@ -68,9 +68,24 @@ public:
 
     void setVoiceCallback(std::function<void(bool)> cb);
 
+    /**
+     * Called from the receiving thread with the level of each incoming
+     * packet, for peers sending the audio level header extension, or else
+     * with the level of each decoded frame.
+     */
+    void setAudioLevelCallback(SocketPair::AudioLevelCallback cb);
+
+    /**
+     * Send the level of each outgoing packet to the peer (RFC 6464). The
+     * header extension is not encrypted: enable it only while the peer
+     * hosts a conference we are part of.
+     */
+    void enableAudioLevel(bool enable);
+
 private:
     void startSender();
     void startReceiver();
+    void updateAudioLevelCallbacks();
     bool check_RCTP_Info_RR(RTCPInfo& rtcpi);
     void adaptQualityAndBitrate();
     void dropProcessing(RTCPInfo* rtcpi);
@@ -93,6 +108,8 @@ private:
     std::chrono::seconds rtcp_checking_interval {4};
 
     std::function<void(bool)> voiceCallback_;
+    SocketPair::AudioLevelCallback audioLevelCallback_;
+    bool audioLevelEnabled_ {false};
 
     void attachRemoteRecorder(const MediaStream& ms);
     void attachLocalRecorder(const MediaStream& ms);
@@ -55,6 +55,9 @@ bool
 AudioSender::setup(SocketPair& socketPair)
 {
     audioEncoder_.reset(new MediaEncoder);
+    socketPair_ = &socketPair;
+    // Sent only toward a conference host, see AudioRtpSession::enableAudioLevel
+    socketPair.reserveAudioLevel();
     muxContext_.reset(socketPair.createIOContext(mtu_));
 
     try {
@@ -89,7 +92,10 @@ AudioSender::update(Observable<std::shared_ptr<jami::MediaFrame>>* /*obs*/,
 
     // check for change in voice activity, if so, call callback
     // downcast MediaFrame to AudioFrame
-    bool hasVoice = std::dynamic_pointer_cast<AudioFrame>(framePtr)->has_voice;
+    auto audioFrame = std::dynamic_pointer_cast<AudioFrame>(framePtr);
+    bool hasVoice = audioFrame->has_voice;
+    // Level reported to the peer (conference host) along with the packets of this frame
+    socketPair_->setOutgoingAudioLevel({audioLevelFromRms(audioFrame->calcRMS()), hasVoice});
     if (hasVoice != voice_) {
         voice_ = hasVoice;
         if (voiceCallback_) {
@@ -99,8 +105,12 @@ AudioSender::update(Observable<std::shared_ptr<jami::MediaFrame>>* /*obs*/,
         }
     }
 
-    if (audioEncoder_->encodeAudio(*std::static_pointer_cast<AudioFrame>(framePtr)) < 0)
+    auto captureToEncode = latency::elapsedUs(frame);
+    auto encodeStart = latency::nowUs();
+    if (audioEncoder_->encodeAudio(*audioFrame) < 0)
         JAMI_ERR("encoding failed");
+    if (latencyStats_)
+        latencyStats_->recordSend(captureToEncode, latency::nowUs() - encodeStart);
 }
 
 void
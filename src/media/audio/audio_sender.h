@@ -22,6 +22,7 @@
 
 #include "media_buffer.h"
 #include "media_codec.h"
+#include "media_latency.h"
 #include "noncopyable.h"
 #include "observer.h"
 #include "socket_pair.h"
@@ -47,6 +48,7 @@ public:
     int setPacketLoss(uint64_t pl);
 
     void setVoiceCallback(std::function<void(bool)> cb);
+    void setLatencyStats(std::shared_ptr<MediaLatencyStats> stats) { latencyStats_ = std::move(stats); }
 
     void update(Observable<std::shared_ptr<jami::MediaFrame>>*,
                 const std::shared_ptr<jami::MediaFrame>&) override;
@@ -60,6 +62,7 @@ private:
     MediaDescription args_;
     std::unique_ptr<MediaEncoder> audioEncoder_;
     std::unique_ptr<MediaIOHandle> muxContext_;
+    SocketPair* socketPair_ {nullptr};
 
     uint64_t sent_samples = 0;
 
@@ -69,6 +72,8 @@ private:
     // last voice activity state
     bool voice_ {false};
     std::function<void(bool)> voiceCallback_;
+
+    std::shared_ptr<MediaLatencyStats> latencyStats_;
 };
 
 } // namespace jami
@@ -21,6 +21,7 @@
 #include "logger.h"
 #include "media/congestion_control.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <utility>
 #include <cmath>
@@ -220,4 +221,363 @@ CongestionControl::get_bw_state(float estimation, float thresh)
     return last_state_;
 }
 
+
+// Transport-wide bandwidth estimation
+
+// Packets sent within this interval form a group, as they are usually a burst
+// of the same frame: delay variation is computed between groups.
+static constexpr int64_t GROUP_LENGTH_US = 5000;
+static constexpr size_t TREND_WINDOW = 20;
+static constexpr double TREND_SMOOTHING = 0.9;
+static constexpr double TREND_GAIN = 4.0;
+static constexpr unsigned TREND_MAX_DELTAS = 60;
+static constexpr double THRESHOLD_UP = 0.0087;
+static constexpr double THRESHOLD_DOWN = 0.039;
+static constexpr double THRESHOLD_MIN = 6.0;
+static constexpr double THRESHOLD_MAX = 600.0;
+static constexpr int64_t OVERUSE_TIME_US = 10000;
+
+static constexpr double DECREASE_FACTOR = 0.85;
+static constexpr double INCREASE_PER_SECOND = 1.08;
+constexpr auto MIN_DECREASE_INTERVAL = std::chrono::milliseconds(200);
+
+static constexpr unsigned LOSS_MIN_PACKETS = 20;
+static constexpr float LOSS_HIGH = 0.10f;
+static constexpr float LOSS_LOW = 0.02f;
+constexpr auto MIN_LOSS_DECREASE_INTERVAL = std::chrono::milliseconds(300);
+
+static constexpr int64_t ACKNOWLEDGED_WINDOW_US = 500000;
+static constexpr size_t PROBE_MIN_PACKETS = 5;
+constexpr auto HISTORY_DURATION = std::chrono::seconds(2);
+constexpr auto FEEDBACK_TIMEOUT = std::chrono::seconds(1);
+
+static int64_t
+toUs(TransportBandwidthEstimator::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+TransportBandwidthEstimator::TransportBandwidthEstimator(uint64_t startBps,
+                                                         uint64_t minBps,
+                                                         uint64_t maxBps)
+    : minBps_(minBps)
+    , maxBps_(maxBps)
+    , delayBps_(startBps)
+    , lossBps_(maxBps)
+{}
+
+void
+TransportBandwidthEstimator::setBounds(uint64_t minBps, uint64_t maxBps)
+{
+    std::lock_guard lk(mutex_);
+    minBps_ = minBps;
+    maxBps_ = maxBps;
+}
+
+uint64_t
+TransportBandwidthEstimator::clamp(double bps) const
+{
+    return std::max<uint64_t>(minBps_, std::min<uint64_t>(maxBps_, bps));
+}
+
+void
+TransportBandwidthEstimator::onPacketSent(uint16_t seq,
+                                          size_t size,
+                                          time_point sendTime,
+                                          int probeCluster)
+{
+    std::lock_guard lk(mutex_);
+    auto sendUs = toUs(sendTime);
+    history_[unwrapper_.unwrap(seq)] = {size, sendUs, probeCluster};
+
+    auto expired = sendUs
+                   - std::chrono::duration_cast<std::chrono::microseconds>(HISTORY_DURATION).count();
+    while (not history_.empty() and history_.begin()->second.sendUs < expired)
+        history_.erase(history_.begin());
+}
+
+void
+TransportBandwidthEstimator::onFeedback(const TransportFeedback& feedback, time_point now)
+{
+    std::lock_guard lk(mutex_);
+    lastFeedback_ = now;
+
+    std::vector<ReceivedPacket> received;
+    received.reserve(feedback.packets.size());
+    unsigned lost = 0;
+    for (const auto& packet : feedback.packets) {
+        auto it = history_.find(unwrapper_.peek(packet.seq));
+        if (it == history_.end())
+            continue;
+        if (packet.received)
+            received.push_back(
+                {it->second.size, it->second.sendUs, packet.arrivalUs, it->second.probeCluster});
+        else
+            ++lost;
+        history_.erase(it);
+    }
+
+    for (const auto& packet : received) {
+        updateDelay(packet);
+        updateAcknowledged(packet);
+    }
+    updateProbes(received, toUs(now));
+    updateDelayBasedRate(now);
+    updateLossBasedRate(lost, received.size(), now);
+}
+
+void
+TransportBandwidthEstimator::updateDelay(const ReceivedPacket& packet)
+{
+    if (not currentGroup_.valid) {
+        currentGroup_ = {packet.sendUs, packet.sendUs, packet.arrivalUs, true};
+        return;
+    }
+    if (packet.sendUs < currentGroup_.firstSendUs)
+        return; // Reordered, belongs to a previous group
+
+    if (packet.sendUs - currentGroup_.firstSendUs <= GROUP_LENGTH_US) {
+        currentGroup_.lastSendUs = std::max(currentGroup_.lastSendUs, packet.sendUs);
+        currentGroup_.lastArrivalUs = std::max(currentGroup_.lastArrivalUs, packet.arrivalUs);
+        return;
+    }
+
+    // The current group is complete
+    if (previousGroup_.valid) {
+        auto sendDelta = (currentGroup_.lastSendUs - previousGroup_.lastSendUs) / 1000.0;
+        auto arrivalDelta = (currentGroup_.lastArrivalUs - previousGroup_.lastArrivalUs) / 1000.0;
+        updateTrend(arrivalDelta - sendDelta, currentGroup_.lastArrivalUs);
+    }
+    previousGroup_ = currentGroup_;
+    currentGroup_ = {packet.sendUs, packet.sendUs, packet.arrivalUs, true};
+}
+
+void
+TransportBandwidthEstimator::updateTrend(double delayVariationMs, int64_t arrivalUs)
+{
+    numDeltas_ = std::min(numDeltas_ + 1, 1000u);
+    accumulatedDelay_ += delayVariationMs;
+    smoothedDelay_ = TREND_SMOOTHING * smoothedDelay_ + (1 - TREND_SMOOTHING) * accumulatedDelay_;
+    if (firstArrivalUs_ < 0)
+        firstArrivalUs_ = arrivalUs;
+    trendSamples_.emplace_back((arrivalUs - firstArrivalUs_) / 1000.0, smoothedDelay_);
+    if (trendSamples_.size() > TREND_WINDOW)
+        trendSamples_.pop_front();
+
+    if (trendSamples_.size() == TREND_WINDOW) {
+        // Slope of the linear regression of the smoothed delay over time
+        double avgX = 0, avgY = 0;
+        for (const auto& [x, y] : trendSamples_) {
+            avgX += x;
+            avgY += y;
+        }
+        avgX /= trendSamples_.size();
+        avgY /= trendSamples_.size();
+        double num = 0, den = 0;
+        for (const auto& [x, y] : trendSamples_) {
+            num += (x - avgX) * (y - avgY);
+            den += (x - avgX) * (x - avgX);
+        }
+        if (den != 0)
+            trend_ = num / den;
+    }
+    detect(std::min(numDeltas_, TREND_MAX_DELTAS) * trend_ * TREND_GAIN, arrivalUs);
+}
+
+void
+TransportBandwidthEstimator::detect(double trend, int64_t arrivalUs)
+{
+    if (trend > threshold_) {
+        if (overuseStartUs_ < 0)
+            overuseStartUs_ = arrivalUs;
+        ++overuseCount_;
+        if (arrivalUs - overuseStartUs_ > OVERUSE_TIME_US and overuseCount_ > 1
+            and trend >= previousTrend_) {
+            state_ = bwOverusing;
+            overuseStartUs_ = -1;
+            overuseCount_ = 0;
+        }
+    } else {
+        overuseStartUs_ = -1;
+        overuseCount_ = 0;
+        state_ = trend < -threshold_ ? bwUnderusing : bwNormal;
+    }
+    previousTrend_ = trend;
+    updateThreshold(trend, arrivalUs);
+}
+
+void
+TransportBandwidthEstimator::updateThreshold(double trend, int64_t arrivalUs)
+{
+    if (lastThresholdUpdateUs_ < 0)
+        lastThresholdUpdateUs_ = arrivalUs;
+    auto absTrend = std::fabs(trend);
+    // Don't adapt to sudden spikes
+    if (absTrend > threshold_ + 15.0) {
+        lastThresholdUpdateUs_ = arrivalUs;
+        return;
+    }
+    auto k = absTrend < threshold_ ? THRESHOLD_DOWN : THRESHOLD_UP;
+    auto dt = std::min<int64_t>(arrivalUs - lastThresholdUpdateUs_, 100000) / 1000.0;
+    threshold_ = std::clamp(threshold_ + k * (absTrend - threshold_) * dt,
+                            THRESHOLD_MIN,
+                            THRESHOLD_MAX);
+    lastThresholdUpdateUs_ = arrivalUs;
+}
+
+void
+TransportBandwidthEstimator::updateAcknowledged(const ReceivedPacket& packet)
+{
+    acknowledged_.emplace_back(packet.arrivalUs, packet.size);
+    while (acknowledged_.front().first < packet.arrivalUs - ACKNOWLEDGED_WINDOW_US)
+        acknowledged_.pop_front();
+    if (acknowledged_.size() < 2)
+        return;
+    size_t bytes = 0;
+    for (const auto& [arrival, size] : acknowledged_)
+        bytes += size;
+    auto span = std::max(acknowledged_.back().first - acknowledged_.front().first,
+                         ACKNOWLEDGED_WINDOW_US / 5);
+    acknowledgedBps_ = bytes * 8 * 1000000 / span;
+}
+
+void
+TransportBandwidthEstimator::updateDelayBasedRate(time_point now)
+{
+    if (lastDelayUpdate_ == time_point {})
+        lastDelayUpdate_ = now;
+    auto dt = std::min(std::chrono::duration<double>(now - lastDelayUpdate_).count(), 1.0);
+    lastDelayUpdate_ = now;
+
+    switch (state_) {
+    case bwOverusing:
+        // Multiplicative decrease, from what actually went through
+        if (now - lastDecrease_ >= MIN_DECREASE_INTERVAL) {
+            auto base = acknowledgedBps_ ? static_cast<double>(acknowledgedBps_) : delayBps_;
+            delayBps_ = std::min(delayBps_, DECREASE_FACTOR * base);
+            lastDecrease_ = now;
+        }
+        break;
+    case bwNormal:
+        delayBps_ *= std::pow(INCREASE_PER_SECOND, dt);
+        // Don't go far beyond what is actually sent
+        if (acknowledgedBps_)
+            delayBps_ = std::min(delayBps_, 1.5 * acknowledgedBps_ + 10000);
+        break;
+    case bwUnderusing:
+        // Queues are draining, hold
+        break;
+    }
+    delayBps_ = clamp(delayBps_);
+}
+
+void
+TransportBandwidthEstimator::updateLossBasedRate(unsigned lost, unsigned received, time_point now)
+{
+    lostCount_ += lost;
+    receivedCount_ += received;
+    if (lostCount_ + receivedCount_ < LOSS_MIN_PACKETS)
+        return;
+
+    lossRate_ = static_cast<float>(lostCount_) / (lostCount_ + receivedCount_);
+    lostCount_ = 0;
+    receivedCount_ = 0;
+    if (lastLossUpdate_ == time_point {})
+        lastLossUpdate_ = now;
+    auto dt = std::min(std::chrono::duration<double>(now - lastLossUpdate_).count(), 1.0);
+    lastLossUpdate_ = now;
+
+    if (lossRate_ > LOSS_HIGH) {
+        if (now - lastLossDecrease_ >= MIN_LOSS_DECREASE_INTERVAL) {
+            lossBps_ = std::min(lossBps_, std::min(delayBps_, lossBps_) * (1 - 0.5 * lossRate_));
+            lastLossDecrease_ = now;
+        }
+    } else if (lossRate_ < LOSS_LOW) {
+        lossBps_ *= std::pow(INCREASE_PER_SECOND, dt);
+    }
+    lossBps_ = clamp(lossBps_);
+}
+
+void
+TransportBandwidthEstimator::updateProbes(const std::vector<ReceivedPacket>& packets,
+                                          int64_t nowUs)
+{
+    for (const auto& packet : packets) {
+        if (packet.probeCluster < 0)
+            continue;
+        auto& cluster = probes_[packet.probeCluster];
+        ++cluster.packets;
+        cluster.bytes += packet.size;
+        if (packet.sendUs < cluster.firstSendUs)
+            cluster.firstSendUs = packet.sendUs;
+        if (packet.sendUs >= cluster.lastSendUs) {
+            cluster.lastSendUs = packet.sendUs;
+            cluster.lastSize = packet.size;
+        }
+        if (packet.arrivalUs < cluster.firstArrivalUs) {
+            cluster.firstArrivalUs = packet.arrivalUs;
+            cluster.firstSize = packet.size;
+        }
+        cluster.lastArrivalUs = std::max(cluster.lastArrivalUs, packet.arrivalUs);
+    }
+
+    auto expired = nowUs - std::chrono::duration_cast<std::chrono::microseconds>(HISTORY_DURATION).count();
+    for (auto it = probes_.begin(); it != probes_.end();) {
+        const auto& cluster = it->second;
+        if (cluster.packets < PROBE_MIN_PACKETS) {
+            if (cluster.lastSendUs < expired)
+                it = probes_.erase(it);
+            else
+                ++it;
+            continue;
+        }
+        auto sendSpan = cluster.lastSendUs - cluster.firstSendUs;
+        auto arrivalSpan = cluster.lastArrivalUs - cluster.firstArrivalUs;
+        if (sendSpan > 0 and arrivalSpan > 0) {
+            // The link can't deliver faster than the probe was sent
+            auto sendBps = (cluster.bytes - cluster.lastSize) * 8 * 1000000.0 / sendSpan;
+            auto arrivalBps = (cluster.bytes - cluster.firstSize) * 8 * 1000000.0 / arrivalSpan;
+            auto probeBps = std::min(sendBps, arrivalBps);
+            if (state_ != bwOverusing and probeBps > delayBps_)
+                delayBps_ = clamp(probeBps);
+        }
+        it = probes_.erase(it);
+    }
+}
+
+uint64_t
+TransportBandwidthEstimator::targetBitrate() const
+{
+    std::lock_guard lk(mutex_);
+    return clamp(std::min(delayBps_, lossBps_));
+}
+
+uint64_t
+TransportBandwidthEstimator::acknowledgedBitrate() const
+{
+    std::lock_guard lk(mutex_);
+    return acknowledgedBps_;
+}
+
+float
+TransportBandwidthEstimator::lossRate() const
+{
+    std::lock_guard lk(mutex_);
+    return lossRate_;
+}
+
+BandwidthUsage
+TransportBandwidthEstimator::delayState() const
+{
+    std::lock_guard lk(mutex_);
+    return state_;
+}
+
+bool
+TransportBandwidthEstimator::hasFeedback(time_point now) const
+{
+    std::lock_guard lk(mutex_);
+    return lastFeedback_ != time_point::min() and now - lastFeedback_ < FEEDBACK_TIMEOUT;
+}
+
 } // namespace jami
\ No newline at end of file
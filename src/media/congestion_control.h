@@ -23,8 +23,12 @@
 
 #include <vector>
 #include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
 
 #include "socket_pair.h"
+#include "transport_cc.h"
 
 namespace jami {
 
@@ -66,5 +70,122 @@ private:
     BandwidthUsage last_state_;
 };
 
+/**
+ * Sender side bandwidth estimation from transport-wide feedback.
+ *
+ * Combines a delay-based estimate (trend of the one-way delay variation
+ * between groups of packets, with an adaptive threshold, driving an AIMD
+ * rate controller) and a loss-based estimate. The target is the lowest of
+ * both. Probe clusters (packets paced faster than the target) measure the
+ * available bandwidth directly, to ramp up faster than the additive increase.
+ *
+ * Thread-safe: packets are reported by the sending thread, feedback by the
+ * receiving one.
+ */
+class TransportBandwidthEstimator
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    TransportBandwidthEstimator(uint64_t startBps, uint64_t minBps, uint64_t maxBps);
+
+    void setBounds(uint64_t minBps, uint64_t maxBps);
+
+    void onPacketSent(uint16_t seq, size_t size, time_point sendTime, int probeCluster = -1);
+    void onFeedback(const TransportFeedback& feedback, time_point now);
+
+    uint64_t targetBitrate() const;
+    // Throughput measured by the receiver, 0 if unknown
+    uint64_t acknowledgedBitrate() const;
+    float lossRate() const;
+    BandwidthUsage delayState() const;
+    // Whether the peer sent feedback recently
+    bool hasFeedback(time_point now) const;
+
+private:
+    struct SentPacket
+    {
+        size_t size;
+        int64_t sendUs;
+        int probeCluster;
+    };
+    struct ReceivedPacket
+    {
+        size_t size;
+        int64_t sendUs;
+        int64_t arrivalUs;
+        int probeCluster;
+    };
+    struct PacketGroup
+    {
+        int64_t firstSendUs {0};
+        int64_t lastSendUs {0};
+        int64_t lastArrivalUs {0};
+        bool valid {false};
+    };
+    struct ProbeCluster
+    {
+        size_t packets {0};
+        size_t bytes {0};
+        size_t firstSize {0};
+        size_t lastSize {0};
+        int64_t firstSendUs {INT64_MAX};
+        int64_t lastSendUs {INT64_MIN};
+        int64_t firstArrivalUs {INT64_MAX};
+        int64_t lastArrivalUs {INT64_MIN};
+    };
+
+    void updateDelay(const ReceivedPacket& packet);
+    void updateTrend(double delayVariationMs, int64_t arrivalUs);
+    void detect(double trend, int64_t arrivalUs);
+    void updateThreshold(double trend, int64_t arrivalUs);
+    void updateAcknowledged(const ReceivedPacket& packet);
+    void updateDelayBasedRate(time_point now);
+    void updateLossBasedRate(unsigned lost, unsigned received, time_point now);
+    void updateProbes(const std::vector<ReceivedPacket>& packets, int64_t nowUs);
+    uint64_t clamp(double bps) const;
+
+    mutable std::mutex mutex_;
+    uint64_t minBps_;
+    uint64_t maxBps_;
+
+    SeqUnwrapper unwrapper_;
+    std::map<int64_t, SentPacket> history_;
+
+    // Delay-based estimation
+    PacketGroup currentGroup_;
+    PacketGroup previousGroup_;
+    double accumulatedDelay_ {0};
+    double smoothedDelay_ {0};
+    std::deque<std::pair<double, double>> trendSamples_;
+    int64_t firstArrivalUs_ {-1};
+    unsigned numDeltas_ {0};
+    double trend_ {0};
+    double previousTrend_ {0};
+    double threshold_ {12.5};
+    int64_t lastThresholdUpdateUs_ {-1};
+    int64_t overuseStartUs_ {-1};
+    unsigned overuseCount_ {0};
+    BandwidthUsage state_ {bwNormal};
+    double delayBps_;
+    time_point lastDelayUpdate_ {};
+    time_point lastDecrease_ {};
+
+    // Loss-based estimation
+    double lossBps_;
+    unsigned lostCount_ {0};
+    unsigned receivedCount_ {0};
+    float lossRate_ {0};
+    time_point lastLossUpdate_ {};
+    time_point lastLossDecrease_ {};
+
+    std::deque<std::pair<int64_t, size_t>> acknowledged_;
+    uint64_t acknowledgedBps_ {0};
+
+    std::map<int, ProbeCluster> probes_;
+    time_point lastFeedback_ {time_point::min()};
+};
+
 } // namespace jami
 #endif
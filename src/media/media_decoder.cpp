@@ -26,6 +26,7 @@
 #include "media_buffer.h"
 #include "media_const.h"
 #include "media_io_handle.h"
+#include "media_latency.h"
 #include "audio/ringbuffer.h"
 #include "audio/resampler.h"
 #include "audio/ringbufferpool.h"
@@ -560,6 +561,7 @@ MediaDecoder::setupStream()
                 JAMI_WARN("Fail to open hardware decoder for %s with %s",
                           avcodec_get_name(decoderCtx_->codec_id),
                           it.getName().c_str());
+                accel_->setUsable(false);
                 avcodec_free_context(&decoderCtx_);
                 decoderCtx_ = nullptr;
                 accel_.reset();
@@ -569,6 +571,7 @@ MediaDecoder::setupStream()
                 JAMI_WARN("Using hardware decoding for %s with %s",
                           avcodec_get_name(decoderCtx_->codec_id),
                           it.getName().c_str());
+                accel_->setUsable(true);
                 break;
             }
         }
@@ -645,6 +648,10 @@ DecodeStatus
 MediaDecoder::decode(AVPacket& packet)
 {
     int frameFinished = 0;
+    std::optional<uint32_t> arrival;
+    if (packetArrivalCallback_)
+        arrival = packetArrivalCallback_();
+    auto received = arrival ? *arrival : latency::nowUs();
     auto ret = avcodec_send_packet(decoderCtx_, &packet);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
 #ifdef RING_ACCEL
@@ -708,6 +715,7 @@ MediaDecoder::decode(AVPacket& packet)
                                       static_cast<AVRounding>(AV_ROUND_NEAR_INF
                                                               | AV_ROUND_PASS_MINMAX));
         lastTimestamp_ = frame->pts;
+        latency::stamp(frame, received);
         if (emulateRate_ and packetTimestamp != AV_NOPTS_VALUE) {
             auto startTime = avStream_->start_time == AV_NOPTS_VALUE ? 0 : avStream_->start_time;
             rational<double> frame_time = rational<double>(getTimeBase())
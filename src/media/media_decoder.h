@@ -48,6 +48,7 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <optional>
 #include <queue>
 
 extern "C" {
@@ -222,6 +223,15 @@ public:
         contextCallback_ = cb;
     }
 
+    /**
+     * Provides the arrival time (latency::nowUs()) of the packet about to be
+     * decoded, used to stamp decoded frames. Defaults to the decoding time.
+     */
+    void setPacketArrivalCallback(std::function<std::optional<uint32_t>()> cb)
+    {
+        packetArrivalCallback_ = std::move(cb);
+    }
+
 private:
     NON_COPYABLE(MediaDecoder);
 
@@ -263,6 +273,7 @@ private:
 
     std::function<void()> contextCallback_;
     std::atomic_bool firstDecode_ {true};
+    std::function<std::optional<uint32_t>()> packetArrivalCallback_;
 
 protected:
     AVDictionary* options_ = nullptr;
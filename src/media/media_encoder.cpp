@@ -303,6 +303,7 @@ MediaEncoder::initStream(const SystemCodecInfo& systemCodecInfo, AVBufferRef* fr
                 JAMI_WARN("Fail to open hardware encoder %s with %s ",
                           avcodec_get_name(static_cast<AVCodecID>(systemCodecInfo.avcodecId)),
                           it.getName().c_str());
+                accel_->setUsable(false);
                 avcodec_free_context(&encoderCtx);
                 encoderCtx = nullptr;
                 accel_ = nullptr;
@@ -312,6 +313,7 @@ MediaEncoder::initStream(const SystemCodecInfo& systemCodecInfo, AVBufferRef* fr
                 JAMI_WARN("Using hardware encoding for %s with %s ",
                           avcodec_get_name(static_cast<AVCodecID>(systemCodecInfo.avcodecId)),
                           it.getName().c_str());
+                accel_->setUsable(true);
                 encoders_.emplace_back(encoderCtx);
                 break;
             }
@@ -1231,12 +1233,14 @@ MediaEncoder::testH265Accel()
             if (avcodec_open2(encoderCtx, outputCodec, nullptr) < 0) {
                 // Failed to open codec
                 JAMI_WARN("Fail to open hardware encoder H265 with %s ", it.getName().c_str());
+                accel->setUsable(false);
                 avcodec_free_context(&encoderCtx);
                 encoderCtx = nullptr;
                 accel = nullptr;
                 continue;
             } else {
                 // Succeed to open codec
+                accel->setUsable(true);
                 avcodec_free_context(&encoderCtx);
                 encoderCtx = nullptr;
                 accel = nullptr;
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "libav_deps.h" // MUST BE INCLUDED FIRST
+#include "media_latency.h"
+
+namespace jami {
+
+namespace latency {
+
+uint32_t
+nowUs()
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+void
+stamp(AVFrame* frame, bool overwrite)
+{
+    if (!frame || (frame->opaque && !overwrite))
+        return;
+    stamp(frame, nowUs());
+}
+
+void
+stamp(AVFrame* frame, uint32_t us)
+{
+    if (!frame)
+        return;
+    // 0 means "not stamped", skip it
+    frame->opaque = reinterpret_cast<void*>(static_cast<uintptr_t>(us ? us : 1));
+}
+
+std::optional<uint32_t>
+elapsedUs(const AVFrame* frame)
+{
+    if (!frame || !frame->opaque)
+        return std::nullopt;
+    auto stamped = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(frame->opaque));
+    return static_cast<uint32_t>(nowUs() - stamped);
+}
+
+} // namespace latency
+
+unsigned
+LatencyHistogram::bucketIndex(uint32_t us) noexcept
+{
+    if (us < LINEAR)
+        return us;
+    unsigned exp = 0;
+    for (auto v = us; v >>= 1;)
+        ++exp;
+    unsigned sub = (us >> (exp - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return LINEAR + (exp - 4) * (1 << SUB_BITS) + sub;
+}
+
+uint64_t
+LatencyHistogram::bucketValue(unsigned index) noexcept
+{
+    if (index < LINEAR)
+        return index;
+    unsigned exp = (index - LINEAR) / (1 << SUB_BITS) + 4;
+    unsigned sub = (index - LINEAR) % (1 << SUB_BITS);
+    uint64_t width = uint64_t(1) << (exp - SUB_BITS);
+    // middle of the bucket
+    return (uint64_t(1) << exp) + sub * width + width / 2;
+}
+
+LatencyHistogram::Summary
+LatencyHistogram::summary() const
+{
+    std::array<uint64_t, BUCKETS> counts;
+    Summary s;
+    for (unsigned i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        s.count += counts[i];
+    }
+    if (s.count == 0)
+        return s;
+    s.max = max_.load(std::memory_order_relaxed);
+    s.mean = sum_.load(std::memory_order_relaxed) / s.count;
+
+    auto percentile = [&](double p) -> uint64_t {
+        auto target = static_cast<uint64_t>(p * s.count);
+        if (target == 0)
+            target = 1;
+        uint64_t acc = 0;
+        for (unsigned i = 0; i < BUCKETS; ++i) {
+            acc += counts[i];
+            if (acc >= target)
+                return std::min<uint64_t>(bucketValue(i), s.max);
+        }
+        return s.max;
+    };
+    s.p50 = percentile(.50);
+    s.p90 = percentile(.90);
+    s.p99 = percentile(.99);
+    return s;
+}
+
+void
+LatencyHistogram::reset() noexcept
+{
+    for (auto& b : buckets_)
+        b.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+const char*
+MediaLatencyStats::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::CaptureToEncode:
+        return "capture_to_encode";
+    case Stage::Encode:
+        return "encode";
+    case Stage::CaptureToSend:
+        return "capture_to_send";
+    case Stage::Decode:
+        return "decode";
+    case Stage::DecodeToRender:
+        return "decode_to_render";
+    case Stage::ReceiveToRender:
+        return "receive_to_render";
+    default:
+        return "unknown";
+    }
+}
+
+std::vector<std::map<std::string, std::string>>
+MediaLatencyStats::toMaps() const
+{
+    std::vector<std::map<std::string, std::string>> ret;
+    for (size_t i = 0; i < histograms_.size(); ++i) {
+        auto s = histograms_[i].summary();
+        if (s.count == 0)
+            continue;
+        ret.emplace_back(std::map<std::string, std::string> {
+            {"stage", stageName(static_cast<Stage>(i))},
+            {"count", std::to_string(s.count)},
+            {"mean", std::to_string(s.mean)},
+            {"p50", std::to_string(s.p50)},
+            {"p90", std::to_string(s.p90)},
+            {"p99", std::to_string(s.p99)},
+            {"max", std::to_string(s.max)},
+        });
+    }
+    return ret;
+}
+
+void
+MediaLatencyStats::reset() noexcept
+{
+    for (auto& h : histograms_)
+        h.reset();
+}
+
+} // namespace jami
@@ -0,0 +1,192 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+extern "C" {
+struct AVFrame;
+}
+
+namespace jami {
+
+/**
+ * Frames are stamped with the time they entered the pipeline (capture on
+ * the send side, arrival of their first packet on the receive side). The
+ * stamp is kept in AVFrame::opaque, which libav leaves untouched and copies
+ * along with the frame properties, so it follows the frame through references.
+ *
+ * Stamps are microseconds on the steady clock, truncated to the pointer
+ * size. Elapsed times are computed with wrapping arithmetic, which is
+ * exact as long as a frame stays less than ~71 minutes in the pipeline.
+ */
+namespace latency {
+
+uint32_t nowUs();
+
+/**
+ * Stamp the frame with the current time, unless it already carries a stamp
+ * and overwrite is false.
+ */
+void stamp(AVFrame* frame, bool overwrite = false);
+
+/**
+ * Stamp the frame with a time previously obtained from nowUs().
+ */
+void stamp(AVFrame* frame, uint32_t us);
+
+/**
+ * Microseconds since the frame was stamped, if it was.
+ */
+std::optional<uint32_t> elapsedUs(const AVFrame* frame);
+
+} // namespace latency
+
+/**
+ * Lock-free latency histogram.
+ *
+ * Values (in microseconds) below 16 have their own bucket, above that each
+ * power of two is split into 4 sub-buckets, reported by their middle value.
+ * This bounds the error on percentiles to ~12% across the whole 32 bits range.
+ */
+class LatencyHistogram
+{
+public:
+    struct Summary
+    {
+        uint64_t count {0};
+        uint64_t mean {0};
+        uint64_t p50 {0};
+        uint64_t p90 {0};
+        uint64_t p99 {0};
+        uint64_t max {0};
+    };
+
+    LatencyHistogram() = default;
+
+    void record(uint32_t us) noexcept
+    {
+        buckets_[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+        auto m = max_.load(std::memory_order_relaxed);
+        while (us > m && !max_.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+    }
+
+    Summary summary() const;
+    void reset() noexcept;
+
+private:
+    NON_COPYABLE(LatencyHistogram);
+
+    static constexpr unsigned LINEAR = 16;
+    static constexpr unsigned SUB_BITS = 2;
+    static constexpr unsigned BUCKETS = LINEAR + (32 - 4) * (1 << SUB_BITS);
+
+    static unsigned bucketIndex(uint32_t us) noexcept;
+    static uint64_t bucketValue(unsigned index) noexcept;
+
+    std::array<std::atomic_uint64_t, BUCKETS> buckets_ {};
+    std::atomic_uint64_t sum_ {0};
+    std::atomic_uint32_t max_ {0};
+};
+
+/**
+ * Per-stream set of latency histograms, one per pipeline stage.
+ *
+ * Send side:
+ *   capture_to_encode: from capture to the encoder input (mixing, scaling, queuing)
+ *   encode:            encoding, packetization and socket write
+ *   capture_to_send:   whole send path
+ * Receive side:
+ *   decode:            from the arrival of the first packet of a frame to the
+ *                      decoded frame (depacketization, queuing and decoding)
+ *   decode_to_render:  from a decoded frame to its delivery to the sinks
+ *                      (video renderer or audio playback ring buffer)
+ *   receive_to_render: whole receive path
+ */
+class MediaLatencyStats
+{
+public:
+    enum class Stage {
+        CaptureToEncode,
+        Encode,
+        CaptureToSend,
+        Decode,
+        DecodeToRender,
+        ReceiveToRender,
+        COUNT
+    };
+
+    static const char* stageName(Stage stage);
+
+    void record(Stage stage, uint32_t us) noexcept { histograms_[static_cast<size_t>(stage)].record(us); }
+
+    /**
+     * @param captureToEncode   latency::elapsedUs() of the frame before encoding
+     * @param encode            time spent encoding and sending the frame
+     */
+    void recordSend(std::optional<uint32_t> captureToEncode, uint32_t encode) noexcept
+    {
+        record(Stage::Encode, encode);
+        if (captureToEncode) {
+            record(Stage::CaptureToEncode, *captureToEncode);
+            record(Stage::CaptureToSend, *captureToEncode + encode);
+        }
+    }
+
+    /**
+     * @param decode            latency::elapsedUs() of the frame out of the decoder
+     * @param receiveToRender   latency::elapsedUs() of the frame once delivered
+     */
+    void recordReceive(std::optional<uint32_t> decode, std::optional<uint32_t> receiveToRender) noexcept
+    {
+        if (!decode || !receiveToRender)
+            return;
+        record(Stage::Decode, *decode);
+        record(Stage::DecodeToRender, *receiveToRender - *decode);
+        record(Stage::ReceiveToRender, *receiveToRender);
+    }
+
+    const LatencyHistogram& histogram(Stage stage) const
+    {
+        return histograms_[static_cast<size_t>(stage)];
+    }
+
+    /**
+     * One map per stage that recorded at least one value, with keys
+     * "stage", "count", "mean", "p50", "p90", "p99" and "max" (microseconds).
+     */
+    std::vector<std::map<std::string, std::string>> toMaps() const;
+
+    void reset() noexcept;
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(Stage::COUNT)> histograms_;
+};
+
+} // namespace jami
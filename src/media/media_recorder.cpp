@@ -45,6 +45,12 @@ namespace jami {
 
 const constexpr char ROTATION_FILTER_INPUT_NAME[] = "in";
 
+// Frames waiting for the recording thread. Past these, the oldest frames are
+// dropped so that producers (decoders, mixer, audio input) are never blocked.
+// Video is bounded separately as queued frames may hold hardware surfaces.
+constexpr size_t MAX_QUEUED_FRAMES = 64;
+constexpr size_t MAX_QUEUED_VIDEO_FRAMES = 8;
+
 // Replaces every occurrence of @from with @to in @str
 static std::string
 replaceAll(const std::string& str, const std::string& from, const std::string& to)
@@ -86,6 +92,14 @@ struct MediaRecorder::StreamObserver : public Observer<std::shared_ptr<MediaFram
     {
         if (not isEnabled)
             return;
+        cb_(m);
+    }
+
+    /**
+     * Bring a frame to main memory and upright, on the recording thread.
+     */
+    std::shared_ptr<MediaFrame> prepare(const std::shared_ptr<MediaFrame>& m)
+    {
 #ifdef ENABLE_VIDEO
         if (info.isVideo) {
             std::shared_ptr<VideoFrame> framePtr;
@@ -98,7 +112,7 @@ struct MediaRecorder::StreamObserver : public Observer<std::shared_ptr<MediaFram
                         *std::static_pointer_cast<VideoFrame>(m), AV_PIX_FMT_NV12);
                 } catch (const std::runtime_error& e) {
                     JAMI_ERR("Accel failure: %s", e.what());
-                    return;
+                    return {};
                 }
             } else
 #endif
@@ -116,17 +130,14 @@ struct MediaRecorder::StreamObserver : public Observer<std::shared_ptr<MediaFram
             if (videoRotationFilter_) {
                 videoRotationFilter_->feedInput(framePtr->pointer(), ROTATION_FILTER_INPUT_NAME);
                 auto rotated = videoRotationFilter_->readOutput();
-                av_frame_remove_side_data(rotated->pointer(), AV_FRAME_DATA_DISPLAYMATRIX);
-                cb_(std::move(rotated));
-            } else {
-                cb_(m);
+                if (rotated)
+                    av_frame_remove_side_data(rotated->pointer(), AV_FRAME_DATA_DISPLAYMATRIX);
+                return rotated;
             }
-        } else {
-#endif
-            cb_(m);
-#ifdef ENABLE_VIDEO
+            return framePtr;
         }
 #endif
+        return m;
     }
 
     void attached(Observable<std::shared_ptr<MediaFrame>>* obs) override
@@ -200,6 +211,10 @@ MediaRecorder::startRecording()
 
     std::lock_guard lk(encoderMtx_);
     encoder_.reset(new MediaEncoder);
+    {
+        std::lock_guard lk(mutexFrameBuff_);
+        stats_ = {};
+    }
 
     JAMI_LOG("Start recording '{}'", getPath());
     if (initRecord() >= 0) {
@@ -221,7 +236,7 @@ MediaRecorder::startRecording()
         dht::ThreadPool::computation().run([rec = shared_from_this()] {
             std::lock_guard lk(rec->encoderMtx_);
             while (rec->isRecording()) {
-                std::shared_ptr<MediaFrame> frame;
+                PendingFrame pending;
                 // get frame from queue
                 {
                     std::unique_lock lk(rec->mutexFrameBuff_);
@@ -231,19 +246,23 @@ MediaRecorder::startRecording()
                     if (rec->interrupted_) {
                         break;
                     }
-                    frame = std::move(rec->frameBuff_.front());
+                    pending = std::move(rec->frameBuff_.front());
                     rec->frameBuff_.pop_front();
+                    if (pending.isVideo)
+                        rec->queuedVideoFrames_--;
                 }
                 try {
-                    // encode frame
-                    if (rec->encoder_ && frame && frame->pointer()) {
+                    // filter and encode frame
+                    for (const auto& frame : rec->processFrame(pending)) {
+                        if (rec->encoder_ && frame && frame->pointer()) {
 #ifdef ENABLE_VIDEO
-                        bool isVideo = (frame->pointer()->width > 0 && frame->pointer()->height > 0);
-                        rec->encoder_->encode(frame->pointer(),
-                                              isVideo ? rec->videoIdx_ : rec->audioIdx_);
+                            bool isVideo = (frame->pointer()->width > 0 && frame->pointer()->height > 0);
+                            rec->encoder_->encode(frame->pointer(),
+                                                  isVideo ? rec->videoIdx_ : rec->audioIdx_);
 #else
-                        rec->encoder_->encode(frame->pointer(), rec->audioIdx_);
+                            rec->encoder_->encode(frame->pointer(), rec->audioIdx_);
 #endif // ENABLE_VIDEO
+                        }
                     }
                 } catch (const MediaEncoderException& e) {
                     JAMI_ERR() << "Failed to record frame: " << e.what();
@@ -265,6 +284,13 @@ MediaRecorder::stopRecording()
     if (isRecording_) {
         JAMI_DBG() << "Stop recording '" << getPath() << "'";
         isRecording_ = false;
+        auto stats = getStats();
+        JAMI_LOG("[Recorder: {:p}] {} frames received, {} video and {} audio frames dropped, up to {} queued",
+                 fmt::ptr(this),
+                 stats.received,
+                 stats.droppedVideo,
+                 stats.droppedAudio,
+                 stats.maxQueued);
         {
             std::lock_guard lk(mutexStreamSetup_);
             for (auto& media : streams_) {
@@ -293,7 +319,7 @@ MediaRecorder::addStream(const MediaStream& ms)
         auto streamPtr = std::make_unique<StreamObserver>(ms,
                                                           [this,
                                                            ms](const std::shared_ptr<MediaFrame>& frame) {
-                                                              onFrame(ms.name, frame);
+                                                              onFrame(ms.name, ms.isVideo, frame);
                                                           });
         it = streams_.insert(std::make_pair(ms.name, std::move(streamPtr))).first;
         JAMI_LOG("[Recorder: {:p}] Recorder input #{}: {:s}", fmt::ptr(this), streams_.size(), ms.name);
@@ -305,7 +331,7 @@ MediaRecorder::addStream(const MediaStream& ms)
                 = std::make_unique<StreamObserver>(ms,
                                                    [this,
                                                     ms](const std::shared_ptr<MediaFrame>& frame) {
-                                                       onFrame(ms.name, frame);
+                                                       onFrame(ms.name, ms.isVideo, frame);
                                                    });
         }
     }
@@ -341,51 +367,84 @@ MediaRecorder::getStream(const std::string& name) const
     return nullptr;
 }
 
+MediaRecorder::Stats
+MediaRecorder::getStats() const
+{
+    std::lock_guard lk(mutexFrameBuff_);
+    return stats_;
+}
+
 void
-MediaRecorder::onFrame(const std::string& name, const std::shared_ptr<MediaFrame>& frame)
+MediaRecorder::onFrame(const std::string& name, bool isVideo, const std::shared_ptr<MediaFrame>& frame)
 {
     if (not isRecording_ || interrupted_)
         return;
 
+    // Keep a reference only: conversion, filtering and encoding happen on the
+    // recording thread. The capture time is taken now to keep streams in sync.
+    auto timestamp = av_gettime();
+    std::lock_guard lk(mutexFrameBuff_);
+    stats_.received++;
+    if (isVideo && queuedVideoFrames_ >= MAX_QUEUED_VIDEO_FRAMES)
+        dropOldestFrame(true);
+    else if (frameBuff_.size() >= MAX_QUEUED_FRAMES)
+        dropOldestFrame(false);
+    frameBuff_.emplace_back(PendingFrame {name, frame, timestamp, isVideo});
+    if (isVideo)
+        queuedVideoFrames_++;
+    stats_.maxQueued = std::max(stats_.maxQueued, frameBuff_.size());
+    cv_.notify_one();
+}
+
+void
+MediaRecorder::dropOldestFrame(bool videoOnly)
+{
+    auto it = videoOnly ? std::find_if(frameBuff_.begin(),
+                                       frameBuff_.end(),
+                                       [](const auto& f) { return f.isVideo; })
+                        : frameBuff_.begin();
+    if (it == frameBuff_.end())
+        return;
+    if (it->isVideo) {
+        queuedVideoFrames_--;
+        stats_.droppedVideo++;
+    } else {
+        stats_.droppedAudio++;
+    }
+    frameBuff_.erase(it);
+    auto dropped = stats_.droppedVideo + stats_.droppedAudio;
+    if (dropped == 1 or dropped % 100 == 0)
+        JAMI_WARNING("[Recorder: {:p}] Recording can't keep up, {} frames dropped",
+                     fmt::ptr(this),
+                     dropped);
+}
+
+std::vector<std::unique_ptr<MediaFrame>>
+MediaRecorder::processFrame(const PendingFrame& pending)
+{
+    std::vector<std::unique_ptr<MediaFrame>> filteredFrames;
     std::lock_guard lk(mutexStreamSetup_);
 
+    auto it = streams_.find(pending.stream);
+    if (it == streams_.end())
+        return filteredFrames;
+    const auto& ms = it->second->info;
+    auto frame = it->second->prepare(pending.frame);
+    if (not frame)
+        return filteredFrames;
+
     // copy frame to not mess with the original frame's pts (does not actually copy frame data)
-    std::unique_ptr<MediaFrame> clone;
-    const auto& ms = streams_[name]->info;
-#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
-    if (ms.isVideo) {
-        auto desc = av_pix_fmt_desc_get(
-            (AVPixelFormat) (std::static_pointer_cast<VideoFrame>(frame))->format());
-        if (desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
-            try {
-                clone = video::HardwareAccel::transferToMainMemory(
-                    *std::static_pointer_cast<VideoFrame>(frame),
-                    static_cast<AVPixelFormat>(ms.format));
-            } catch (const std::runtime_error& e) {
-                JAMI_ERR("Accel failure: %s", e.what());
-                return;
-            }
-        } else {
-            clone = std::make_unique<MediaFrame>();
-            clone->copyFrom(*frame);
-        }
-    } else {
-#endif // ENABLE_VIDEO && RING_ACCEL
-        clone = std::make_unique<MediaFrame>();
-        clone->copyFrom(*frame);
-#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
-    }
-#endif // ENABLE_VIDEO && RING_ACCEL
-    clone->pointer()->pts = av_rescale_q_rnd(av_gettime() - startTimeStamp_,
+    auto clone = std::make_unique<MediaFrame>();
+    clone->copyFrom(*frame);
+    clone->pointer()->pts = av_rescale_q_rnd(pending.timestamp - startTimeStamp_,
                                              {1, AV_TIME_BASE},
                                              ms.timeBase,
                                              static_cast<AVRounding>(AV_ROUND_NEAR_INF
                                                                      | AV_ROUND_PASS_MINMAX));
-    std::vector<std::unique_ptr<MediaFrame>> filteredFrames;
 #ifdef ENABLE_VIDEO
     if (ms.isVideo && videoFilter_ && outputVideoFilter_) {
         std::lock_guard lk(mutexFilterVideo_);
-                videoFilter_->feedInput(clone->pointer(), name);
+        videoFilter_->feedInput(clone->pointer(), pending.stream);
         auto videoFilterOutput = videoFilter_->readOutput();
         if (videoFilterOutput) {
             outputVideoFilter_->feedInput(videoFilterOutput->pointer(), "input");
@@ -396,7 +455,7 @@ MediaRecorder::onFrame(const std::string& name, const std::shared_ptr<MediaFrame
     } else if (audioFilter_ && outputAudioFilter_) {
 #endif // ENABLE_VIDEO
         std::lock_guard lkA(mutexFilterAudio_);
-        audioFilter_->feedInput(clone->pointer(), name);
+        audioFilter_->feedInput(clone->pointer(), pending.stream);
         auto audioFilterOutput = audioFilter_->readOutput();
         if (audioFilterOutput) {
             outputAudioFilter_->feedInput(audioFilterOutput->pointer(), "input");
@@ -405,12 +464,7 @@ MediaRecorder::onFrame(const std::string& name, const std::shared_ptr<MediaFrame
 #ifdef ENABLE_VIDEO
     }
 #endif // ENABLE_VIDEO
-
-    for (auto& fFrame : filteredFrames) {
-        std::lock_guard lk(mutexFrameBuff_);
-        frameBuff_.emplace_back(std::move(fFrame));
-        cv_.notify_one();
-    }
+    return filteredFrames;
 }
 
 int
@@ -712,6 +766,7 @@ MediaRecorder::reset()
     {
         std::lock_guard lk(mutexFrameBuff_);
         frameBuff_.clear();
+        queuedVideoFrames_ = 0;
     }
     videoIdx_ = audioIdx_ = -1;
     {
@@ -30,6 +30,7 @@
 #include "noncopyable.h"
 #include "observer.h"
 
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -37,6 +38,7 @@
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 #include <condition_variable>
 #include <atomic>
 
@@ -124,12 +126,44 @@ public:
      */
     void stopRecording();
 
+    /**
+     * Frames received from the streams since the recording started, frames
+     * dropped because the recording pipeline could not keep up, and the
+     * highest number of frames waiting to be processed.
+     */
+    struct Stats
+    {
+        uint64_t received {0};
+        uint64_t droppedVideo {0};
+        uint64_t droppedAudio {0};
+        size_t maxQueued {0};
+    };
+
+    Stats getStats() const;
+
 private:
     NON_COPYABLE(MediaRecorder);
 
     struct StreamObserver;
 
-    void onFrame(const std::string& name, const std::shared_ptr<MediaFrame>& frame);
+    /**
+     * Frame received from a stream, waiting to be converted, filtered and
+     * encoded by the recording thread.
+     */
+    struct PendingFrame
+    {
+        std::string stream;
+        std::shared_ptr<MediaFrame> frame;
+        int64_t timestamp {0};
+        bool isVideo {false};
+    };
+
+    /**
+     * Called on the producer thread: only queues a reference to the frame.
+     */
+    void onFrame(const std::string& name, bool isVideo, const std::shared_ptr<MediaFrame>& frame);
+    void dropOldestFrame(bool videoOnly);
+    std::vector<std::unique_ptr<MediaFrame>> processFrame(const PendingFrame& pending);
 
     void flush();
     void reset();
@@ -142,7 +176,7 @@ private:
     std::mutex mutexStreamSetup_;
     std::string buildAudioFilter(const std::vector<MediaStream>& peers) const;
 
-    std::mutex mutexFrameBuff_;
+    mutable std::mutex mutexFrameBuff_;
     std::mutex mutexFilterVideo_;
     std::mutex mutexFilterAudio_;
 
@@ -171,7 +205,9 @@ private:
     std::condition_variable cv_;
     std::atomic_bool interrupted_ {false};
 
-    std::list<std::shared_ptr<MediaFrame>> frameBuff_;
+    std::list<PendingFrame> frameBuff_;
+    size_t queuedVideoFrames_ {0};
+    Stats stats_;
 };
 
 }; // namespace jami
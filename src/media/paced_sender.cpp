@@ -0,0 +1,114 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "media/paced_sender.h"
+#include "logger.h"
+
+namespace jami {
+
+PacedSender::PacedSender(SendCallback send)
+    : send_(std::move(send))
+    , loop_([] { return true; }, [this] { process(); }, [] {})
+{
+    loop_.start();
+}
+
+PacedSender::~PacedSender()
+{
+    {
+        std::lock_guard lk(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    loop_.join();
+}
+
+void
+PacedSender::enqueue(Packet&& packet)
+{
+    {
+        std::lock_guard lk(mutex_);
+        queuedBytes_ += packet.data.size();
+        queue_.emplace_back(std::move(packet));
+    }
+    cv_.notify_one();
+}
+
+void
+PacedSender::setPacingRate(uint64_t bps, clock::duration maxQueueDelay)
+{
+    std::lock_guard lk(mutex_);
+    pacingBps_ = bps;
+    if (maxQueueDelay > clock::duration::zero())
+        maxQueueDelay_ = maxQueueDelay;
+}
+
+int
+PacedSender::probe(uint64_t bps, unsigned packets)
+{
+    std::lock_guard lk(mutex_);
+    probeBps_ = bps;
+    probePackets_ = packets;
+    return ++probeCluster_;
+}
+
+size_t
+PacedSender::queuedBytes() const
+{
+    std::lock_guard lk(mutex_);
+    return queuedBytes_;
+}
+
+void
+PacedSender::process()
+{
+    std::unique_lock lk(mutex_);
+    cv_.wait(lk, [this] { return stopping_ or not queue_.empty(); });
+    if (stopping_) {
+        loop_.stop();
+        return;
+    }
+    if (cv_.wait_until(lk, budget_.nextSend(), [this] { return stopping_; })) {
+        loop_.stop();
+        return;
+    }
+
+    auto packet = std::move(queue_.front());
+    queue_.pop_front();
+    queuedBytes_ -= packet.data.size();
+
+    int cluster = -1;
+    uint64_t bps;
+    if (probePackets_) {
+        --probePackets_;
+        cluster = probeCluster_;
+        bps = probeBps_;
+    } else {
+        // Drain the queue within the maximum delay, whatever the pacing rate
+        auto maxDelay = std::chrono::duration<double>(maxQueueDelay_).count();
+        bps = std::max<uint64_t>(pacingBps_, queuedBytes_ * 8 / maxDelay);
+        if (not pacingBps_)
+            bps = 0;
+    }
+    budget_.onSent(packet.data.size(), clock::now(), bps);
+    lk.unlock();
+
+    send_(packet, cluster);
+}
+
+} // namespace jami
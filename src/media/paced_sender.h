@@ -0,0 +1,132 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+#include "threadloop.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Leaky bucket deciding when the next packet may leave.
+ * Small bursts (BURST) are allowed to absorb timer imprecision.
+ */
+class PacingBudget
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    static constexpr auto BURST = std::chrono::milliseconds(2);
+
+    time_point nextSend() const { return next_; }
+
+    /**
+     * Account for a packet sent at now, at rate bps (unpaced if 0).
+     */
+    void onSent(size_t size, time_point now, uint64_t bps)
+    {
+        if (not bps) {
+            next_ = now;
+            return;
+        }
+        next_ = std::max(next_, now - BURST)
+                + std::chrono::duration_cast<clock::duration>(
+                    std::chrono::duration<double>(size * 8.0 / bps));
+    }
+
+private:
+    time_point next_ {};
+};
+
+/**
+ * Spreads outgoing packets over time instead of sending each frame as a
+ * burst, which overflows the queues of constrained links.
+ *
+ * Packets leave at the pacing rate, or faster if needed so that none stays
+ * queued longer than the maximum queue delay (typically a frame interval,
+ * so that pacing never accumulates latency).
+ *
+ * A probe sends the next packets at a higher rate, tagged with a cluster
+ * identifier, so that the bandwidth estimator can measure the throughput
+ * of the link beyond the current target.
+ */
+class PacedSender
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Packet
+    {
+        std::vector<uint8_t> data;
+        uint16_t transportSeq {0};
+    };
+
+    /**
+     * Called from the pacer thread for each packet leaving.
+     * probeCluster is -1 outside of probes.
+     */
+    using SendCallback = std::function<void(Packet& packet, int probeCluster)>;
+
+    explicit PacedSender(SendCallback send);
+    ~PacedSender();
+
+    void enqueue(Packet&& packet);
+
+    void setPacingRate(uint64_t bps, clock::duration maxQueueDelay);
+
+    /**
+     * Send the next packets at rate bps.
+     * @return the identifier of the probe cluster
+     */
+    int probe(uint64_t bps, unsigned packets);
+
+    size_t queuedBytes() const;
+
+private:
+    NON_COPYABLE(PacedSender);
+
+    void process();
+
+    SendCallback send_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Packet> queue_;
+    size_t queuedBytes_ {0};
+    PacingBudget budget_;
+    uint64_t pacingBps_ {0};
+    clock::duration maxQueueDelay_ {std::chrono::milliseconds(100)};
+
+    uint64_t probeBps_ {0};
+    unsigned probePackets_ {0};
+    int probeCluster_ {-1};
+
+    bool stopping_ {false};
+    ThreadLoop loop_;
+};
+
+} // namespace jami
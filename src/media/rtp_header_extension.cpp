@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "media/rtp_header_extension.h"
+
+#include <cstring>
+
+namespace jami {
+
+static constexpr size_t RTP_HEADER_SIZE = 12;
+static constexpr uint16_t ONE_BYTE_EXTENSION_PROFILE = 0xBEDE;
+
+// Offset of the header extension, after the CSRC list
+static size_t
+headerExtensionOffset(const uint8_t* buf, size_t len)
+{
+    auto offset = RTP_HEADER_SIZE + 4 * (buf[0] & 0x0f);
+    return offset <= len ? offset : 0;
+}
+
+int
+addHeaderExtension(uint8_t* dst,
+                   size_t capacity,
+                   const uint8_t* src,
+                   size_t len,
+                   uint8_t id,
+                   const uint8_t* data,
+                   size_t dataLen)
+{
+    if (len < RTP_HEADER_SIZE or id == 0 or id >= 15 or dataLen == 0 or dataLen > 16)
+        return -1;
+    auto offset = headerExtensionOffset(src, len);
+    if (not offset)
+        return -1;
+
+    // The element, padded to a 32 bits boundary
+    uint8_t element[20] {};
+    element[0] = id << 4 | (dataLen - 1);
+    std::memcpy(element + 1, data, dataLen);
+    size_t elementSize = (1 + dataLen + 3) & ~size_t(3);
+
+    if (src[0] & 0x10) {
+        // Append to the existing extension
+        if (len < offset + 4)
+            return -1;
+        if ((src[offset] << 8 | src[offset + 1]) != ONE_BYTE_EXTENSION_PROFILE)
+            return -1;
+        uint16_t words = src[offset + 2] << 8 | src[offset + 3];
+        auto end = offset + 4 + 4 * words;
+        if (len < end or capacity < len + elementSize)
+            return -1;
+        std::memcpy(dst, src, end);
+        std::memcpy(dst + end, element, elementSize);
+        std::memcpy(dst + end + elementSize, src + end, len - end);
+        words += elementSize / 4;
+        dst[offset + 2] = words >> 8;
+        dst[offset + 3] = words & 0xff;
+        return len + elementSize;
+    }
+
+    if (capacity < len + RTP_EXTENSION_HEADER_SIZE + elementSize)
+        return -1;
+    std::memcpy(dst, src, offset);
+    dst[0] |= 0x10;
+    dst[offset] = ONE_BYTE_EXTENSION_PROFILE >> 8;
+    dst[offset + 1] = ONE_BYTE_EXTENSION_PROFILE & 0xff;
+    dst[offset + 2] = 0;
+    dst[offset + 3] = elementSize / 4;
+    std::memcpy(dst + offset + RTP_EXTENSION_HEADER_SIZE, element, elementSize);
+    std::memcpy(dst + offset + RTP_EXTENSION_HEADER_SIZE + elementSize, src + offset, len - offset);
+    return len + RTP_EXTENSION_HEADER_SIZE + elementSize;
+}
+
+const uint8_t*
+findHeaderExtension(const uint8_t* buf, size_t len, uint8_t id, size_t& dataLen)
+{
+    if (len < RTP_HEADER_SIZE or not(buf[0] & 0x10))
+        return nullptr;
+    auto offset = headerExtensionOffset(buf, len);
+    if (not offset or len < offset + 4)
+        return nullptr;
+    if ((buf[offset] << 8 | buf[offset + 1]) != ONE_BYTE_EXTENSION_PROFILE)
+        return nullptr;
+    auto end = offset + 4 + 4 * (buf[offset + 2] << 8 | buf[offset + 3]);
+    if (len < end)
+        return nullptr;
+
+    for (auto pos = offset + 4; pos < end;) {
+        if (buf[pos] == 0) { // padding
+            ++pos;
+            continue;
+        }
+        uint8_t elementId = buf[pos] >> 4;
+        size_t elementLen = (buf[pos] & 0x0f) + 1;
+        if (elementId == 15 or pos + 1 + elementLen > end)
+            break;
+        if (elementId == id) {
+            dataLen = elementLen;
+            return buf + pos + 1;
+        }
+        pos += 1 + elementLen;
+    }
+    return nullptr;
+}
+
+} // namespace jami
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace jami {
+
+/**
+ * RTP header extensions, one-byte header form (RFC 8285).
+ *
+ * Elements are added to outgoing packets after the encoder, and read from
+ * incoming ones before decryption (SRTP leaves the header in clear).
+ * Identifiers are fixed instead of negotiated in the SDP: peers not knowing
+ * an element skip it.
+ */
+
+// Size of the extension header (profile and length), added to a packet
+// along with its first element
+static constexpr size_t RTP_EXTENSION_HEADER_SIZE {4};
+
+/**
+ * Copy an RTP packet, adding an element (1 to 16 bytes of data) to its
+ * header extension, which is created if needed. Elements already present
+ * stay first.
+ * @return the size of the new packet, or -1 if the packet can't be extended
+ * or doesn't fit in dst
+ */
+int addHeaderExtension(uint8_t* dst,
+                       size_t capacity,
+                       const uint8_t* src,
+                       size_t len,
+                       uint8_t id,
+                       const uint8_t* data,
+                       size_t dataLen);
+
+/**
+ * Find an element in the header extension of an RTP packet.
+ * @param dataLen   set to the size of the element data, if found
+ * @return the element data, nullptr if not found
+ */
+const uint8_t* findHeaderExtension(const uint8_t* buf, size_t len, uint8_t id, size_t& dataLen);
+
+} // namespace jami
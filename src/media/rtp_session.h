@@ -25,6 +25,7 @@
 #include "socket_pair.h"
 #include "connectivity/sip_utils.h"
 #include "media/media_codec.h"
+#include "media/media_latency.h"
 
 #include <functional>
 #include <string>
@@ -78,6 +79,8 @@ public:
 
     inline std::string streamId() const { return streamId_; }
 
+    const std::shared_ptr<MediaLatencyStats>& getLatencyStats() const { return latencyStats_; }
+
 protected:
     std::recursive_mutex mutex_;
     const std::string callId_;
@@ -90,6 +93,8 @@ protected:
     uint16_t mtu_;
     std::shared_ptr<MediaRecorder> recorder_;
     std::function<void(MediaType, bool)> onSuccessfulSetup_;
+    // Shared with the sender and receiver, survives their restarts
+    std::shared_ptr<MediaLatencyStats> latencyStats_ {std::make_shared<MediaLatencyStats>()};
 
     std::string getRemoteRtpUri() const { return "rtp://" + send_.addr.toString(true); }
 };
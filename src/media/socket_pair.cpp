@@ -25,7 +25,10 @@
 #include "libav_deps.h" // THEN THIS ONE AFTER
 
 #include "socket_pair.h"
+#include "paced_sender.h"
 #include "libav_utils.h"
+#include "media_latency.h"
+#include "rtp_header_extension.h"
 #include "logger.h"
 #include "connectivity/security/memory.h"
 
@@ -198,7 +201,7 @@ SocketPair::SocketPair(std::unique_ptr<dhtnet::IceSocket> rtp_sock, std::unique_
 
     rtp_sock_->setOnRecv([this](uint8_t* buf, size_t len) {
         std::lock_guard l(dataBuffMutex_);
-        rtpDataBuff_.emplace_back(buf, buf + len);
+        rtpDataBuff_.emplace_back(std::vector<uint8_t>(buf, buf + len), latency::nowUs());
         cv_.notify_one();
         return len;
     });
@@ -213,12 +216,13 @@ SocketPair::SocketPair(std::unique_ptr<dhtnet::IceSocket> rtp_sock, std::unique_
 SocketPair::~SocketPair()
 {
     interrupt();
+    pacer_.reset();
     closeSockets();
     JAMI_DBG("[%p] Instance destroyed", this);
 }
 
 bool
-SocketPair::waitForRTCP(std::chrono::seconds interval)
+SocketPair::waitForRTCP(std::chrono::milliseconds interval)
 {
     std::unique_lock lock(rtcpInfo_mutex_);
     return cvRtcpPacketReadyToRead_.wait_for(lock, interval, [this] {
@@ -366,6 +370,35 @@ SocketPair::openSockets(const char* uri, int local_rtp_port)
               dst_rtcp_port);
 }
 
+void
+SocketPair::enableTransportCC(PacketSentCallback onSent, TransportFeedbackCallback onFeedback)
+{
+    packetSentCallback_ = std::move(onSent);
+    transportFeedbackCallback_ = std::move(onFeedback);
+    pacer_ = std::make_unique<PacedSender>([this](PacedSender::Packet& packet, int cluster) {
+        if (sendPacket(packet.data.data(), packet.data.size()) < 0)
+            return;
+        if (packetSentCallback_)
+            packetSentCallback_(packet.transportSeq,
+                                packet.data.size(),
+                                std::chrono::steady_clock::now(),
+                                cluster);
+    });
+}
+
+void
+SocketPair::setPacingRate(uint64_t bps, std::chrono::steady_clock::duration maxQueueDelay)
+{
+    if (pacer_)
+        pacer_->setPacingRate(bps, maxQueueDelay);
+}
+
+int
+SocketPair::probe(uint64_t bps, unsigned packets)
+{
+    return pacer_ ? pacer_->probe(bps, packets) : -1;
+}
+
 MediaIOHandle*
 SocketPair::createIOContext(const uint16_t mtu)
 {
@@ -376,8 +409,15 @@ SocketPair::createIOContext(const uint16_t mtu)
         ip_header_size = 40;
     else
         ip_header_size = 20;
+    // libav's RTP muxer emits no header extension, the elements added to
+    // outgoing packets come with the extension header
+    unsigned extension_size = (pacer_ ? TRANSPORT_CC_EXTENSION_SIZE : 0)
+                              + (audioLevelReserved_ ? AUDIO_LEVEL_EXTENSION_SIZE : 0);
+    if (extension_size)
+        extension_size += RTP_EXTENSION_HEADER_SIZE;
     return new MediaIOHandle(
-        mtu - (srtpContext_ ? SRTP_OVERHEAD : 0) - UDP_HEADER_SIZE - ip_header_size,
+        mtu - (srtpContext_ ? SRTP_OVERHEAD : 0) - extension_size - UDP_HEADER_SIZE
+            - ip_header_size,
         true,
         [](void* sp, uint8_t* buf, int len) {
             return static_cast<SocketPair*>(sp)->readCallback(buf, len);
@@ -438,12 +478,13 @@ SocketPair::waitForData()
 }
 
 int
-SocketPair::readRtpData(void* buf, int buf_size)
+SocketPair::readRtpData(void* buf, int buf_size, uint32_t& arrival)
 {
     // handle system socket
     if (rtpHandle_ >= 0) {
         struct sockaddr_storage from;
         socklen_t from_len = sizeof(from);
+        arrival = latency::nowUs();
         return recvfrom(rtpHandle_,
                         static_cast<char*>(buf),
                         buf_size,
@@ -455,9 +496,10 @@ SocketPair::readRtpData(void* buf, int buf_size)
     // handle ICE
     std::unique_lock lk(dataBuffMutex_);
     if (not rtpDataBuff_.empty()) {
-        auto pkt = std::move(rtpDataBuff_.front());
+        auto [pkt, pktArrival] = std::move(rtpDataBuff_.front());
         rtpDataBuff_.pop_front();
         lk.unlock(); // to not block our ICE callbacks
+        arrival = pktArrival;
         int pkt_size = pkt.size();
         int len = std::min(pkt_size, buf_size);
         std::copy_n(pkt.begin(), len, static_cast<char*>(buf));
@@ -497,6 +539,36 @@ SocketPair::readRtcpData(void* buf, int buf_size)
     return 0;
 }
 
+void
+SocketPair::onRtpArrival(const uint8_t* buf, size_t len, uint32_t arrival)
+{
+    if (len < 8)
+        return;
+    // Packets of a frame share their RTP timestamp, which is never encrypted
+    uint32_t timestamp = (uint32_t(buf[4]) << 24) | (uint32_t(buf[5]) << 16)
+                         | (uint32_t(buf[6]) << 8) | buf[7];
+    std::lock_guard lk(frameArrivalsMutex_);
+    if (lastRtpTimestamp_ == timestamp)
+        return;
+    lastRtpTimestamp_ = timestamp;
+    frameArrivals_.emplace_back(arrival);
+}
+
+std::optional<uint32_t>
+SocketPair::takeFrameArrival()
+{
+    std::lock_guard lk(frameArrivalsMutex_);
+    if (frameArrivals_.empty())
+        return std::nullopt;
+    auto arrival = frameArrivals_.front();
+    frameArrivals_.pop_front();
+    // The demuxer reads the first packet of the next frame before returning
+    // the current one, anything older was dropped by the depacketizer.
+    while (frameArrivals_.size() > 1)
+        frameArrivals_.pop_front();
+    return arrival;
+}
+
 int
 SocketPair::readCallback(uint8_t* buf, int buf_size)
 {
@@ -506,6 +578,7 @@ SocketPair::readCallback(uint8_t* buf, int buf_size)
 
     int len = 0;
     bool fromRTCP = false;
+    uint32_t arrival = 0;
 
     if (datatype & static_cast<int>(DataType::RTCP)) {
         len = readRtcpData(buf, buf_size);
@@ -521,6 +594,9 @@ SocketPair::readCallback(uint8_t* buf, int buf_size)
             // 206 = REMB PT
             else if (header->pt == 206)
                 saveRtcpREMBPacket(buf, len);
+            // 205 = RTPFB PT
+            else if (header->pt == 205)
+                onTransportFeedback(buf, len);
             // 200 = SR PT
             else if (header->pt == 200) {
                 // not used yet
@@ -533,7 +609,7 @@ SocketPair::readCallback(uint8_t* buf, int buf_size)
 
     // No RTCP... try RTP
     if (!len and (datatype & static_cast<int>(DataType::RTP))) {
-        len = readRtpData(buf, buf_size);
+        len = readRtpData(buf, buf_size, arrival);
         fromRTCP = false;
     }
 
@@ -543,6 +619,17 @@ SocketPair::readCallback(uint8_t* buf, int buf_size)
     if (not fromRTCP && (buf_size < static_cast<int>(MINIMUM_RTP_HEADER_SIZE)))
         return len;
 
+    // The header extension is not encrypted
+    if (not fromRTCP) {
+        onRtpArrival(buf, len, arrival);
+        onTransportSequence(buf, len);
+        std::lock_guard lk(audioLevelMutex_);
+        if (audioLevelCallback_) {
+            if (auto level = readAudioLevel(buf, len))
+                audioLevelCallback_(*level);
+        }
+    }
+
     // SRTP decrypt
     if (not fromRTCP and srtpContext_ and srtpContext_->srtp_in.aes) {
         int32_t gradient = 0;
@@ -617,17 +704,93 @@ SocketPair::writeData(uint8_t* buf, int buf_size)
         return rtp_sock_->send(buf, buf_size);
 }
 
+void
+SocketPair::onTransportFeedback(uint8_t* buf, size_t len)
+{
+    if (not transportFeedbackCallback_)
+        return;
+    if (auto feedback = parseTransportFeedback(buf, len))
+        transportFeedbackCallback_(*feedback);
+}
+
+void
+SocketPair::onTransportSequence(const uint8_t* buf, size_t len)
+{
+    auto seq = readTransportSequence(buf, len);
+    if (not seq)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    uint32_t mediaSsrc = buf[8] << 24 | buf[9] << 16 | buf[10] << 8 | buf[11];
+    feedbackBuilder_.onPacket(*seq, mediaSsrc, now);
+    if (not feedbackBuilder_.shouldSend(now))
+        return;
+
+    auto feedback = feedbackBuilder_.build(ssrcOut_, now);
+    if (feedback.empty() or noWrite_)
+        return;
+    std::lock_guard lk(writeMutex_);
+    if (writeData(feedback.data(), feedback.size()) < 0)
+        JAMI_DBG("[%p] Unable to send transport feedback", this);
+}
+
+int
+SocketPair::sendPacket(uint8_t* buf, int buf_size)
+{
+    int ret;
+    do {
+        if (interrupted_)
+            return -EINTR;
+        ret = writeData(buf, buf_size);
+    } while (ret < 0 and errno == EAGAIN);
+    return ret < 0 ? -errno : ret;
+}
+
 int
 SocketPair::writeCallback(uint8_t* buf, int buf_size)
 {
     if (noWrite_)
         return 0;
 
+    std::lock_guard lk(writeMutex_);
     int ret;
     bool isRTCP = RTP_PT_IS_RTCP(buf[1]);
     unsigned int ts_LSB, ts_MSB;
     double currentSRTS, currentLatency;
 
+    // Audio level of the packet, also left in clear
+    if (audioLevelReserved_ and audioLevelEnabled_ and not isRTCP) {
+        auto size = buf_size + RTP_EXTENSION_HEADER_SIZE + AUDIO_LEVEL_EXTENSION_SIZE;
+        if (audioLevelPacket_.size() < size)
+            audioLevelPacket_.resize(size);
+        auto len = addAudioLevel(audioLevelPacket_.data(),
+                                 audioLevelPacket_.size(),
+                                 buf,
+                                 buf_size,
+                                 {audioLevelOut_, voiceOut_});
+        if (len > 0) {
+            buf = audioLevelPacket_.data();
+            buf_size = len;
+        }
+    }
+
+    // Number the packet for transport-wide feedback, before encryption
+    // as the header extension stays in clear
+    uint16_t transportSeq = 0;
+    if (pacer_ and not isRTCP) {
+        auto size = buf_size + RTP_EXTENSION_HEADER_SIZE + TRANSPORT_CC_EXTENSION_SIZE;
+        if (extendedPacket_.size() < size)
+            extendedPacket_.resize(size);
+        transportSeq = transportSeq_;
+        auto len = addTransportSequence(
+            extendedPacket_.data(), extendedPacket_.size(), buf, buf_size, transportSeq);
+        if (len > 0) {
+            ++transportSeq_;
+            ssrcOut_ = buf[8] << 24 | buf[9] << 16 | buf[10] << 8 | buf[11];
+            buf = extendedPacket_.data();
+            buf_size = len;
+        }
+    }
+
     // Encrypt?
     if (not isRTCP and srtpContext_ and srtpContext_->srtp_out.aes) {
         buf_size = ff_srtp_encrypt(&srtpContext_->srtp_out,
@@ -651,11 +814,13 @@ SocketPair::writeCallback(uint8_t* buf, int buf_size)
                            && ntohl(header->fraction_lost) & RTCP_RR_FRACTION_MASK);
     }
 
-    do {
-        if (interrupted_)
-            return -EINTR;
-        ret = writeData(buf, buf_size);
-    } while (ret < 0 and errno == EAGAIN);
+    // Media packets leave from the pacer thread
+    if (pacer_ and not isRTCP) {
+        pacer_->enqueue({std::vector<uint8_t>(buf, buf + buf_size), transportSeq});
+        return buf_size;
+    }
+
+    ret = sendPacket(buf, buf_size);
 
     if (buf[1] == 200) // Sender Report
     {
@@ -684,7 +849,7 @@ SocketPair::writeCallback(uint8_t* buf, int buf_size)
         // JAMI_WARN("SENDING NEW RTCP RR !! ");
     }
 
-    return ret < 0 ? -errno : ret;
+    return ret;
 }
 
 double
@@ -26,6 +26,8 @@
 #endif
 
 #include "media_io_handle.h"
+#include "transport_cc.h"
+#include "audio/audio_level.h"
 
 #ifndef _WIN32
 #include <sys/socket.h>
@@ -44,7 +46,9 @@ using socklen_t = int;
 #include <mutex>
 #include <memory>
 #include <atomic>
+#include <deque>
 #include <list>
+#include <optional>
 #include <vector>
 #include <condition_variable>
 #include <functional>
@@ -52,6 +56,7 @@ using socklen_t = int;
 namespace jami {
 
 class SRTPProtoContext;
+class PacedSender;
 
 typedef struct
 {
@@ -145,6 +150,7 @@ public:
     // if to stop the receiver thread to exit and there is no more data
     // to read (if the peer mutes/stops the media/RTP stream).
     void setReadBlockingMode(bool blocking);
+    bool isReadBlocking() const { return readBlockingMode_; }
 
     MediaIOHandle* createIOContext(const uint16_t mtu);
 
@@ -176,7 +182,7 @@ public:
     std::list<rtcpRRHeader> getRtcpRR();
     std::list<rtcpREMBHeader> getRtcpREMB();
 
-    bool waitForRTCP(std::chrono::seconds interval);
+    bool waitForRTCP(std::chrono::milliseconds interval);
     double getLastLatency();
 
     void setPacketLossCallback(std::function<void(void)> cb)
@@ -187,8 +193,77 @@ public:
 
     int writeData(uint8_t* buf, int buf_size);
 
+    /**
+     * Read one packet, RTP packets are decrypted.
+     * Same as the read operation of the IO context, for users
+     * handling packets without libavformat.
+     */
+    int readPacket(uint8_t* buf, int buf_size) { return readCallback(buf, buf_size); }
+
+    /**
+     * Send one packet, RTP packets are encrypted.
+     * May be used concurrently with the IO context.
+     */
+    int writePacket(uint8_t* buf, int buf_size) { return writeCallback(buf, buf_size); }
+
     uint16_t lastSeqValOut();
 
+    using PacketSentCallback = std::function<
+        void(uint16_t seq, size_t size, std::chrono::steady_clock::time_point sendTime, int probeCluster)>;
+    using TransportFeedbackCallback = std::function<void(const TransportFeedback&)>;
+
+    /**
+     * Number outgoing RTP packets with transport-wide sequence numbers and
+     * send them through a pacer. Must be called before createIOContext(),
+     * which reserves room for the header extension.
+     * @param onSent        called for each packet leaving the pacer
+     * @param onFeedback    called for each transport-wide feedback received
+     */
+    void enableTransportCC(PacketSentCallback onSent, TransportFeedbackCallback onFeedback);
+    void setPacingRate(uint64_t bps, std::chrono::steady_clock::duration maxQueueDelay);
+    /**
+     * Send the next packets at rate bps, as a probe cluster.
+     * @return the probe cluster identifier, -1 if transport-cc is not enabled
+     */
+    int probe(uint64_t bps, unsigned packets);
+
+    /**
+     * Leave room for the audio level header extension in outgoing RTP packets.
+     * Must be called before createIOContext().
+     */
+    void reserveAudioLevel() { audioLevelReserved_ = true; }
+    /**
+     * Add the audio level header extension to outgoing RTP packets, if room
+     * was reserved for it. The extension is not encrypted by SRTP, so only
+     * enable it toward a peer that needs it (a conference host).
+     */
+    void enableAudioLevel(bool enable) { audioLevelEnabled_ = enable; }
+    /**
+     * Level reported in the next outgoing packets.
+     */
+    void setOutgoingAudioLevel(AudioLevel level)
+    {
+        audioLevelOut_ = level.level;
+        voiceOut_ = level.voice;
+    }
+
+    /**
+     * Arrival time (latency::nowUs()) of the first packet of the oldest frame
+     * read through the IO context and not yet taken. Frames are told apart by
+     * their RTP timestamp. The decoder takes one per packet it decodes.
+     */
+    std::optional<uint32_t> takeFrameArrival();
+
+    using AudioLevelCallback = std::function<void(AudioLevel)>;
+    /**
+     * Called with the audio level of each incoming RTP packet carrying one.
+     */
+    void setAudioLevelCallback(AudioLevelCallback cb)
+    {
+        std::lock_guard lk(audioLevelMutex_);
+        audioLevelCallback_ = std::move(cb);
+    }
+
 private:
     NON_COPYABLE(SocketPair);
     using clock = std::chrono::steady_clock;
@@ -198,16 +273,25 @@ private:
     int writeCallback(uint8_t* buf, int buf_size);
 
     int waitForData();
-    int readRtpData(void* buf, int buf_size);
+    int readRtpData(void* buf, int buf_size, uint32_t& arrival);
     int readRtcpData(void* buf, int buf_size);
     void saveRtcpRRPacket(uint8_t* buf, size_t len);
     void saveRtcpREMBPacket(uint8_t* buf, size_t len);
+    void onTransportFeedback(uint8_t* buf, size_t len);
+    void onTransportSequence(const uint8_t* buf, size_t len);
+    void onRtpArrival(const uint8_t* buf, size_t len, uint32_t arrival);
+    int sendPacket(uint8_t* buf, int buf_size);
 
     std::mutex dataBuffMutex_;
     std::condition_variable cv_;
-    std::list<std::vector<uint8_t>> rtpDataBuff_;
+    // RTP packets with their arrival time
+    std::list<std::pair<std::vector<uint8_t>, uint32_t>> rtpDataBuff_;
     std::list<std::vector<uint8_t>> rtcpDataBuff_;
 
+    std::mutex frameArrivalsMutex_;
+    std::deque<uint32_t> frameArrivals_;
+    std::optional<uint32_t> lastRtpTimestamp_;
+
     std::unique_ptr<dhtnet::IceSocket> rtp_sock_;
     std::unique_ptr<dhtnet::IceSocket> rtcp_sock_;
 
@@ -220,6 +304,8 @@ private:
     // receiver thread if the peer stops/mutes the media (RTP)
     std::atomic_bool readBlockingMode_ {false};
     std::atomic_bool noWrite_ {false};
+    // Protects the SRTP output context and its buffer
+    std::mutex writeMutex_;
     std::unique_ptr<SRTPProtoContext> srtpContext_;
     std::function<void(void)> packetLossCallback_;
     std::function<void(int, int)> rtpDelayCallback_;
@@ -245,6 +331,25 @@ private:
     time_point arrival_TS {};
 
     TS_Frame svgTS = {};
+
+    // Transport-wide congestion control, sender side
+    std::unique_ptr<PacedSender> pacer_;
+    PacketSentCallback packetSentCallback_;
+    TransportFeedbackCallback transportFeedbackCallback_;
+    uint16_t transportSeq_ {0};
+    uint32_t ssrcOut_ {0};
+    std::vector<uint8_t> extendedPacket_;
+    // Receiver side
+    TransportFeedbackBuilder feedbackBuilder_;
+
+    // Audio level header extension
+    bool audioLevelReserved_ {false};
+    std::atomic_bool audioLevelEnabled_ {false};
+    std::atomic<uint8_t> audioLevelOut_ {AUDIO_LEVEL_SILENCE};
+    std::atomic_bool voiceOut_ {false};
+    std::vector<uint8_t> audioLevelPacket_;
+    std::mutex audioLevelMutex_;
+    AudioLevelCallback audioLevelCallback_;
 };
 
 } // namespace jami
@@ -0,0 +1,258 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "media/transport_cc.h"
+#include "media/rtp_header_extension.h"
+
+#include <algorithm>
+
+namespace jami {
+
+static constexpr uint8_t RTCP_VERSION = 2;
+static constexpr uint8_t RTPFB_PT = 205;
+static constexpr uint8_t TRANSPORT_CC_FMT = 15;
+static constexpr size_t FEEDBACK_HEADER_SIZE = 20;
+
+// Receive deltas are expressed in 250us units, the reference time in 64ms units
+static constexpr int64_t DELTA_UNIT_US = 250;
+static constexpr int64_t REFERENCE_UNIT_US = 64000;
+
+// Packet status symbols
+static constexpr uint8_t NOT_RECEIVED = 0;
+static constexpr uint8_t SMALL_DELTA = 1;
+static constexpr uint8_t LARGE_DELTA = 2;
+
+// Limit the size of a single feedback packet
+static constexpr int64_t MAX_REPORTED_PACKETS = 1000;
+static constexpr size_t MAX_PENDING_ARRIVALS = 2000;
+
+int
+addTransportSequence(uint8_t* dst, size_t capacity, const uint8_t* src, size_t len, uint16_t seq)
+{
+    const uint8_t data[2] {static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq)};
+    return addHeaderExtension(dst, capacity, src, len, TRANSPORT_CC_EXTENSION_ID, data, sizeof(data));
+}
+
+std::optional<uint16_t>
+readTransportSequence(const uint8_t* buf, size_t len)
+{
+    size_t dataLen;
+    auto data = findHeaderExtension(buf, len, TRANSPORT_CC_EXTENSION_ID, dataLen);
+    if (not data or dataLen != 2)
+        return {};
+    return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+// Transport-wide feedback
+//
+//     0                   1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |V=2|P|  FMT=15 |    PT=205     |           length              |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                     SSRC of packet sender                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                      SSRC of media source                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |      base sequence number     |      packet status count      |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 12 |                 reference time                | fb pkt. count |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 16 |          packet chunk         |         packet chunk          |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    .                                                               .
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |         packet chunk          |  recv delta   |  recv delta   |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    .                                                               .
+
+static void
+insert2Byte(std::vector<uint8_t>& v, uint16_t val)
+{
+    v.push_back(val >> 8);
+    v.push_back(val & 0xff);
+}
+
+static void
+insert4Byte(std::vector<uint8_t>& v, uint32_t val)
+{
+    insert2Byte(v, val >> 16);
+    insert2Byte(v, val & 0xffff);
+}
+
+void
+TransportFeedbackBuilder::onPacket(uint16_t seq, uint32_t mediaSsrc, time_point arrival)
+{
+    auto unwrapped = unwrapper_.unwrap(seq);
+    if (nextSeq_ >= 0 and unwrapped < nextSeq_)
+        return; // Already reported as lost
+    mediaSsrc_ = mediaSsrc;
+    arrivals_[unwrapped]
+        = std::chrono::duration_cast<std::chrono::microseconds>(arrival - epoch_).count();
+    if (arrivals_.size() > MAX_PENDING_ARRIVALS)
+        arrivals_.erase(arrivals_.begin());
+}
+
+std::vector<uint8_t>
+TransportFeedbackBuilder::build(uint32_t senderSsrc, time_point now)
+{
+    std::vector<uint8_t> packet;
+    lastSent_ = now;
+    if (arrivals_.empty())
+        return packet;
+
+    auto begin = arrivals_.begin()->first;
+    // Don't report a long gap, e.g. after the sender restarted
+    if (nextSeq_ >= 0 and begin - nextSeq_ < MAX_REPORTED_PACKETS)
+        begin = nextSeq_;
+    auto end = std::min(arrivals_.rbegin()->first, begin + MAX_REPORTED_PACKETS - 1);
+
+    auto referenceTime = arrivals_.begin()->second / REFERENCE_UNIT_US;
+    auto last = referenceTime * REFERENCE_UNIT_US;
+
+    std::vector<uint8_t> symbols;
+    std::vector<uint8_t> deltas;
+    symbols.reserve(end - begin + 1);
+    auto it = arrivals_.begin();
+    for (auto seq = begin; seq <= end; ++seq) {
+        if (it == arrivals_.end() or it->first != seq) {
+            symbols.push_back(NOT_RECEIVED);
+            continue;
+        }
+        auto delta = (it->second - last + DELTA_UNIT_US / 2) / DELTA_UNIT_US;
+        if (delta < INT16_MIN or delta > INT16_MAX) {
+            // Too far apart: report the remaining packets in the next feedback
+            end = seq - 1;
+            break;
+        }
+        if (delta >= 0 and delta <= 0xff) {
+            symbols.push_back(SMALL_DELTA);
+            deltas.push_back(delta);
+        } else {
+            symbols.push_back(LARGE_DELTA);
+            insert2Byte(deltas, static_cast<uint16_t>(delta));
+        }
+        last += delta * DELTA_UNIT_US;
+        ++it;
+    }
+    if (symbols.empty())
+        return packet;
+
+    packet.reserve(FEEDBACK_HEADER_SIZE + 2 * (symbols.size() / 7 + 1) + deltas.size() + 3);
+    packet.push_back(RTCP_VERSION << 6 | TRANSPORT_CC_FMT);
+    packet.push_back(RTPFB_PT);
+    insert2Byte(packet, 0); // length, set below
+    insert4Byte(packet, senderSsrc);
+    insert4Byte(packet, mediaSsrc_);
+    insert2Byte(packet, static_cast<uint16_t>(begin));
+    insert2Byte(packet, static_cast<uint16_t>(symbols.size()));
+    insert4Byte(packet, static_cast<uint32_t>(referenceTime) << 8 | feedbackCount_++);
+
+    // Status vector chunks, 7 two-bit symbols each
+    for (size_t i = 0; i < symbols.size(); i += 7) {
+        uint16_t chunk = 0xc000;
+        for (size_t j = 0; j < 7 and i + j < symbols.size(); ++j)
+            chunk |= symbols[i + j] << (12 - 2 * j);
+        insert2Byte(packet, chunk);
+    }
+    packet.insert(packet.end(), deltas.begin(), deltas.end());
+    while (packet.size() % 4)
+        packet.push_back(0);
+    auto length = packet.size() / 4 - 1;
+    packet[2] = length >> 8;
+    packet[3] = length & 0xff;
+
+    nextSeq_ = end + 1;
+    arrivals_.erase(arrivals_.begin(), arrivals_.upper_bound(end));
+    return packet;
+}
+
+std::optional<TransportFeedback>
+parseTransportFeedback(const uint8_t* buf, size_t len)
+{
+    if (len < FEEDBACK_HEADER_SIZE or buf[0] >> 6 != RTCP_VERSION
+        or (buf[0] & 0x1f) != TRANSPORT_CC_FMT or buf[1] != RTPFB_PT)
+        return {};
+    size_t size = 4 * ((buf[2] << 8 | buf[3]) + 1);
+    if (size > len or size < FEEDBACK_HEADER_SIZE)
+        return {};
+
+    TransportFeedback feedback;
+    feedback.mediaSsrc = uint32_t(buf[8]) << 24 | uint32_t(buf[9]) << 16 | uint32_t(buf[10]) << 8
+                         | buf[11];
+    uint16_t baseSeq = buf[12] << 8 | buf[13];
+    size_t count = buf[14] << 8 | buf[15];
+    // 24 bits signed
+    int32_t referenceTime = static_cast<int32_t>(uint32_t(buf[16]) << 24 | uint32_t(buf[17]) << 16
+                                                 | uint32_t(buf[18]) << 8)
+                            >> 8;
+    feedback.feedbackCount = buf[19];
+
+    std::vector<uint8_t> symbols;
+    symbols.reserve(count);
+    size_t pos = FEEDBACK_HEADER_SIZE;
+    while (symbols.size() < count) {
+        if (pos + 2 > size)
+            return {};
+        uint16_t chunk = buf[pos] << 8 | buf[pos + 1];
+        pos += 2;
+        if (not(chunk & 0x8000)) {
+            // Run length chunk
+            uint8_t symbol = (chunk >> 13) & 0x3;
+            size_t run = std::min<size_t>(chunk & 0x1fff, count - symbols.size());
+            symbols.insert(symbols.end(), run, symbol);
+        } else if (not(chunk & 0x4000)) {
+            // Status vector chunk, 14 one-bit symbols
+            for (int i = 13; i >= 0 and symbols.size() < count; --i)
+                symbols.push_back((chunk >> i) & 0x1);
+        } else {
+            // Status vector chunk, 7 two-bit symbols
+            for (int i = 6; i >= 0 and symbols.size() < count; --i)
+                symbols.push_back((chunk >> (2 * i)) & 0x3);
+        }
+    }
+
+    feedback.packets.reserve(count);
+    int64_t arrival = static_cast<int64_t>(referenceTime) * REFERENCE_UNIT_US;
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t seq = baseSeq + i;
+        int64_t delta;
+        switch (symbols[i]) {
+        case SMALL_DELTA:
+            if (pos + 1 > size)
+                return {};
+            delta = buf[pos];
+            pos += 1;
+            break;
+        case LARGE_DELTA:
+            if (pos + 2 > size)
+                return {};
+            delta = static_cast<int16_t>(buf[pos] << 8 | buf[pos + 1]);
+            pos += 2;
+            break;
+        default:
+            feedback.packets.push_back({seq, false, 0});
+            continue;
+        }
+        arrival += delta * DELTA_UNIT_US;
+        feedback.packets.push_back({seq, true, arrival});
+    }
+    return feedback;
+}
+
+} // namespace jami
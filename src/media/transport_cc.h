@@ -0,0 +1,141 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Transport-wide congestion control
+ * (draft-holmer-rmcat-transport-wide-cc-extensions-01).
+ *
+ * Outgoing RTP packets are numbered with a transport-wide sequence number
+ * carried in a one-byte header extension. The receiver reports the arrival
+ * time of each of them in RTCP feedback packets, which lets the sender
+ * estimate both loss and queuing delay on the path.
+ *
+ * The identifier is fixed instead of negotiated in the SDP: peers not
+ * knowing it simply ignore the element.
+ */
+static constexpr uint8_t TRANSPORT_CC_EXTENSION_ID {5};
+// Size of the element, the extension header (RTP_EXTENSION_HEADER_SIZE)
+// comes on top for the first element of a packet
+static constexpr unsigned TRANSPORT_CC_EXTENSION_SIZE {4};
+
+/**
+ * Copy an RTP packet, adding the transport-wide sequence number extension.
+ * @return the size of the new packet, or -1 if the packet can't be extended
+ * or doesn't fit in dst
+ */
+int addTransportSequence(
+    uint8_t* dst, size_t capacity, const uint8_t* src, size_t len, uint16_t seq);
+
+/**
+ * @return the transport-wide sequence number of an RTP packet, if any
+ */
+std::optional<uint16_t> readTransportSequence(const uint8_t* buf, size_t len);
+
+/**
+ * Unwrap 16 bits sequence numbers to monotonic 64 bits values.
+ */
+class SeqUnwrapper
+{
+public:
+    int64_t unwrap(uint16_t seq)
+    {
+        last_ = peek(seq);
+        init_ = true;
+        return last_;
+    }
+
+    // Unwrap without updating the reference
+    int64_t peek(uint16_t seq) const
+    {
+        if (not init_)
+            return seq;
+        return last_ + static_cast<int16_t>(seq - static_cast<uint16_t>(last_));
+    }
+
+private:
+    int64_t last_ {0};
+    bool init_ {false};
+};
+
+struct TransportFeedback
+{
+    struct Packet
+    {
+        uint16_t seq;
+        bool received;
+        // Arrival time in microseconds, on the receiver's clock
+        int64_t arrivalUs;
+    };
+
+    uint32_t mediaSsrc {0};
+    uint8_t feedbackCount {0};
+    std::vector<Packet> packets;
+};
+
+std::optional<TransportFeedback> parseTransportFeedback(const uint8_t* buf, size_t len);
+
+/**
+ * Receiver side: collects arrival times and builds feedback packets.
+ */
+class TransportFeedbackBuilder
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    static constexpr auto INTERVAL = std::chrono::milliseconds(100);
+
+    explicit TransportFeedbackBuilder(time_point epoch = clock::now())
+        : epoch_(epoch)
+    {}
+
+    void onPacket(uint16_t seq, uint32_t mediaSsrc, time_point arrival);
+
+    bool shouldSend(time_point now) const
+    {
+        return not arrivals_.empty() and now - lastSent_ >= INTERVAL;
+    }
+
+    /**
+     * Report every packet received (or lost) since the previous feedback.
+     */
+    std::vector<uint8_t> build(uint32_t senderSsrc, time_point now);
+
+private:
+    time_point epoch_;
+    time_point lastSent_ {};
+    SeqUnwrapper unwrapper_;
+    // Unwrapped sequence number -> arrival (microseconds since epoch_)
+    std::map<int64_t, int64_t> arrivals_;
+    // First sequence number not reported yet
+    int64_t nextSeq_ {-1};
+    uint32_t mediaSsrc_ {0};
+    uint8_t feedbackCount_ {0};
+};
+
+} // namespace jami
@@ -29,8 +29,15 @@
 #include "string_utils.h"
 #include "fileutils.h"
 #include "logger.h"
+#include "manager.h"
 #include "accel.h"
 
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+
 namespace jami {
 namespace video {
 
@@ -119,6 +126,78 @@ static std::list<HardwareAPI> apiListEnc = {
     // false},
 };
 
+/**
+ * Hardware devices opened by codecs, shared by all codecs (libav device
+ * contexts are reference counted and may be used by several codecs).
+ * Devices left unused for deviceIdleTimeout are closed, unless prewarm
+ * keeps them for the accounts' codecs.
+ */
+static std::chrono::steady_clock::duration deviceIdleTimeout {std::chrono::minutes(2)};
+
+struct CachedDevice
+{
+    AVBufferRef* ref {nullptr};
+    std::chrono::steady_clock::time_point lastUsed;
+    bool kept {false};
+};
+
+struct DeviceCache
+{
+    std::mutex mutex;
+    std::map<std::pair<AVHWDeviceType, std::string>, CachedDevice> devices;
+
+    std::map<std::pair<AVHWDeviceType, std::string>, CachedDevice>::iterator
+    find(const AVBufferRef* deviceCtx)
+    {
+        return std::find_if(devices.begin(), devices.end(), [&](const auto& device) {
+            return device.second.ref->data == deviceCtx->data;
+        });
+    }
+};
+
+static DeviceCache&
+deviceCache()
+{
+    static DeviceCache cache;
+    return cache;
+}
+
+/**
+ * Outcome of opening codecs per (codec, API, direction, resolution). Failures
+ * are only remembered for a while as some are transient (e.g. encoder session
+ * limits), and only for the resolution that failed as hardware limits depend
+ * on it.
+ */
+static std::chrono::steady_clock::duration probeFailureTtl {std::chrono::minutes(5)};
+
+struct ProbeResult
+{
+    bool usable {false};
+    std::chrono::steady_clock::time_point time;
+};
+
+static std::mutex probeMutex;
+static std::map<std::tuple<AVCodecID, std::string, CodecType, int, int>, ProbeResult> probeResults;
+
+void
+HardwareAccel::releaseIdleDevices()
+{
+    auto& cache = deviceCache();
+    std::lock_guard lk(cache.mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = cache.devices.begin(); it != cache.devices.end();) {
+        // Only the cache still references the device
+        if (not it->second.kept and av_buffer_get_ref_count(it->second.ref) == 1
+            and now - it->second.lastUsed >= deviceIdleTimeout) {
+            JAMI_DBG("Releasing idle hardware device %s", it->first.second.c_str());
+            av_buffer_unref(&it->second.ref);
+            it = cache.devices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 HardwareAccel::HardwareAccel(AVCodecID id,
                              const std::string& name,
                              AVHWDeviceType hwType,
@@ -137,10 +216,20 @@ HardwareAccel::HardwareAccel(AVCodecID id,
 
 HardwareAccel::~HardwareAccel()
 {
-    if (deviceCtx_)
-        av_buffer_unref(&deviceCtx_);
     if (framesCtx_)
         av_buffer_unref(&framesCtx_);
+    if (deviceCtx_) {
+        {
+            auto& cache = deviceCache();
+            std::lock_guard lk(cache.mutex);
+            auto cached = cache.find(deviceCtx_);
+            if (cached != cache.devices.end())
+                cached->second.lastUsed = std::chrono::steady_clock::now();
+        }
+        av_buffer_unref(&deviceCtx_);
+        if (Manager::initialized)
+            Manager::instance().scheduleTaskIn([] { releaseIdleDevices(); }, deviceIdleTimeout);
+    }
 }
 
 static AVPixelFormat
@@ -167,6 +256,19 @@ HardwareAccel::init_device(const char* name, const char* device, int flags)
 {
     const AVHWDeviceContext* dev = nullptr;
 
+    auto& cache = deviceCache();
+    std::lock_guard lk(cache.mutex);
+    auto key = std::make_pair(hwType_, std::string(device ? device : ""));
+    auto cached = cache.devices.find(key);
+    if (cached != cache.devices.end()) {
+        deviceCtx_ = av_buffer_ref(cached->second.ref);
+        if (deviceCtx_) {
+            cached->second.lastUsed = std::chrono::steady_clock::now();
+            JAMI_DBG("Reusing %s device.", name);
+            return 0;
+        }
+    }
+
     // Create device ctx
     int err;
     err = av_hwdevice_ctx_create(&deviceCtx_, hwType_, device, NULL, flags);
@@ -183,6 +285,8 @@ HardwareAccel::init_device(const char* name, const char* device, int flags)
         return -1;
     }
     JAMI_DBG("Device type %s successfully created.", name);
+    if (auto ref = av_buffer_ref(deviceCtx_))
+        cache.devices.emplace(std::move(key), CachedDevice {ref, std::chrono::steady_clock::now()});
 
     return 0;
 }
@@ -399,6 +503,8 @@ HardwareAccel::transferToMainMemory(const VideoFrame& frame, AVPixelFormat desir
     }
 
     output->pts = input->pts;
+    // Latency stamp (see media_latency.h)
+    output->opaque = input->opaque;
     if (AVFrameSideData* side_data = av_frame_get_side_data(input, AV_FRAME_DATA_DISPLAYMATRIX))
         av_frame_new_side_data_from_buf(output,
                                         AV_FRAME_DATA_DISPLAYMATRIX,
@@ -429,9 +535,17 @@ HardwareAccel::getCompatibleAccel(AVCodecID id, int width, int height, CodecType
 {
     std::list<HardwareAccel> l;
     const auto& list = (type == CODEC_ENCODER) ? &apiListEnc : &apiListDec;
+    std::lock_guard lk(probeMutex);
+    auto now = std::chrono::steady_clock::now();
     for (auto& api : *list) {
         const auto& it = std::find(api.supportedCodecs.begin(), api.supportedCodecs.end(), id);
         if (it != api.supportedCodecs.end()) {
+            auto probe = probeResults.find({id, api.name, type, width, height});
+            if (probe != probeResults.end() and not probe->second.usable
+                and now - probe->second.time < probeFailureTtl) {
+                JAMI_DBG("Skipping %s for %s, it recently failed", api.name.c_str(), avcodec_get_name(id));
+                continue;
+            }
             auto hwtype = AV_HWDEVICE_TYPE_NONE;
             while ((hwtype = av_hwdevice_iterate_types(hwtype)) != AV_HWDEVICE_TYPE_NONE) {
                 if (hwtype == api.hwType) {
@@ -445,7 +559,11 @@ HardwareAccel::getCompatibleAccel(AVCodecID id, int width, int height, CodecType
                     accel.height_ = height;
                     accel.width_ = width;
                     accel.possible_devices_ = &api.possible_devices;
-                    l.emplace_back(std::move(accel));
+                    // APIs known to work go first
+                    if (probe != probeResults.end() and probe->second.usable)
+                        l.emplace_front(std::move(accel));
+                    else
+                        l.emplace_back(std::move(accel));
                 }
             }
         }
@@ -453,5 +571,126 @@ HardwareAccel::getCompatibleAccel(AVCodecID id, int width, int height, CodecType
     return l;
 }
 
+void
+HardwareAccel::setUsable(bool usable) const
+{
+    {
+        std::lock_guard lk(probeMutex);
+        probeResults[{id_, name_, type_, width_, height_}] = {usable,
+                                                             std::chrono::steady_clock::now()};
+    }
+    if (not usable and deviceCtx_) {
+        // The device may be what failed (e.g. lost after a GPU reset), open
+        // a new one next time. Codecs using it keep their reference.
+        auto& cache = deviceCache();
+        std::lock_guard lk(cache.mutex);
+        auto cached = cache.find(deviceCtx_);
+        if (cached != cache.devices.end()) {
+            av_buffer_unref(&cached->second.ref);
+            cache.devices.erase(cached);
+        }
+    }
+}
+
+void
+HardwareAccel::releaseDevices()
+{
+    auto& cache = deviceCache();
+    std::lock_guard lk(cache.mutex);
+    for (auto& [key, device] : cache.devices)
+        av_buffer_unref(&device.ref);
+    cache.devices.clear();
+}
+
+/**
+ * Opens then closes a codec with this API, as a call would, so that the
+ * driver is loaded and its outcome recorded before the call.
+ */
+static bool
+openCodec(HardwareAccel& accel, CodecType type, int width, int height)
+{
+    auto codec = (type == CODEC_ENCODER)
+                     ? avcodec_find_encoder_by_name(accel.getCodecName().c_str())
+                     : avcodec_find_decoder(accel.getCodecId());
+    if (not codec)
+        return false;
+    auto codecCtx = avcodec_alloc_context3(codec);
+    if (not codecCtx)
+        return false;
+    codecCtx->width = width;
+    codecCtx->height = height;
+    codecCtx->time_base = AVRational {1, 30};
+    codecCtx->pix_fmt = accel.getFormat();
+    codecCtx->opaque = &accel;
+    if (type == CODEC_ENCODER)
+        codecCtx->bit_rate = SystemCodecInfo::DEFAULT_VIDEO_BITRATE * 1000;
+    accel.setDetails(codecCtx);
+    auto ret = avcodec_open2(codecCtx, codec, nullptr);
+    avcodec_free_context(&codecCtx);
+    return ret >= 0;
+}
+
+void
+HardwareAccel::prewarm(const std::set<AVCodecID>& ids,
+                       bool decoding,
+                       bool encoding,
+                       int width,
+                       int height)
+{
+    // Each prewarm decides alone which devices are kept
+    static std::mutex prewarmMutex;
+    std::lock_guard prewarmLock(prewarmMutex);
+
+    // Devices of the APIs that opened a codec
+    std::set<const uint8_t*> used;
+    auto warm = [&](CodecType type) {
+        for (auto id : ids) {
+            for (auto& accel : getCompatibleAccel(id, width, height, type)) {
+                if (accel.initAPI(false, nullptr) < 0)
+                    continue;
+                auto usable = openCodec(accel, type, width, height);
+                accel.setUsable(usable);
+                if (usable) {
+                    JAMI_DBG("Prewarmed %s for %s",
+                             accel.getName().c_str(),
+                             accel.getCodecName().c_str());
+                    used.emplace(accel.deviceCtx_->data);
+                }
+            }
+        }
+    };
+    if (decoding)
+        warm(CODEC_DECODER);
+    if (encoding)
+        warm(CODEC_ENCODER);
+
+    {
+        auto& cache = deviceCache();
+        std::lock_guard lk(cache.mutex);
+        for (auto& [key, device] : cache.devices)
+            device.kept = used.count(device.ref->data) != 0;
+    }
+    // Close the devices the accounts no longer need
+    releaseIdleDevices();
+}
+
+#ifdef LIBJAMI_TESTABLE
+void
+HardwareAccel::setTimeouts(std::chrono::steady_clock::duration deviceIdle,
+                           std::chrono::steady_clock::duration probeFailure)
+{
+    deviceIdleTimeout = deviceIdle;
+    probeFailureTtl = probeFailure;
+}
+
+std::size_t
+HardwareAccel::deviceCount()
+{
+    auto& cache = deviceCache();
+    std::lock_guard lk(cache.mutex);
+    return cache.devices.size();
+}
+#endif
+
 } // namespace video
 } // namespace jami
@@ -21,10 +21,13 @@
 
 #pragma once
 
+#include "def.h"
 #include "libav_deps.h"
 #include "media_codec.h"
 
+#include <chrono>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include <list>
@@ -160,6 +163,50 @@ public:
     int initAPI(bool linkable, AVBufferRef* framesCtx);
     bool dynBitrate() { return dynBitrate_; }
 
+    /**
+     * @brief Records whether a codec could be opened with this API at this
+     * resolution.
+     *
+     * getCompatibleAccel then lists APIs known to work first, and skips
+     * those that recently failed instead of probing them at every call.
+     * On failure, the device opened by initAPI is no longer shared with
+     * codecs opened later.
+     */
+    void setUsable(bool usable) const;
+
+    /**
+     * @brief Releases the device contexts kept for codecs opened later.
+     */
+    static void releaseDevices();
+
+    /**
+     * @brief Closes the cached devices no codec used for the idle timeout.
+     *
+     * Devices kept by prewarm stay open.
+     */
+    static void releaseIdleDevices();
+
+    /**
+     * @brief Opens the devices and codecs usable for these codecs ahead of
+     * the first call.
+     *
+     * Each codec is opened and closed once with every compatible API, which
+     * loads the drivers and records which APIs work. The devices of the APIs
+     * that worked are kept open until a later prewarm no longer needs them.
+     * Blocking, call it off any latency sensitive thread.
+     */
+    static void prewarm(const std::set<AVCodecID>& ids,
+                        bool decoding,
+                        bool encoding,
+                        int width,
+                        int height);
+
+#ifdef LIBJAMI_TESTABLE
+    static void setTimeouts(std::chrono::steady_clock::duration deviceIdle,
+                            std::chrono::steady_clock::duration probeFailure);
+    static std::size_t deviceCount();
+#endif
+
 private:
     bool initDevice(const std::string& device);
     bool initFrame();
@@ -22,6 +22,7 @@
 #include "libav_deps.h" // MUST BE INCLUDED FIRST
 #include "video_base.h"
 #include "media_buffer.h"
+#include "media_latency.h"
 #include "string_utils.h"
 #include "logger.h"
 
@@ -45,6 +46,7 @@ VideoGenerator::publishFrame()
 {
     std::lock_guard lk(mutex_);
     lastFrame_ = std::move(writableFrame_);
+    latency::stamp(lastFrame_->pointer());
     notify(std::static_pointer_cast<MediaFrame>(lastFrame_));
 }
 
@@ -53,6 +55,7 @@ VideoGenerator::publishFrame(std::shared_ptr<VideoFrame> frame)
 {
     std::lock_guard lk(mutex_);
     lastFrame_ = std::move(frame);
+    latency::stamp(lastFrame_->pointer());
     notify(std::static_pointer_cast<MediaFrame>(lastFrame_));
 }
 
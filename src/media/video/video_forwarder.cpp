@@ -0,0 +1,526 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "video_forwarder.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace jami {
+namespace video {
+
+static constexpr size_t RTP_HEADER_SIZE {12};
+// Do not flood a source with key frame requests while switching
+static constexpr std::chrono::milliseconds KEYFRAME_REQUEST_INTERVAL {500};
+// RTP video clock rate
+static constexpr unsigned VIDEO_CLOCK_KHZ {90};
+
+static inline uint16_t
+read16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t
+read32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16
+           | static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+static inline void
+write16(uint8_t* p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+static inline void
+write32(uint8_t* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+/**
+ * @return offset of the payload in an RTP packet, 0 if the packet is invalid
+ */
+static size_t
+payloadOffset(const uint8_t* buf, size_t len)
+{
+    if (len < RTP_HEADER_SIZE or (buf[0] >> 6) != 2)
+        return 0;
+    size_t offset = RTP_HEADER_SIZE + 4 * (buf[0] & 0x0f);
+    if (buf[0] & 0x10) {
+        // Header extension
+        if (len < offset + 4)
+            return 0;
+        offset += 4 + 4 * read16(buf + offset + 2);
+    }
+    return offset < len ? offset : 0;
+}
+
+static bool
+isH264KeyFrameStart(const uint8_t* p, size_t len)
+{
+    auto isKey = [](uint8_t type) {
+        return type == 5 or type == 7; // IDR, SPS
+    };
+    auto type = p[0] & 0x1f;
+    if (type == 24) // STAP-A
+        return len > 3 and isKey(p[3] & 0x1f);
+    if (type == 28) // FU-A
+        return len > 1 and (p[1] & 0x80) and isKey(p[1] & 0x1f);
+    return isKey(type);
+}
+
+static bool
+isH265KeyFrameStart(const uint8_t* p, size_t len)
+{
+    auto isKey = [](uint8_t type) {
+        return (type >= 16 and type <= 21) or (type >= 32 and type <= 34); // IRAP, VPS/SPS/PPS
+    };
+    if (len < 2)
+        return false;
+    auto type = (p[0] >> 1) & 0x3f;
+    if (type == 48) // Aggregation packet
+        return len > 4 and isKey((p[4] >> 1) & 0x3f);
+    if (type == 49) // Fragmentation unit
+        return len > 2 and (p[2] & 0x80) and isKey(p[2] & 0x3f);
+    return isKey(type);
+}
+
+static bool
+isVP8KeyFrameStart(const uint8_t* p, size_t len)
+{
+    // Payload descriptor (RFC 7741), the frame must start in this packet
+    if (not(p[0] & 0x10) or (p[0] & 0x07) != 0)
+        return false;
+    size_t offset = 1;
+    if (p[0] & 0x80) {
+        if (len < 2)
+            return false;
+        auto ext = p[1];
+        offset = 2;
+        if (ext & 0x80) // PictureID
+            offset += (len > offset and (p[offset] & 0x80)) ? 2 : 1;
+        if (ext & 0x40) // TL0PICIDX
+            offset += 1;
+        if (ext & 0x30) // TID/KEYIDX
+            offset += 1;
+    }
+    // Inverse key frame flag of the VP8 payload header
+    return offset < len and not(p[offset] & 0x01);
+}
+
+/**
+ * @return true if the payload starts a frame that can be decoded on its own.
+ * Unknown codecs are switched at any packet, relying on the key frame
+ * requested from the new source.
+ */
+static bool
+isKeyFrameStart(const std::string& codec, const uint8_t* p, size_t len)
+{
+    if (len == 0)
+        return false;
+    if (codec == "H264")
+        return isH264KeyFrameStart(p, len);
+    if (codec == "H265")
+        return isH265KeyFrameStart(p, len);
+    if (codec == "VP8")
+        return isVP8KeyFrameStart(p, len);
+    return true;
+}
+
+/**
+ * Callbacks of a participant, shared with the threads calling them so that
+ * they are called without mutex_ held.
+ */
+class VideoForwarder::Output
+{
+public:
+    Output(PacketSink sink, KeyFrameRequest keyFrameRequest)
+        : sink_(std::move(sink))
+        , keyFrameRequest_(std::move(keyFrameRequest))
+    {}
+
+    void send(uint8_t* buf, size_t len)
+    {
+        std::lock_guard lk(mutex_);
+        if (sink_)
+            sink_(buf, len);
+    }
+
+    void requestKeyFrame()
+    {
+        std::lock_guard lk(mutex_);
+        if (keyFrameRequest_)
+            keyFrameRequest_();
+    }
+
+    /**
+     * Callbacks are not called anymore once returned.
+     */
+    void close()
+    {
+        std::lock_guard lk(mutex_);
+        sink_ = {};
+        keyFrameRequest_ = {};
+    }
+
+private:
+    std::mutex mutex_;
+    PacketSink sink_;
+    KeyFrameRequest keyFrameRequest_;
+};
+
+struct VideoForwarder::Participant
+{
+    std::string streamId;
+    LegParams params;
+    std::shared_ptr<Output> output;
+    bool canRequestKeyFrame {false};
+    clock::time_point lastKeyFrameRequest {};
+
+    // As a source, participants receiving this stream
+    std::vector<Participant*> receivers;
+
+    // As a receiver, stream forwarded to this participant and the state
+    // needed to present it as a single continuous stream
+    Participant* source {nullptr};
+    bool waitKeyFrame {true};
+    bool started {false};
+    uint32_t ssrc {0};
+    uint32_t sourceSsrc {0};
+    uint16_t seqOffset {0};
+    uint32_t tsOffset {0};
+    uint16_t lastSeq {0};
+    uint32_t lastTs {0};
+    clock::time_point lastSent {};
+};
+
+VideoForwarder::VideoForwarder(const std::string& confId)
+    : confId_(confId)
+{
+    JAMI_LOG("[conf:{}] Video forwarding enabled", confId_);
+}
+
+VideoForwarder::~VideoForwarder()
+{
+    JAMI_LOG("[conf:{}] Video forwarding stopped: {} packets forwarded, {} dropped, {} switches",
+             confId_,
+             stats_.forwarded,
+             stats_.dropped,
+             stats_.switches);
+}
+
+void
+VideoForwarder::addParticipant(const std::string& streamId,
+                               LegParams params,
+                               PacketSink sink,
+                               KeyFrameRequest requestKeyFrame)
+{
+    static thread_local std::mt19937 rand {std::random_device {}()};
+
+    std::vector<KeyFrameRequest> requests;
+    std::shared_ptr<Output> replaced;
+    {
+        std::lock_guard lk(mutex_);
+        auto participant = std::make_unique<Participant>();
+        participant->streamId = streamId;
+        participant->params = std::move(params);
+        participant->canRequestKeyFrame = static_cast<bool>(requestKeyFrame);
+        participant->output = std::make_shared<Output>(std::move(sink), std::move(requestKeyFrame));
+        participant->ssrc = std::uniform_int_distribution<uint32_t> {}(rand);
+        participant->lastSeq = participant->params.initialSeq - 1;
+        JAMI_DEBUG("[conf:{}] Forwarding video with {} ({})",
+                   confId_,
+                   streamId,
+                   participant->params.codec);
+        auto it = participants_.find(streamId);
+        if (it != participants_.end()) {
+            detach(*it->second, requests);
+            replaced = std::move(it->second->output);
+            it->second = std::move(participant);
+        } else {
+            participants_.emplace(streamId, std::move(participant));
+        }
+        updateSelection(requests);
+    }
+    if (replaced)
+        replaced->close();
+    for (const auto& request : requests)
+        request();
+}
+
+void
+VideoForwarder::removeParticipant(const std::string& streamId)
+{
+    std::vector<KeyFrameRequest> requests;
+    std::shared_ptr<Output> output;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = participants_.find(streamId);
+        if (it == participants_.end())
+            return;
+        detach(*it->second, requests);
+        output = std::move(it->second->output);
+        participants_.erase(it);
+        updateSelection(requests);
+    }
+    // Packets routed before the removal may still be sent by other threads
+    output->close();
+    for (const auto& request : requests)
+        request();
+}
+
+bool
+VideoForwarder::hasParticipant(const std::string& streamId) const
+{
+    std::lock_guard lk(mutex_);
+    return participants_.find(streamId) != participants_.end();
+}
+
+void
+VideoForwarder::setPriorities(std::vector<std::string> streamIds)
+{
+    std::vector<KeyFrameRequest> requests;
+    {
+        std::lock_guard lk(mutex_);
+        if (priorities_ == streamIds)
+            return;
+        priorities_ = std::move(streamIds);
+        updateSelection(requests);
+    }
+    for (const auto& request : requests)
+        request();
+}
+
+void
+VideoForwarder::requestKeyFrame(const std::string& streamId)
+{
+    std::vector<KeyFrameRequest> requests;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = participants_.find(streamId);
+        if (it != participants_.end() and it->second->source)
+            askKeyFrame(*it->second->source, requests);
+    }
+    for (const auto& request : requests)
+        request();
+}
+
+std::string
+VideoForwarder::selectedSource(const std::string& streamId) const
+{
+    std::lock_guard lk(mutex_);
+    auto it = participants_.find(streamId);
+    if (it != participants_.end() and it->second->source)
+        return it->second->source->streamId;
+    return {};
+}
+
+VideoForwarder::Stats
+VideoForwarder::getStats() const
+{
+    std::lock_guard lk(mutex_);
+    return stats_;
+}
+
+void
+VideoForwarder::updateSelection(std::vector<KeyFrameRequest>& requests)
+{
+    auto canForward = [](const Participant& source, const Participant& receiver) {
+        return &source != &receiver and source.params.receive and receiver.params.send
+               and source.params.codec == receiver.params.codec;
+    };
+
+    for (auto& [id, receiver] : participants_) {
+        Participant* source = nullptr;
+        // Most important stream that is not the participant's own
+        for (const auto& streamId : priorities_) {
+            auto it = participants_.find(streamId);
+            if (it != participants_.end() and canForward(*it->second, *receiver)) {
+                source = it->second.get();
+                break;
+            }
+        }
+        // Otherwise avoid switching for nothing
+        if (not source and receiver->source and canForward(*receiver->source, *receiver))
+            source = receiver->source;
+        if (not source) {
+            for (auto& [otherId, other] : participants_) {
+                if (canForward(*other, *receiver)) {
+                    source = other.get();
+                    break;
+                }
+            }
+        }
+        select(*receiver, source, requests);
+    }
+}
+
+void
+VideoForwarder::detach(Participant& participant, std::vector<KeyFrameRequest>& requests)
+{
+    for (auto* receiver : std::vector<Participant*>(participant.receivers))
+        select(*receiver, nullptr, requests);
+    select(participant, nullptr, requests);
+}
+
+void
+VideoForwarder::select(Participant& receiver,
+                       Participant* source,
+                       std::vector<KeyFrameRequest>& requests)
+{
+    if (receiver.source == source)
+        return;
+    if (receiver.source) {
+        auto& receivers = receiver.source->receivers;
+        receivers.erase(std::remove(receivers.begin(), receivers.end(), &receiver),
+                        receivers.end());
+    }
+    receiver.source = source;
+    receiver.waitKeyFrame = true;
+    if (source) {
+        JAMI_DEBUG("[conf:{}] Forwarding {} to {}", confId_, source->streamId, receiver.streamId);
+        source->receivers.emplace_back(&receiver);
+        stats_.switches++;
+        askKeyFrame(*source, requests);
+    }
+}
+
+void
+VideoForwarder::askKeyFrame(Participant& source, std::vector<KeyFrameRequest>& requests)
+{
+    auto now = clock::now();
+    if (now - source.lastKeyFrameRequest < KEYFRAME_REQUEST_INTERVAL or not source.canRequestKeyFrame)
+        return;
+    source.lastKeyFrameRequest = now;
+    requests.emplace_back([output = source.output] { output->requestKeyFrame(); });
+}
+
+void
+VideoForwarder::onPacket(const std::string& streamId, const uint8_t* buf, size_t len)
+{
+    // Packets rewritten for each receiver, sent once mutex_ is released.
+    // Kept per thread to reuse the buffers.
+    struct Outgoing
+    {
+        std::shared_ptr<Output> output;
+        std::vector<uint8_t> packet;
+    };
+    static thread_local std::vector<Outgoing> outgoing;
+    size_t count = 0;
+
+    std::vector<KeyFrameRequest> requests;
+    {
+        std::lock_guard lk(mutex_);
+        auto it = participants_.find(streamId);
+        if (it == participants_.end() or it->second->receivers.empty())
+            return;
+        auto payload = payloadOffset(buf, len);
+        if (not payload)
+            return;
+
+        auto& source = *it->second;
+        auto keyFrame = isKeyFrameStart(source.params.codec, buf + payload, len - payload);
+        auto ssrc = read32(buf + 8);
+        for (auto* receiver : source.receivers) {
+            // A new SSRC means the source restarted its encoder
+            if (receiver->sourceSsrc != ssrc) {
+                receiver->sourceSsrc = ssrc;
+                receiver->waitKeyFrame = true;
+            }
+            if (receiver->waitKeyFrame) {
+                if (not keyFrame) {
+                    stats_.dropped++;
+                    askKeyFrame(source, requests);
+                    continue;
+                }
+                // Continue the sequence and the timeline previously sent to the receiver
+                auto now = clock::now();
+                uint16_t nextSeq = receiver->lastSeq + 1;
+                uint32_t nextTs = read32(buf + 4);
+                if (receiver->started) {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       now - receiver->lastSent)
+                                       .count();
+                    nextTs = receiver->lastTs
+                             + static_cast<uint32_t>(std::max<int64_t>(elapsed, 1) * VIDEO_CLOCK_KHZ);
+                }
+                receiver->seqOffset = nextSeq - read16(buf + 2);
+                receiver->tsOffset = nextTs - read32(buf + 4);
+                receiver->waitKeyFrame = false;
+            }
+            if (outgoing.size() == count)
+                outgoing.emplace_back();
+            auto& out = outgoing[count++];
+            out.output = receiver->output;
+            rewrite(*receiver, buf, len, payload, out.packet);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        auto& out = outgoing[i];
+        out.output->send(out.packet.data(), out.packet.size());
+        out.output.reset();
+    }
+    for (const auto& request : requests)
+        request();
+}
+
+void
+VideoForwarder::rewrite(Participant& receiver,
+                        const uint8_t* buf,
+                        size_t len,
+                        size_t payload,
+                        std::vector<uint8_t>& packet)
+{
+    // Fixed header and CSRC list, without the source's header extension:
+    // the receiver's leg adds its own
+    size_t headerSize = RTP_HEADER_SIZE + 4 * (buf[0] & 0x0f);
+    packet.resize(headerSize + len - payload);
+    auto* p = packet.data();
+    std::memcpy(p, buf, headerSize);
+    std::memcpy(p + headerSize, buf + payload, len - payload);
+    p[0] &= ~0x10;
+
+    uint16_t seq = read16(buf + 2) + receiver.seqOffset;
+    uint32_t ts = read32(buf + 4) + receiver.tsOffset;
+    p[1] = (p[1] & 0x80) | (receiver.params.payloadType & 0x7f);
+    write16(p + 2, seq);
+    write32(p + 4, ts);
+    write32(p + 8, receiver.ssrc);
+
+    // Late packets must not move the reference back
+    if (not receiver.started or static_cast<int16_t>(seq - receiver.lastSeq) > 0)
+        receiver.lastSeq = seq;
+    if (not receiver.started or static_cast<int32_t>(ts - receiver.lastTs) > 0) {
+        receiver.lastTs = ts;
+        receiver.lastSent = clock::now();
+    }
+    receiver.started = true;
+    stats_.forwarded++;
+}
+
+} // namespace video
+} // namespace jami
@@ -0,0 +1,153 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "noncopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace jami {
+namespace video {
+
+/**
+ * Selective forwarding of video between the participants of a conference.
+ *
+ * Instead of decoding every participant, mixing and encoding the result
+ * once per participant, each participant receives the RTP packets of one
+ * other participant as they were sent, without transcoding. Packets are
+ * rewritten (SSRC, sequence number, timestamp and payload type) so that
+ * each participant sees a single continuous stream, whatever the source
+ * currently forwarded to it.
+ *
+ * Which participant is forwarded to whom follows the conference priorities
+ * (active stream, then voice activity): everybody sees the first stream of
+ * the list which is not their own. Sources are switched on a key frame,
+ * which is requested from the new source.
+ *
+ * Encryption is done by the caller (PacketSink), per participant. Header
+ * extensions of the source are not forwarded, they describe the source's
+ * leg (e.g. its transport-wide sequence numbers).
+ */
+class VideoForwarder
+{
+public:
+    /**
+     * Sends a clear RTP packet to a participant.
+     * The buffer is only valid during the call. Called without any lock of
+     * the forwarder held, from the thread of the source's onPacket().
+     */
+    using PacketSink = std::function<void(uint8_t* buf, size_t len)>;
+    using KeyFrameRequest = std::function<void()>;
+
+    struct LegParams
+    {
+        // Codec name as negotiated (e.g. "H264"). Streams are only forwarded
+        // between participants using the same codec.
+        std::string codec;
+        // Payload type to use for packets sent to the participant
+        uint8_t payloadType {0};
+        // Next sequence number expected by the participant
+        uint16_t initialSeq {0};
+        // Whether the participant accepts video
+        bool send {true};
+        // Whether the participant sends video
+        bool receive {true};
+    };
+
+    struct Stats
+    {
+        uint64_t forwarded {0};
+        // Packets not forwarded while waiting for a key frame
+        uint64_t dropped {0};
+        uint64_t switches {0};
+    };
+
+    explicit VideoForwarder(const std::string& confId);
+    ~VideoForwarder();
+
+    void addParticipant(const std::string& streamId,
+                        LegParams params,
+                        PacketSink sink,
+                        KeyFrameRequest requestKeyFrame);
+
+    /**
+     * Once returned, the participant's sink and key frame request callback
+     * are not called anymore (waits for a call in progress).
+     */
+    void removeParticipant(const std::string& streamId);
+
+    bool hasParticipant(const std::string& streamId) const;
+
+    /**
+     * Routes a clear RTP packet received from a participant.
+     */
+    void onPacket(const std::string& streamId, const uint8_t* buf, size_t len);
+
+    /**
+     * @param streamIds Streams by decreasing priority
+     */
+    void setPriorities(std::vector<std::string> streamIds);
+
+    /**
+     * A participant needs a key frame: ask the source forwarded to it.
+     */
+    void requestKeyFrame(const std::string& streamId);
+
+    /**
+     * @return the stream forwarded to a participant, empty if none
+     */
+    std::string selectedSource(const std::string& streamId) const;
+
+    Stats getStats() const;
+
+private:
+    NON_COPYABLE(VideoForwarder);
+
+    using clock = std::chrono::steady_clock;
+    class Output;
+    struct Participant;
+
+    void updateSelection(std::vector<KeyFrameRequest>& requests);
+    void detach(Participant& participant, std::vector<KeyFrameRequest>& requests);
+    void select(Participant& receiver,
+                Participant* source,
+                std::vector<KeyFrameRequest>& requests);
+    void askKeyFrame(Participant& source, std::vector<KeyFrameRequest>& requests);
+    void rewrite(Participant& receiver,
+                 const uint8_t* buf,
+                 size_t len,
+                 size_t payload,
+                 std::vector<uint8_t>& packet);
+
+    const std::string confId_;
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Participant>> participants_;
+    std::vector<std::string> priorities_;
+    Stats stats_;
+};
+
+} // namespace video
+} // namespace jami
@@ -26,6 +26,7 @@
 #include "client/videomanager.h"
 #include "manager.h"
 #include "media_filter.h"
+#include "media_latency.h"
 #include "sinkclient.h"
 #include "logger.h"
 #include "filter_transpose.h"
@@ -293,6 +294,9 @@ VideoMixer::process()
 
     libav_utils::fillWithBlack(output.pointer());
 
+    // Age of the most recent source frame composed into the output. The oldest
+    // one is not used: a source that stopped sending keeps being redrawn.
+    std::optional<uint32_t> captureAge;
     {
         std::lock_guard lk(audioOnlySourcesMtx_);
         std::shared_lock lock(rwMutex_);
@@ -367,10 +371,13 @@ VideoMixer::process()
                     calc_position(x, fooInput, wantedIndex);
 
                 if (!blackFrame) {
-                    if (fooInput)
+                    if (fooInput) {
                         successfullyRendered |= render_frame(output, fooInput, x);
-                    else
+                        if (auto age = latency::elapsedUs(fooInput->pointer()))
+                            captureAge = std::min(captureAge.value_or(*age), *age);
+                    } else {
                         JAMI_WARN("[mixer:%s] Nothing to render for %p", id_.c_str(), x->source);
+                    }
                 }
 
                 x->hasVideo = !blackFrame && successfullyRendered;
@@ -414,6 +421,9 @@ VideoMixer::process()
                                              static_cast<AVRounding>(AV_ROUND_NEAR_INF
                                                                      | AV_ROUND_PASS_MINMAX));
     lastTimestamp_ = output.pointer()->pts;
+    // Keep the capture time, so capture_to_encode includes the time spent up to here
+    if (captureAge)
+        latency::stamp(output.pointer(), latency::nowUs() - *captureAge);
     publishFrame();
 }
 
@@ -92,6 +92,7 @@ VideoReceiveThread::setup()
     JAMI_DBG("[%p] Setupping video receiver", this);
 
     videoDecoder_.reset(new MediaDecoder([this](const std::shared_ptr<MediaFrame>& frame) mutable {
+        auto decode = latency::elapsedUs(frame->pointer());
         libav_utils::AVBufferPtr displayMatrix;
         {
             std::lock_guard l(rotationMtx_);
@@ -103,6 +104,8 @@ VideoReceiveThread::setup()
                                             AV_FRAME_DATA_DISPLAYMATRIX,
                                             displayMatrix.release());
         publishFrame(std::static_pointer_cast<VideoFrame>(frame));
+        if (latencyStats_)
+            latencyStats_->recordReceive(decode, latency::elapsedUs(frame->pointer()));
     }));
     videoDecoder_->setContextCallback([this]() {
         if (recorderCallback_)
@@ -151,6 +154,7 @@ VideoReceiveThread::setup()
     if (args_.input == SDP_FILENAME) {
         // Now replace our custom AVIOContext with one that will read packets
         videoDecoder_->setIOContext(demuxContext_.get());
+        videoDecoder_->setPacketArrivalCallback(packetArrival_);
     }
     return true;
 }
@@ -191,6 +195,8 @@ void
 VideoReceiveThread::addIOContext(SocketPair& socketPair)
 {
     demuxContext_.reset(socketPair.createIOContext(mtu_));
+    // Same lifetime as demuxContext_, which already refers to socketPair
+    packetArrival_ = [&socketPair] { return socketPair.takeFrameArrival(); };
 }
 
 void
@@ -39,6 +39,7 @@
 #include <climits>
 #include <sstream>
 #include <memory>
+#include <optional>
 
 namespace jami {
 class SocketPair;
@@ -89,6 +90,8 @@ public:
     void setRecorderCallback(
         const std::function<void(const MediaStream& ms)>& cb);
 
+    void setLatencyStats(std::shared_ptr<MediaLatencyStats> stats) { latencyStats_ = std::move(stats); }
+
 private:
     NON_COPYABLE(VideoReceiveThread);
 
@@ -105,6 +108,7 @@ private:
     std::istringstream stream_;
     MediaIOHandle sdpContext_;
     std::unique_ptr<MediaIOHandle> demuxContext_;
+    std::function<std::optional<uint32_t>()> packetArrival_;
     std::shared_ptr<SinkClient> sink_;
     bool isVideoConfigured_ {false};
     uint16_t mtu_;
@@ -127,6 +131,7 @@ private:
     std::function<void(void)> keyFrameRequestCallback_;
     std::function<void(MediaType, bool)> onSuccessfulSetup_;
     std::function<void(const MediaStream& ms)> recorderCallback_;
+    std::shared_ptr<MediaLatencyStats> latencyStats_;
 };
 
 } // namespace video
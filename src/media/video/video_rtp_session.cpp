@@ -25,6 +25,7 @@
 #include "video_sender.h"
 #include "video_receive_thread.h"
 #include "video_mixer.h"
+#include "video_forwarder.h"
 #include "socket_pair.h"
 #include "sip/sipvoiplink.h" // for enqueueKeyframeRequest
 #include "manager.h"
@@ -61,6 +62,8 @@ constexpr auto DELAY_AFTER_RESTART = std::chrono::milliseconds(1000);
 constexpr auto EXPIRY_TIME_RTCP = std::chrono::seconds(2);
 constexpr auto DELAY_AFTER_REMB_INC = std::chrono::seconds(1);
 constexpr auto DELAY_AFTER_REMB_DEC = std::chrono::milliseconds(500);
+// Large enough for any RTP packet, whatever the MTU
+constexpr size_t FORWARD_BUFFER_SIZE {4096};
 
 VideoRtpSession::VideoRtpSession(const string& callId,
                                  const string& streamId,
@@ -204,6 +207,8 @@ VideoRtpSession::startSender()
                 getRemoteRtpUri(), ms, send_, *socketPair_, initSeqVal_ + 1, mtu_, allowHwAccel));
             if (changeOrientationCallback_)
                 sender_->setChangeOrientationCallback(changeOrientationCallback_);
+            sender_->setLatencyStats(latencyStats_);
+            updatePacingRate();
             if (socketPair_)
                 socketPair_->setPacketLossCallback([this]() { cbKeyFrameRequest_(); });
 
@@ -233,6 +238,10 @@ VideoRtpSession::restartSender()
     if (not socketPair_)
         return;
 
+    // Nothing is encoded while forwarding
+    if (forwarder_)
+        return;
+
     startSender();
 
     if (conference_)
@@ -280,6 +289,7 @@ VideoRtpSession::startReceiver()
             JAMI_WARN("[%p] Already has a receiver, restarting", this);
         receiveThread_.reset(
             new VideoReceiveThread(callId_, !conference_, receive_.receiving_sdp, mtu_));
+        receiveThread_->setLatencyStats(latencyStats_);
 
         // ensure that start has been called
         if (not socketPair_)
@@ -375,6 +385,9 @@ VideoRtpSession::start(std::unique_ptr<dhtnet::IceSocket> rtp_sock, std::unique_
         return;
     }
 
+    // The socket is about to be replaced
+    stopForwarding();
+
     try {
         if (rtp_sock and rtcp_sock) {
             if (send_.addr) {
@@ -402,11 +415,19 @@ VideoRtpSession::start(std::unique_ptr<dhtnet::IceSocket> rtp_sock, std::unique_
                                     send_.crypto.getCryptoSuite().c_str(),
                                     send_.crypto.getSrtpKeyInfo().c_str());
         }
+
+        if (send_.enabled)
+            setupTransportCC();
     } catch (const std::runtime_error& e) {
         JAMI_ERR("[%p] Socket creation failed: %s", this, e.what());
         return;
     }
 
+    if (forwarder_) {
+        startForwarding();
+        return;
+    }
+
     startSender();
     startReceiver();
 
@@ -427,6 +448,7 @@ VideoRtpSession::stop()
 {
     std::lock_guard lock(mutex_);
 
+    stopForwarding();
     stopSender(true);
     stopReceiver(true);
 
@@ -451,6 +473,17 @@ VideoRtpSession::setMuted(bool mute, Direction dir)
 {
     std::lock_guard lock(mutex_);
 
+    if (forwarder_) {
+        auto& onHold = dir == Direction::SEND ? send_.onHold : receive_.onHold;
+        if (onHold != mute) {
+            onHold = mute;
+            // Update what the forwarder sends to and takes from this participant
+            stopForwarding();
+            startForwarding();
+        }
+        return;
+    }
+
     // Sender
     if (dir == Direction::SEND) {
         if (send_.onHold == mute) {
@@ -500,6 +533,11 @@ void
 VideoRtpSession::forceKeyFrame()
 {
     std::lock_guard lock(mutex_);
+    // The participant needs a key frame from the stream forwarded to it
+    if (forwarder_) {
+        forwarder_->requestKeyFrame(streamId_);
+        return;
+    }
 #if __ANDROID__
     if (videoLocal_)
         emitSignal<libjami::VideoSignal::RequestKeyFrame>(videoLocal_->getName());
@@ -572,8 +610,14 @@ VideoRtpSession::enterConference(Conference& conference)
 
     conference_ = &conference;
     videoMixer_ = conference.getVideoMixer();
+    forwarder_ = conference.getVideoForwarder();
     JAMI_DBG("[%p] enterConference (conf: %s)", this, conference.getConfId().c_str());
 
+    if (forwarder_) {
+        startForwarding();
+        return;
+    }
+
     if (send_.enabled or receiveThread_) {
         // Restart encoder with conference parameter ON in order to unlink HW encoder
         // from HW decoder.
@@ -594,6 +638,20 @@ VideoRtpSession::exitConference()
 
     JAMI_DBG("[%p] exitConference (conf: %s)", this, conference_->getConfId().c_str());
 
+    if (forwarder_) {
+        stopForwarding();
+        forwarder_.reset();
+        videoMixer_.reset();
+        conference_ = nullptr;
+        // Back to a regular call
+        if (socketPair_) {
+            startSender();
+            startReceiver();
+            setupVideoPipeline();
+        }
+        return;
+    }
+
     if (videoMixer_) {
         if (sender_)
             videoMixer_->detach(sender_.get());
@@ -612,6 +670,92 @@ VideoRtpSession::exitConference()
     conference_ = nullptr;
 }
 
+void
+VideoRtpSession::startForwarding()
+{
+    // Concurrency protection must be done by caller.
+
+    if (not socketPair_ or not forwarder_ or forwardLoop_)
+        return;
+
+    JAMI_DBG("[%p] Start forwarding video for call %s", this, callId_.c_str());
+
+    // Packets are forwarded as received, nothing is encoded nor decoded
+    stopSender(true);
+    stopReceiver(true);
+    receiveThread_.reset();
+    if (rtcpCheckerThread_.isRunning())
+        rtcpCheckerThread_.join();
+    socketPair_->stopSendOp(false);
+    socketPair_->setReadBlockingMode(true);
+
+    VideoForwarder::LegParams params;
+    if (auto codec = send_.codec ? send_.codec : receive_.codec)
+        params.codec = codec->name;
+    if (send_.codec)
+        params.payloadType = send_.codec->payloadType;
+    params.initialSeq = socketPair_->lastSeqValOut() + 1;
+    params.send = send_.enabled and not send_.onHold;
+    params.receive = receive_.enabled and not receive_.onHold;
+
+    // The socket outlives the participant, removed from the forwarder in stopForwarding()
+    auto* socket = socketPair_.get();
+    forwarder_->addParticipant(
+        streamId_,
+        std::move(params),
+        [socket](uint8_t* buf, size_t len) { socket->writePacket(buf, static_cast<int>(len)); },
+        [this] {
+            if (cbKeyFrameRequest_)
+                cbKeyFrameRequest_();
+        });
+    // Listed in the conference layout, without video as the host does not decode it
+    if (videoMixer_)
+        videoMixer_->addAudioOnlySource(callId_, streamId_);
+
+    forwardBuffer_.resize(FORWARD_BUFFER_SIZE);
+    forwardLoop_ = std::make_unique<ThreadLoop>(
+        [] { return true; },
+        [this, forwarder = forwarder_, socket] {
+            auto len = socket->readPacket(forwardBuffer_.data(),
+                                          static_cast<int>(forwardBuffer_.size()));
+            // Interrupted, closed, or switched to non-blocking reads with
+            // nothing left: stop rather than polling the socket in a loop
+            if (len < 0 or (len == 0 and not socket->isReadBlocking())) {
+                forwardLoop_->stop();
+                return;
+            }
+            // RTCP packet types are 192 to 223 (RFC 5761), RTCP is handled by the socket
+            if (len > 0 and (forwardBuffer_[1] < 192 or forwardBuffer_[1] > 223))
+                forwarder->onPacket(streamId_, forwardBuffer_.data(), static_cast<size_t>(len));
+        },
+        [] {});
+    forwardLoop_->start();
+}
+
+void
+VideoRtpSession::stopForwarding()
+{
+    // Concurrency protection must be done by caller.
+
+    if (not forwardLoop_)
+        return;
+
+    JAMI_DBG("[%p] Stop forwarding video for call %s", this, callId_.c_str());
+
+    forwarder_->removeParticipant(streamId_);
+    if (videoMixer_)
+        videoMixer_->removeAudioOnlySource(callId_, streamId_);
+
+    // Unblock the pending read
+    forwardLoop_->stop();
+    if (socketPair_)
+        socketPair_->setReadBlockingMode(false);
+    forwardLoop_->join();
+    forwardLoop_.reset();
+    if (socketPair_)
+        socketPair_->setReadBlockingMode(true);
+}
+
 bool
 VideoRtpSession::check_RCTP_Info_RR(RTCPInfo& rtcpi)
 {
@@ -792,9 +936,83 @@ VideoRtpSession::storeVideoBitrateInfo()
     }
 }
 
+void
+VideoRtpSession::setupTransportCC()
+{
+    setupVideoBitrateInfo();
+    bwe_ = std::make_shared<TransportBandwidthEstimator>(
+        videoBitrateInfo_.videoBitrateCurrent * 1000ull,
+        videoBitrateInfo_.videoBitrateMin * 1000ull,
+        videoBitrateInfo_.videoBitrateMax * 1000ull);
+    socketPair_->enableTransportCC(
+        [bwe = bwe_](uint16_t seq, size_t size, clock::time_point sendTime, int cluster) {
+            bwe->onPacketSent(seq, size, sendTime, cluster);
+        },
+        [bwe = bwe_](const TransportFeedback& feedback) {
+            bwe->onFeedback(feedback, clock::now());
+        });
+}
+
+void
+VideoRtpSession::updatePacingRate()
+{
+    if (not socketPair_)
+        return;
+    // Pace at 1.5 times the encoder bitrate, but never keep a frame queued
+    // for longer than a frame interval
+    auto fps = localVideoParams_.framerate.real();
+    if (fps <= 0.)
+        fps = 30.;
+    socketPair_->setPacingRate(videoBitrateInfo_.videoBitrateCurrent * 1500ull,
+                               std::chrono::duration_cast<clock::duration>(
+                                   std::chrono::duration<double>(1. / fps)));
+}
+
+void
+VideoRtpSession::adaptWithTransportCC()
+{
+    // Receiver reports and REMB are superseded by the transport-wide feedback
+    uint64_t br;
+    check_RCTP_Info_REMB(&br);
+    RTCPInfo rtcpi {};
+    check_RCTP_Info_RR(rtcpi);
+
+    setupVideoBitrateInfo();
+    bwe_->setBounds(videoBitrateInfo_.videoBitrateMin * 1000ull,
+                    videoBitrateInfo_.videoBitrateMax * 1000ull);
+
+    auto now = clock::now();
+    unsigned current = videoBitrateInfo_.videoBitrateCurrent;
+    unsigned target = bwe_->targetBitrate() / 1000;
+    if (target < current * 0.95f
+        or (target > current * 1.05f and now - last_REMB_inc_ > std::chrono::seconds(1))) {
+        JAMI_DBG("[BandwidthAdapt] Transport-wide estimate: %u Kbps (loss %.1f%%), bitrate was %u Kbps",
+                 target,
+                 bwe_->lossRate() * 100.f,
+                 current);
+        if (target > current)
+            last_REMB_inc_ = now;
+        setNewBitrate(target);
+        updatePacingRate();
+    }
+
+    // Probe for more bandwidth while the path is not congested
+    if (bwe_->delayState() == bwNormal
+        and videoBitrateInfo_.videoBitrateCurrent < videoBitrateInfo_.videoBitrateMax
+        and now - lastProbe_ > std::chrono::seconds(5)) {
+        lastProbe_ = now;
+        socketPair_->probe(videoBitrateInfo_.videoBitrateCurrent * 2000ull, 10);
+    }
+}
+
 void
 VideoRtpSession::processRtcpChecker()
 {
+    if (bwe_ and bwe_->hasFeedback(clock::now())) {
+        adaptWithTransportCC();
+        socketPair_->waitForRTCP(std::chrono::milliseconds(200));
+        return;
+    }
     adaptQualityAndBitrate();
     socketPair_->waitForRTCP(std::chrono::seconds(rtcp_checking_interval));
 }
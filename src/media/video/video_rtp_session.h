@@ -32,6 +32,7 @@
 
 namespace jami {
 class CongestionControl;
+class TransportBandwidthEstimator;
 class Conference;
 class MediaRecorder;
 } // namespace jami
@@ -41,6 +42,7 @@ namespace video {
 
 class VideoInput;
 class VideoMixer;
+class VideoForwarder;
 class VideoSender;
 class VideoReceiveThread;
 
@@ -120,6 +122,8 @@ private:
     void stopSender(bool forceStopSocket = false);
     void startReceiver();
     void stopReceiver(bool forceStopSocket = false);
+    void startForwarding();
+    void stopForwarding();
     using clock = std::chrono::steady_clock;
     using time_point = clock::time_point;
 
@@ -129,6 +133,10 @@ private:
     std::shared_ptr<VideoReceiveThread> receiveThread_;
     Conference* conference_ {nullptr};
     std::shared_ptr<VideoMixer> videoMixer_;
+    // Set in conferences forwarding video instead of mixing it
+    std::shared_ptr<VideoForwarder> forwarder_;
+    std::unique_ptr<ThreadLoop> forwardLoop_;
+    std::vector<uint8_t> forwardBuffer_;
     std::shared_ptr<VideoInput> videoLocal_;
     uint16_t initSeqVal_ = 0;
 
@@ -145,6 +153,9 @@ private:
     void dropProcessing(RTCPInfo* rtcpi);
     void delayProcessing(int br);
     void setNewBitrate(unsigned int newBR);
+    void setupTransportCC();
+    void adaptWithTransportCC();
+    void updatePacingRate();
 
     // no packet loss can be calculated as no data in input
     static constexpr float NO_INFO_CALCULATED {-1.0};
@@ -176,6 +187,11 @@ private:
 
     std::unique_ptr<CongestionControl> cc;
 
+    // Sender side estimation from transport-wide feedback, when the peer
+    // sends it. Otherwise REMB and receiver reports are used.
+    std::shared_ptr<TransportBandwidthEstimator> bwe_;
+    time_point lastProbe_ {time_point::min()};
+
     std::function<void(void)> cbKeyFrameRequest_;
 
     std::atomic<int> rotation_ {0};
@@ -74,6 +74,9 @@ VideoSender::encodeAndSendVideo(const std::shared_ptr<VideoFrame>& input_frame)
             changeOrientationCallback_(rotation_);
     }
 
+    auto captureToEncode = latency::elapsedUs(input_frame->pointer());
+    auto encodeStart = latency::nowUs();
+
     if (auto packet = input_frame->packet()) {
         videoEncoder_->send(*packet);
     } else {
@@ -86,6 +89,8 @@ VideoSender::encodeAndSendVideo(const std::shared_ptr<VideoFrame>& input_frame)
         if (videoEncoder_->encode(input_frame, is_keyframe, frameNumber_++) < 0)
             JAMI_ERR("encoding failed");
     }
+    if (latencyStats_)
+        latencyStats_->recordSend(captureToEncode, latency::nowUs() - encodeStart);
 #ifdef DEBUG_SDP
     if (frameNumber_ == 1) // video stream is lazy initialized, wait for first frame
         videoEncoder_->print_sdp();
@@ -24,6 +24,7 @@
 #include "noncopyable.h"
 #include "media_encoder.h"
 #include "media_io_handle.h"
+#include "media_latency.h"
 
 #include <map>
 #include <string>
@@ -63,6 +64,8 @@ public:
     void setChangeOrientationCallback(std::function<void(int)> cb);
     int setBitrate(uint64_t br);
 
+    void setLatencyStats(std::shared_ptr<MediaLatencyStats> stats) { latencyStats_ = std::move(stats); }
+
 private:
     static constexpr int KEYFRAMES_AT_START {1}; // Number of keyframes to enforce at stream startup
     static constexpr unsigned KEY_FRAME_PERIOD {0}; // seconds before forcing a keyframe
@@ -81,6 +84,7 @@ private:
 
     int rotation_ = -1;
     std::function<void(int)> changeOrientationCallback_;
+    std::shared_ptr<MediaLatencyStats> latencyStats_;
 };
 } // namespace video
 } // namespace jami
@@ -48,6 +48,7 @@ ChatServicesManager::registerComponentsLifeCycleManagers(PluginManager& pluginMa
         PluginPreferencesUtils::addAlwaysHandlerPreference(ptr->getChatHandlerDetails().at("name"),
                                                            ptr->id().substr(0, found));
         chatHandlers_.emplace_back(std::move(ptr));
+        activationTables_.clear();
         return 0;
     };
 
@@ -76,6 +77,7 @@ ChatServicesManager::registerComponentsLifeCycleManagers(PluginManager& pluginMa
             }
             handlersNameMap_.erase((*handlerIt)->getChatHandlerDetails().at("name"));
             chatHandlers_.erase(handlerIt);
+            activationTables_.clear();
         }
         return true;
     };
@@ -142,25 +144,21 @@ ChatServicesManager::publishMessage(pluginMessagePtr message)
     auto& chatAllowDenySet = allowDenyList_[mPair];
 
     // Search for activation flag.
-    for (auto& chatHandler : chatHandlers_) {
-        std::string chatHandlerName = chatHandler->getChatHandlerDetails().at("name");
-        std::size_t found = chatHandler->id().find_last_of(DIR_SEPARATOR_CH);
+    for (const auto& [chatHandler, chatHandlerName, always] : getActivationTable(message->accountId)) {
         // toggle is true if we should automatically activate the ChatHandler.
-        bool toggle = PluginPreferencesUtils::getAlwaysPreference(chatHandler->id().substr(0, found),
-                                                                  chatHandlerName,
-                                                                  message->accountId);
+        bool toggle = always;
         // toggle is overwritten if we have previously activated/deactivated the ChatHandler
         // for the given conversation.
         auto allowedIt = chatAllowDenySet.find(chatHandlerName);
         if (allowedIt != chatAllowDenySet.end())
             toggle = (*allowedIt).second;
-        bool toggled = handlers.find((uintptr_t) chatHandler.get()) != handlers.end();
+        bool toggled = handlers.find((uintptr_t) chatHandler) != handlers.end();
         if (toggle || toggled) {
             // Creates chat subjects if it doesn't exist yet.
             auto& subject = chatSubjects_.emplace(mPair, std::make_shared<PublishObservable<pluginMessagePtr>>()).first->second;
             if (!toggled) {
                 // If activation is expected, and not yet performed, we perform activation
-                handlers.insert((uintptr_t) chatHandler.get());
+                handlers.insert((uintptr_t) chatHandler);
                 chatHandler->notifyChatSubject(mPair, subject);
                 chatAllowDenySet[chatHandlerName] = true;
                 PluginPreferencesUtils::setAllowDenyListPreferences(allowDenyList_);
@@ -171,6 +169,31 @@ ChatServicesManager::publishMessage(pluginMessagePtr message)
     }
 }
 
+const std::vector<ChatServicesManager::HandlerActivation>&
+ChatServicesManager::getActivationTable(const std::string& accountId)
+{
+    auto version = PluginPreferencesUtils::cacheVersion();
+    if (version != activationVersion_) {
+        activationTables_.clear();
+        activationVersion_ = version;
+    }
+    auto it = activationTables_.find(accountId);
+    if (it != activationTables_.end())
+        return it->second;
+
+    std::vector<HandlerActivation> table;
+    table.reserve(chatHandlers_.size());
+    for (auto& chatHandler : chatHandlers_) {
+        auto name = chatHandler->getChatHandlerDetails().at("name");
+        std::size_t found = chatHandler->id().find_last_of(DIR_SEPARATOR_CH);
+        bool always = PluginPreferencesUtils::getAlwaysPreference(chatHandler->id().substr(0, found),
+                                                                  name,
+                                                                  accountId);
+        table.push_back({chatHandler.get(), std::move(name), always});
+    }
+    return activationTables_.emplace(accountId, std::move(table)).first->second;
+}
+
 void
 ChatServicesManager::cleanChatSubjects(const std::string& accountId, const std::string& peerId)
 {
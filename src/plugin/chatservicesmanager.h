@@ -130,6 +130,21 @@ private:
                            const std::string& peerId,
                            const bool toggle);
 
+    struct HandlerActivation
+    {
+        ChatHandler* handler;
+        std::string name;
+        // "always" preference of the handler for the account
+        bool always;
+    };
+
+    /**
+     * @brief Returns the ChatHandlers and their "always" preference for an account.
+     * The table is computed once and kept until handlers or preferences change.
+     * @param accountId
+     */
+    const std::vector<HandlerActivation>& getActivationTable(const std::string& accountId);
+
     // Components that a plugin can register through registerChatHandler service.
     // These objects can then be activated with toggleChatHandler.
     std::list<ChatHandlerPtr> chatHandlers_;
@@ -147,6 +162,11 @@ private:
     // Maps a ChatHandler name and the address of this ChatHandler.
     std::map<std::string, uintptr_t> handlersNameMap_ {};
 
+    // Activation tables per accountId, valid for activationVersion_ of the
+    // plugin preferences cache.
+    std::map<std::string, std::vector<HandlerActivation>> activationTables_;
+    uint64_t activationVersion_ {0};
+
     // Component that stores persistent ChatHandlers' status for each existing
     // accountId, peerId pair.
     // A map of accountId, peerId pairs and ChatHandler-status pairs.
@@ -299,9 +299,10 @@ JamiPluginManager::installPlugin(const std::string& jplPath, bool force)
                                             destinationDir,
                                             PluginUtils::uncompressJplFunction);
             }
+            PluginPreferencesUtils::invalidateCache(destinationDir);
             if (!libjami::getPluginsEnabled()) {
                 libjami::setPluginsEnabled(true);
-                Manager::instance().saveConfig();
+                Manager::instance().saveConfig(Manager::CONFIG_PLUGINS);
                 loadPlugins();
                 return r;
             }
@@ -334,7 +335,9 @@ JamiPluginManager::uninstallPlugin(const std::string& rootPath)
                                      / "plugins" / detailsIt->second.at("id"), ec);
             pluginDetailsMap_.erase(detailsIt);
         }
-        return std::filesystem::remove_all(rootPath, ec) ? SUCCESS : FAILURE;
+        auto removed = std::filesystem::remove_all(rootPath, ec);
+        PluginPreferencesUtils::invalidateCache(rootPath);
+        return removed ? SUCCESS : FAILURE;
     } else {
         JAMI_INFO() << "PLUGIN: not installed.";
         return FAILURE;
@@ -470,11 +473,13 @@ JamiPluginManager::setPluginPreference(const std::filesystem::path& rootPath,
             msgpack::pack(fs, pluginUserPreferencesMap);
         } catch (const std::exception& e) {
             JAMI_ERR() << e.what();
+            PluginPreferencesUtils::invalidateCache(rootPath);
             if (force) {
                 loadPlugin(rootPath.string());
             }
             return false;
         }
+        PluginPreferencesUtils::invalidateCache(rootPath);
     }
     if (force) {
         loadPlugin(rootPath.string());
@@ -25,6 +25,8 @@
 #include <msgpack.hpp>
 #include <sstream>
 #include <fstream>
+#include <atomic>
+#include <mutex>
 #include <fmt/core.h>
 
 #include "logger.h"
@@ -32,6 +34,35 @@
 
 namespace jami {
 
+/**
+ * Parsed preference files, per plugin. Reading them means opening and
+ * parsing a JSON and a msgpack file, which is too costly to be done for
+ * each chat message or call.
+ */
+struct PreferencesCache
+{
+    struct Plugin
+    {
+        // Keyed by preferences.json file path
+        std::map<std::filesystem::path, std::vector<std::map<std::string, std::string>>> preferences;
+        // Keyed by preferences.msgpack file path
+        std::map<std::filesystem::path, std::map<std::string, std::string>> values;
+    };
+
+    std::mutex mutex;
+    // Preferences are translated, drop them if the language changes
+    std::string language;
+    std::map<std::filesystem::path, Plugin> plugins;
+    std::atomic_uint64_t version {1};
+};
+
+static PreferencesCache&
+preferencesCache()
+{
+    static PreferencesCache cache;
+    return cache;
+}
+
 std::filesystem::path
 PluginPreferencesUtils::getPreferencesConfigFilePath(const std::filesystem::path& rootPath,
                                                      const std::string& accountId)
@@ -103,6 +134,22 @@ std::vector<std::map<std::string, std::string>>
 PluginPreferencesUtils::getPreferences(const std::filesystem::path& rootPath, const std::string& accountId)
 {
     auto preferenceFilePath = getPreferencesConfigFilePath(rootPath, accountId);
+    const auto& lang = PluginUtils::getLanguage();
+    auto& cache = preferencesCache();
+    uint64_t version;
+    {
+        std::lock_guard lk(cache.mutex);
+        version = cache.version;
+        if (cache.language != lang) {
+            cache.language = lang;
+            cache.plugins.clear();
+        }
+        auto& cached = cache.plugins[rootPath].preferences;
+        auto it = cached.find(preferenceFilePath);
+        if (it != cached.end())
+            return it->second;
+    }
+
     std::lock_guard guard(dhtnet::fileutils::getFileLock(preferenceFilePath));
     std::ifstream file(preferenceFilePath);
     Json::Value root;
@@ -113,7 +160,6 @@ PluginPreferencesUtils::getPreferences(const std::filesystem::path& rootPath, co
     std::vector<std::map<std::string, std::string>> preferences;
     if (file) {
         // Get preferences locale
-        const auto& lang = PluginUtils::getLanguage();
         auto locales = PluginUtils::getLocales(rootPath.string(), std::string(string_remove_suffix(lang, '.')));
 
         // Read the file to a json format
@@ -159,6 +205,10 @@ PluginPreferencesUtils::getPreferences(const std::filesystem::path& rootPath, co
         }
     }
 
+    // Do not keep what was read if the file was modified meanwhile
+    std::lock_guard lk(cache.mutex);
+    if (cache.language == lang && cache.version == version)
+        cache.plugins[rootPath].preferences[preferenceFilePath] = preferences;
     return preferences;
 }
 
@@ -167,6 +217,17 @@ PluginPreferencesUtils::getUserPreferencesValuesMap(const std::filesystem::path&
                                                     const std::string& accountId)
 {
     auto preferencesValuesFilePath = valuesFilePath(rootPath, accountId);
+    auto& cache = preferencesCache();
+    uint64_t version;
+    {
+        std::lock_guard lk(cache.mutex);
+        version = cache.version;
+        auto& cached = cache.plugins[rootPath].values;
+        auto it = cached.find(preferencesValuesFilePath);
+        if (it != cached.end())
+            return it->second;
+    }
+
     std::lock_guard guard(dhtnet::fileutils::getFileLock(preferencesValuesFilePath));
     std::ifstream file(preferencesValuesFilePath, std::ios::binary);
     std::map<std::string, std::string> rmap;
@@ -195,6 +256,9 @@ PluginPreferencesUtils::getUserPreferencesValuesMap(const std::filesystem::path&
             }
         }
     }
+    std::lock_guard lk(cache.mutex);
+    if (cache.version == version)
+        cache.plugins[rootPath].values[preferencesValuesFilePath] = rmap;
     return rmap;
 }
 
@@ -248,6 +312,7 @@ PluginPreferencesUtils::resetPreferencesValuesMap(const std::string& rootPath,
         returnValue = false;
         JAMI_ERR() << e.what();
     }
+    invalidateCache(rootPath);
 
     return returnValue;
 }
@@ -360,6 +425,7 @@ PluginPreferencesUtils::addAlwaysHandlerPreference(const std::string& handlerNam
         outFile << root.toStyledString();
         outFile.close();
     }
+    invalidateCache(rootPath);
 }
 
 bool
@@ -383,4 +449,19 @@ PluginPreferencesUtils::getAlwaysPreference(const std::string& rootPath,
 
     return false;
 }
+
+void
+PluginPreferencesUtils::invalidateCache(const std::filesystem::path& rootPath)
+{
+    auto& cache = preferencesCache();
+    std::lock_guard lk(cache.mutex);
+    cache.plugins.erase(rootPath);
+    cache.version.fetch_add(1);
+}
+
+uint64_t
+PluginPreferencesUtils::cacheVersion()
+{
+    return preferencesCache().version.load();
+}
 } // namespace jami
@@ -153,6 +153,19 @@ public:
                                     const std::string& handlerName,
                                     const std::string& accountId);
 
+    /**
+     * @brief Drops the parsed preferences and values kept in memory for a plugin.
+     * Must be called whenever one of the plugin's preference files is modified.
+     * @param rootPath
+     */
+    static void invalidateCache(const std::filesystem::path& rootPath);
+
+    /**
+     * @brief Returns a counter increased each time cached preferences are
+     * invalidated, so that values derived from them can be recomputed.
+     */
+    static uint64_t cacheVersion();
+
 private:
     PluginPreferencesUtils() {}
     ~PluginPreferencesUtils() {}
@@ -785,9 +785,11 @@ SIPAccount::sendRegister()
         throw VoipLinkException("Unable to initialize account registration structure");
     }
 
+    // Headers and routes are cloned by regc: allocate them from a pool of
+    // our own rather than from one shared with the other SIP threads
+    auto pool = sip_utils::smart_alloc_pool(link_.getEndpoint(), "regc.tmp", 512, 512);
     if (hasServiceRoute())
-        pjsip_regc_set_route_set(regc,
-                                 sip_utils::createRouteSet(getServiceRoute(), link_.getPool()));
+        pjsip_regc_set_route_set(regc, sip_utils::createRouteSet(getServiceRoute(), pool.get()));
 
     pjsip_regc_set_credentials(regc, getCredentialCount(), getCredInfo());
 
@@ -796,7 +798,7 @@ SIPAccount::sendRegister()
     auto pjUserAgent = CONST_PJ_STR(getUserAgentName());
     constexpr pj_str_t STR_USER_AGENT = CONST_PJ_STR("User-Agent");
 
-    pjsip_generic_string_hdr* h = pjsip_generic_string_hdr_create(link_.getPool(),
+    pjsip_generic_string_hdr* h = pjsip_generic_string_hdr_create(pool.get(),
                                                                   &STR_USER_AGENT,
                                                                   &pjUserAgent);
     pj_list_push_back(&hdr_list, (pjsip_hdr*) h);
@@ -885,14 +887,15 @@ SIPAccount::onRegister(pjsip_regc_cbparam* param)
              */
             // update_rfc5626_status(acc, param->rdata);
 
-            if (config().allowIPAutoRewrite and checkNATAddress(param, link_.getPool()))
+            if (config().allowIPAutoRewrite and checkNATAddress(param))
                 JAMI_WARN("New contact: %s", getContactHeader().c_str());
 
             /* TODO Check and update Service-Route header */
-            if (hasServiceRoute())
+            if (hasServiceRoute()) {
+                auto pool = sip_utils::smart_alloc_pool(link_.getEndpoint(), "regc.tmp", 512, 512);
                 pjsip_regc_set_route_set(param->regc,
-                                         sip_utils::createRouteSet(getServiceRoute(),
-                                                                   link_.getPool()));
+                                         sip_utils::createRouteSet(getServiceRoute(), pool.get()));
+            }
 
             setRegistrationState(RegistrationState::REGISTERED, param->code);
         }
@@ -1504,7 +1507,7 @@ SIPAccount::supportPresence(int function, bool enabled)
         and not presence_->isSupported(PRESENCE_FUNCTION_SUBSCRIBE))
         enablePresence(false);
 
-    Manager::instance().saveConfig();
+    Manager::instance().saveConfig(Manager::CONFIG_ACCOUNTS);
     // FIXME: bad signal used here, we need a global config changed signal.
     emitSignal<libjami::ConfigurationSignal::AccountsChanged>();
 }
@@ -1560,7 +1563,7 @@ SIPAccount::resetAutoRegistration()
 }
 
 bool
-SIPAccount::checkNATAddress(pjsip_regc_cbparam* param, pj_pool_t* pool)
+SIPAccount::checkNATAddress(pjsip_regc_cbparam* param)
 {
     JAMI_DBG("[Account %s] Checking IP route after the registration", accountID_.c_str());
 
@@ -1590,8 +1593,10 @@ SIPAccount::checkNATAddress(pjsip_regc_cbparam* param, pj_pool_t* pool)
     JAMI_DBG("Checking received VIA address: %s", via_addrstr.c_str());
 
     if (via_addr_.host.slen == 0 or via_tp_ != tp) {
-        if (pj_strcmp(&via_addr_.host, via_addr))
-            pj_strdup(pool, &via_addr_.host, via_addr);
+        if (pj_strcmp(&via_addr_.host, via_addr)) {
+            viaAddrHost_ = sip_utils::as_view(*via_addr);
+            via_addr_.host = sip_utils::CONST_PJ_STR(viaAddrHost_);
+        }
 
         // Update Via header
         via_addr_.port = rport;
@@ -107,10 +107,9 @@ public:
     /**
      * Update NAT address, Via and Contact header from the REGISTER response
      * @param param pjsip reg cbparam
-     * @param pool
      * @return update status
      */
-    bool checkNATAddress(pjsip_regc_cbparam* param, pj_pool_t* pool);
+    bool checkNATAddress(pjsip_regc_cbparam* param);
 
     /**
      * Returns true if this is the IP2IP account
@@ -605,6 +604,8 @@ private:
      * Optional: via_addr construct from received parameters
      */
     pjsip_host_port via_addr_;
+    // Storage of via_addr_.host when learnt from the registrar (see checkNATAddress)
+    std::string viaAddrHost_ {};
 
     // This is used at runtime . Mainly by SIPAccount::usePublishedAddressPortInVIA()
     std::string publishedIpStr_ {};
@@ -257,6 +257,10 @@ SIPCall::configureRtpSession(const std::shared_ptr<RtpSession>& rtpSession,
 
     if (localMedia.type == MediaType::MEDIA_AUDIO) {
         setupVoiceCallback(rtpSession);
+        auto audioRtp = std::static_pointer_cast<AudioRtpSession>(rtpSession);
+        if (audioLevelCallback_)
+            audioRtp->setAudioLevelCallback(audioLevelCallback_);
+        audioRtp->enableAudioLevel(audioLevelEnabled_);
     }
 
 #ifdef ENABLE_VIDEO
@@ -3217,6 +3221,28 @@ SIPCall::exitConference()
     conf_.reset();
 }
 
+void
+SIPCall::setAudioLevelCallback(SocketPair::AudioLevelCallback cb)
+{
+    std::lock_guard lk {callMutex_};
+    audioLevelCallback_ = std::move(cb);
+    for (const auto& audioRtp : getRtpSessionList(MediaType::MEDIA_AUDIO))
+        std::static_pointer_cast<AudioRtpSession>(audioRtp)->setAudioLevelCallback(
+            audioLevelCallback_);
+}
+
+void
+SIPCall::enableAudioLevel(bool enable)
+{
+    std::lock_guard lk {callMutex_};
+    if (audioLevelEnabled_ == enable)
+        return;
+    audioLevelEnabled_ = enable;
+    JAMI_DEBUG("[call:{}] {} sending audio levels", getCallId(), enable ? "Start" : "Stop");
+    for (const auto& audioRtp : getRtpSessionList(MediaType::MEDIA_AUDIO))
+        std::static_pointer_cast<AudioRtpSession>(audioRtp)->enableAudioLevel(enable);
+}
+
 void
 SIPCall::setActiveMediaStream(const std::string& accountUri,
     const std::string& deviceId,
@@ -3367,6 +3393,34 @@ SIPCall::monitor() const
     }
 }
 
+std::vector<std::map<std::string, std::string>>
+SIPCall::getLatencyStats() const
+{
+    std::lock_guard lk {callMutex_};
+    std::vector<std::map<std::string, std::string>> stats;
+    for (const auto& stream : rtpStreams_) {
+        if (not stream.rtpSession_)
+            continue;
+        for (auto& stage : stream.rtpSession_->getLatencyStats()->toMaps()) {
+            stage.emplace("streamId", stream.rtpSession_->streamId());
+            stage.emplace("mediaType",
+                          stream.rtpSession_->getMediaType() == MediaType::MEDIA_AUDIO ? "audio"
+                                                                                       : "video");
+            stats.emplace_back(std::move(stage));
+        }
+    }
+    return stats;
+}
+
+void
+SIPCall::resetLatencyStats()
+{
+    std::lock_guard lk {callMutex_};
+    for (const auto& stream : rtpStreams_)
+        if (stream.rtpSession_)
+            stream.rtpSession_->getLatencyStats()->reset();
+}
+
 bool
 SIPCall::toggleRecording()
 {
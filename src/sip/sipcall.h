@@ -151,6 +151,12 @@ public:
     std::map<std::string, std::string> getDetails() const override;
     void enterConference(std::shared_ptr<Conference> conference) override;
     void exitConference() override;
+    /**
+     * Forward the audio levels sent by the peer, for the conference
+     * we host to follow who is speaking. Called from the receiving thread.
+     */
+    void setAudioLevelCallback(SocketPair::AudioLevelCallback cb);
+    void enableAudioLevel(bool enable) override;
 #ifdef ENABLE_VIDEO
     std::mutex sinksMtx_;
     void createSinks(ConfInfo& infos) override;
@@ -179,6 +185,9 @@ public:
 
     void monitor() const override;
 
+    std::vector<std::map<std::string, std::string>> getLatencyStats() const override;
+    void resetLatencyStats() override;
+
     /**
      * Set peer's User-Agent found in the message header
      */
@@ -472,6 +481,10 @@ private:
 
     // Vector holding the current RTP sessions.
     std::vector<RtpStream> rtpStreams_;
+    // Applied to the audio RTP sessions, including the ones created later
+    SocketPair::AudioLevelCallback audioLevelCallback_;
+    // Whether the peer hosts a conference, which reads our audio levels
+    bool audioLevelEnabled_ {false};
 
     /**
      * Hold the transport used for SIP communication.
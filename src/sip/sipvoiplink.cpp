@@ -67,6 +67,7 @@
 
 #include <istream>
 #include <algorithm>
+#include <optional>
 #include <regex>
 
 namespace jami {
@@ -78,6 +79,29 @@ using sip_utils::CONST_PJ_STR;
 static pjsip_endpoint* endpt_;
 static pjsip_module mod_ua_;
 
+/**
+ * Number of threads polling the SIP endpoint, set with the JAMI_SIP_THREADS
+ * environment variable. PJSIP serializes what needs to be: each transport
+ * has a single pending read, so messages of a connection (and thus of a
+ * dialog) are handled in order, and dialogs and transactions are locked.
+ * Extra threads let calls be signalled while another one is busy with
+ * a burst of messages.
+ */
+static constexpr const char* SIPTHREADS = "JAMI_SIP_THREADS";
+static constexpr unsigned MAX_SIP_THREADS = 16;
+
+static unsigned
+sipThreadCount()
+{
+    if (auto envvar = getenv(SIPTHREADS))
+        return std::clamp(to_int<unsigned>(envvar, 1), 1u, MAX_SIP_THREADS);
+    return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+}
+
+/** Period of the event loop lag probe, and lag worth a warning */
+static constexpr std::chrono::milliseconds LAG_PROBE_PERIOD {1000};
+static constexpr std::chrono::milliseconds LAG_WARNING {200};
+
 static void invite_session_state_changed_cb(pjsip_inv_session* inv, pjsip_event* e);
 static void outgoing_request_forked_cb(pjsip_inv_session* inv, pjsip_event* e);
 static void transaction_state_changed_cb(pjsip_inv_session* inv,
@@ -494,7 +518,11 @@ transaction_request_cb(pjsip_rx_data* rdata)
         return PJ_FALSE;
     }
 
-    // dialog is now owned by invite
+    // dialog is now owned by invite. Keep it locked until the call is attached
+    // and answered: other SIP threads may already receive requests of this
+    // dialog (e.g. a CANCEL), which must find the call
+    std::optional<sip_utils::PJDialogLock> dialogLock;
+    dialogLock.emplace(dialog);
     pjsip_dlg_dec_lock(dialog);
 
     inv->mod_data[mod_ua_.id] = call.get();
@@ -557,6 +585,7 @@ transaction_request_cb(pjsip_rx_data* rdata)
     }
 
     call->setState(Call::ConnectionState::RINGING);
+    dialogLock.reset();
 
     Manager::instance().incomingCall(account->getAccountID(), *call);
 
@@ -603,12 +632,6 @@ SIPVoIPLink::getMod()
     return &mod_ua_;
 }
 
-pj_pool_t*
-SIPVoIPLink::getPool() noexcept
-{
-    return pool_.get();
-}
-
 pj_caching_pool*
 SIPVoIPLink::getCachingPool() noexcept
 {
@@ -735,12 +758,19 @@ SIPVoIPLink::SIPVoIPLink()
     TRY(pjsip_replaces_init_module(endpt_));
 #undef TRY
 
-    sipThread_ = std::thread([this] {
-        while (running_)
-            handleEvents();
-    });
+    pj_timer_entry_init(&lagTimer_, 0, this, &SIPVoIPLink::onLagProbe);
+    scheduleLagProbe();
 
-    JAMI_DBG("SIPVoIPLink@%p", this);
+    auto threads = sipThreadCount();
+    sipThreads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        sipThreads_.emplace_back([this] {
+            while (running_)
+                handleEvents();
+        });
+    }
+
+    JAMI_DBG("SIPVoIPLink@%p (%u SIP threads)", this, threads);
 }
 
 SIPVoIPLink::~SIPVoIPLink() {}
@@ -760,7 +790,10 @@ SIPVoIPLink::shutdown()
     pjsip_tpmgr_set_state_cb(pjsip_endpt_get_tpmgr(endpt_), nullptr);
 
     running_ = false;
-    sipThread_.join();
+    for (auto& thread : sipThreads_)
+        thread.join();
+    sipThreads_.clear();
+    pjsip_endpt_cancel_timer(endpt_, &lagTimer_);
     pjsip_endpt_destroy(endpt_);
     pool_.reset();
     pj_caching_pool_destroy(&cp_);
@@ -816,6 +849,30 @@ SIPVoIPLink::handleEvents()
                  sip_utils::sip_strerror(ret).c_str());
 }
 
+void
+SIPVoIPLink::scheduleLagProbe()
+{
+    auto ms = LAG_PROBE_PERIOD.count();
+    pj_time_val delay = {static_cast<long>(ms / 1000), static_cast<long>(ms % 1000)};
+    lagDue_ = std::chrono::steady_clock::now() + LAG_PROBE_PERIOD;
+    if (pjsip_endpt_schedule_timer(endpt_, &lagTimer_, &delay) != PJ_SUCCESS)
+        JAMI_WARN("Unable to schedule SIP event loop probe");
+}
+
+void
+SIPVoIPLink::onLagProbe(pj_timer_heap_t*, pj_timer_entry* entry)
+{
+    auto* link = static_cast<SIPVoIPLink*>(entry->user_data);
+    auto lag = std::chrono::steady_clock::now() - link->lagDue_;
+    auto lagUs = std::chrono::duration_cast<std::chrono::microseconds>(lag).count();
+    link->lagHistogram_.record(static_cast<uint32_t>(std::max<decltype(lagUs)>(lagUs, 0)));
+    if (lag > LAG_WARNING)
+        JAMI_WARNING("SIP event loop lagging: timer fired {} ms late",
+                     std::chrono::duration_cast<std::chrono::milliseconds>(lag).count());
+    if (link->running_)
+        link->scheduleLagProbe();
+}
+
 void
 SIPVoIPLink::registerKeepAliveTimer(pj_timer_entry& timer, pj_time_val& delay)
 {
@@ -1551,6 +1608,7 @@ SIPVoIPLink::resolveSrvName(const std::string& name,
             }
         });
 
+    std::lock_guard lk(poolMutex_);
     pjsip_endpt_resolve(endpt_, pool_.get(), &host_info, (void*) token, resolver_callback);
 }
 
@@ -1597,6 +1655,7 @@ SIPVoIPLink::findLocalAddressFromTransport(pjsip_transport* transport,
     auto tp_sel = getTransportSelector(transport);
     pjsip_tpmgr_fla2_param param
         = {transportType, &tp_sel, pjstring, PJ_FALSE, {nullptr, 0}, 0, nullptr};
+    std::lock_guard lk(poolMutex_);
     if (pjsip_tpmgr_find_local_addr2(tpmgr, pool_.get(), &param) != PJ_SUCCESS) {
         JAMI_WARN("Could not retrieve local address and port from transport, using %s :%d",
                   addr.c_str(),
@@ -30,6 +30,7 @@
 
 #include "ring_types.h"
 #include "noncopyable.h"
+#include "media/media_latency.h"
 
 #include <dhtnet/ip_utils.h>
 
@@ -43,12 +44,14 @@
 #ifdef ENABLE_VIDEO
 #include <queue>
 #endif
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <memory>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <vector>
 
 namespace jami {
 
@@ -78,6 +81,17 @@ public:
      */
     void handleEvents();
 
+    /**
+     * Number of threads polling the SIP endpoint.
+     */
+    unsigned workerCount() const { return sipThreads_.size(); }
+
+    /**
+     * Event loop lag: how late a periodic SIP timer fires compared to its
+     * due time, in microseconds. Grows when workers are all busy.
+     */
+    LatencyHistogram::Summary eventLoopLag() const { return lagHistogram_.summary(); }
+
     /**
      * Register a new keepalive registration timer to this endpoint
      */
@@ -123,7 +137,6 @@ public:
     pjsip_module* getMod();
 
     pj_caching_pool* getCachingPool() noexcept;
-    pj_pool_t* getPool() noexcept;
 
     /**
      * Get the correct address to use (ie advertised) from
@@ -163,8 +176,16 @@ private:
 
     mutable pj_caching_pool cp_;
     std::unique_ptr<pj_pool_t, decltype(pj_pool_release)&> pool_;
+    // pj pools are not thread safe, and pool_ is used from every SIP thread
+    mutable std::mutex poolMutex_;
     std::atomic_bool running_ {true};
-    std::thread sipThread_;
+    std::vector<std::thread> sipThreads_;
+
+    void scheduleLagProbe();
+    static void onLagProbe(pj_timer_heap_t*, pj_timer_entry* entry);
+    pj_timer_entry lagTimer_ {};
+    std::chrono::steady_clock::time_point lagDue_ {};
+    LatencyHistogram lagHistogram_;
 
     friend class SIPTest;
 };
@@ -39,6 +39,7 @@ public:
         GIT,           // Start with "git:"
         DATA_TRANSFER, // Start with "data-transfer://"
         SYNC,          // Start with "sync:"
+        MESSAGE,       // Start with "msg:"
         UNRECOGNIZED   // Anything that doesn't fit in other categories
     };
 
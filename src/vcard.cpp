@@ -18,28 +18,127 @@
  ***************************************************************************/
 
 #include "vcard.h"
+#include "fileutils.h"
 #include "string_utils.h"
 
+#include <fstream>
+
 namespace vCard {
 
+const std::string&
+Profile::sha3() const
+{
+    std::call_once(sha3Once_, [this] {
+        sha3_ = jami::fileutils::sha3sum(reinterpret_cast<const uint8_t*>(content_.data()),
+                                         content_.size());
+    });
+    return sha3_;
+}
+
 namespace utils {
 
+bool
+nextProperty(std::string_view& content, std::string_view& key, std::string_view& value)
+{
+    std::string_view line;
+    while (jami::getline(content, line)) {
+        const auto dblptPos = line.find(':');
+        if (dblptPos == std::string_view::npos)
+            continue;
+        key = line.substr(0, dblptPos);
+        value = line.substr(dblptPos + 1);
+        return true;
+    }
+    return false;
+}
+
 std::map<std::string, std::string>
 toMap(std::string_view content)
 {
     std::map<std::string, std::string> vCard;
 
-    std::string_view line;
-    while (jami::getline(content, line)) {
-        if (line.size()) {
-            const auto dblptPos = line.find(':');
-            if (dblptPos == std::string::npos)
-                continue;
-            vCard.emplace(line.substr(0, dblptPos), line.substr(dblptPos + 1));
+    std::string_view key, value;
+    while (nextProperty(content, key, value))
+        vCard.emplace(key, value);
+    return vCard;
+}
+
+// Avatars make profiles large: bound the memory kept for them
+static constexpr uintmax_t PROFILE_CACHE_MAX_BYTES = 8 * 1024 * 1024;
+
+struct ProfileCacheEntry
+{
+    std::shared_ptr<const Profile> profile;
+    uint64_t lastUse;
+};
+
+static std::mutex profileCacheMtx;
+static std::map<std::filesystem::path, ProfileCacheEntry> profileCache;
+static uintmax_t profileCacheBytes {0};
+static uint64_t profileCacheTick {0};
+
+std::shared_ptr<const Profile>
+loadProfile(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return {};
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return {};
+
+    {
+        std::lock_guard lk(profileCacheMtx);
+        auto it = profileCache.find(path);
+        if (it != profileCache.end()) {
+            if (it->second.profile->mtime() == mtime && it->second.profile->size() == size) {
+                it->second.lastUse = ++profileCacheTick;
+                return it->second.profile;
+            }
+            profileCacheBytes -= it->second.profile->size();
+            profileCache.erase(it);
         }
     }
-    return vCard;
+
+    // Read outside of the lock; a concurrent load of the same file is harmless
+    std::string content(size, '\0');
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return {};
+    file.read(content.data(), size);
+    content.resize(file.gcount());
+    auto profile = std::make_shared<const Profile>(std::move(content), mtime, size);
+
+    std::lock_guard lk(profileCacheMtx);
+    auto& entry = profileCache[path];
+    if (entry.profile)
+        profileCacheBytes -= entry.profile->size();
+    entry = {profile, ++profileCacheTick};
+    profileCacheBytes += size;
+    while (profileCacheBytes > PROFILE_CACHE_MAX_BYTES && profileCache.size() > 1) {
+        auto oldest = profileCache.end();
+        for (auto it = profileCache.begin(); it != profileCache.end(); ++it)
+            if (it->second.profile != profile
+                && (oldest == profileCache.end() || it->second.lastUse < oldest->second.lastUse))
+                oldest = it;
+        profileCacheBytes -= oldest->second.profile->size();
+        profileCache.erase(oldest);
+    }
+    return profile;
 }
+
+void
+invalidateProfile(const std::filesystem::path& path)
+{
+    std::lock_guard lk(profileCacheMtx);
+    auto it = profileCache.find(path);
+    if (it != profileCache.end()) {
+        profileCacheBytes -= it->second.profile->size();
+        profileCache.erase(it);
+    }
+}
+
 } // namespace utils
 
 } // namespace vCard
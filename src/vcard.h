@@ -18,9 +18,12 @@
  ***************************************************************************/
 #pragma once
 
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
-#include <map>
 
 namespace vCard {
 
@@ -81,13 +84,69 @@ struct Value
     constexpr static const char* RDV_DEVICE = "rdvDevice";
 };
 
+/**
+ * A vCard file loaded in memory. Instances are immutable and shared;
+ * see utils::loadProfile().
+ */
+class Profile
+{
+public:
+    Profile(std::string content, std::filesystem::file_time_type mtime, uintmax_t size)
+        : content_(std::move(content))
+        , mtime_(mtime)
+        , size_(size)
+    {}
+    Profile(const Profile&) = delete;
+    Profile& operator=(const Profile&) = delete;
+
+    const std::string& content() const { return content_; }
+    std::filesystem::file_time_type mtime() const { return mtime_; }
+    uintmax_t size() const { return size_; }
+
+    /**
+     * SHA3-512 of the file, as returned by fileutils::sha3File().
+     * Computed on first use.
+     */
+    const std::string& sha3() const;
+
+private:
+    const std::string content_;
+    const std::filesystem::file_time_type mtime_;
+    const uintmax_t size_;
+    mutable std::once_flag sha3Once_;
+    mutable std::string sha3_;
+};
+
 namespace utils {
+/**
+ * Split the next "KEY:value" line of a vCard payload, with an API similar
+ * to jami::getline. Lines without ':' are skipped. Nothing is copied: @key
+ * and @value point into the original payload.
+ * @param content   payload, consumed during iteration
+ * @return true if a property was found, false at the end of the payload
+ */
+bool nextProperty(std::string_view& content, std::string_view& key, std::string_view& value);
+
 /**
  * Payload to vCard
  * @param content payload
  * @return the vCard representation
  */
 std::map<std::string, std::string> toMap(std::string_view content);
+
+/**
+ * Load a vCard file, going through a process-wide cache. A cached entry is
+ * reused as long as the file's modification time and size are unchanged,
+ * so callers may call this every time they need the profile.
+ * @return the profile, or nullptr if the file does not exist or is unreadable
+ */
+std::shared_ptr<const Profile> loadProfile(const std::filesystem::path& path);
+
+/**
+ * Drop the cached profile of a file, to be called after writing it: a
+ * rewrite may keep the same size within the modification time resolution.
+ */
+void invalidateProfile(const std::filesystem::path& path);
 } // namespace utils
 
 } // namespace vCard
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+/*
+ * Throughput of base64 encoding and decoding, against the pjlib
+ * implementation the daemon used before.
+ *
+ * Usage: bench_base64 [--filter name] [--size bytes] [--iterations N]
+ *
+ * The default size is that of a commit signature. Results are printed on
+ * stdout as a JSON object keyed by benchmark name; throughput is in
+ * (decoded) bytes per second.
+ */
+
+#include "bench.h"
+
+#include "base64.h"
+
+#include <pjlib.h>
+#include <pjlib-util/base64.h>
+
+#include <random>
+#include <stdexcept>
+
+namespace jami {
+namespace bench {
+
+static std::vector<uint8_t>
+makeData(size_t size)
+{
+    std::mt19937 rng(1);
+    std::vector<uint8_t> data(size);
+    for (auto& b : data)
+        b = static_cast<uint8_t>(rng());
+    return data;
+}
+
+template<typename F>
+static Json::Value
+run(const Options& opts, size_t size, F&& f)
+{
+    const auto iterations = opts.get("iterations", 100000u);
+    Samples samples("bytes");
+    samples.reserve(iterations);
+    auto start = clock::now();
+    for (unsigned i = 0; i < iterations; ++i)
+        samples.measure(f, static_cast<double>(size));
+    auto report = samples.toJson(clock::now() - start);
+    report["size"] = static_cast<Json::UInt64>(size);
+    return report;
+}
+
+static Json::Value
+encode(const Options& opts)
+{
+    const auto data = makeData(opts.get("size", 512u));
+    std::string out(base64::encodedSize(data.size()), '\0');
+    return run(opts, data.size(), [&] { base64::encode(data.data(), data.size(), out.data()); });
+}
+
+static Json::Value
+encodePjlib(const Options& opts)
+{
+    const auto data = makeData(opts.get("size", 512u));
+    std::string out(PJ_BASE256_TO_BASE64_LEN(data.size()), '\0');
+    return run(opts, data.size(), [&] {
+        int len = out.size();
+        if (pj_base64_encode(data.data(), data.size(), out.data(), &len) != PJ_SUCCESS)
+            throw std::runtime_error("pj_base64_encode failed");
+    });
+}
+
+static Json::Value
+decode(const Options& opts)
+{
+    const auto str = base64::encode(makeData(opts.get("size", 512u)));
+    std::vector<uint8_t> out(base64::decodedMaxSize(str.size()));
+    return run(opts, out.size(), [&] { base64::decode(str, out.data()); });
+}
+
+static Json::Value
+decodePjlib(const Options& opts)
+{
+    const auto str = base64::encode(makeData(opts.get("size", 512u)));
+    std::vector<uint8_t> out(PJ_BASE64_TO_BASE256_LEN(str.size()));
+    pj_str_t input {const_cast<char*>(str.data()), static_cast<pj_ssize_t>(str.size())};
+    return run(opts, out.size(), [&] {
+        int len = out.size();
+        if (pj_base64_decode(&input, out.data(), &len) != PJ_SUCCESS)
+            throw std::runtime_error("pj_base64_decode failed");
+    });
+}
+
+} // namespace bench
+} // namespace jami
+
+int
+main(int argc, char** argv)
+{
+    using namespace jami::bench;
+    Options opts(argc, argv);
+
+    return runBenchmarks(opts,
+                         {
+                             {"encode", [&] { return encode(opts); }},
+                             {"encode_pjlib", [&] { return encodePjlib(opts); }},
+                             {"decode", [&] { return decode(opts); }},
+                             {"decode_pjlib", [&] { return decodePjlib(opts); }},
+                         });
+}
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <json/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace jami {
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * Collects per-iteration latencies and the amount of work processed,
+ * and turns them into a JSON report (throughput, p50/p99 latency).
+ */
+class Samples
+{
+public:
+    explicit Samples(std::string unit = "items")
+        : unit_(std::move(unit))
+    {}
+
+    void reserve(size_t n) { latencies_.reserve(n); }
+
+    void add(clock::duration latency, double work = 1.)
+    {
+        latencies_.emplace_back(std::chrono::duration<double, std::micro>(latency).count());
+        work_ += work;
+    }
+
+    template<typename F>
+    void measure(F&& f, double work = 1.)
+    {
+        auto start = clock::now();
+        f();
+        add(clock::now() - start, work);
+    }
+
+    size_t size() const { return latencies_.size(); }
+
+    Json::Value toJson(clock::duration wallTime) const
+    {
+        Json::Value out;
+        auto sorted = latencies_;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) -> double {
+            if (sorted.empty())
+                return 0.;
+            auto idx = static_cast<size_t>(p * (sorted.size() - 1) + .5);
+            return sorted[std::min(idx, sorted.size() - 1)];
+        };
+        double total = 0.;
+        for (auto l : sorted)
+            total += l;
+        auto seconds = std::chrono::duration<double>(wallTime).count();
+
+        out["iterations"] = static_cast<Json::UInt64>(sorted.size());
+        out["throughput"] = seconds > 0. ? work_ / seconds : 0.;
+        out["throughput_unit"] = unit_ + "/s";
+        out["latency_us"]["p50"] = percentile(.50);
+        out["latency_us"]["p99"] = percentile(.99);
+        out["latency_us"]["max"] = sorted.empty() ? 0. : sorted.back();
+        out["latency_us"]["mean"] = sorted.empty() ? 0. : total / sorted.size();
+        return out;
+    }
+
+private:
+    std::string unit_;
+    std::vector<double> latencies_;
+    double work_ {0.};
+};
+
+/**
+ * Minimal command line handling shared by benchmark executables:
+ *   --filter <substring>   only run benchmarks whose name contains substring
+ *   --<key> <value>        free-form parameters read with get()
+ */
+class Options
+{
+public:
+    Options(int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            if (std::strncmp(argv[i], "--", 2) == 0)
+                values_[argv[i] + 2] = argv[i + 1];
+        }
+    }
+
+    std::string get(const std::string& key, const std::string& def) const
+    {
+        auto it = values_.find(key);
+        return it == values_.end() ? def : it->second;
+    }
+
+    unsigned get(const std::string& key, unsigned def) const
+    {
+        auto it = values_.find(key);
+        return it == values_.end() ? def : static_cast<unsigned>(std::strtoul(it->second.c_str(), nullptr, 10));
+    }
+
+    bool enabled(const std::string& name) const
+    {
+        auto filter = get("filter", std::string {});
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+private:
+    std::map<std::string, std::string> values_;
+};
+
+/**
+ * Run every enabled benchmark and print one JSON document on stdout.
+ * Each benchmark returns its own Samples-derived report; exceptions
+ * are reported in the output instead of aborting the whole run.
+ */
+using Benchmark = std::function<Json::Value()>;
+
+inline int
+runBenchmarks(const Options& opts, const std::vector<std::pair<std::string, Benchmark>>& benchmarks)
+{
+    Json::Value root(Json::objectValue);
+    int ret = 0;
+    for (const auto& [name, run] : benchmarks) {
+        if (!opts.enabled(name))
+            continue;
+        try {
+            root[name] = run();
+        } catch (const std::exception& e) {
+            root[name]["error"] = e.what();
+            ret = 1;
+        }
+    }
+    Json::StreamWriterBuilder wbuilder;
+    wbuilder["indentation"] = "  ";
+    std::cout << Json::writeString(wbuilder, root) << std::endl;
+    return ret;
+}
+
+} // namespace bench
+} // namespace jami
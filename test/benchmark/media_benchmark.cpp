@@ -0,0 +1,380 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+/*
+ * Offline benchmark of the media stack.
+ *
+ * Usage: bench_media [--filter name] [--iterations N] [--participants N]
+ *                    [--sources K] [--input file] [--port P]
+ *
+ * Results are printed on stdout as a JSON object keyed by benchmark name.
+ */
+
+#include "bench.h"
+
+#include "jami.h"
+#include "fileutils.h"
+#include "media/libav_deps.h"
+#include "media/libav_utils.h"
+#include "media/media_buffer.h"
+#include "media/media_decoder.h"
+#include "media/media_device.h"
+#include "media/media_encoder.h"
+#include "media/media_io_handle.h"
+#include "media/socket_pair.h"
+#include "media/system_codec_container.h"
+#include "media/audio/audio_format.h"
+#include "media/audio/resampler.h"
+#include "media/audio/ringbuffer.h"
+#include "media/audio/ringbufferpool.h"
+#ifdef ENABLE_VIDEO
+#include "media/video/video_mixer.h"
+#endif
+
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace jami {
+namespace bench {
+
+static constexpr const char* SRTP_SUITE = "AES_CM_128_HMAC_SHA1_80";
+static constexpr const char* SRTP_KEY = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn";
+
+static std::shared_ptr<AudioFrame>
+makeSine(const AudioFormat& format, size_t samples, float freq, size_t offset = 0)
+{
+    auto frame = std::make_shared<AudioFrame>(format, samples);
+    auto f = frame->pointer();
+    const float step = 2.f * static_cast<float>(M_PI) * freq / format.sample_rate;
+    bool planar = av_sample_fmt_is_planar(format.sampleFormat);
+    unsigned channels = planar ? format.nb_channels : 1;
+    unsigned interleave = planar ? 1 : format.nb_channels;
+    for (unsigned c = 0; c < channels; ++c) {
+        for (size_t s = 0; s < samples; ++s) {
+            auto v = std::sin(step * (offset + s)) * .25f;
+            for (unsigned i = 0; i < interleave; ++i) {
+                auto idx = s * interleave + i;
+                if (format.sampleFormat == AV_SAMPLE_FMT_S16
+                    || format.sampleFormat == AV_SAMPLE_FMT_S16P)
+                    reinterpret_cast<int16_t*>(f->extended_data[c])[idx] = static_cast<int16_t>(
+                        v * std::numeric_limits<int16_t>::max());
+                else
+                    reinterpret_cast<float*>(f->extended_data[c])[idx] = v;
+            }
+        }
+    }
+    return frame;
+}
+
+/**
+ * N participants bound together as in a conference: every participant
+ * writes one 20 ms frame, then reads the mix of all the others.
+ */
+static Json::Value
+ringBufferPoolMix(const Options& opts)
+{
+    const auto participants = opts.get("participants", 8u);
+    const auto iterations = opts.get("iterations", 500u);
+    const AudioFormat format {48000, 1};
+    const size_t frameSize = format.sample_rate / 50;
+
+    RingBufferPool pool;
+    pool.setInternalAudioFormat(format);
+    std::vector<std::string> ids;
+    std::vector<std::shared_ptr<RingBuffer>> buffers;
+    for (unsigned i = 0; i < participants; ++i) {
+        ids.emplace_back("participant_" + std::to_string(i));
+        buffers.emplace_back(pool.createRingBuffer(ids.back()));
+    }
+    for (unsigned i = 0; i < participants; ++i)
+        for (unsigned j = i + 1; j < participants; ++j)
+            pool.bindRingbuffers(ids[i], ids[j]);
+
+    auto source = makeSine(format, frameSize, 440.f);
+    Samples samples("frames");
+    samples.reserve(iterations * participants);
+    auto start = clock::now();
+    for (unsigned it = 0; it < iterations; ++it) {
+        for (auto& rb : buffers) {
+            auto frame = std::make_shared<AudioFrame>();
+            frame->copyFrom(*source);
+            rb->put(std::move(frame));
+        }
+        for (const auto& id : ids)
+            samples.measure([&] { pool.getData(id); });
+    }
+    auto report = samples.toJson(clock::now() - start);
+    report["participants"] = participants;
+    return report;
+}
+
+static Json::Value
+audioFrameMix(const Options& opts)
+{
+    const auto iterations = opts.get("iterations", 500u) * 20;
+    const AudioFormat format {48000, 2, AV_SAMPLE_FMT_FLTP};
+    const size_t frameSize = format.sample_rate / 50;
+    auto a = makeSine(format, frameSize, 440.f);
+    auto b = makeSine(format, frameSize, 660.f);
+
+    Samples samples("samples");
+    samples.reserve(iterations);
+    auto start = clock::now();
+    for (unsigned it = 0; it < iterations; ++it)
+        samples.measure([&] { a->mix(*b); }, frameSize * format.nb_channels);
+    return samples.toJson(clock::now() - start);
+}
+
+static Json::Value
+resample(const Options& opts)
+{
+    const auto iterations = opts.get("iterations", 500u) * 4;
+    const AudioFormat in {44100, 2};
+    const AudioFormat out {48000, 1, AV_SAMPLE_FMT_FLTP};
+    const size_t frameSize = in.sample_rate / 50;
+
+    Resampler resampler;
+    Samples samples("samples");
+    samples.reserve(iterations);
+    auto start = clock::now();
+    for (unsigned it = 0; it < iterations; ++it) {
+        auto frame = makeSine(in, frameSize, 440.f, it * frameSize);
+        samples.measure([&] { resampler.resample(std::move(frame), out); }, frameSize);
+    }
+    return samples.toJson(clock::now() - start);
+}
+
+#ifdef ENABLE_VIDEO
+
+/**
+ * Decode the bundled video file and re-encode every frame with VP8,
+ * measuring decode and encode separately.
+ */
+static Json::Value
+transcode(const Options& opts)
+{
+    const auto input = opts.get("input", std::string("media/test_video_file.mp4"));
+    const std::string output = "bench_media.mkv";
+    auto vp8Codec = std::static_pointer_cast<SystemVideoCodecInfo>(
+        getSystemCodecContainer()->searchCodecByName("VP8", MEDIA_VIDEO));
+    if (!vp8Codec)
+        throw std::runtime_error("VP8 codec not available");
+
+    std::unique_ptr<MediaEncoder> encoder;
+    std::unique_ptr<MediaDecoder> decoder;
+    Samples decodeSamples("packets");
+    Samples encodeSamples("frames");
+    int64_t frameNumber = 0;
+
+    decoder = std::make_unique<MediaDecoder>([&](std::shared_ptr<MediaFrame>&& f) {
+        auto frame = std::static_pointer_cast<VideoFrame>(f);
+        if (!encoder) {
+            encoder = std::make_unique<MediaEncoder>();
+            encoder->openOutput(output);
+            encoder->setOptions(MediaStream("v",
+                                            AV_PIX_FMT_YUV420P,
+                                            rational<int>(1, 30),
+                                            frame->width(),
+                                            frame->height(),
+                                            1,
+                                            30));
+            encoder->addStream(*vp8Codec);
+            encoder->setIOContext(nullptr);
+        }
+        encodeSamples.measure([&] { encoder->encode(frame, frameNumber == 0, frameNumber); });
+        ++frameNumber;
+    });
+#ifdef RING_ACCEL
+    decoder->enableAccel(false);
+#endif
+    DeviceParams dev;
+    dev.input = input;
+    if (decoder->openInput(dev) < 0 || decoder->setupVideo() < 0)
+        throw std::runtime_error("Unable to open " + input);
+
+    auto start = clock::now();
+    for (;;) {
+        // decode() synchronously runs the encoder through the observer,
+        // so this covers the whole decode -> encode loop of one packet.
+        auto t0 = clock::now();
+        auto status = decoder->decode();
+        auto t1 = clock::now();
+        if (status == MediaDemuxer::Status::EndOfFile)
+            break;
+        if (status == MediaDemuxer::Status::ReadError)
+            throw std::runtime_error("Decode error");
+        decodeSamples.add(t1 - t0);
+    }
+    if (encoder)
+        encoder->flush();
+    auto wall = clock::now() - start;
+    decoder.reset();
+    encoder.reset();
+    dhtnet::fileutils::remove(output);
+
+    Json::Value report;
+    report["decode_and_encode"] = decodeSamples.toJson(wall);
+    report["encode"] = encodeSamples.toJson(wall);
+    report["frames"] = static_cast<Json::Int64>(frameNumber);
+    return report;
+}
+
+/**
+ * K synthetic sources composited by a VideoMixer. The mixer runs at its
+ * own pace, so what is measured is the delay between output frames and
+ * the achieved output frame rate.
+ */
+static Json::Value
+videoMixer(const Options& opts)
+{
+    const auto sourceCount = opts.get("sources", 9u);
+    const auto frames = opts.get("iterations", 500u) / 5;
+    const int width = 640, height = 360;
+
+    video::VideoMixer mixer("bench_mixer");
+    mixer.setParameters(1280, 720);
+
+    std::vector<std::unique_ptr<PublishObservable<std::shared_ptr<MediaFrame>>>> sources;
+    for (unsigned i = 0; i < sourceCount; ++i) {
+        sources.emplace_back(std::make_unique<PublishObservable<std::shared_ptr<MediaFrame>>>());
+        mixer.attachVideo(sources.back().get(), "call_" + std::to_string(i), "video_0");
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    Samples samples("frames");
+    samples.reserve(frames);
+    auto last = clock::now();
+    FuncObserver<std::shared_ptr<MediaFrame>> output([&](const std::shared_ptr<MediaFrame>&) {
+        std::lock_guard lk(mtx);
+        auto now = clock::now();
+        if (samples.size() < frames)
+            samples.add(now - last);
+        last = now;
+        cv.notify_one();
+    });
+    mixer.attach(&output);
+
+    auto start = clock::now();
+    std::unique_lock lk(mtx);
+    last = start;
+    while (samples.size() < frames) {
+        lk.unlock();
+        for (auto& source : sources) {
+            auto frame = std::make_shared<VideoFrame>();
+            frame->reserve(AV_PIX_FMT_YUV420P, width, height);
+            frame->noise();
+            source->publish(frame);
+        }
+        lk.lock();
+        cv.wait_for(lk, std::chrono::milliseconds(100));
+    }
+    auto wall = clock::now() - start;
+    lk.unlock();
+
+    mixer.detach(&output);
+    for (auto& source : sources)
+        mixer.detachVideo(source.get());
+
+    auto report = samples.toJson(wall);
+    report["sources"] = sourceCount;
+    return report;
+}
+
+#endif // ENABLE_VIDEO
+
+/**
+ * Two SocketPairs connected over loopback with SRTP enabled on both ends.
+ * Each iteration writes one RTP packet and reads it back on the peer.
+ */
+static Json::Value
+socketPairSrtp(const Options& opts)
+{
+    const auto iterations = opts.get("iterations", 500u) * 10;
+    const int portA = static_cast<int>(opts.get("port", 45000u));
+    const int portB = portA + 2;
+    const uint16_t mtu = 1280;
+
+    SocketPair sender(fmt::format("rtp://127.0.0.1:{}", portB).c_str(), portA);
+    SocketPair receiver(fmt::format("rtp://127.0.0.1:{}", portA).c_str(), portB);
+    sender.createSRTP(SRTP_SUITE, SRTP_KEY, SRTP_SUITE, SRTP_KEY);
+    receiver.createSRTP(SRTP_SUITE, SRTP_KEY, SRTP_SUITE, SRTP_KEY);
+    std::unique_ptr<MediaIOHandle> out(sender.createIOContext(mtu));
+    std::unique_ptr<MediaIOHandle> in(receiver.createIOContext(mtu));
+
+    // 12 bytes RTP header, dynamic payload type, then payload
+    std::vector<uint8_t> packet(1000, 0xAB);
+    packet[0] = 0x80;
+    packet[1] = 96;
+    std::vector<uint8_t> recvBuf(mtu);
+
+    Samples samples("packets");
+    samples.reserve(iterations);
+    auto start = clock::now();
+    for (unsigned it = 0; it < iterations; ++it) {
+        uint16_t seq = it & 0xffff;
+        uint32_t ts = it * 3000;
+        packet[2] = seq >> 8;
+        packet[3] = seq & 0xff;
+        packet[4] = ts >> 24;
+        packet[5] = (ts >> 16) & 0xff;
+        packet[6] = (ts >> 8) & 0xff;
+        packet[7] = ts & 0xff;
+        packet[11] = 1; // SSRC
+        samples.measure([&] {
+            avio_write(out->getContext(), packet.data(), packet.size());
+            avio_flush(out->getContext());
+            if (avio_read_partial(in->getContext(), recvBuf.data(), recvBuf.size()) <= 0)
+                throw std::runtime_error("Unable to read back RTP packet");
+        });
+    }
+    auto report = samples.toJson(clock::now() - start);
+    report["packet_size"] = static_cast<Json::UInt>(packet.size());
+    return report;
+}
+
+} // namespace bench
+} // namespace jami
+
+int
+main(int argc, char** argv)
+{
+    using namespace jami::bench;
+    Options opts(argc, argv);
+
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_NO_LOCAL_MEDIA
+                                    | libjami::LIBJAMI_FLAG_NO_AUTOLOAD));
+    jami::libav_utils::av_init();
+
+    auto ret = runBenchmarks(opts,
+                             {
+                                 {"ringbufferpool_mix", [&] { return ringBufferPoolMix(opts); }},
+                                 {"audioframe_mix", [&] { return audioFrameMix(opts); }},
+                                 {"resampler", [&] { return resample(opts); }},
+#ifdef ENABLE_VIDEO
+                                 {"transcode", [&] { return transcode(opts); }},
+                                 {"video_mixer", [&] { return videoMixer(opts); }},
+#endif
+                                 {"socketpair_srtp", [&] { return socketPairSrtp(opts); }},
+                             });
+
+    libjami::fini();
+    return ret;
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+/*
+ * Throughput of UTF-8 validation, vectorized against scalar.
+ *
+ * Usage: bench_utf8 [--filter name] [--size KiB] [--iterations N]
+ *
+ * Results are printed on stdout as a JSON object keyed by benchmark name;
+ * throughput is in bytes per second.
+ */
+
+#include "bench.h"
+
+#include "connectivity/utf8_utils.h"
+
+#include <random>
+#include <stdexcept>
+
+namespace jami {
+namespace bench {
+
+/**
+ * Chat-like text: mostly ASCII words with a share of accented Latin,
+ * CJK and emoji sequences, as found in message bodies and vCards.
+ */
+static std::string
+makeText(size_t size, unsigned nonAsciiPercent)
+{
+    static const char* const WORDS[] = {"hello ", "message ", "jami ", "call ", "the ", "ok "};
+    static const char* const WIDE[] = {"é", "ç", "ü", "€", "日本", "中文", "😀", "👍"};
+    std::mt19937 rng(1);
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        if (rng() % 100 < nonAsciiPercent)
+            text += WIDE[rng() % std::size(WIDE)];
+        else
+            text += WORDS[rng() % std::size(WORDS)];
+    }
+    // don't cut a sequence in two
+    while (!utf8_validate_fallback(text))
+        text.pop_back();
+    return text;
+}
+
+static Json::Value
+validate(const Options& opts, unsigned nonAsciiPercent, bool(validator)(std::string_view))
+{
+    const auto size = opts.get("size", 1024u) * 1024;
+    const auto iterations = opts.get("iterations", 200u);
+    const auto text = makeText(size, nonAsciiPercent);
+
+    Samples samples("bytes");
+    samples.reserve(iterations);
+    auto start = clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        samples.measure(
+            [&] {
+                if (!validator(text))
+                    throw std::runtime_error("text rejected");
+            },
+            static_cast<double>(text.size()));
+    }
+    auto report = samples.toJson(clock::now() - start);
+    report["non_ascii_percent"] = nonAsciiPercent;
+    return report;
+}
+
+} // namespace bench
+} // namespace jami
+
+int
+main(int argc, char** argv)
+{
+    using namespace jami::bench;
+    Options opts(argc, argv);
+
+    return runBenchmarks(opts,
+                         {
+                             {"ascii", [&] { return validate(opts, 0, jami::utf8_validate); }},
+                             {"ascii_fallback",
+                              [&] { return validate(opts, 0, jami::utf8_validate_fallback); }},
+                             {"mixed", [&] { return validate(opts, 20, jami::utf8_validate); }},
+                             {"mixed_fallback",
+                              [&] { return validate(opts, 20, jami::utf8_validate_fallback); }},
+                         });
+}
@@ -26,6 +26,11 @@
 
 #include "base64.h"
 
+#include <pjlib.h>
+#include <pjlib-util/base64.h>
+
+#include <random>
+
 namespace jami { namespace test {
 
 class Base64Test : public CppUnit::TestFixture {
@@ -36,11 +41,17 @@ private:
     void encodingTest();
     void decodingTestSuccess();
     void decodingTestFail();
+    void encodingLengthsTest();
+    void decodingPjlibTest();
+    void bufferTest();
 
     CPPUNIT_TEST_SUITE(Base64Test);
     CPPUNIT_TEST(encodingTest);
     CPPUNIT_TEST(decodingTestSuccess);
     CPPUNIT_TEST(decodingTestFail);
+    CPPUNIT_TEST(encodingLengthsTest);
+    CPPUNIT_TEST(decodingPjlibTest);
+    CPPUNIT_TEST(bufferTest);
     CPPUNIT_TEST_SUITE_END();
 
     const std::vector<uint8_t> test_bytes = { 23, 45, 67, 87, 89, 34, 2, 45, 9, 10 };
@@ -74,6 +85,84 @@ Base64Test::decodingTestFail()
     CPPUNIT_ASSERT(true);
 }
 
+static std::vector<uint8_t>
+pjDecode(const std::string& str)
+{
+    std::vector<uint8_t> out(str.size() + 4);
+    int len = out.size();
+    pj_str_t input {const_cast<char*>(str.data()), (pj_ssize_t) str.size()};
+    if (!str.empty())
+        pj_base64_decode(&input, out.data(), &len);
+    else
+        len = 0;
+    out.resize(len);
+    return out;
+}
+
+void
+Base64Test::encodingLengthsTest()
+{
+    // Every tail length, below and above the vectorized block sizes
+    std::mt19937 rng(42);
+    for (size_t size = 1; size < 300; ++size) {
+        std::vector<uint8_t> data(size);
+        for (auto& b : data)
+            b = static_cast<uint8_t>(rng());
+
+        std::string expected(PJ_BASE256_TO_BASE64_LEN(size), '\0');
+        int len = expected.size();
+        CPPUNIT_ASSERT(pj_base64_encode(data.data(), size, expected.data(), &len) == PJ_SUCCESS);
+        expected.resize(len);
+
+        auto encoded = jami::base64::encode(data);
+        CPPUNIT_ASSERT_EQUAL(expected, encoded);
+        CPPUNIT_ASSERT_EQUAL(jami::base64::encodedSize(size), encoded.size());
+        CPPUNIT_ASSERT(jami::base64::decode(encoded) == data);
+    }
+}
+
+void
+Base64Test::decodingPjlibTest()
+{
+    // Invalid characters must be handled exactly as pjlib did
+    std::mt19937 rng(42);
+    const std::string garbage = "=\n\r -_#\x80\xff";
+    for (int i = 0; i < 5000; ++i) {
+        std::vector<uint8_t> data(rng() % 200);
+        for (auto& b : data)
+            b = static_cast<uint8_t>(rng());
+        auto str = jami::base64::encode(data);
+        if (!str.empty()) {
+            for (auto n = rng() % 4; n > 0; --n)
+                str[rng() % str.size()] = garbage[rng() % garbage.size()];
+            str.resize(str.size() - rng() % std::min<size_t>(str.size(), 3));
+        }
+        CPPUNIT_ASSERT(jami::base64::decode(str) == pjDecode(str));
+    }
+}
+
+void
+Base64Test::bufferTest()
+{
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+
+    // Nothing is written past the advertised sizes
+    std::vector<char> encoded(jami::base64::encodedSize(data.size()) + 8, '#');
+    auto len = jami::base64::encode(data.data(), data.size(), encoded.data());
+    CPPUNIT_ASSERT_EQUAL(jami::base64::encodedSize(data.size()), len);
+    CPPUNIT_ASSERT_EQUAL('#', encoded[len]);
+
+    std::string_view str(encoded.data(), len);
+    std::vector<uint8_t> decoded(jami::base64::decodedMaxSize(str.size()) + 8, 0xAA);
+    auto size = jami::base64::decode(str, decoded.data());
+    CPPUNIT_ASSERT_EQUAL(data.size(), size);
+    CPPUNIT_ASSERT(std::equal(data.begin(), data.end(), decoded.begin()));
+    for (auto i = jami::base64::decodedMaxSize(str.size()); i < decoded.size(); ++i)
+        CPPUNIT_ASSERT_EQUAL((uint8_t) 0xAA, decoded[i]);
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::Base64Test::name());
@@ -0,0 +1,173 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../test_runner.h"
+#include "call_factory.h"
+#include "jami.h"
+#include "jamidht/jamiaccount.h"
+#include "manager.h"
+#include "sip/sipcall.h"
+
+#include "common.h"
+
+namespace jami {
+namespace test {
+
+class CallFactoryTest : public CppUnit::TestFixture
+{
+public:
+    CallFactoryTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+    }
+    ~CallFactoryTest() { libjami::fini(); }
+    static std::string name() { return "CallFactory"; }
+    void setUp();
+    void tearDown();
+
+    std::string aliceId;
+    std::mt19937_64 rand_ {std::random_device {}()};
+
+private:
+    void testAddRemove();
+    void testConcurrentAccess();
+    void testClear();
+
+    CPPUNIT_TEST_SUITE(CallFactoryTest);
+    CPPUNIT_TEST(testAddRemove);
+    CPPUNIT_TEST(testConcurrentAccess);
+    CPPUNIT_TEST(testClear);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CallFactoryTest, CallFactoryTest::name());
+
+void
+CallFactoryTest::setUp()
+{
+    auto actors = load_actors("actors/alice.yml");
+    aliceId = actors["alice"];
+}
+
+void
+CallFactoryTest::tearDown()
+{
+    wait_for_removal_of(aliceId);
+}
+
+void
+CallFactoryTest::testAddRemove()
+{
+    auto account = Manager::instance().getAccount<JamiAccount>(aliceId);
+    CallFactory factory(rand_);
+    CPPUNIT_ASSERT(factory.empty());
+
+    auto call = factory.newSipCall(account, Call::CallType::OUTGOING, {});
+    CPPUNIT_ASSERT(call);
+    const auto id = call->getCallId();
+    CPPUNIT_ASSERT(factory.hasCall(id));
+    CPPUNIT_ASSERT(factory.hasCall(id, Call::LinkType::SIP));
+    CPPUNIT_ASSERT(factory.getCall<SIPCall>(id) == call);
+    CPPUNIT_ASSERT(factory.callCount() == 1);
+    CPPUNIT_ASSERT(factory.getCallIDs() == std::vector<std::string> {id});
+
+    factory.removeCall(id);
+    CPPUNIT_ASSERT(!factory.hasCall(id));
+    CPPUNIT_ASSERT(!factory.getCall(id));
+    CPPUNIT_ASSERT(factory.empty());
+
+    factory.forbid();
+    CPPUNIT_ASSERT(!factory.newSipCall(account, Call::CallType::OUTGOING, {}));
+}
+
+void
+CallFactoryTest::testConcurrentAccess()
+{
+    auto account = Manager::instance().getAccount<JamiAccount>(aliceId);
+    CallFactory factory(rand_);
+    constexpr unsigned THREADS = 8;
+    constexpr unsigned CALLS = 32;
+
+    std::atomic_bool failed {false};
+    std::atomic_bool done {false};
+    // Enumerate while calls are added and removed
+    std::thread reader([&] {
+        while (!done) {
+            for (const auto& call : factory.getAllCalls())
+                if (!call)
+                    failed = true;
+            factory.callCount(Call::LinkType::SIP);
+        }
+    });
+    std::vector<std::thread> writers;
+    for (unsigned t = 0; t < THREADS; ++t) {
+        writers.emplace_back([&] {
+            std::vector<std::string> ids;
+            for (unsigned i = 0; i < CALLS; ++i) {
+                auto call = factory.newSipCall(account, Call::CallType::OUTGOING, {});
+                if (!call || factory.getCall(call->getCallId()) != call)
+                    failed = true;
+                else
+                    ids.emplace_back(call->getCallId());
+            }
+            for (const auto& id : ids)
+                factory.removeCall(id);
+        });
+    }
+    for (auto& w : writers)
+        w.join();
+    done = true;
+    reader.join();
+
+    CPPUNIT_ASSERT(!failed);
+    CPPUNIT_ASSERT(factory.empty());
+}
+
+void
+CallFactoryTest::testClear()
+{
+    auto account = Manager::instance().getAccount<JamiAccount>(aliceId);
+    CallFactory factory(rand_);
+    std::vector<std::weak_ptr<SIPCall>> calls;
+    for (unsigned i = 0; i < 64; ++i)
+        calls.emplace_back(factory.newSipCall(account, Call::CallType::OUTGOING, {}));
+    CPPUNIT_ASSERT(factory.callCount() == calls.size());
+
+    factory.clear();
+    CPPUNIT_ASSERT(factory.empty());
+    for (const auto& call : calls)
+        CPPUNIT_ASSERT(call.expired());
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::CallFactoryTest::name())
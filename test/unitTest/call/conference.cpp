@@ -24,6 +24,7 @@
 #include <string>
 
 #include "manager.h"
+#include "conference.h"
 #include "client/videomanager.h"
 #include "jamidht/jamiaccount.h"
 #include "../../test_runner.h"
@@ -109,6 +110,7 @@ private:
     void testBrokenParticipantAudioOnly();
     void testAudioOnlyLeaveLayout();
     void testRemoveConferenceInOneOne();
+    void testConfInfoDelta();
 
     CPPUNIT_TEST_SUITE(ConferenceTest);
     CPPUNIT_TEST(testGetConference);
@@ -134,6 +136,7 @@ private:
     CPPUNIT_TEST(testBrokenParticipantAudioOnly);
     CPPUNIT_TEST(testAudioOnlyLeaveLayout);
     CPPUNIT_TEST(testRemoveConferenceInOneOne);
+    CPPUNIT_TEST(testConfInfoDelta);
     CPPUNIT_TEST_SUITE_END();
 
     // Common parts
@@ -1120,6 +1123,48 @@ ConferenceTest::testRemoveConferenceInOneOne()
     libjami::unregisterSignalHandlers();
 }
 
+void
+ConferenceTest::testConfInfoDelta()
+{
+    ConfInfo base;
+    base.w = 1280;
+    base.h = 720;
+    for (const auto& uri : {"bob", "carla", "davi"}) {
+        ParticipantInfo info;
+        info.uri = uri;
+        info.device = "device";
+        info.sinkId = std::string(uri) + "_video_0";
+        base.emplace_back(info);
+    }
+    CPPUNIT_ASSERT(base.deltaFrom(base).isNull());
+
+    // Only one participant speaking: nothing else is sent
+    auto updated = base;
+    updated[1].voiceActivity = true;
+    auto delta = updated.deltaFrom(base);
+    CPPUNIT_ASSERT(delta["delta"].asBool());
+    CPPUNIT_ASSERT(delta["p"].size() == 1);
+    CPPUNIT_ASSERT(delta["p"][0]["uri"].asString() == "carla");
+    CPPUNIT_ASSERT(!delta.isMember("removed"));
+
+    // Participant leaving and joining
+    updated.erase(updated.begin());
+    ParticipantInfo erin;
+    erin.uri = "erin";
+    erin.sinkId = "erin_video_0";
+    updated.emplace_back(erin);
+    updated.layout = 2;
+    delta = updated.deltaFrom(base);
+    CPPUNIT_ASSERT(delta["p"].size() == 2);
+    CPPUNIT_ASSERT(delta["removed"].size() == 1);
+    CPPUNIT_ASSERT(delta["removed"][0]["uri"].asString() == "bob");
+
+    auto applied = base;
+    applied.applyDelta(delta);
+    CPPUNIT_ASSERT(applied == updated);
+    CPPUNIT_ASSERT(applied.layout == 2);
+}
+
 } // namespace test
 } // namespace jami
 
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "config/config_writer.h"
+#include "scheduled_executor.h"
+#include "fileutils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../test_runner.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class ConfigWriterTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "config_writer"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testDebounce();
+    void testSections();
+    void testAtomicReplace();
+    void testCancel();
+
+    CPPUNIT_TEST_SUITE(ConfigWriterTest);
+    CPPUNIT_TEST(testDebounce);
+    CPPUNIT_TEST(testSections);
+    CPPUNIT_TEST(testAtomicReplace);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string read() const { return fileutils::loadTextFile(path_); }
+
+    ScheduledExecutor executor_ {"config_writer"};
+    std::filesystem::path dir_;
+    std::filesystem::path path_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ConfigWriterTest, ConfigWriterTest::name());
+
+void
+ConfigWriterTest::setUp()
+{
+    char templateName[] = {"config_writer_XXXXXX"};
+    auto directory = mkdtemp(templateName);
+    CPPUNIT_ASSERT(directory);
+    dir_ = std::filesystem::absolute(directory);
+    path_ = dir_ / "config.yml";
+}
+
+void
+ConfigWriterTest::tearDown()
+{
+    std::filesystem::remove_all(dir_);
+}
+
+void
+ConfigWriterTest::testDebounce()
+{
+    std::atomic_int calls {0};
+    ConfigWriter writer(executor_, 200ms);
+    for (int i = 0; i < 100; ++i) {
+        writer.save(path_, "main", [&calls, i] {
+            ++calls;
+            return std::to_string(i);
+        });
+    }
+    // Nothing is written on the caller thread
+    CPPUNIT_ASSERT_EQUAL(0, calls.load());
+    CPPUNIT_ASSERT(not std::filesystem::exists(path_));
+
+    for (int i = 0; i < 50 and not std::filesystem::exists(path_); ++i)
+        std::this_thread::sleep_for(100ms);
+    CPPUNIT_ASSERT(std::filesystem::exists(path_));
+    // Only the last serializer runs, once
+    CPPUNIT_ASSERT_EQUAL(1, calls.load());
+    CPPUNIT_ASSERT_EQUAL(std::string("99"), read());
+
+    // Nothing pending: the scheduled write is gone
+    std::this_thread::sleep_for(400ms);
+    CPPUNIT_ASSERT_EQUAL(1, calls.load());
+}
+
+void
+ConfigWriterTest::testSections()
+{
+    std::atomic_int callsA {0};
+    ConfigWriter writer(executor_, 1h);
+    writer.save(path_, "a", [&] {
+        ++callsA;
+        return std::string("a: 1\n");
+    });
+    writer.save(path_, "b", [] { return std::string("b: 1\n"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(std::string("a: 1\nb: 1\n"), read());
+
+    // Only the dirty section is serialized again, the file keeps the order
+    writer.save(path_, "b", [] { return std::string("b: 2\n"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(1, callsA.load());
+    CPPUNIT_ASSERT_EQUAL(std::string("a: 1\nb: 2\n"), read());
+
+    // A failing section keeps its last content
+    writer.save(path_, "a", []() -> std::string { throw std::runtime_error("error"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(std::string("a: 1\nb: 2\n"), read());
+}
+
+void
+ConfigWriterTest::testAtomicReplace()
+{
+    ConfigWriter writer(executor_, 1h);
+    writer.save(path_, "main", [] { return std::string("first"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(std::string("first"), read());
+
+    writer.save(path_, "main", [] { return std::string("second"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(std::string("second"), read());
+    CPPUNIT_ASSERT(not std::filesystem::exists(path_.string() + ".tmp"));
+
+    // Unchanged content is not written again
+    auto past = std::filesystem::last_write_time(path_) - 1h;
+    std::filesystem::last_write_time(path_, past);
+    writer.save(path_, "main", [] { return std::string("second"); });
+    writer.flush();
+    CPPUNIT_ASSERT(std::filesystem::last_write_time(path_) == past);
+
+    // A leftover of an interrupted write doesn't matter
+    fileutils::saveFile(path_.string() + ".tmp", std::vector<uint8_t> {'x'});
+    writer.save(path_, "main", [] { return std::string("third"); });
+    writer.flush();
+    CPPUNIT_ASSERT_EQUAL(std::string("third"), read());
+    CPPUNIT_ASSERT(not std::filesystem::exists(path_.string() + ".tmp"));
+
+    // The owner's directory is gone: nothing is written
+    std::filesystem::remove_all(dir_);
+    writer.save(path_, "main", [] { return std::string("fourth"); });
+    writer.flush();
+    CPPUNIT_ASSERT(not std::filesystem::exists(dir_));
+}
+
+void
+ConfigWriterTest::testCancel()
+{
+    std::atomic_int calls {0};
+    {
+        ConfigWriter writer(executor_, 100ms);
+        writer.save(path_, "main", [&] {
+            ++calls;
+            return std::string("content");
+        });
+        writer.cancel();
+        std::this_thread::sleep_for(300ms);
+        CPPUNIT_ASSERT(not std::filesystem::exists(path_));
+    }
+    CPPUNIT_ASSERT_EQUAL(0, calls.load());
+
+    // Pending changes are written on destruction
+    {
+        ConfigWriter writer(executor_, 1h);
+        writer.save(path_, "main", [] { return std::string("content"); });
+    }
+    CPPUNIT_ASSERT_EQUAL(std::string("content"), read());
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::ConfigWriterTest::name());
@@ -157,6 +157,7 @@ private:
     void testLoadPartiallyRemovedConversation();
     void testReactionsOnEditedMessage();
     void testUpdateProfileMultiDevice();
+    void testCoalescedAnnouncements();
 
     CPPUNIT_TEST_SUITE(ConversationTest);
     CPPUNIT_TEST(testCreateConversation);
@@ -210,6 +211,7 @@ private:
     CPPUNIT_TEST(testLoadPartiallyRemovedConversation);
     CPPUNIT_TEST(testReactionsOnEditedMessage);
     CPPUNIT_TEST(testUpdateProfileMultiDevice);
+    CPPUNIT_TEST(testCoalescedAnnouncements);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -2403,6 +2405,50 @@ ConversationTest::testUpdateProfileMultiDevice()
 
 }
 
+void
+ConversationTest::testCoalescedAnnouncements()
+{
+    std::cout << "\nRunning test: " << __func__ << std::endl;
+    connectSignals();
+
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    std::vector<std::string> announced;
+    aliceAccount->convModule()->onCommitAnnounced(
+        [&](const std::string& /* conversationId */, const std::string& commitId) {
+            announced.emplace_back(commitId);
+            cv.notify_one();
+        });
+
+    auto convId = libjami::startConversation(aliceId);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&]() { return !aliceData.conversationId.empty(); }));
+
+    // Commits sent in a burst, well within the announce delay (300ms)
+    constexpr size_t burst = 5;
+    auto aliceMsgSize = aliceData.messages.size();
+    for (size_t i = 0; i < burst; ++i)
+        libjami::sendMessage(aliceId, convId, fmt::format("message {}", i), "");
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&]() {
+        return aliceData.messages.size() == aliceMsgSize + burst;
+    }));
+
+    // The first commit is announced right away, the others in a single
+    // announcement of the last one
+    CPPUNIT_ASSERT(cv.wait_for(lk, 10s, [&]() { return announced.size() == 2; }));
+    CPPUNIT_ASSERT(announced.front() == aliceData.messages[aliceMsgSize].id);
+    CPPUNIT_ASSERT(announced.back() == aliceData.messages.back().id);
+    CPPUNIT_ASSERT(!cv.wait_for(lk, 1s, [&]() { return announced.size() > 2; }));
+
+    // Once the delay elapsed without commits, the next one is announced on its own
+    libjami::sendMessage(aliceId, convId, "later"s, "");
+    CPPUNIT_ASSERT(cv.wait_for(lk, 10s, [&]() { return announced.size() == 3; }));
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&]() {
+        return aliceData.messages.size() == aliceMsgSize + burst + 1;
+    }));
+    CPPUNIT_ASSERT(announced.back() == aliceData.messages.back().id);
+    CPPUNIT_ASSERT(!cv.wait_for(lk, 1s, [&]() { return announced.size() > 3; }));
+    aliceAccount->convModule()->onCommitAnnounced({});
+}
+
 } // namespace test
 } // namespace jami
 
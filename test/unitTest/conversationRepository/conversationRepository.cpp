@@ -75,6 +75,7 @@ private:
     void testDiff();
 
     void testMergeProfileWithConflict();
+    void testValidFetchManyCommits();
 
     std::string addCommit(git_repository* repo,
                           const std::shared_ptr<JamiAccount> account,
@@ -93,6 +94,7 @@ private:
     CPPUNIT_TEST(testFFMerge);
     CPPUNIT_TEST(testDiff);
     CPPUNIT_TEST(testMergeProfileWithConflict);
+    CPPUNIT_TEST(testValidFetchManyCommits);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -507,6 +509,69 @@ ConversationRepositoryTest::testMergeProfileWithConflict()
     CPPUNIT_ASSERT(repository->log().size() == 5 /* Initial, add, modify 1, modify 2, merge */);
 }
 
+void
+ConversationRepositoryTest::testValidFetchManyCommits()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobAccount = Manager::instance().getAccount<JamiAccount>(bobId);
+    auto repository = ConversationRepository::createConversation(aliceAccount);
+    CPPUNIT_ASSERT(repository != nullptr);
+
+    // Enough commits for the authors to be checked in parallel
+    constexpr size_t nbCommits = 100;
+    std::string lastId;
+    for (size_t i = 0; i < nbCommits; ++i)
+        lastId = repository->commitMessage(
+            fmt::format("{{\"type\":\"text/plain\",\"body\":\"Message {}\"}}", i));
+    CPPUNIT_ASSERT(!lastId.empty());
+
+    auto repoPath = fileutils::get_data_dir() / aliceAccount->getAccountID() / "conversations"
+                    / repository->id();
+    git_repository* repo;
+    CPPUNIT_ASSERT(git_repository_open(&repo, repoPath.c_str()) == 0);
+
+    // Bob's device is not a member, so his commit must be refused
+    auto bobCommit = addCommit(repo,
+                               bobAccount,
+                               "main",
+                               "{\"type\":\"text/plain\",\"body\":\"Intruder\"}");
+    CPPUNIT_ASSERT(!bobCommit.empty());
+
+    // Pretend the commits were fetched from another device: main goes back to
+    // the initial commit and the remote branch points to the new commits
+    const std::string remoteDevice = "remoteDevice";
+    git_remote* remote = nullptr;
+    CPPUNIT_ASSERT(git_remote_create(&remote,
+                                     repo,
+                                     remoteDevice.c_str(),
+                                     ("git://" + remoteDevice + "/" + repository->id()).c_str())
+                   == 0);
+    git_remote_free(remote);
+    auto setRef = [&](const std::string& name, const std::string& id) {
+        git_oid oid;
+        git_reference* ref = nullptr;
+        git_oid_fromstr(&oid, id.c_str());
+        auto res = git_reference_create(&ref, repo, name.c_str(), &oid, true, nullptr) == 0;
+        git_reference_free(ref);
+        return res;
+    };
+    auto remoteMain = "refs/remotes/" + remoteDevice + "/main";
+    CPPUNIT_ASSERT(setRef("refs/heads/main", repository->id()));
+    CPPUNIT_ASSERT(setRef(remoteMain, lastId));
+
+    auto [commits, error] = repository->validFetch(remoteDevice);
+    CPPUNIT_ASSERT(!error);
+    CPPUNIT_ASSERT(commits.size() == nbCommits);
+    CPPUNIT_ASSERT(commits.back().id == lastId);
+
+    // A commit from a non member device is refused, even after the others were checked
+    CPPUNIT_ASSERT(setRef(remoteMain, bobCommit));
+    std::tie(commits, error) = repository->validFetch(remoteDevice);
+    CPPUNIT_ASSERT(error);
+    CPPUNIT_ASSERT(commits.empty());
+    git_repository_free(repo);
+}
+
 } // namespace test
 } // namespace jami
 
@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jamidht/device_uri_cache.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../test_runner.h"
+
+namespace jami {
+namespace test {
+
+class DeviceUriCacheTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "device_uri_cache"; }
+
+private:
+    void testResolve();
+    void testInvalidate();
+    void testConcurrentAccess();
+
+    CPPUNIT_TEST_SUITE(DeviceUriCacheTest);
+    CPPUNIT_TEST(testResolve);
+    CPPUNIT_TEST(testInvalidate);
+    CPPUNIT_TEST(testConcurrentAccess);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(DeviceUriCacheTest, DeviceUriCacheTest::name());
+
+void
+DeviceUriCacheTest::testResolve()
+{
+    DeviceUriCache cache;
+    int calls = 0;
+    auto resolver = [&](const std::string& device) {
+        ++calls;
+        return device == "unknown" ? std::string {} : "uri-" + device;
+    };
+
+    CPPUNIT_ASSERT(cache.get("dev1").empty());
+    CPPUNIT_ASSERT(cache.resolve("dev1", resolver) == "uri-dev1");
+    CPPUNIT_ASSERT(cache.resolve("dev1", resolver) == "uri-dev1");
+    CPPUNIT_ASSERT(calls == 1);
+    CPPUNIT_ASSERT(cache.get("dev1") == "uri-dev1");
+
+    // Failures are not cached
+    CPPUNIT_ASSERT(cache.resolve("unknown", resolver).empty());
+    CPPUNIT_ASSERT(cache.resolve("unknown", resolver).empty());
+    CPPUNIT_ASSERT(calls == 3);
+
+    cache.set("dev2", "other");
+    CPPUNIT_ASSERT(cache.resolve("dev2", resolver) == "other");
+    CPPUNIT_ASSERT(calls == 3);
+}
+
+void
+DeviceUriCacheTest::testInvalidate()
+{
+    DeviceUriCache cache;
+    cache.set("dev1", "alice");
+    cache.set("dev2", "alice");
+    cache.set("dev3", "bob");
+
+    cache.invalidate("dev1");
+    CPPUNIT_ASSERT(cache.get("dev1").empty());
+    CPPUNIT_ASSERT(cache.get("dev2") == "alice");
+
+    // Revoking an account forgets all its devices
+    cache.invalidateUri("alice");
+    CPPUNIT_ASSERT(cache.get("dev2").empty());
+    CPPUNIT_ASSERT(cache.get("dev3") == "bob");
+
+    cache.clear();
+    CPPUNIT_ASSERT(cache.get("dev3").empty());
+}
+
+void
+DeviceUriCacheTest::testConcurrentAccess()
+{
+    DeviceUriCache cache;
+    constexpr int threadCount = 8;
+    constexpr int deviceCount = 1000;
+    std::atomic_bool wrongUri {false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < deviceCount; ++i) {
+                auto device = std::to_string(i);
+                auto uri = cache.resolve(device, [](const std::string& d) { return "uri-" + d; });
+                if (uri != "uri-" + device)
+                    wrongUri = true;
+                if (i % threadCount == t)
+                    cache.invalidate(device);
+                if (i % 100 == 0)
+                    cache.invalidateUri("uri-" + device);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    CPPUNIT_ASSERT(!wrongUri);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::DeviceUriCacheTest::name())
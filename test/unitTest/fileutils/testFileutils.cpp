@@ -23,9 +23,13 @@
 
 #include "../../test_runner.h"
 #include "fileutils.h"
+#include "archiver.h"
+#include "base64.h"
 
 #include "jami.h"
 
+#include <opendht/crypto.h>
+
 #include <string>
 #include <iostream>
 #include <cstdlib>
@@ -46,6 +50,9 @@ private:
     void testIsDirectoryWritable();
     void testGetCleanPath();
     void testFullPath();
+    void testArchiveStream();
+    void testArchiveStreamTruncated();
+    void testReplaceFileSync();
 
     CPPUNIT_TEST_SUITE(FileutilsTest);
     CPPUNIT_TEST(testPath);
@@ -53,6 +60,9 @@ private:
     CPPUNIT_TEST(testIsDirectoryWritable);
     CPPUNIT_TEST(testGetCleanPath);
     CPPUNIT_TEST(testFullPath);
+    CPPUNIT_TEST(testArchiveStream);
+    CPPUNIT_TEST(testArchiveStreamTruncated);
+    CPPUNIT_TEST(testReplaceFileSync);
     CPPUNIT_TEST_SUITE_END();
 
     static constexpr auto tmpFileName = "temp_file";
@@ -145,6 +155,112 @@ FileutilsTest::testFullPath()
     CPPUNIT_ASSERT(getFullPath(NON_EXISTANT_PATH_BASE, "test").compare(NON_EXISTANT_PATH) == 0);
 }
 
+void
+FileutilsTest::testArchiveStream()
+{
+    auto path = TEST_PATH + DIR_SEPARATOR_STR + "archive.gz";
+    std::string data;
+    while (data.size() < 3 * archiver::STREAM_CHUNK_SIZE)
+        data += std::to_string(data.size()) + '\n';
+
+    // Password, spans several chunks
+    writeArchive(data, path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(archiver::isStream(path));
+    auto read = readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(std::string(read.data.begin(), read.data.end()) == data);
+    CPPUNIT_ASSERT(!read.salt.empty());
+    CPPUNIT_ASSERT_THROW(readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "wrong"), std::exception);
+
+    // Key derived from the password, as used by ArchiveAccountManager
+    auto salt = read.salt;
+    auto key = base64::encode(dht::crypto::stretchKey("pass", salt, 256 / 8));
+    writeArchive("{}", path, ARCHIVE_AUTH_SCHEME_KEY, key, salt);
+    read = readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(std::string(read.data.begin(), read.data.end()) == "{}");
+    CPPUNIT_ASSERT(read.salt == salt);
+
+    // Serialized straight into the stream
+    CPPUNIT_ASSERT(writeArchive(
+        [&](std::ostream& os) {
+            for (size_t i = 0; i < data.size(); i += 1000)
+                os << std::string_view(data).substr(i, 1000);
+        },
+        path,
+        ARCHIVE_AUTH_SCHEME_PASSWORD,
+        "pass"));
+    CPPUNIT_ASSERT(archiver::isStream(path));
+    read = readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(std::string(read.data.begin(), read.data.end()) == data);
+
+    // Exports are readable by previous versions
+    CPPUNIT_ASSERT(writeArchive(data, path, ARCHIVE_AUTH_SCHEME_KEY, key, salt, true));
+    CPPUNIT_ASSERT(!archiver::isStream(path));
+    auto legacy = archiver::decompress(
+        dht::crypto::aesDecrypt(dht::crypto::aesGetEncrypted(loadFile(path)), base64::decode(key)));
+    CPPUNIT_ASSERT(std::string(legacy.begin(), legacy.end()) == data);
+    CPPUNIT_ASSERT(dht::crypto::aesGetSalt(loadFile(path)) == salt);
+    CPPUNIT_ASSERT(writeArchive(data, path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass", salt, true));
+    CPPUNIT_ASSERT(!archiver::isStream(path));
+    read = readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(std::string(read.data.begin(), read.data.end()) == data);
+
+    // Archives written by previous versions are still readable
+    saveFile(path, dht::crypto::aesEncrypt(archiver::compress(data), "pass", salt));
+    CPPUNIT_ASSERT(!archiver::isStream(path));
+    read = readArchive(path, ARCHIVE_AUTH_SCHEME_PASSWORD, "pass");
+    CPPUNIT_ASSERT(std::string(read.data.begin(), read.data.end()) == data);
+    std::filesystem::remove(path);
+}
+
+void
+FileutilsTest::testArchiveStreamTruncated()
+{
+    auto path = TEST_PATH + DIR_SEPARATOR_STR + "archive.gz";
+    std::vector<uint8_t> key(32, 42);
+    std::string data(10000, 'a');
+    {
+        archiver::StreamWriter writer(path, key, {}, 1024);
+        writer.write(data);
+        writer.close();
+    }
+    std::string read;
+    archiver::readStream(path, key, [&](const uint8_t* d, size_t s) {
+        read.append(reinterpret_cast<const char*>(d), s);
+    });
+    CPPUNIT_ASSERT(read == data);
+
+    // Dropping the end of the stream must be detected
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+    CPPUNIT_ASSERT_THROW(archiver::readStream(path, key, [](const uint8_t*, size_t) {}),
+                         std::runtime_error);
+
+    // An unclosed writer leaves nothing behind
+    std::filesystem::remove(path);
+    {
+        archiver::StreamWriter writer(path, key);
+        writer.write(data);
+    }
+    CPPUNIT_ASSERT(!std::filesystem::exists(path));
+}
+
+void
+FileutilsTest::testReplaceFileSync()
+{
+    auto path = TEST_PATH + DIR_SEPARATOR_STR + "synced";
+    CPPUNIT_ASSERT(writeFileSync(path, "abc"));
+    CPPUNIT_ASSERT(writeFileSync(path, "def", true));
+    CPPUNIT_ASSERT(loadTextFile(path) == "abcdef");
+
+    CPPUNIT_ASSERT(replaceFileSync(path, "ghi"));
+    CPPUNIT_ASSERT(loadTextFile(path) == "ghi");
+    CPPUNIT_ASSERT(!std::filesystem::exists(path + ".tmp"));
+
+    // A failed replace leaves the file untouched
+    CPPUNIT_ASSERT(!replaceFileSync(NON_EXISTANT_PATH_BASE + DIR_SEPARATOR_STR + "file", "jkl"));
+    CPPUNIT_ASSERT(loadTextFile(path) == "ghi");
+    std::filesystem::remove(path);
+}
+
 }}} // namespace jami::test::fileutils
 
 RING_TEST_RUNNER(jami::fileutils::test::FileutilsTest::name());
@@ -0,0 +1,209 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "kv_store.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "../../test_runner.h"
+
+namespace jami {
+namespace test {
+
+class KvStoreTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "kv_store"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testPutGet();
+    void testReopen();
+    void testLegacySnapshot();
+    void testScan();
+    void testAssign();
+    void testTruncatedLog();
+
+    CPPUNIT_TEST_SUITE(KvStoreTest);
+    CPPUNIT_TEST(testPutGet);
+    CPPUNIT_TEST(testReopen);
+    CPPUNIT_TEST(testLegacySnapshot);
+    CPPUNIT_TEST(testScan);
+    CPPUNIT_TEST(testAssign);
+    CPPUNIT_TEST(testTruncatedLog);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::filesystem::path dir_;
+    std::filesystem::path path_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(KvStoreTest, KvStoreTest::name());
+
+void
+KvStoreTest::setUp()
+{
+    char templateName[] = {"kv_store_XXXXXX"};
+    auto directory = mkdtemp(templateName);
+    CPPUNIT_ASSERT(directory);
+    dir_ = std::filesystem::absolute(directory);
+    path_ = dir_ / "store";
+}
+
+void
+KvStoreTest::tearDown()
+{
+    std::filesystem::remove_all(dir_);
+}
+
+void
+KvStoreTest::testPutGet()
+{
+    auto store = KvStore::open(path_);
+    CPPUNIT_ASSERT(store->empty());
+    store->put(std::string("a"), 1);
+    store->put(std::string("b"), 2);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), store->size());
+    CPPUNIT_ASSERT_EQUAL(1, *store->get<int>(std::string("a")));
+    store->put(std::string("a"), 3);
+    CPPUNIT_ASSERT_EQUAL(3, *store->get<int>(std::string("a")));
+    store->erase(std::string("b"));
+    CPPUNIT_ASSERT(!store->get<int>(std::string("b")));
+    // Same path, same instance
+    CPPUNIT_ASSERT(KvStore::open(path_) == store);
+}
+
+void
+KvStoreTest::testReopen()
+{
+    {
+        auto store = KvStore::open(path_);
+        for (int i = 0; i < 100; ++i)
+            store->put(std::to_string(i), std::string(i, 'x'));
+        store->erase(std::string("42"));
+        store->commit();
+        CPPUNIT_ASSERT(std::filesystem::file_size(path_.string() + ".log") > 0);
+        // Destroying the store commits pending updates
+        store->put(std::string("last"), std::string("value"));
+    }
+    auto store = KvStore::open(path_);
+    auto values = store->load<std::string, std::string>();
+    CPPUNIT_ASSERT_EQUAL(size_t(100), values.size());
+    CPPUNIT_ASSERT(values.find("42") == values.end());
+    CPPUNIT_ASSERT_EQUAL(std::string(12, 'x'), values["12"]);
+    CPPUNIT_ASSERT_EQUAL(std::string("value"), values["last"]);
+    // The log was folded into the snapshot when reopening
+    CPPUNIT_ASSERT_EQUAL(uintmax_t(0), std::filesystem::file_size(path_.string() + ".log"));
+}
+
+void
+KvStoreTest::testLegacySnapshot()
+{
+    std::map<std::string, std::map<std::string, std::string>> legacy {{"conv1", {{"k", "v"}}},
+                                                                      {"conv2", {}}};
+    {
+        std::ofstream file(path_, std::ios::trunc | std::ios::binary);
+        msgpack::pack(file, legacy);
+    }
+    {
+        auto store = KvStore::open(path_);
+        CPPUNIT_ASSERT(store->load<std::string, decltype(legacy)::mapped_type>() == legacy);
+        legacy["conv3"]["a"] = "b";
+        store->put(std::string("conv3"), legacy["conv3"]);
+        store->commit();
+    }
+    {
+        // Open the store again to fold the log
+        KvStore::open(path_);
+    }
+    // The snapshot can still be read as a whole
+    std::ifstream file(path_, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto oh = msgpack::unpack(data.data(), data.size());
+    CPPUNIT_ASSERT(oh.get().as<decltype(legacy)>() == legacy);
+}
+
+void
+KvStoreTest::testScan()
+{
+    auto store = KvStore::open(path_);
+    for (char c = 'a'; c <= 'z'; ++c)
+        store->put(std::string(1, c), int(c));
+    std::string keys;
+    store->scan<std::string, int>("d", "h", [&](std::string&& key, int&& value) {
+        CPPUNIT_ASSERT_EQUAL(int(key[0]), value);
+        keys += key;
+        return true;
+    });
+    CPPUNIT_ASSERT_EQUAL(std::string("defg"), keys);
+}
+
+void
+KvStoreTest::testAssign()
+{
+    auto store = KvStore::open(path_);
+    store->assign(std::map<std::string, int> {{"a", 1}, {"b", 2}, {"c", 3}});
+    store->commit();
+    auto logSize = std::filesystem::file_size(path_.string() + ".log");
+
+    // Unchanged entries are not written again
+    store->assign(std::map<std::string, int> {{"a", 1}, {"b", 2}, {"c", 3}});
+    store->commit();
+    CPPUNIT_ASSERT_EQUAL(logSize, std::filesystem::file_size(path_.string() + ".log"));
+
+    store->assign(std::map<std::string, int> {{"a", 1}, {"c", 4}});
+    auto values = store->load<std::string, int>();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), values.size());
+    CPPUNIT_ASSERT_EQUAL(4, values["c"]);
+}
+
+void
+KvStoreTest::testTruncatedLog()
+{
+    {
+        auto store = KvStore::open(path_);
+        store->put(std::string("a"), std::string("first"));
+        store->put(std::string("b"), std::string("second"));
+        store->commit();
+    }
+    // Simulate a record interrupted by a crash
+    {
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, std::make_tuple(std::string("c"), std::string("third")));
+        std::ofstream log(path_.string() + ".log", std::ios::app | std::ios::binary);
+        log.write(buffer.data(), buffer.size() - 2);
+    }
+    auto store = KvStore::open(path_);
+    auto values = store->load<std::string, std::string>();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), values.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("second"), values["b"]);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::KvStoreTest::name());
@@ -42,15 +42,25 @@ private:
     void testBiggerInput();
     void testBiggerOutput();
     void testDifferentFormat();
+    void testBufferReuse();
+    void testByReference();
+    void testMixedQueue();
 
     void gotFrame(std::shared_ptr<AudioFrame>&& framePtr);
     std::shared_ptr<AudioFrame> getFrame(int n);
+    // Frame whose samples are numbered from first
+    std::shared_ptr<AudioFrame> getNumberedFrame(int n, int first);
+    // Whether samples of frame are numbered from first
+    bool isNumbered(const AudioFrame& frame, int n, int first);
 
     CPPUNIT_TEST_SUITE(AudioFrameResizerTest);
     CPPUNIT_TEST(testSameSize);
     CPPUNIT_TEST(testBiggerInput);
     CPPUNIT_TEST(testBiggerOutput);
     CPPUNIT_TEST(testDifferentFormat);
+    CPPUNIT_TEST(testBufferReuse);
+    CPPUNIT_TEST(testByReference);
+    CPPUNIT_TEST(testMixedQueue);
     CPPUNIT_TEST_SUITE_END();
 
     std::shared_ptr<AudioFrameResizer> q_;
@@ -79,6 +89,28 @@ AudioFrameResizerTest::getFrame(int n)
     return frame;
 }
 
+std::shared_ptr<AudioFrame>
+AudioFrameResizerTest::getNumberedFrame(int n, int first)
+{
+    auto frame = getFrame(n);
+    auto data = reinterpret_cast<int16_t*>(frame->pointer()->data[0]);
+    for (int i = 0; i < n; ++i)
+        for (unsigned c = 0; c < format_.nb_channels; ++c)
+            data[i * format_.nb_channels + c] = first + i;
+    return frame;
+}
+
+bool
+AudioFrameResizerTest::isNumbered(const AudioFrame& frame, int n, int first)
+{
+    auto data = reinterpret_cast<const int16_t*>(frame.pointer()->data[0]);
+    for (int i = 0; i < n; ++i)
+        for (unsigned c = 0; c < format_.nb_channels; ++c)
+            if (data[i * format_.nb_channels + c] != first + i)
+                return false;
+    return true;
+}
+
 void
 AudioFrameResizerTest::testSameSize()
 {
@@ -127,6 +159,77 @@ AudioFrameResizerTest::testDifferentFormat()
     CPPUNIT_ASSERT(q_->samples() == 0);
 }
 
+void
+AudioFrameResizerTest::testBufferReuse()
+{
+    // no callback, frames are copied in and read into a caller-owned buffer
+    q_.reset(new AudioFrameResizer(format_, outputSize_));
+    auto in = getFrame(outputSize_ / 2);
+    in->pointer()->pts = 1;
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(*in));
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(*in));
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(*in));
+    CPPUNIT_ASSERT(in.use_count() == 1);
+    CPPUNIT_ASSERT(q_->samples() == outputSize_ + outputSize_ / 2);
+
+    auto out = getFrame(outputSize_ * 2);
+    auto data = out->pointer()->data[0];
+    CPPUNIT_ASSERT(!q_->dequeue(*out, outputSize_ * 2));
+    CPPUNIT_ASSERT(q_->dequeue(*out, outputSize_));
+    CPPUNIT_ASSERT(out->pointer()->data[0] == data);
+    CPPUNIT_ASSERT(out->pointer()->pts == 1);
+    CPPUNIT_ASSERT(q_->samples() == outputSize_ / 2);
+
+    q_->discard(outputSize_);
+    CPPUNIT_ASSERT(q_->samples() == 0);
+}
+
+void
+AudioFrameResizerTest::testByReference()
+{
+    // no callback, a frame of the output size goes through without a copy
+    q_.reset(new AudioFrameResizer(format_, outputSize_));
+    auto in = getNumberedFrame(outputSize_, 0);
+    auto inPtr = in.get();
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(std::move(in)));
+    CPPUNIT_ASSERT(q_->samples() == outputSize_);
+    auto out = q_->dequeue();
+    CPPUNIT_ASSERT(out.get() == inPtr);
+    CPPUNIT_ASSERT(q_->samples() == 0);
+    CPPUNIT_ASSERT(!q_->dequeue());
+}
+
+void
+AudioFrameResizerTest::testMixedQueue()
+{
+    // frames kept by reference and copied samples come out in order
+    q_.reset(new AudioFrameResizer(format_, outputSize_));
+    auto half = outputSize_ / 2;
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(getNumberedFrame(half, 0)));
+    auto copied = getNumberedFrame(half, half);
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(*copied));
+    // queued after copied samples, so copied too
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(getNumberedFrame(outputSize_, outputSize_)));
+    CPPUNIT_ASSERT(q_->samples() == 2 * outputSize_);
+
+    auto out = q_->dequeue();
+    CPPUNIT_ASSERT(out && out->pointer()->nb_samples == outputSize_);
+    CPPUNIT_ASSERT(isNumbered(*out, outputSize_, 0));
+    auto buffer = getFrame(outputSize_);
+    CPPUNIT_ASSERT(q_->dequeue(*buffer, outputSize_));
+    CPPUNIT_ASSERT(isNumbered(*buffer, outputSize_, outputSize_));
+    CPPUNIT_ASSERT(q_->samples() == 0);
+
+    // discard part of a frame kept by reference
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(getNumberedFrame(outputSize_, 0)));
+    CPPUNIT_ASSERT_NO_THROW(q_->enqueue(getNumberedFrame(outputSize_, outputSize_)));
+    q_->discard(half);
+    CPPUNIT_ASSERT(q_->samples() == 2 * outputSize_ - half);
+    out = q_->dequeue();
+    CPPUNIT_ASSERT(out && isNumbered(*out, outputSize_, half));
+    CPPUNIT_ASSERT(q_->samples() == outputSize_ - half);
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::AudioFrameResizerTest::name());
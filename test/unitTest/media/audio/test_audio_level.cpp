@@ -0,0 +1,268 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "media/audio/audio_level.h"
+#include "media/transport_cc.h"
+#include "media/rtp_header_extension.h"
+
+#include "../../test_runner.h"
+
+#include <vector>
+
+namespace jami { namespace test {
+
+using clock = std::chrono::steady_clock;
+using namespace std::literals::chrono_literals;
+
+class AudioLevelTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "audio_level"; }
+
+private:
+    void testLevelFromRms();
+    void testHeaderExtension();
+    void testVoiceHysteresis();
+    void testDominantSpeaker();
+    void testStaleAndVoiceOnlyStreams();
+
+    CPPUNIT_TEST_SUITE(AudioLevelTest);
+    CPPUNIT_TEST(testLevelFromRms);
+    CPPUNIT_TEST(testHeaderExtension);
+    CPPUNIT_TEST(testVoiceHysteresis);
+    CPPUNIT_TEST(testDominantSpeaker);
+    CPPUNIT_TEST(testStaleAndVoiceOnlyStreams);
+    CPPUNIT_TEST_SUITE_END();
+
+    /**
+     * Feed the detector with one level every 20ms for the given duration.
+     * @return true if any update reported a change
+     */
+    bool feed(ActiveSpeakerDetector& detector,
+              const std::vector<std::pair<std::string, AudioLevel>>& levels,
+              clock::duration duration);
+
+    clock::time_point now_ {clock::now()};
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(AudioLevelTest, AudioLevelTest::name());
+
+// RTP header followed by a payload
+static std::vector<uint8_t>
+rtpPacket(size_t payloadSize)
+{
+    std::vector<uint8_t> packet(12 + payloadSize);
+    packet[0] = 0x80;
+    packet[1] = 111;
+    packet[2] = 0x12;
+    packet[3] = 0x34;
+    for (size_t i = 0; i < payloadSize; ++i)
+        packet[12 + i] = static_cast<uint8_t>(i);
+    return packet;
+}
+
+bool
+AudioLevelTest::feed(ActiveSpeakerDetector& detector,
+                     const std::vector<std::pair<std::string, AudioLevel>>& levels,
+                     clock::duration duration)
+{
+    bool changed = false;
+    for (auto end = now_ + duration; now_ < end; now_ += 20ms)
+        for (const auto& [id, level] : levels)
+            changed |= detector.onLevel(id, level, now_);
+    return changed;
+}
+
+void
+AudioLevelTest::testLevelFromRms()
+{
+    CPPUNIT_ASSERT_EQUAL(uint8_t(0), audioLevelFromRms(1.f));
+    CPPUNIT_ASSERT_EQUAL(uint8_t(0), audioLevelFromRms(2.f));
+    CPPUNIT_ASSERT_EQUAL(uint8_t(20), audioLevelFromRms(.1f));
+    CPPUNIT_ASSERT_EQUAL(uint8_t(40), audioLevelFromRms(.01f));
+    CPPUNIT_ASSERT_EQUAL(AUDIO_LEVEL_SILENCE, audioLevelFromRms(0.f));
+    CPPUNIT_ASSERT_EQUAL(AUDIO_LEVEL_SILENCE, audioLevelFromRms(1e-9f));
+}
+
+void
+AudioLevelTest::testHeaderExtension()
+{
+    auto packet = rtpPacket(100);
+    CPPUNIT_ASSERT(not readAudioLevel(packet.data(), packet.size()));
+
+    // New header extension
+    std::vector<uint8_t> withLevel(packet.size() + RTP_EXTENSION_HEADER_SIZE + AUDIO_LEVEL_EXTENSION_SIZE);
+    auto len = addAudioLevel(withLevel.data(), withLevel.size(), packet.data(), packet.size(), {42, true});
+    CPPUNIT_ASSERT_EQUAL(int(withLevel.size()), len);
+    auto level = readAudioLevel(withLevel.data(), len);
+    CPPUNIT_ASSERT(level);
+    CPPUNIT_ASSERT_EQUAL(uint8_t(42), level->level);
+    CPPUNIT_ASSERT(level->voice);
+    // Payload moved after the extension
+    CPPUNIT_ASSERT(std::equal(packet.begin() + 12, packet.end(), withLevel.begin() + 20));
+
+    // Too small
+    CPPUNIT_ASSERT_EQUAL(-1, addAudioLevel(withLevel.data(), packet.size(), packet.data(), packet.size(), {}));
+
+    // Existing extension, as the one carrying abs-send-time (ID 3)
+    auto absSendTime = rtpPacket(100);
+    absSendTime[0] |= 0x10;
+    const uint8_t extension[] {0xBE, 0xDE, 0x00, 0x01, 0x32, 0x01, 0x02, 0x03};
+    absSendTime.insert(absSendTime.begin() + 12, std::begin(extension), std::end(extension));
+    std::vector<uint8_t> both(absSendTime.size() + AUDIO_LEVEL_EXTENSION_SIZE + TRANSPORT_CC_EXTENSION_SIZE);
+    len = addAudioLevel(both.data(), both.size(), absSendTime.data(), absSendTime.size(), {127, false});
+    CPPUNIT_ASSERT_EQUAL(int(absSendTime.size() + AUDIO_LEVEL_EXTENSION_SIZE), len);
+    // abs-send-time stays first, where the receiver expects it
+    CPPUNIT_ASSERT(std::equal(both.begin(), both.begin() + 12 + 2, absSendTime.begin()));
+    CPPUNIT_ASSERT(std::equal(both.begin() + 16, both.begin() + 20, absSendTime.begin() + 16));
+
+    // Along with the transport-wide sequence number
+    std::vector<uint8_t> out(both.size());
+    len = addTransportSequence(out.data(), out.size(), both.data(), len, 4242);
+    CPPUNIT_ASSERT_EQUAL(int(out.size()), len);
+    level = readAudioLevel(out.data(), len);
+    CPPUNIT_ASSERT(level);
+    CPPUNIT_ASSERT_EQUAL(uint8_t(127), level->level);
+    CPPUNIT_ASSERT(not level->voice);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(4242), *readTransportSequence(out.data(), len));
+    CPPUNIT_ASSERT(std::equal(packet.begin() + 12, packet.end(), out.end() - 100));
+
+    // Both elements on a packet sent by libav, which carries no extension:
+    // the extension header is only counted once
+    std::vector<uint8_t> sent(packet.size() + RTP_EXTENSION_HEADER_SIZE
+                              + AUDIO_LEVEL_EXTENSION_SIZE + TRANSPORT_CC_EXTENSION_SIZE);
+    len = addAudioLevel(sent.data(), sent.size(), packet.data(), packet.size(), {42, true});
+    CPPUNIT_ASSERT(len > 0);
+    std::vector<uint8_t> numbered(sent.size());
+    len = addTransportSequence(numbered.data(), numbered.size(), sent.data(), len, 1);
+    CPPUNIT_ASSERT_EQUAL(int(numbered.size()), len);
+}
+
+void
+AudioLevelTest::testVoiceHysteresis()
+{
+    ActiveSpeakerDetector detector;
+    CPPUNIT_ASSERT(not detector.isSpeaking("a"));
+
+    // Background noise
+    CPPUNIT_ASSERT(not feed(detector, {{"a", {65, false}}}, 1s));
+    CPPUNIT_ASSERT(not *detector.isSpeaking("a"));
+    CPPUNIT_ASSERT(detector.reportsLevels("a"));
+
+    // Speech
+    CPPUNIT_ASSERT(feed(detector, {{"a", {25, true}}}, 200ms));
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+
+    // Quieter speech, between both thresholds, keeps speaking
+    CPPUNIT_ASSERT(not feed(detector, {{"a", {50, false}}}, 1s));
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+
+    // A short pause is bridged
+    CPPUNIT_ASSERT(not feed(detector, {{"a", {90, false}}}, 200ms));
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+    CPPUNIT_ASSERT(not feed(detector, {{"a", {25, true}}}, 200ms));
+
+    // Silence
+    CPPUNIT_ASSERT(feed(detector, {{"a", {90, false}}}, 1s));
+    CPPUNIT_ASSERT(not *detector.isSpeaking("a"));
+    // Stays dominant while nobody else speaks
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+
+    // Quiet voice only counts when flagged by the sender
+    CPPUNIT_ASSERT(not feed(detector, {{"a", {50, false}}}, 1s));
+    CPPUNIT_ASSERT(not *detector.isSpeaking("a"));
+    CPPUNIT_ASSERT(feed(detector, {{"a", {50, true}}}, 1s));
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+}
+
+void
+AudioLevelTest::testDominantSpeaker()
+{
+    ActiveSpeakerDetector detector;
+    feed(detector, {{"a", {30, true}}, {"b", {90, false}}, {"c", {90, false}}}, 2s);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+
+    // Talking over with a similar level doesn't take over
+    feed(detector, {{"a", {30, true}}, {"b", {28, true}}}, 3s);
+    CPPUNIT_ASSERT(*detector.isSpeaking("b"));
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+
+    // A short loud interjection neither
+    feed(detector, {{"a", {30, true}}, {"c", {10, true}}}, 100ms);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+    feed(detector, {{"a", {30, true}}, {"b", {90, false}}, {"c", {90, false}}}, 2s);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+
+    // Once a stops, b takes over
+    feed(detector, {{"a", {90, false}}, {"b", {35, true}}}, 2s);
+    CPPUNIT_ASSERT_EQUAL(std::string("b"), detector.dominant());
+
+    // No switch before the dwell time, even for a louder speaker
+    feed(detector, {{"a", {90, false}}, {"b", {90, false}}, {"c", {90, false}}}, 1s);
+    feed(detector, {{"b", {90, false}}, {"c", {90, false}}}, 1s);
+    for (auto end = now_ + 2s; detector.dominant() != "a" and now_ < end;)
+        feed(detector, {{"a", {20, true}}, {"b", {40, true}}}, 20ms);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+    feed(detector, {{"a", {90, false}}, {"b", {90, false}}, {"c", {10, true}}}, 1s);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), detector.dominant());
+    feed(detector, {{"a", {90, false}}, {"b", {90, false}}, {"c", {10, true}}}, 1s);
+    CPPUNIT_ASSERT_EQUAL(std::string("c"), detector.dominant());
+
+    // Leaving
+    CPPUNIT_ASSERT(detector.remove("c"));
+    CPPUNIT_ASSERT(detector.dominant().empty());
+    CPPUNIT_ASSERT(not detector.isSpeaking("c"));
+}
+
+void
+AudioLevelTest::testStaleAndVoiceOnlyStreams()
+{
+    ActiveSpeakerDetector detector;
+
+    // A peer not sending levels
+    CPPUNIT_ASSERT(detector.onVoice("host", true, now_));
+    CPPUNIT_ASSERT(*detector.isSpeaking("host"));
+    CPPUNIT_ASSERT(not detector.reportsLevels("host"));
+    CPPUNIT_ASSERT_EQUAL(std::string("host"), detector.dominant());
+
+    // A speaking peer stops sending (discontinuous transmission)
+    feed(detector, {{"a", {20, true}}}, 2s);
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+    CPPUNIT_ASSERT(not detector.onVoice("a", false, now_));
+    CPPUNIT_ASSERT(*detector.isSpeaking("a"));
+    CPPUNIT_ASSERT(detector.onVoice("host", false, now_));
+    now_ += ActiveSpeakerDetector::STALE_AFTER + 20ms;
+    CPPUNIT_ASSERT(detector.process(now_));
+    CPPUNIT_ASSERT(not *detector.isSpeaking("a"));
+
+    // Participants who left
+    CPPUNIT_ASSERT(detector.onVoice("b", true, now_));
+    CPPUNIT_ASSERT(detector.retainVoiceStreams({"host"}));
+    CPPUNIT_ASSERT(not detector.isSpeaking("b"));
+    CPPUNIT_ASSERT(detector.isSpeaking("host"));
+    CPPUNIT_ASSERT(detector.isSpeaking("a"));
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::AudioLevelTest::name());
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "media/audio/audio-processing/null_audio_processor.h"
+#include "media/libav_deps.h"
+#include "media/libav_utils.h"
+#include "media/media_buffer.h"
+
+#include "../../../test_runner.h"
+
+#include <algorithm>
+
+namespace jami {
+namespace test {
+
+class AudioProcessorTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "audio_processor"; }
+
+private:
+    void testNativeFormat();
+    void testResampled();
+
+    std::shared_ptr<AudioFrame> getFrame(const AudioFormat& format, int n);
+
+    CPPUNIT_TEST_SUITE(AudioProcessorTest);
+    CPPUNIT_TEST(testNativeFormat);
+    CPPUNIT_TEST(testResampled);
+    CPPUNIT_TEST_SUITE_END();
+
+    AudioFormat format_ = AudioFormat::STEREO();
+    unsigned frameSize_ = 480;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(AudioProcessorTest, AudioProcessorTest::name());
+
+std::shared_ptr<AudioFrame>
+AudioProcessorTest::getFrame(const AudioFormat& format, int n)
+{
+    auto frame = std::make_shared<AudioFrame>(format, n);
+    libav_utils::fillWithSilence(frame->pointer());
+    return frame;
+}
+
+void
+AudioProcessorTest::testNativeFormat()
+{
+    // Frames of the processing size and format reach the processor as is
+    NullAudioProcessor processor(format_, frameSize_);
+    processor.putRecorded(getFrame(format_, frameSize_)); // dropped, no playback yet
+    processor.putPlayback(getFrame(format_, frameSize_));
+    auto recorded = getFrame(format_, frameSize_);
+    auto recordedPtr = recorded.get();
+    processor.putRecorded(std::move(recorded));
+
+    auto out = processor.getProcessed();
+    CPPUNIT_ASSERT(out.get() == recordedPtr);
+    CPPUNIT_ASSERT(!processor.getProcessed());
+}
+
+void
+AudioProcessorTest::testResampled()
+{
+    // Frames in another format are resampled and resized
+    const AudioFormat inFormat(16000, 1);
+    NullAudioProcessor processor(format_, frameSize_);
+    processor.putRecorded(getFrame(inFormat, 160));
+    std::vector<AudioFrame*> recorded;
+    for (int i = 0; i < 10; ++i) {
+        processor.putPlayback(getFrame(format_, frameSize_));
+        auto frame = getFrame(inFormat, 160);
+        recorded.emplace_back(frame.get());
+        processor.putRecorded(std::move(frame));
+    }
+
+    auto out = processor.getProcessed();
+    CPPUNIT_ASSERT(out);
+    CPPUNIT_ASSERT(out->getFormat() == format_);
+    CPPUNIT_ASSERT(out->pointer()->nb_samples == (int) frameSize_);
+    CPPUNIT_ASSERT(std::find(recorded.begin(), recorded.end(), out.get()) == recorded.end());
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::AudioProcessorTest::name());
@@ -0,0 +1,274 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "media/congestion_control.h"
+#include "media/paced_sender.h"
+#include "media/rtp_header_extension.h"
+#include "media/transport_cc.h"
+
+#include "../../test_runner.h"
+
+#include <deque>
+#include <random>
+
+namespace jami { namespace test {
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * Simulated path: a bottleneck link with a drop-tail queue, a propagation
+ * delay and random losses, fed by a paced video sender. Time is virtual
+ * and advances by steps of 1ms.
+ */
+class LinkSimulation
+{
+public:
+    static constexpr size_t PACKET_SIZE = 1200;
+    static constexpr uint32_t SSRC = 0x12345678;
+
+    LinkSimulation(uint64_t capacityBps, float lossRate = 0.f)
+        : capacityBps_(capacityBps)
+        , lossRate_(lossRate)
+        , epoch_(clock::now())
+        , builder_(epoch_)
+        , estimator_(START_BPS, 100000, 4000000)
+    {}
+
+    void setCapacity(uint64_t bps) { capacityBps_ = bps; }
+    void setLossRate(float rate) { lossRate_ = rate; }
+    uint64_t target() const { return target_; }
+
+    /**
+     * Run for the given duration.
+     * @return the average target over the last second
+     */
+    uint64_t run(std::chrono::milliseconds duration)
+    {
+        double sum = 0;
+        unsigned count = 0;
+        auto end = nowUs_ + duration.count() * 1000;
+        for (; nowUs_ < end; nowUs_ += 1000) {
+            step();
+            if (end - nowUs_ <= 1000000) {
+                sum += target_;
+                ++count;
+            }
+        }
+        return count ? sum / count : target_;
+    }
+
+private:
+    static constexpr uint64_t START_BPS = 500000;
+    static constexpr int64_t PROPAGATION_US = 20000;
+    static constexpr size_t QUEUE_LIMIT = 60000;
+
+    clock::time_point at(int64_t us) const { return epoch_ + std::chrono::microseconds(us); }
+
+    void step()
+    {
+        // Encoder: one frame every 33ms, at the current target
+        if (nowUs_ >= nextFrameUs_) {
+            nextFrameUs_ += 33333;
+            size_t frameBytes = target_ / 30 / 8;
+            for (size_t sent = 0; sent < frameBytes; sent += PACKET_SIZE)
+                queued_++;
+        }
+
+        // Pacer
+        while (queued_ and budget_.nextSend() <= at(nowUs_)) {
+            --queued_;
+            auto seq = seq_++;
+            estimator_.onPacketSent(seq, PACKET_SIZE, at(nowUs_));
+            budget_.onSent(PACKET_SIZE, at(nowUs_), target_ * 3 / 2);
+            transmit(seq);
+        }
+
+        // Receiver
+        while (not inFlight_.empty() and inFlight_.front().first <= nowUs_) {
+            builder_.onPacket(inFlight_.front().second, SSRC, at(inFlight_.front().first));
+            inFlight_.pop_front();
+        }
+        if (builder_.shouldSend(at(nowUs_))) {
+            auto packet = builder_.build(0, at(nowUs_));
+            if (auto feedback = parseTransportFeedback(packet.data(), packet.size()))
+                feedbacks_.emplace_back(nowUs_ + PROPAGATION_US, std::move(*feedback));
+        }
+
+        // Sender
+        while (not feedbacks_.empty() and feedbacks_.front().first <= nowUs_) {
+            estimator_.onFeedback(feedbacks_.front().second, at(nowUs_));
+            feedbacks_.pop_front();
+        }
+        if (nowUs_ % 200000 == 0)
+            target_ = estimator_.targetBitrate();
+    }
+
+    void transmit(uint16_t seq)
+    {
+        if (std::uniform_real_distribution<float>(0.f, 1.f)(rand_) < lossRate_)
+            return;
+        auto start = std::max(nowUs_, linkBusyUntilUs_);
+        if ((start - nowUs_) * static_cast<double>(capacityBps_) / 8e6 > QUEUE_LIMIT)
+            return; // Tail drop
+        linkBusyUntilUs_ = start + PACKET_SIZE * 8e6 / capacityBps_;
+        inFlight_.emplace_back(linkBusyUntilUs_ + PROPAGATION_US, seq);
+    }
+
+    uint64_t capacityBps_;
+    float lossRate_;
+    clock::time_point epoch_;
+    std::mt19937 rand_ {42};
+
+    TransportFeedbackBuilder builder_;
+    TransportBandwidthEstimator estimator_;
+    PacingBudget budget_;
+
+    int64_t nowUs_ {0};
+    int64_t nextFrameUs_ {0};
+    int64_t linkBusyUntilUs_ {0};
+    uint64_t target_ {START_BPS};
+    unsigned queued_ {0};
+    uint16_t seq_ {0};
+    std::deque<std::pair<int64_t, uint16_t>> inFlight_;
+    std::deque<std::pair<int64_t, TransportFeedback>> feedbacks_;
+};
+
+class CongestionControlTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "congestion_control"; }
+
+private:
+    void testSequenceExtension();
+    void testFeedback();
+    void testConvergence();
+    void testCapacityDrop();
+    void testLoss();
+
+    CPPUNIT_TEST_SUITE(CongestionControlTest);
+    CPPUNIT_TEST(testSequenceExtension);
+    CPPUNIT_TEST(testFeedback);
+    CPPUNIT_TEST(testConvergence);
+    CPPUNIT_TEST(testCapacityDrop);
+    CPPUNIT_TEST(testLoss);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CongestionControlTest, CongestionControlTest::name());
+
+void
+CongestionControlTest::testSequenceExtension()
+{
+    // RTP header without extension, followed by 4 bytes of payload
+    std::vector<uint8_t> rtp = {0x80, 96, 0, 1, 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78, 1, 2, 3, 4};
+    std::vector<uint8_t> out(rtp.size() + 16);
+    auto len = addTransportSequence(out.data(), out.size(), rtp.data(), rtp.size(), 0xABCD);
+    CPPUNIT_ASSERT(len == static_cast<int>(rtp.size() + RTP_EXTENSION_HEADER_SIZE + TRANSPORT_CC_EXTENSION_SIZE));
+    CPPUNIT_ASSERT(out[0] & 0x10);
+    CPPUNIT_ASSERT(*readTransportSequence(out.data(), len) == 0xABCD);
+    // payload is untouched
+    CPPUNIT_ASSERT(std::equal(rtp.begin() + 12, rtp.end(), out.begin() + len - 4));
+    CPPUNIT_ASSERT(not readTransportSequence(rtp.data(), rtp.size()));
+
+    // Appended to an existing extension, which stays first: only the
+    // element is added
+    std::vector<uint8_t> ext = {0x90, 96, 0, 1, 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78,
+                                0xBE, 0xDE, 0, 1, 0x32, 0xAA, 0xBB, 0xCC, 1, 2, 3, 4};
+    len = addTransportSequence(out.data(), out.size(), ext.data(), ext.size(), 7);
+    CPPUNIT_ASSERT(len == static_cast<int>(ext.size() + TRANSPORT_CC_EXTENSION_SIZE));
+    CPPUNIT_ASSERT(out[16] == 0x32 and out[17] == 0xAA);
+    CPPUNIT_ASSERT(*readTransportSequence(out.data(), len) == 7);
+    CPPUNIT_ASSERT(std::equal(ext.begin() + 20, ext.end(), out.begin() + len - 4));
+
+    // Doesn't fit
+    CPPUNIT_ASSERT(addTransportSequence(out.data(), ext.size(), ext.data(), ext.size(), 7) < 0);
+}
+
+void
+CongestionControlTest::testFeedback()
+{
+    auto epoch = clock::now();
+    TransportFeedbackBuilder builder(epoch);
+    // Packets 65530 to 65545 (wrapping), 65533 and 65540 lost
+    for (uint32_t i = 65530; i < 65546; ++i) {
+        if (i == 65533 or i == 65540)
+            continue;
+        builder.onPacket(i & 0xFFFF, 0xCAFE, epoch + std::chrono::milliseconds(i - 65530));
+    }
+    auto now = epoch + std::chrono::milliseconds(100);
+    CPPUNIT_ASSERT(builder.shouldSend(now));
+    auto packet = builder.build(0xBEEF, now);
+    CPPUNIT_ASSERT(packet.size() % 4 == 0);
+    CPPUNIT_ASSERT(packet[1] == 205 and (packet[0] & 0x1F) == 15);
+    CPPUNIT_ASSERT(not builder.shouldSend(now));
+
+    auto feedback = parseTransportFeedback(packet.data(), packet.size());
+    CPPUNIT_ASSERT(feedback);
+    CPPUNIT_ASSERT(feedback->mediaSsrc == 0xCAFE);
+    CPPUNIT_ASSERT(feedback->packets.size() == 16);
+    for (uint32_t i = 0; i < 16; ++i) {
+        const auto& p = feedback->packets[i];
+        CPPUNIT_ASSERT(p.seq == ((65530 + i) & 0xFFFF));
+        CPPUNIT_ASSERT(p.received == (i != 3 and i != 10));
+        if (p.received && i > 0)
+            CPPUNIT_ASSERT(p.arrivalUs - feedback->packets[0].arrivalUs == i * 1000);
+    }
+
+    // Truncated packets are rejected
+    CPPUNIT_ASSERT(not parseTransportFeedback(packet.data(), 12));
+}
+
+void
+CongestionControlTest::testConvergence()
+{
+    LinkSimulation sim(1000000);
+    auto target = sim.run(std::chrono::seconds(20));
+    CPPUNIT_ASSERT_MESSAGE(std::to_string(target), target > 600000 and target < 1150000);
+}
+
+void
+CongestionControlTest::testCapacityDrop()
+{
+    LinkSimulation sim(2000000);
+    auto target = sim.run(std::chrono::seconds(20));
+    CPPUNIT_ASSERT_MESSAGE(std::to_string(target), target > 1200000);
+    sim.setCapacity(500000);
+    sim.run(std::chrono::seconds(3));
+    CPPUNIT_ASSERT_MESSAGE(std::to_string(sim.target()), sim.target() < 600000);
+}
+
+void
+CongestionControlTest::testLoss()
+{
+    // Random losses below the threshold don't collapse the rate
+    LinkSimulation sim(2000000, 0.01f);
+    auto target = sim.run(std::chrono::seconds(20));
+    CPPUNIT_ASSERT_MESSAGE(std::to_string(target), target > 1200000);
+
+    // Heavy losses reduce it
+    sim.setLossRate(0.2f);
+    auto lossy = sim.run(std::chrono::seconds(5));
+    CPPUNIT_ASSERT_MESSAGE(std::to_string(lossy), lossy < target * 0.7);
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::CongestionControlTest::name());
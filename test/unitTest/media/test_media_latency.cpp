@@ -0,0 +1,135 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include "media/media_latency.h"
+
+#include "../../test_runner.h"
+
+#include <limits>
+#include <thread>
+
+namespace jami { namespace test {
+
+class MediaLatencyTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "media_latency"; }
+
+private:
+    void testHistogram();
+    void testStamp();
+    void testStats();
+
+    CPPUNIT_TEST_SUITE(MediaLatencyTest);
+    CPPUNIT_TEST(testHistogram);
+    CPPUNIT_TEST(testStamp);
+    CPPUNIT_TEST(testStats);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(MediaLatencyTest, MediaLatencyTest::name());
+
+void
+MediaLatencyTest::testHistogram()
+{
+    LatencyHistogram h;
+    CPPUNIT_ASSERT(h.summary().count == 0);
+
+    for (uint32_t i = 1; i <= 10000; ++i)
+        h.record(i);
+    auto s = h.summary();
+    CPPUNIT_ASSERT(s.count == 10000);
+    CPPUNIT_ASSERT(s.max == 10000);
+    CPPUNIT_ASSERT(s.mean == 5000);
+    // bucket resolution is ~12%
+    CPPUNIT_ASSERT(s.p50 > 4400 && s.p50 < 5600);
+    CPPUNIT_ASSERT(s.p99 > 8700 && s.p99 <= 10000);
+
+    // small values are exact
+    h.reset();
+    CPPUNIT_ASSERT(h.summary().count == 0);
+    for (int i = 0; i < 100; ++i)
+        h.record(7);
+    s = h.summary();
+    CPPUNIT_ASSERT(s.p50 == 7 && s.p99 == 7 && s.max == 7);
+
+    // extreme values do not overflow the bucket array
+    h.record(std::numeric_limits<uint32_t>::max());
+    CPPUNIT_ASSERT(h.summary().max == std::numeric_limits<uint32_t>::max());
+}
+
+void
+MediaLatencyTest::testStamp()
+{
+    AVFrame* frame = av_frame_alloc();
+    CPPUNIT_ASSERT(!latency::elapsedUs(frame));
+
+    latency::stamp(frame);
+    auto first = frame->opaque;
+    CPPUNIT_ASSERT(latency::elapsedUs(frame));
+
+    // an existing stamp is kept unless asked otherwise
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    latency::stamp(frame);
+    CPPUNIT_ASSERT(frame->opaque == first);
+    CPPUNIT_ASSERT(*latency::elapsedUs(frame) >= 2000);
+    latency::stamp(frame, true);
+    CPPUNIT_ASSERT(*latency::elapsedUs(frame) < 2000);
+
+    // the stamp follows frame references
+    AVFrame* ref = av_frame_alloc();
+    av_frame_ref(ref, frame);
+    CPPUNIT_ASSERT(ref->opaque == frame->opaque);
+
+    av_frame_free(&ref);
+    av_frame_free(&frame);
+}
+
+void
+MediaLatencyTest::testStats()
+{
+    MediaLatencyStats stats;
+    CPPUNIT_ASSERT(stats.toMaps().empty());
+
+    stats.recordSend(std::nullopt, 100);
+    auto maps = stats.toMaps();
+    CPPUNIT_ASSERT(maps.size() == 1);
+    CPPUNIT_ASSERT(maps[0]["stage"] == "encode");
+
+    stats.recordSend(1000, 100);
+    stats.recordReceive(300, 1300);
+    CPPUNIT_ASSERT(stats.toMaps().size() == 6);
+    CPPUNIT_ASSERT(
+        stats.histogram(MediaLatencyStats::Stage::CaptureToSend).summary().max == 1100);
+    CPPUNIT_ASSERT(
+        stats.histogram(MediaLatencyStats::Stage::DecodeToRender).summary().max == 1000);
+
+    stats.reset();
+    CPPUNIT_ASSERT(stats.toMaps().empty());
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::MediaLatencyTest::name());
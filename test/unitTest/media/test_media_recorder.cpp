@@ -0,0 +1,176 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "media/libav_deps.h"
+#include "media/media_buffer.h"
+#include "media/media_recorder.h"
+#include "media/media_stream.h"
+
+#include <dhtnet/fileutils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include "../../test_runner.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class MediaRecorderTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "media_recorder"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testRecordAudio();
+    void testBoundedQueue();
+    void testStopWhileQueued();
+
+    CPPUNIT_TEST_SUITE(MediaRecorderTest);
+    CPPUNIT_TEST(testRecordAudio);
+    CPPUNIT_TEST(testBoundedQueue);
+    CPPUNIT_TEST(testStopWhileQueued);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::shared_ptr<MediaRecorder> recorder_;
+    std::string path_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(MediaRecorderTest, MediaRecorderTest::name());
+
+void
+MediaRecorderTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+    libav_utils::av_init();
+    recorder_ = std::make_shared<MediaRecorder>();
+    path_ = (std::filesystem::current_path() / "test_media_recorder").string();
+    recorder_->setPath(path_);
+}
+
+void
+MediaRecorderTest::tearDown()
+{
+    if (recorder_->isRecording())
+        recorder_->stopRecording();
+    dhtnet::fileutils::remove(recorder_->getPath());
+    recorder_.reset();
+    libjami::fini();
+}
+
+static std::shared_ptr<MediaFrame>
+audioFrame()
+{
+    auto frame = std::make_shared<AudioFrame>(AudioFormat::STEREO(), 960);
+    std::fill_n(frame->pointer()->data[0], frame->pointer()->linesize[0], 0);
+    return frame;
+}
+
+void
+MediaRecorderTest::testRecordAudio()
+{
+    recorder_->audioOnly(true);
+    auto stream = recorder_->addStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(stream);
+    CPPUNIT_ASSERT(recorder_->startRecording() >= 0);
+    CPPUNIT_ASSERT(recorder_->isRecording());
+
+    // Producers only queue the frames, at the pace of a real source
+    constexpr unsigned FRAMES = 50;
+    for (unsigned i = 0; i < FRAMES; ++i) {
+        stream->update(nullptr, audioFrame());
+        std::this_thread::sleep_for(20ms);
+    }
+    auto stats = recorder_->getStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(FRAMES), stats.received);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.droppedVideo);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.droppedAudio);
+
+    recorder_->stopRecording();
+    recorder_->removeStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(std::filesystem::is_regular_file(recorder_->getPath()));
+    CPPUNIT_ASSERT(std::filesystem::file_size(recorder_->getPath()) > 0);
+}
+
+void
+MediaRecorderTest::testBoundedQueue()
+{
+    recorder_->audioOnly(true);
+    auto stream = recorder_->addStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(recorder_->startRecording() >= 0);
+
+    // A burst far larger than the queue: producers are never blocked, the
+    // oldest frames are dropped and the queue stays bounded
+    constexpr unsigned FRAMES = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < FRAMES; ++i)
+        stream->update(nullptr, audioFrame());
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - start < 5s);
+
+    auto stats = recorder_->getStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(FRAMES), stats.received);
+    CPPUNIT_ASSERT(stats.maxQueued <= 64);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.droppedVideo);
+    recorder_->stopRecording();
+    recorder_->removeStream(MediaStream("a:local", AudioFormat::STEREO()));
+
+    // Frames received while not recording are ignored
+    auto before = recorder_->getStats().received;
+    stream = recorder_->addStream(MediaStream("a:local", AudioFormat::STEREO()));
+    stream->update(nullptr, audioFrame());
+    CPPUNIT_ASSERT_EQUAL(before, recorder_->getStats().received);
+}
+
+void
+MediaRecorderTest::testStopWhileQueued()
+{
+    recorder_->audioOnly(true);
+    auto stream = recorder_->addStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(recorder_->startRecording() >= 0);
+    for (unsigned i = 0; i < 64; ++i)
+        stream->update(nullptr, audioFrame());
+
+    // Stopping with frames still queued must neither hang nor crash, and the
+    // recorder can record again
+    recorder_->stopRecording();
+    recorder_->removeStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(not recorder_->isRecording());
+
+    stream = recorder_->addStream(MediaStream("a:local", AudioFormat::STEREO()));
+    CPPUNIT_ASSERT(recorder_->startRecording() >= 0);
+    stream->update(nullptr, audioFrame());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), recorder_->getStats().received);
+    recorder_->stopRecording();
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::MediaRecorderTest::name());
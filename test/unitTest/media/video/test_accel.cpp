@@ -0,0 +1,171 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "logger.h"
+#include "media/video/accel.h"
+
+#include "../../../test_runner.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami { namespace video { namespace test {
+
+class AccelTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "accel"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testProbeFailure();
+    void testDeviceCache();
+    void testPrewarmKeepsDevices();
+
+    CPPUNIT_TEST_SUITE(AccelTest);
+    CPPUNIT_TEST(testProbeFailure);
+    CPPUNIT_TEST(testDeviceCache);
+    CPPUNIT_TEST(testPrewarmKeepsDevices);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(AccelTest, AccelTest::name());
+
+static constexpr auto TIMEOUT = 100ms;
+
+static bool
+contains(const std::list<HardwareAccel>& accels, const std::string& name)
+{
+    return std::find_if(accels.begin(), accels.end(), [&](const auto& accel) {
+               return accel.getName() == name;
+           })
+           != accels.end();
+}
+
+void
+AccelTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+    HardwareAccel::setTimeouts(TIMEOUT, TIMEOUT);
+}
+
+void
+AccelTest::tearDown()
+{
+    HardwareAccel::releaseDevices();
+    HardwareAccel::setTimeouts(std::chrono::minutes(2), std::chrono::minutes(5));
+    libjami::fini();
+}
+
+void
+AccelTest::testProbeFailure()
+{
+    auto accels = HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER);
+    if (accels.empty()) {
+        JAMI_WARN("No hardware API built in, skipping");
+        return;
+    }
+    auto name = accels.front().getName();
+
+    // A failure is remembered for this resolution only
+    accels.front().setUsable(false);
+    CPPUNIT_ASSERT(
+        not contains(HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER),
+                     name));
+    CPPUNIT_ASSERT(
+        contains(HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 1280, 720, CODEC_DECODER),
+                 name));
+
+    // And is forgotten once expired
+    std::this_thread::sleep_for(TIMEOUT + 50ms);
+    accels = HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER);
+    CPPUNIT_ASSERT(contains(accels, name));
+
+    // An API known to work is tried first
+    auto& accel = *std::find_if(accels.begin(), accels.end(), [&](const auto& accel) {
+        return accel.getName() == name;
+    });
+    accel.setUsable(true);
+    accels = HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER);
+    CPPUNIT_ASSERT(accels.front().getName() == name);
+}
+
+void
+AccelTest::testDeviceCache()
+{
+    auto before = HardwareAccel::deviceCount();
+    {
+        auto first = HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER);
+        auto it = std::find_if(first.begin(), first.end(), [](auto& accel) {
+            return accel.initAPI(false, nullptr) == 0;
+        });
+        if (it == first.end()) {
+            JAMI_WARN("No hardware device available, skipping");
+            return;
+        }
+        CPPUNIT_ASSERT(HardwareAccel::deviceCount() == before + 1);
+
+        // A second codec shares the device
+        auto second = HardwareAccel::getCompatibleAccel(AV_CODEC_ID_H264, 640, 480, CODEC_DECODER);
+        for (auto& accel : second) {
+            if (accel.getName() == it->getName())
+                CPPUNIT_ASSERT(accel.initAPI(false, nullptr) == 0);
+        }
+        CPPUNIT_ASSERT(HardwareAccel::deviceCount() == before + 1);
+    }
+
+    // Closed once no codec used it for the idle timeout
+    HardwareAccel::releaseIdleDevices();
+    CPPUNIT_ASSERT(HardwareAccel::deviceCount() == before + 1);
+    std::this_thread::sleep_for(TIMEOUT + 50ms);
+    HardwareAccel::releaseIdleDevices();
+    CPPUNIT_ASSERT(HardwareAccel::deviceCount() == before);
+}
+
+void
+AccelTest::testPrewarmKeepsDevices()
+{
+    HardwareAccel::prewarm({AV_CODEC_ID_H264}, true, false, 640, 480);
+    auto kept = HardwareAccel::deviceCount();
+    if (kept == 0) {
+        JAMI_WARN("No hardware decoder available, skipping");
+        return;
+    }
+
+    // Prewarmed devices outlive the idle timeout
+    std::this_thread::sleep_for(TIMEOUT + 50ms);
+    HardwareAccel::releaseIdleDevices();
+    CPPUNIT_ASSERT(HardwareAccel::deviceCount() == kept);
+
+    // Until no account needs them anymore
+    HardwareAccel::prewarm({}, true, false, 640, 480);
+    std::this_thread::sleep_for(TIMEOUT + 50ms);
+    HardwareAccel::releaseIdleDevices();
+    CPPUNIT_ASSERT(HardwareAccel::deviceCount() == 0);
+}
+
+}}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::video::test::AccelTest::name());
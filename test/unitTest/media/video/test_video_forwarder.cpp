@@ -0,0 +1,291 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "media/video/video_forwarder.h"
+
+#include "../../../test_runner.h"
+
+#include <map>
+#include <vector>
+
+namespace jami { namespace video { namespace test {
+
+struct Packet
+{
+    uint8_t pt;
+    uint16_t seq;
+    uint32_t ts;
+    uint32_t ssrc;
+    std::vector<uint8_t> payload;
+};
+
+static std::vector<uint8_t>
+makePacket(uint8_t pt, uint16_t seq, uint32_t ts, uint32_t ssrc, std::vector<uint8_t> payload)
+{
+    std::vector<uint8_t> p {0x80, pt,
+                            uint8_t(seq >> 8), uint8_t(seq),
+                            uint8_t(ts >> 24), uint8_t(ts >> 16), uint8_t(ts >> 8), uint8_t(ts),
+                            uint8_t(ssrc >> 24), uint8_t(ssrc >> 16), uint8_t(ssrc >> 8), uint8_t(ssrc)};
+    p.insert(p.end(), payload.begin(), payload.end());
+    return p;
+}
+
+static Packet
+parsePacket(const uint8_t* p, size_t len)
+{
+    return {uint8_t(p[1] & 0x7f),
+            uint16_t(p[2] << 8 | p[3]),
+            uint32_t(p[4]) << 24 | uint32_t(p[5]) << 16 | uint32_t(p[6]) << 8 | p[7],
+            uint32_t(p[8]) << 24 | uint32_t(p[9]) << 16 | uint32_t(p[10]) << 8 | p[11],
+            std::vector<uint8_t>(p + 12, p + len)};
+}
+
+// H.264 single NAL units
+static const std::vector<uint8_t> IDR {0x65, 0x88, 0x84};
+static const std::vector<uint8_t> NON_IDR {0x41, 0x9a, 0x02};
+
+class VideoForwarderTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "video_forwarder"; }
+
+    void setUp();
+
+private:
+    void testRouting();
+    void testSwitch();
+    void testCodecMismatch();
+    void testRemove();
+    void testHeaderExtension();
+    void testReentrantSink();
+
+    void add(const std::string& id, const std::string& codec = "H264", uint8_t pt = 96);
+    void send(const std::string& id, uint16_t seq, uint32_t ts, const std::vector<uint8_t>& payload);
+
+    CPPUNIT_TEST_SUITE(VideoForwarderTest);
+    CPPUNIT_TEST(testRouting);
+    CPPUNIT_TEST(testSwitch);
+    CPPUNIT_TEST(testCodecMismatch);
+    CPPUNIT_TEST(testRemove);
+    CPPUNIT_TEST(testHeaderExtension);
+    CPPUNIT_TEST(testReentrantSink);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::unique_ptr<VideoForwarder> forwarder_;
+    std::map<std::string, std::vector<Packet>> received_;
+    std::map<std::string, unsigned> keyFrameRequests_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(VideoForwarderTest, VideoForwarderTest::name());
+
+void
+VideoForwarderTest::setUp()
+{
+    forwarder_ = std::make_unique<VideoForwarder>("conf");
+    received_.clear();
+    keyFrameRequests_.clear();
+}
+
+void
+VideoForwarderTest::add(const std::string& id, const std::string& codec, uint8_t pt)
+{
+    VideoForwarder::LegParams params;
+    params.codec = codec;
+    params.payloadType = pt;
+    params.initialSeq = 1000;
+    forwarder_->addParticipant(
+        id,
+        params,
+        [this, id](uint8_t* buf, size_t len) { received_[id].emplace_back(parsePacket(buf, len)); },
+        [this, id] { keyFrameRequests_[id]++; });
+}
+
+void
+VideoForwarderTest::send(const std::string& id,
+                         uint16_t seq,
+                         uint32_t ts,
+                         const std::vector<uint8_t>& payload)
+{
+    auto ssrc = static_cast<uint32_t>(std::hash<std::string> {}(id));
+    auto packet = makePacket(100, seq, ts, ssrc, payload);
+    forwarder_->onPacket(id, packet.data(), packet.size());
+}
+
+void
+VideoForwarderTest::testRouting()
+{
+    add("a");
+    add("b", "H264", 97);
+    add("c");
+    forwarder_->setPriorities({"a"});
+
+    // Everybody sees "a", "a" sees somebody else
+    CPPUNIT_ASSERT(forwarder_->selectedSource("b") == "a");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("c") == "a");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("a") == "b");
+    CPPUNIT_ASSERT(keyFrameRequests_["a"] == 1);
+
+    // Nothing is forwarded before a key frame
+    send("a", 10, 9000, NON_IDR);
+    CPPUNIT_ASSERT(received_["b"].empty());
+    CPPUNIT_ASSERT(forwarder_->getStats().dropped == 2);
+
+    send("a", 11, 12000, IDR);
+    send("a", 12, 15000, NON_IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 2);
+    CPPUNIT_ASSERT(received_["c"].size() == 2);
+    CPPUNIT_ASSERT(received_["a"].empty());
+
+    // Headers are rewritten for each receiver, payload is untouched
+    const auto& b = received_["b"];
+    const auto& c = received_["c"];
+    CPPUNIT_ASSERT(b[0].pt == 97 && c[0].pt == 96);
+    CPPUNIT_ASSERT(b[0].seq == 1000 && b[1].seq == 1001);
+    CPPUNIT_ASSERT(b[1].ts - b[0].ts == 3000);
+    CPPUNIT_ASSERT(b[0].ssrc == b[1].ssrc && b[0].ssrc != c[0].ssrc);
+    CPPUNIT_ASSERT(b[0].payload == IDR && b[1].payload == NON_IDR);
+}
+
+void
+VideoForwarderTest::testSwitch()
+{
+    add("a");
+    add("b");
+    add("c");
+    forwarder_->setPriorities({"a"});
+    send("a", 10, 9000, IDR);
+    send("a", 11, 12000, NON_IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 2);
+    auto last = received_["b"].back();
+
+    forwarder_->setPriorities({"c"});
+    CPPUNIT_ASSERT(forwarder_->selectedSource("b") == "c");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("a") == "c");
+    // "c" keeps seeing "a" rather than switching for nothing
+    CPPUNIT_ASSERT(forwarder_->selectedSource("c") == "a");
+    CPPUNIT_ASSERT(keyFrameRequests_["c"] >= 1);
+
+    // Old source is not forwarded anymore, new one waits for a key frame
+    send("a", 12, 15000, NON_IDR);
+    send("c", 500, 123456, NON_IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 2);
+
+    // The stream continues where it stopped
+    send("c", 501, 126456, IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 3);
+    const auto& next = received_["b"].back();
+    CPPUNIT_ASSERT(next.seq == uint16_t(last.seq + 1));
+    CPPUNIT_ASSERT(int32_t(next.ts - last.ts) > 0);
+    CPPUNIT_ASSERT(next.ssrc == last.ssrc);
+    CPPUNIT_ASSERT(forwarder_->getStats().switches >= 5);
+}
+
+void
+VideoForwarderTest::testCodecMismatch()
+{
+    add("a");
+    add("b", "VP8");
+    forwarder_->setPriorities({"a"});
+    CPPUNIT_ASSERT(forwarder_->selectedSource("b").empty());
+    CPPUNIT_ASSERT(forwarder_->selectedSource("a").empty());
+
+    add("c", "VP8");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("b") == "c");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("c") == "b");
+
+    // VP8 key frame: start of partition 0, P bit cleared
+    auto ssrc = 1234u;
+    auto packet = makePacket(100, 1, 0, ssrc, {0x10, 0x00, 0x9d, 0x01, 0x2a});
+    forwarder_->onPacket("c", packet.data(), packet.size());
+    CPPUNIT_ASSERT(received_["b"].size() == 1);
+    CPPUNIT_ASSERT(received_["a"].empty());
+}
+
+void
+VideoForwarderTest::testRemove()
+{
+    add("a");
+    add("b");
+    add("c");
+    forwarder_->setPriorities({"a"});
+    send("a", 10, 9000, IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 1);
+
+    forwarder_->removeParticipant("a");
+    CPPUNIT_ASSERT(not forwarder_->hasParticipant("a"));
+    CPPUNIT_ASSERT(forwarder_->selectedSource("b") == "c");
+    CPPUNIT_ASSERT(forwarder_->selectedSource("c") == "b");
+
+    // Packets from a removed participant are ignored
+    send("a", 11, 12000, IDR);
+    CPPUNIT_ASSERT(received_["b"].size() == 1);
+    CPPUNIT_ASSERT(received_["c"].size() == 1);
+}
+
+void
+VideoForwarderTest::testHeaderExtension()
+{
+    add("a");
+    add("b");
+    forwarder_->setPriorities({"a"});
+
+    // One-byte header extension with a transport-wide sequence number (ID 5)
+    auto packet = makePacket(100, 10, 9000, 1234, {0xbe, 0xde, 0x00, 0x01, 0x51, 0x00, 0x2a, 0x00});
+    packet[0] |= 0x10;
+    packet.insert(packet.end(), IDR.begin(), IDR.end());
+    forwarder_->onPacket("a", packet.data(), packet.size());
+
+    // The extension describes the source's leg, it is not forwarded
+    CPPUNIT_ASSERT(received_["b"].size() == 1);
+    CPPUNIT_ASSERT(received_["b"][0].payload == IDR);
+    CPPUNIT_ASSERT(forwarder_->getStats().forwarded == 1);
+}
+
+void
+VideoForwarderTest::testReentrantSink()
+{
+    add("a");
+    forwarder_->setPriorities({"a"});
+
+    // Sinks are called without the forwarder locked
+    unsigned sent = 0;
+    VideoForwarder::LegParams params;
+    params.codec = "H264";
+    forwarder_->addParticipant(
+        "b",
+        params,
+        [&](uint8_t*, size_t) {
+            CPPUNIT_ASSERT(forwarder_->selectedSource("b") == "a");
+            sent++;
+        },
+        {});
+    send("a", 10, 9000, IDR);
+    CPPUNIT_ASSERT(sent == 1);
+
+    // Not called anymore once removed
+    forwarder_->removeParticipant("b");
+    send("a", 11, 12000, IDR);
+    CPPUNIT_ASSERT(sent == 1);
+}
+
+}}} // namespace jami::video::test
+
+RING_TEST_RUNNER(jami::video::test::VideoForwarderTest::name());
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <set>
+#include <string>
+
+#include "../../test_runner.h"
+#include "account_const.h"
+#include "common.h"
+#include "jami.h"
+#include "jamidht/jamiaccount.h"
+#include "jamidht/message_channel_handler.h"
+#include "manager.h"
+
+#include <dhtnet/connectionmanager.h>
+#include <dhtnet/multiplexed_socket.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class MessageChannelTest : public CppUnit::TestFixture
+{
+public:
+    MessageChannelTest()
+    {
+        // Init daemon
+        libjami::init(
+            libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+    }
+    ~MessageChannelTest() { libjami::fini(); }
+    static std::string name() { return "MessageChannel"; }
+    void setUp();
+    void tearDown();
+
+    std::string aliceId;
+    std::string bobId;
+
+    std::mutex mtx;
+    std::unique_lock<std::mutex> lk {mtx};
+    std::condition_variable cv;
+
+    std::vector<std::string> bobMessages;
+    std::set<std::string> aliceSent;
+
+private:
+    void connectSignals();
+
+    void testSendMessage();
+    void testPipelinedMessages();
+    void testTooBigMessage();
+
+    CPPUNIT_TEST_SUITE(MessageChannelTest);
+    CPPUNIT_TEST(testSendMessage);
+    CPPUNIT_TEST(testPipelinedMessages);
+    CPPUNIT_TEST(testTooBigMessage);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(MessageChannelTest, MessageChannelTest::name());
+
+void
+MessageChannelTest::setUp()
+{
+    auto actors = load_actors_and_wait_for_announcement("actors/alice-bob.yml");
+    aliceId = actors["alice"];
+    bobId = actors["bob"];
+    bobMessages.clear();
+    aliceSent.clear();
+
+    // Pin certificates, no DHT lookup is needed to accept the channels
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobAccount = Manager::instance().getAccount<JamiAccount>(bobId);
+    bobAccount->certStore().pinCertificate(aliceAccount->identity().second);
+    aliceAccount->certStore().pinCertificate(bobAccount->identity().second);
+}
+
+void
+MessageChannelTest::tearDown()
+{
+    libjami::unregisterSignalHandlers();
+    wait_for_removal_of({aliceId, bobId});
+}
+
+void
+MessageChannelTest::connectSignals()
+{
+    std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>> confHandlers;
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConfigurationSignal::IncomingAccountMessage>(
+            [&](const std::string& accountId,
+                const std::string&,
+                const std::string&,
+                const std::map<std::string, std::string>& payloads) {
+                if (accountId != bobId)
+                    return;
+                auto it = payloads.find("text/plain");
+                if (it == payloads.end())
+                    return;
+                std::lock_guard lock(mtx);
+                bobMessages.emplace_back(it->second);
+                cv.notify_one();
+            }));
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConfigurationSignal::AccountMessageStatusChanged>(
+            [&](const std::string& accountId,
+                const std::string&,
+                const std::string&,
+                const std::string& messageId,
+                int status) {
+                if (accountId != aliceId
+                    || status != static_cast<int>(libjami::Account::MessageStates::SENT))
+                    return;
+                std::lock_guard lock(mtx);
+                aliceSent.emplace(messageId);
+                cv.notify_one();
+            }));
+    libjami::registerSignalHandlers(confHandlers);
+}
+
+void
+MessageChannelTest::testSendMessage()
+{
+    connectSignals();
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobUri = Manager::instance().getAccount<JamiAccount>(bobId)->getUsername();
+
+    auto msgId = libjami::sendAccountTextMessage(aliceId, bobUri, {{"text/plain", "hello"}}, 0);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&] {
+        return !bobMessages.empty() && aliceSent.count(std::to_string(msgId));
+    }));
+    CPPUNIT_ASSERT(bobMessages.front() == "hello");
+
+    // The message went through a message channel, not a SIP one
+    auto& handlers = aliceAccount->channelHandlers();
+    auto handler = static_cast<MessageChannelHandler*>(handlers[Uri::Scheme::MESSAGE].get());
+    CPPUNIT_ASSERT(!handler->getConnections(bobUri).empty());
+}
+
+void
+MessageChannelTest::testPipelinedMessages()
+{
+    connectSignals();
+    auto bobUri = Manager::instance().getAccount<JamiAccount>(bobId)->getUsername();
+
+    // Open the channel
+    libjami::sendAccountTextMessage(aliceId, bobUri, {{"text/plain", "first"}}, 0);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&] { return !bobMessages.empty(); }));
+
+    // Several messages in flight on the same channel are all acknowledged
+    constexpr size_t count = 20;
+    std::set<std::string> ids;
+    for (size_t i = 0; i < count; ++i)
+        ids.emplace(std::to_string(
+            libjami::sendAccountTextMessage(aliceId,
+                                            bobUri,
+                                            {{"text/plain", "msg " + std::to_string(i)}},
+                                            0)));
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&] {
+        return bobMessages.size() == count + 1
+               && std::all_of(ids.begin(), ids.end(), [&](const auto& id) {
+                      return aliceSent.count(id);
+                  });
+    }));
+}
+
+void
+MessageChannelTest::testTooBigMessage()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobAccount = Manager::instance().getAccount<JamiAccount>(bobId);
+    auto bobDeviceId = DeviceId(std::string(bobAccount->currentDeviceId()));
+
+    std::shared_ptr<dhtnet::ChannelSocket> channel;
+    std::atomic_bool closed {false};
+    aliceAccount->connectionManager().connectDevice(
+        bobDeviceId,
+        "msg://" + bobDeviceId.toString(),
+        [&](std::shared_ptr<dhtnet::ChannelSocket> socket, const DeviceId&) {
+            std::lock_guard lock(mtx);
+            channel = socket;
+            cv.notify_one();
+        });
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&] { return channel != nullptr; }));
+    channel->onShutdown([&] {
+        closed = true;
+        cv.notify_one();
+    });
+
+    // {"c": <string of 2 MiB>}, header only: bob must not buffer it
+    std::vector<uint8_t> data {0x81, 0xa1, 'c', 0xdb, 0x00, 0x20, 0x00, 0x00};
+    data.resize(data.size() + 4096, 'a');
+    std::error_code ec;
+    channel->write(data.data(), data.size(), ec);
+    CPPUNIT_ASSERT(!ec);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 30s, [&] { return closed.load(); }));
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::MessageChannelTest::name())
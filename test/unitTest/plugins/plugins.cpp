@@ -22,13 +22,17 @@
 
 #include <condition_variable>
 #include <opendht/crypto.h>
+#include <msgpack.hpp>
 #include <filesystem>
+#include <fstream>
 #include <memory>
 #include <string>
 
 #include "manager.h"
 #include "plugin/jamipluginmanager.h"
 #include "plugin/pluginsutils.h"
+#include "plugin/pluginpreferencesutils.h"
+#include "plugin/streamdata.h"
 #include "jamidht/jamiaccount.h"
 #include "../../test_runner.h"
 #include "jami.h"
@@ -136,8 +140,10 @@ private:
     void testHandlers();
     void testDetailsAndPreferences();
     void testTranslations();
+    void testPreferencesCache();
     void testCall();
     void testMessage();
+    void testChatHandlerAlways();
 
     CPPUNIT_TEST_SUITE(PluginsTest);
     CPPUNIT_TEST(testEnable);
@@ -148,8 +154,10 @@ private:
     CPPUNIT_TEST(testHandlers);
     CPPUNIT_TEST(testDetailsAndPreferences);
     CPPUNIT_TEST(testTranslations);
+    CPPUNIT_TEST(testPreferencesCache);
     CPPUNIT_TEST(testCall);
     CPPUNIT_TEST(testMessage);
+    CPPUNIT_TEST(testChatHandlerAlways);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -541,6 +549,58 @@ PluginsTest::testTranslations()
     CPPUNIT_ASSERT(!Manager::instance().getJamiPluginManager().uninstallPlugin(installationPath_));
 }
 
+void
+PluginsTest::testPreferencesCache()
+{
+    Manager::instance().pluginPreferences.setPluginsEnabled(true);
+    auto& pluginManager = Manager::instance().getJamiPluginManager();
+    pluginManager.installPlugin(jplPath_, true);
+    // Unload now to avoid reloads when changing the preferences
+    pluginManager.unloadPlugin(installationPath_);
+
+    auto preferences = pluginManager.getPluginPreferences(installationPath_, "");
+    CPPUNIT_ASSERT(!preferences.empty());
+    auto key = preferences[0]["key"];
+    auto preferencesValuesOrig = pluginManager.getPluginPreferencesValuesMap(installationPath_, "");
+
+    // Setting a preference is seen by the next read
+    auto version = PluginPreferencesUtils::cacheVersion();
+    CPPUNIT_ASSERT(pluginManager.setPluginPreference(installationPath_, "", key, aliceData.accountId_));
+    CPPUNIT_ASSERT(PluginPreferencesUtils::cacheVersion() > version);
+    auto preferencesValues = pluginManager.getPluginPreferencesValuesMap(installationPath_, "");
+    CPPUNIT_ASSERT(preferencesValues[key] == aliceData.accountId_);
+
+    // Reads are served from memory, a file modified behind the daemon is not seen...
+    version = PluginPreferencesUtils::cacheVersion();
+    {
+        auto userValues = PluginPreferencesUtils::getUserPreferencesValuesMap(installationPath_, "");
+        userValues[key] = bobData.accountId_;
+        std::ofstream fs(PluginPreferencesUtils::valuesFilePath(installationPath_, ""),
+                         std::ios::binary);
+        msgpack::pack(fs, userValues);
+    }
+    CPPUNIT_ASSERT(pluginManager.getPluginPreferencesValuesMap(installationPath_, "") == preferencesValues);
+    CPPUNIT_ASSERT_EQUAL(version, PluginPreferencesUtils::cacheVersion());
+
+    // ...until the cache of the plugin is invalidated
+    PluginPreferencesUtils::invalidateCache(installationPath_);
+    CPPUNIT_ASSERT(PluginPreferencesUtils::cacheVersion() > version);
+    preferencesValues = pluginManager.getPluginPreferencesValuesMap(installationPath_, "");
+    CPPUNIT_ASSERT(preferencesValues[key] == bobData.accountId_);
+
+    // Reset is seen by the next read
+    pluginManager.resetPluginPreferencesValuesMap(installationPath_, "");
+    preferencesValues = pluginManager.getPluginPreferencesValuesMap(installationPath_, "");
+    CPPUNIT_ASSERT(preferencesValues[key] == preferencesValuesOrig[key]);
+
+    // Uninstall drops what was read from the plugin's files
+    CPPUNIT_ASSERT(!PluginPreferencesUtils::getPreferences(installationPath_).empty());
+    version = PluginPreferencesUtils::cacheVersion();
+    CPPUNIT_ASSERT(!pluginManager.uninstallPlugin(installationPath_));
+    CPPUNIT_ASSERT(PluginPreferencesUtils::cacheVersion() > version);
+    CPPUNIT_ASSERT(PluginPreferencesUtils::getPreferences(installationPath_).empty());
+}
+
 bool
 PluginsTest::waitForSignal(CallData& callData,
                             const std::string& expectedSignal,
@@ -766,6 +826,55 @@ PluginsTest::testMessage()
     CPPUNIT_ASSERT(!Manager::instance().getJamiPluginManager().uninstallPlugin(installationPath_));
 }
 
+void
+PluginsTest::testChatHandlerAlways()
+{
+    Manager::instance().pluginPreferences.setPluginsEnabled(true);
+    auto& pluginManager = Manager::instance().getJamiPluginManager();
+    auto& chatServicesManager = pluginManager.getChatServicesManager();
+    pluginManager.installPlugin(jplPath_, true);
+
+    std::string handlerName;
+    for (const auto& handler : chatServicesManager.getChatHandlers()) {
+        auto details = chatServicesManager.getChatHandlerDetails(handler);
+        if (std::find(chatHandlers_.begin(), chatHandlers_.end(), details["name"])
+            != chatHandlers_.end()) {
+            handlerName = details["name"];
+            break;
+        }
+    }
+    CPPUNIT_ASSERT(!handlerName.empty());
+
+    auto publish = [&](const std::string& accountId, const std::string& peerId) {
+        chatServicesManager.publishMessage(
+            std::make_shared<JamiMessage>(accountId,
+                                          peerId,
+                                          false,
+                                          std::map<std::string, std::string> {{"text/plain", "hi"}},
+                                          false));
+    };
+
+    // Handlers are not activated by default
+    publish(aliceData.accountId_, bobData.userName_);
+    CPPUNIT_ASSERT(chatServicesManager.getChatHandlerStatus(aliceData.accountId_, bobData.userName_).empty());
+
+    // Turning the "always" preference on is taken into account by the next message
+    CPPUNIT_ASSERT(pluginManager.setPluginPreference(installationPath_,
+                                                     aliceData.accountId_,
+                                                     handlerName + "Always",
+                                                     "1"));
+    publish(aliceData.accountId_, bobData.userName_);
+    auto statusMap = chatServicesManager.getChatHandlerStatus(aliceData.accountId_, bobData.userName_);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, statusMap.size());
+    CPPUNIT_ASSERT(chatServicesManager.getChatHandlerDetails(statusMap[0])["name"] == handlerName);
+
+    // Only for this account
+    publish(bobData.accountId_, aliceData.userName_);
+    CPPUNIT_ASSERT(chatServicesManager.getChatHandlerStatus(bobData.accountId_, aliceData.userName_).empty());
+
+    CPPUNIT_ASSERT(!pluginManager.uninstallPlugin(installationPath_));
+}
+
 } // namespace test
 } // namespace jami
 
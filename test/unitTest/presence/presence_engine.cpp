@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jamidht/presence_engine.h"
+
+#include "../../test_runner.h"
+
+#include <set>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class PresenceEngineTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "presence_engine"; }
+    void setUp();
+
+private:
+    void testBatches();
+    void testInferredFromConnection();
+    void testInferredGrace();
+    void testBackoff();
+    void testFailedListen();
+    void testUntrack();
+
+    CPPUNIT_TEST_SUITE(PresenceEngineTest);
+    CPPUNIT_TEST(testBatches);
+    CPPUNIT_TEST(testInferredFromConnection);
+    CPPUNIT_TEST(testInferredGrace);
+    CPPUNIT_TEST(testBackoff);
+    CPPUNIT_TEST(testFailedListen);
+    CPPUNIT_TEST(testUntrack);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::unique_ptr<PresenceEngine> engine;
+    std::vector<dht::InfoHash> listens;
+    std::vector<dht::InfoHash> cancelled;
+    std::set<DeviceId> connected;
+    std::vector<PresenceEngine::clock::duration> scheduled;
+    std::map<dht::InfoHash, bool> changes;
+    bool failListens {false};
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(PresenceEngineTest, PresenceEngineTest::name());
+
+void
+PresenceEngineTest::setUp()
+{
+    listens.clear();
+    cancelled.clear();
+    connected.clear();
+    scheduled.clear();
+    changes.clear();
+    failListens = false;
+    engine = std::make_unique<PresenceEngine>(PresenceEngine::Callbacks {
+        [this](const dht::InfoHash& h) {
+            if (failListens)
+                return std::future<size_t>();
+            listens.emplace_back(h);
+            std::promise<size_t> token;
+            token.set_value(listens.size());
+            return token.get_future();
+        },
+        [this](const dht::InfoHash& h, std::future<size_t>&&) { cancelled.emplace_back(h); },
+        [this](const DeviceId& device) { return connected.count(device) != 0; },
+        [this](PresenceEngine::clock::duration delay) { scheduled.emplace_back(delay); },
+        [this](const dht::InfoHash& h, bool online) { changes[h] = online; }});
+}
+
+void
+PresenceEngineTest::testBatches()
+{
+    for (int i = 0; i < 100; ++i)
+        CPPUNIT_ASSERT(engine->track(dht::InfoHash::get("buddy" + std::to_string(i))));
+    CPPUNIT_ASSERT(not engine->track(dht::InfoHash::get("buddy0")));
+    // A single run is scheduled for all of them
+    CPPUNIT_ASSERT(scheduled.size() == 1);
+
+    auto now = PresenceEngine::clock::now();
+    engine->process(now);
+    CPPUNIT_ASSERT(listens.size() == PresenceEngine::BATCH_SIZE);
+    CPPUNIT_ASSERT(scheduled.size() == 2 and scheduled.back() == PresenceEngine::BATCH_INTERVAL);
+    for (int i = 1; i < 4; ++i)
+        engine->process(now + i * PresenceEngine::BATCH_INTERVAL);
+    CPPUNIT_ASSERT(listens.size() == 100);
+    CPPUNIT_ASSERT(std::set<dht::InfoHash>(listens.begin(), listens.end()).size() == 100);
+
+    auto stats = engine->getStats();
+    CPPUNIT_ASSERT(stats.tracked == 100 and stats.listening == 100 and stats.pending == 0);
+    CPPUNIT_ASSERT(stats.listens == 100);
+}
+
+void
+PresenceEngineTest::testInferredFromConnection()
+{
+    auto buddy = dht::InfoHash::get("buddy");
+    auto device = dht::InfoHash::get("device");
+    auto deviceId = DeviceId::get("device");
+    engine->track(buddy);
+    engine->process();
+    CPPUNIT_ASSERT(listens.size() == 1);
+
+    CPPUNIT_ASSERT(engine->onAnnouncement(buddy, device, deviceId, false));
+    CPPUNIT_ASSERT(changes[buddy] and engine->isOnline(buddy));
+    CPPUNIT_ASSERT(engine->presence()[buddy.toString()]);
+
+    // The DHT restarts while the device is connected: no need to listen
+    connected.emplace(deviceId);
+    auto now = PresenceEngine::clock::now();
+    engine->restart(now);
+    CPPUNIT_ASSERT(not engine->isOnline(buddy));
+    changes.clear();
+    engine->process(now);
+    CPPUNIT_ASSERT(listens.size() == 1);
+    auto stats = engine->getStats();
+    CPPUNIT_ASSERT(stats.inferred == 1 and stats.skippedListens == 1 and stats.online == 1);
+    // Online from the connection
+    CPPUNIT_ASSERT(changes[buddy] and engine->isOnline(buddy));
+    CPPUNIT_ASSERT(engine->presence()[buddy.toString()]);
+
+    // Listened to later anyway, to see the devices it adds, staying online
+    changes.clear();
+    engine->process(now + PresenceEngine::INFERRED_RECHECK);
+    CPPUNIT_ASSERT(listens.size() == 2);
+    CPPUNIT_ASSERT(engine->getStats().listening == 1 and engine->isOnline(buddy));
+    CPPUNIT_ASSERT(engine->onAnnouncement(buddy, dht::InfoHash::get("device2"), {}, false));
+    CPPUNIT_ASSERT(changes.empty() and engine->isOnline(buddy));
+}
+
+void
+PresenceEngineTest::testInferredGrace()
+{
+    auto buddy = dht::InfoHash::get("buddy");
+    auto device = dht::InfoHash::get("device");
+    auto deviceId = DeviceId::get("device");
+    engine->track(buddy);
+    engine->process();
+    engine->onAnnouncement(buddy, device, deviceId, false);
+    connected.emplace(deviceId);
+    auto now = PresenceEngine::clock::now();
+    engine->restart(now);
+    engine->process(now);
+    CPPUNIT_ASSERT(engine->getStats().inferred == 1);
+
+    // The connection closes: listened to again, and still online meanwhile
+    changes.clear();
+    connected.clear();
+    engine->onConnectionClosed(buddy);
+    engine->process(now + 1s);
+    CPPUNIT_ASSERT(listens.size() == 2);
+    CPPUNIT_ASSERT(scheduled.back() == PresenceEngine::INFERRED_GRACE);
+    CPPUNIT_ASSERT(changes.empty() and engine->isOnline(buddy));
+
+    // Nothing announced in time: offline
+    engine->process(now + 1s + PresenceEngine::INFERRED_GRACE);
+    CPPUNIT_ASSERT(changes.count(buddy) and not changes[buddy]);
+    CPPUNIT_ASSERT(not engine->isOnline(buddy));
+    CPPUNIT_ASSERT(engine->getStats().listening == 1);
+}
+
+void
+PresenceEngineTest::testBackoff()
+{
+    auto online = dht::InfoHash::get("online");
+    auto offline = dht::InfoHash::get("offline");
+    engine->track(online);
+    engine->track(offline);
+    auto now = PresenceEngine::clock::now();
+    engine->process(now);
+    CPPUNIT_ASSERT(listens.size() == 2);
+    engine->onAnnouncement(online, dht::InfoHash::get("device"), {}, false);
+
+    // The buddy seen online is listened to first
+    engine->restart(now);
+    engine->process(now);
+    CPPUNIT_ASSERT(listens.size() == 3 and listens.back() == online);
+    CPPUNIT_ASSERT(engine->getStats().pending == 1);
+    engine->process(now + PresenceEngine::MIN_BACKOFF);
+    CPPUNIT_ASSERT(listens.size() == 4 and listens.back() == offline);
+
+    // The delay doubles at each session spent offline
+    now += PresenceEngine::MIN_BACKOFF;
+    engine->restart(now);
+    engine->process(now + PresenceEngine::MIN_BACKOFF);
+    CPPUNIT_ASSERT(listens.size() == 5);
+    engine->process(now + 2 * PresenceEngine::MIN_BACKOFF);
+    CPPUNIT_ASSERT(listens.size() == 6 and listens.back() == offline);
+
+    // Up to the maximum
+    for (int i = 0; i < 20; ++i) {
+        now += PresenceEngine::MAX_BACKOFF;
+        engine->restart(now);
+        engine->process(now + PresenceEngine::MAX_BACKOFF);
+    }
+    engine->onAnnouncement(online, dht::InfoHash::get("device"), {}, false);
+    now += PresenceEngine::MAX_BACKOFF;
+    engine->restart(now);
+    auto count = listens.size();
+    engine->process(now + PresenceEngine::MAX_BACKOFF - 1s);
+    CPPUNIT_ASSERT(listens.size() == count + 1 and listens.back() == online);
+    engine->process(now + PresenceEngine::MAX_BACKOFF);
+    CPPUNIT_ASSERT(listens.size() == count + 2 and listens.back() == offline);
+}
+
+void
+PresenceEngineTest::testFailedListen()
+{
+    auto buddy = dht::InfoHash::get("buddy");
+    failListens = true;
+    engine->track(buddy);
+    auto now = PresenceEngine::clock::now();
+    engine->process(now);
+    CPPUNIT_ASSERT(engine->getStats().failedListens == 1);
+    CPPUNIT_ASSERT(scheduled.back() == PresenceEngine::MIN_BACKOFF);
+
+    failListens = false;
+    engine->process(now + 1s);
+    CPPUNIT_ASSERT(listens.empty());
+    engine->process(now + PresenceEngine::MIN_BACKOFF);
+    CPPUNIT_ASSERT(listens.size() == 1);
+}
+
+void
+PresenceEngineTest::testUntrack()
+{
+    auto buddy = dht::InfoHash::get("buddy");
+    engine->track(buddy);
+    engine->process();
+    engine->untrack(buddy);
+    CPPUNIT_ASSERT(cancelled.size() == 1 and cancelled[0] == buddy);
+    CPPUNIT_ASSERT(not engine->isTracked(buddy));
+    // Late announcements stop the listen
+    CPPUNIT_ASSERT(not engine->onAnnouncement(buddy, dht::InfoHash::get("device"), {}, false));
+    CPPUNIT_ASSERT(engine->getStats().tracked == 0);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::PresenceEngineTest::name())
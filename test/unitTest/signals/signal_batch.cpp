@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../../test_runner.h"
+#include "client/ring_signal.h"
+#include "jami.h"
+#include "manager.h"
+
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class SignalBatchTest : public CppUnit::TestFixture
+{
+public:
+    SignalBatchTest()
+    {
+        // Init daemon
+        libjami::init(
+            libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+    }
+    ~SignalBatchTest() { libjami::fini(); }
+    static std::string name() { return "SignalBatch"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testBatchOrder();
+    void testFlushBeforeUpdate();
+    void testFlushAfterInterval();
+
+    void receive(const std::string& conversationId, const std::string& messageId);
+
+    CPPUNIT_TEST_SUITE(SignalBatchTest);
+    CPPUNIT_TEST(testBatchOrder);
+    CPPUNIT_TEST(testFlushBeforeUpdate);
+    CPPUNIT_TEST(testFlushAfterInterval);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    // Delivered signals, as "<signal> <conversation> <message ids>"
+    std::vector<std::string> events;
+    unsigned single {0};
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SignalBatchTest, SignalBatchTest::name());
+
+void
+SignalBatchTest::setUp()
+{
+    events.clear();
+    single = 0;
+    std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>> confHandlers;
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConversationSignal::SwarmMessageReceived>(
+            [&](const std::string&, const std::string&, const libjami::SwarmMessage&) {
+                std::lock_guard lk {mtx};
+                ++single;
+                cv.notify_one();
+            }));
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConversationSignal::SwarmMessagesReceived>(
+            [&](const std::string&,
+                const std::string& conversationId,
+                std::vector<libjami::SwarmMessage> messages) {
+                std::lock_guard lk {mtx};
+                auto event = "batch " + conversationId;
+                for (const auto& message : messages)
+                    event += " " + message.id;
+                events.emplace_back(std::move(event));
+                cv.notify_one();
+            }));
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConversationSignal::SwarmMessageUpdated>(
+            [&](const std::string&,
+                const std::string& conversationId,
+                const libjami::SwarmMessage& message) {
+                std::lock_guard lk {mtx};
+                events.emplace_back("update " + conversationId + " " + message.id);
+                cv.notify_one();
+            }));
+    libjami::registerSignalHandlers(confHandlers);
+}
+
+void
+SignalBatchTest::tearDown()
+{
+    libjami::setSignalBatchInterval(0ms);
+    libjami::unregisterSignalHandlers();
+}
+
+void
+SignalBatchTest::receive(const std::string& conversationId, const std::string& messageId)
+{
+    libjami::SwarmMessage message;
+    message.id = messageId;
+    emitSignal<libjami::ConversationSignal::SwarmMessageReceived>(std::string("account"),
+                                                                  conversationId,
+                                                                  message);
+}
+
+void
+SignalBatchTest::testBatchOrder()
+{
+    // Long enough for the batch not to be delivered by itself
+    libjami::setSignalBatchInterval(1h);
+    for (auto id : {"0", "1", "2", "3", "4"})
+        receive("conv", id);
+    {
+        std::lock_guard lk {mtx};
+        CPPUNIT_ASSERT(events.empty());
+    }
+
+    flushSignalBatches();
+    std::lock_guard lk {mtx};
+    CPPUNIT_ASSERT(events == std::vector<std::string> {"batch conv 0 1 2 3 4"});
+    CPPUNIT_ASSERT_EQUAL(0u, single);
+}
+
+void
+SignalBatchTest::testFlushBeforeUpdate()
+{
+    libjami::setSignalBatchInterval(1h);
+    receive("conv", "0");
+    receive("other", "a");
+    receive("conv", "1");
+
+    // The update refers to a batched message, which must be delivered first
+    libjami::SwarmMessage edited;
+    edited.id = "1";
+    emitSignal<libjami::ConversationSignal::SwarmMessageUpdated>(std::string("account"),
+                                                                 std::string("conv"),
+                                                                 edited);
+    {
+        std::lock_guard lk {mtx};
+        CPPUNIT_ASSERT(events == std::vector<std::string>({"batch conv 0 1", "update conv 1"}));
+    }
+
+    // Other conversations stay batched
+    receive("conv", "2");
+    flushSignalBatches();
+    std::lock_guard lk {mtx};
+    CPPUNIT_ASSERT(events
+                   == std::vector<std::string>(
+                       {"batch conv 0 1", "update conv 1", "batch conv 2", "batch other a"}));
+}
+
+void
+SignalBatchTest::testFlushAfterInterval()
+{
+    libjami::setSignalBatchInterval(50ms);
+    receive("conv", "0");
+    receive("conv", "1");
+    std::unique_lock lk {mtx};
+    CPPUNIT_ASSERT(cv.wait_for(lk, 10s, [&] { return not events.empty(); }));
+    CPPUNIT_ASSERT(events == std::vector<std::string> {"batch conv 0 1"});
+
+    // Without interval, signals are delivered directly
+    lk.unlock();
+    libjami::setSignalBatchInterval(0ms);
+    receive("conv", "2");
+    lk.lock();
+    CPPUNIT_ASSERT_EQUAL(1u, single);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::SignalBatchTest::name())
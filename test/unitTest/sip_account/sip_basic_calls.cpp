@@ -22,7 +22,11 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "callmanager_interface.h"
 #include "manager.h"
@@ -83,6 +87,8 @@ class SipBasicCallTest : public CppUnit::TestFixture
 public:
     SipBasicCallTest()
     {
+        // Several SIP threads, so that dialogs are handled concurrently
+        setenv("JAMI_SIP_THREADS", "4", 0);
         // Init daemon
         libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
         if (not Manager::instance().initialized)
@@ -101,6 +107,7 @@ private:
     void peer_answer_with_all_media_disabled();
     void hold_resume_test();
     void blind_transfer_test();
+    void concurrent_calls_test();
 
     CPPUNIT_TEST_SUITE(SipBasicCallTest);
     CPPUNIT_TEST(audio_only_test);
@@ -109,6 +116,7 @@ private:
     CPPUNIT_TEST(peer_answer_with_all_media_disabled);
     CPPUNIT_TEST(hold_resume_test);
     CPPUNIT_TEST(blind_transfer_test);
+    CPPUNIT_TEST(concurrent_calls_test);
     CPPUNIT_TEST_SUITE_END();
 
     // Event/Signal handlers
@@ -1089,6 +1097,91 @@ SipBasicCallTest::blind_transfer_test()
     JAMI_INFO("Calls normally ended on both sides");
 }
 
+void
+SipBasicCallTest::concurrent_calls_test()
+{
+    // Alice and Carla call Bob at the same time: both dialogs are set up,
+    // answered and torn down concurrently by the SIP threads.
+
+    JAMI_INFO("=== Begin test %s ===", __FUNCTION__);
+
+    for (const auto& alias : {"ALICE", "BOB", "CARLA"}) {
+        auto const& account = Manager::instance().getAccount<SIPAccount>(
+            callDataMap_[alias].accountId_);
+        account->setLocalPort(callDataMap_[alias].listeningPort_);
+    }
+    const auto& bobId = callDataMap_["BOB"].accountId_;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::string> bobCalls;
+    std::map<std::string, std::string> states;
+
+    std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>> signalHandlers;
+    signalHandlers.insert(libjami::exportable_callback<libjami::CallSignal::IncomingCallWithMedia>(
+        [&](const std::string& accountId,
+            const std::string& callId,
+            const std::string&,
+            const std::vector<libjami::MediaMap>) {
+            if (accountId != bobId)
+                return;
+            std::lock_guard lk {mtx};
+            bobCalls.emplace_back(callId);
+            cv.notify_all();
+        }));
+    signalHandlers.insert(libjami::exportable_callback<libjami::CallSignal::StateChange>(
+        [&](const std::string&, const std::string& callId, const std::string& state, signed) {
+            std::lock_guard lk {mtx};
+            states[callId] = state;
+            cv.notify_all();
+        }));
+    libjami::registerSignalHandlers(signalHandlers);
+
+    MediaAttribute audio(MediaType::MEDIA_AUDIO);
+    audio.enabled_ = true;
+    audio.label_ = "audio_0";
+    auto mediaList = MediaAttribute::mediaAttributesToMediaMaps({audio});
+
+    std::string bobUri = callDataMap_["BOB"].userName_
+                         + "@127.0.0.1:" + std::to_string(callDataMap_["BOB"].listeningPort_);
+    auto aliceCall = libjami::placeCallWithMedia(callDataMap_["ALICE"].accountId_,
+                                                 bobUri,
+                                                 mediaList);
+    auto carlaCall = libjami::placeCallWithMedia(callDataMap_["CARLA"].accountId_,
+                                                 bobUri,
+                                                 mediaList);
+    CPPUNIT_ASSERT(not aliceCall.empty());
+    CPPUNIT_ASSERT(not carlaCall.empty());
+
+    std::unique_lock lk {mtx};
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(10), [&] { return bobCalls.size() == 2; }));
+    auto calls = bobCalls;
+    lk.unlock();
+    for (const auto& callId : calls)
+        libjami::acceptWithMedia(bobId, callId, mediaList);
+
+    lk.lock();
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(10), [&] {
+        return states[aliceCall] == "CURRENT" and states[carlaCall] == "CURRENT"
+               and states[calls[0]] == "CURRENT" and states[calls[1]] == "CURRENT";
+    }));
+    lk.unlock();
+
+    libjami::hangUp(callDataMap_["ALICE"].accountId_, aliceCall);
+    libjami::hangUp(callDataMap_["CARLA"].accountId_, carlaCall);
+
+    lk.lock();
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(10), [&] {
+        return states[aliceCall] == "OVER" and states[carlaCall] == "OVER"
+               and states[calls[0]] == "OVER" and states[calls[1]] == "OVER";
+    }));
+    lk.unlock();
+    // The handlers refer to this scope
+    libjami::unregisterSignalHandlers();
+
+    JAMI_INFO("Concurrent calls normally ended on both sides");
+}
+
 } // namespace test
 } // namespace jami
 
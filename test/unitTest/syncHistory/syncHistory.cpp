@@ -34,6 +34,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <filesystem>
+#include <set>
 
 using namespace libjami::Account;
 using namespace std::literals::chrono_literals;
@@ -92,6 +93,7 @@ private:
     void testCreateConversationWithOnlineDevice();
     void testCreateConversationWithMessagesThenAddDevice();
     void testCreateMultipleConversationThenAddDevice();
+    void testSyncManyRequestsThenAddDevice();
     void testReceivesInviteThenAddDevice();
     void testRemoveConversationOnAllDevices();
     void testSyncCreateAccountExportDeleteReimportOldBackup();
@@ -108,6 +110,7 @@ private:
     CPPUNIT_TEST(testCreateConversationWithOnlineDevice);
     CPPUNIT_TEST(testCreateConversationWithMessagesThenAddDevice);
     CPPUNIT_TEST(testCreateMultipleConversationThenAddDevice);
+    CPPUNIT_TEST(testSyncManyRequestsThenAddDevice);
     CPPUNIT_TEST(testReceivesInviteThenAddDevice);
     CPPUNIT_TEST(testRemoveConversationOnAllDevices);
     CPPUNIT_TEST(testSyncCreateAccountExportDeleteReimportOldBackup);
@@ -493,6 +496,59 @@ SyncHistoryTest::testCreateMultipleConversationThenAddDevice()
     CPPUNIT_ASSERT(cv.wait_for(lk, 60s, [&]() { return conversationReady == 4; }));
 }
 
+void
+SyncHistoryTest::testSyncManyRequestsThenAddDevice()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobUri = Manager::instance().getAccount<JamiAccount>(bobId)->getUsername();
+
+    auto aliceArchive = std::filesystem::current_path().string() + "/alice.gz";
+    aliceAccount->exportArchive(aliceArchive);
+
+    // Added after the export, so alice2 only gets them by sync. Their hashes
+    // don't fit in one message.
+    constexpr size_t count = 1300;
+    auto requests = ConversationModule::convRequests(aliceId);
+    for (size_t i = 0; i < count; ++i) {
+        ConversationRequest req;
+        req.conversationId = dht::InfoHash::getRandom().toString();
+        req.from = bobUri;
+        req.received = std::time(nullptr);
+        req.declined = req.received;
+        requests[req.conversationId] = std::move(req);
+    }
+    ConversationModule::saveConvRequests(aliceId, requests);
+
+    std::mutex mtx;
+    std::unique_lock lk {mtx};
+    std::condition_variable cv;
+    std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>> confHandlers;
+    std::set<std::string> declined;
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConversationSignal::ConversationRequestDeclined>(
+            [&](const std::string& accountId, const std::string& conversationId) {
+                if (accountId != alice2Id)
+                    return;
+                std::lock_guard lock(mtx);
+                declined.emplace(conversationId);
+                cv.notify_one();
+            }));
+    libjami::registerSignalHandlers(confHandlers);
+    confHandlers.clear();
+
+    std::map<std::string, std::string> details = libjami::getAccountTemplate("RING");
+    details[ConfProperties::TYPE] = "RING";
+    details[ConfProperties::DISPLAYNAME] = "ALICE2";
+    details[ConfProperties::ALIAS] = "ALICE2";
+    details[ConfProperties::UPNP_ENABLED] = "true";
+    details[ConfProperties::ARCHIVE_PASSWORD] = "";
+    details[ConfProperties::ARCHIVE_PIN] = "";
+    details[ConfProperties::ARCHIVE_PATH] = aliceArchive;
+    alice2Id = Manager::instance().addAccount(details);
+
+    CPPUNIT_ASSERT(cv.wait_for(lk, 120s, [&]() { return declined.size() == count; }));
+}
+
 void
 SyncHistoryTest::testReceivesInviteThenAddDevice()
 {
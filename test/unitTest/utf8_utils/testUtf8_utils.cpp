@@ -21,7 +21,9 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <random>
 #include <string>
+#include <vector>
 
 #include "connectivity/utf8_utils.h"
 #include "../../test_runner.h"
@@ -36,10 +38,18 @@ public:
 private:
     void utf8_validate_test();
     void utf8_make_valid_test();
+    void utf8_validate_offsets_test();
+    void utf8_validate_nul_test();
+    void utf8_validate_random_test();
+    void utf8_make_valid_multiple_test();
 
     CPPUNIT_TEST_SUITE(Utf8UtilsTest);
     CPPUNIT_TEST(utf8_validate_test);
     CPPUNIT_TEST(utf8_make_valid_test);
+    CPPUNIT_TEST(utf8_validate_offsets_test);
+    CPPUNIT_TEST(utf8_validate_nul_test);
+    CPPUNIT_TEST(utf8_validate_random_test);
+    CPPUNIT_TEST(utf8_make_valid_multiple_test);
     CPPUNIT_TEST_SUITE_END();
 
     const std::string VALIDE_UTF8 = "çèềé{}()/\\*";
@@ -66,6 +76,92 @@ Utf8UtilsTest::utf8_make_valid_test()
     CPPUNIT_ASSERT(utf8_validate(str));
 }
 
+void
+Utf8UtilsTest::utf8_validate_offsets_test()
+{
+    // Sequences placed at every offset of a few vector blocks, including
+    // the ones straddling a block boundary and the zero-padded tail
+    const std::vector<std::string> valid = {"é", "€", "😀", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf"};
+    const std::vector<std::string> invalid = {
+        "\x80",             // lone continuation
+        "\xc3",             // truncated 2 bytes
+        "\xe2\x82",         // truncated 3 bytes
+        "\xf0\x9f\x98",     // truncated 4 bytes
+        "\xc0\xaf",         // overlong 2 bytes
+        "\xe0\x80\xaf",     // overlong 3 bytes
+        "\xf0\x80\x80\xaf", // overlong 4 bytes
+        "\xed\xa0\x80",     // surrogate
+        "\xf4\x90\x80\x80", // above U+10FFFF
+        "\xf8\x88\x80\x80\x80",
+        "\xff",
+    };
+    for (size_t len : {1, 31, 32, 33, 64, 70}) {
+        for (size_t offset = 0; offset < len; ++offset) {
+            for (const auto& seq : valid) {
+                std::string str(len, 'a');
+                str.insert(offset, seq);
+                CPPUNIT_ASSERT(utf8_validate(str));
+                CPPUNIT_ASSERT(utf8_validate_fallback(str));
+            }
+            for (const auto& seq : invalid) {
+                std::string str(len, 'a');
+                str.insert(offset, seq);
+                CPPUNIT_ASSERT(!utf8_validate(str));
+                CPPUNIT_ASSERT(!utf8_validate_fallback(str));
+                // also at the very end, where only the tail check sees it
+                CPPUNIT_ASSERT(!utf8_validate(std::string(len, 'a') + seq));
+            }
+        }
+    }
+}
+
+void
+Utf8UtilsTest::utf8_validate_nul_test()
+{
+    // Validation stops at the first nul byte
+    std::string str("abc\0\xff", 5);
+    CPPUNIT_ASSERT(utf8_validate(str));
+    CPPUNIT_ASSERT(utf8_validate_fallback(str));
+    str = std::string(40, 'a') + std::string("\xff\0", 2);
+    CPPUNIT_ASSERT(!utf8_validate(str));
+    CPPUNIT_ASSERT(!utf8_validate_fallback(str));
+
+    // make_valid replaces nul bytes instead
+    CPPUNIT_ASSERT_EQUAL(std::string("abc\xef\xbf\xbd" "d"),
+                         utf8_make_valid(std::string_view("abc\0d", 5)));
+}
+
+void
+Utf8UtilsTest::utf8_validate_random_test()
+{
+    // The vectorized validator must agree with the scalar one
+    const std::vector<std::string> pieces = {"a", "hello world ", "é", "€", "😀", "\x80", "\xbf",
+                                             "\xc2", "\xdf\xbf", "\xe0\xa0", "\xe0\x9f\xbf",
+                                             "\xed\x9f\xbf", "\xed\xa0\x80", "\xf0\x90",
+                                             "\xf4\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xfe"};
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; ++i) {
+        std::string str;
+        auto n = rng() % 32;
+        for (unsigned j = 0; j < n; ++j)
+            str += pieces[rng() % pieces.size()];
+        if (!str.empty() && rng() % 4 == 0)
+            str[rng() % str.size()] = static_cast<char>(rng());
+        CPPUNIT_ASSERT_EQUAL(utf8_validate_fallback(str), utf8_validate(str));
+        CPPUNIT_ASSERT(utf8_validate(utf8_make_valid(str)));
+    }
+}
+
+void
+Utf8UtilsTest::utf8_make_valid_multiple_test()
+{
+    // Every invalid byte is replaced and the valid parts around them are kept
+    CPPUNIT_ASSERT_EQUAL(std::string("a\xef\xbf\xbd" "bé\xef\xbf\xbd" "(c"),
+                         utf8_make_valid("a\xff" "bé\xc3\x28" "c"));
+    CPPUNIT_ASSERT_EQUAL(std::string("\xef\xbf\xbd" "x\xef\xbf\xbd"),
+                         utf8_make_valid("\x80x\xfe"));
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::Utf8UtilsTest::name());
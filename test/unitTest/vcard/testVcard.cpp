@@ -0,0 +1,185 @@
+/*
+ *  Copyright (C) 2024 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../../test_runner.h"
+#include "fileutils.h"
+#include "vcard.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace jami { namespace test {
+
+class VCardTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "vcard"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testNextProperty();
+    void testToMap();
+    void testLoadProfile();
+    void testLoadProfileMissing();
+    void testInvalidateProfile();
+
+    CPPUNIT_TEST_SUITE(VCardTest);
+    CPPUNIT_TEST(testNextProperty);
+    CPPUNIT_TEST(testToMap);
+    CPPUNIT_TEST(testLoadProfile);
+    CPPUNIT_TEST(testLoadProfileMissing);
+    CPPUNIT_TEST(testInvalidateProfile);
+    CPPUNIT_TEST_SUITE_END();
+
+    void write(const std::string& content);
+
+    std::filesystem::path dir_;
+    std::filesystem::path path_;
+
+    const std::string VCARD = "BEGIN:VCARD\n"
+                              "VERSION:2.1\n"
+                              "FN:Alice\n"
+                              "\n"
+                              "no separator\n"
+                              "PHOTO;ENCODING=BASE64;TYPE=PNG:iVBORw0KGgo=\n"
+                              "END:VCARD";
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(VCardTest, VCardTest::name());
+
+void
+VCardTest::setUp()
+{
+    char templateName[] = {"ring_unit_tests_XXXXXX"};
+    auto dir = mkdtemp(templateName);
+    CPPUNIT_ASSERT(dir);
+    dir_ = std::filesystem::absolute(dir);
+    path_ = dir_ / "profile.vcf";
+}
+
+void
+VCardTest::tearDown()
+{
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+}
+
+void
+VCardTest::write(const std::string& content)
+{
+    std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+void
+VCardTest::testNextProperty()
+{
+    std::string_view content = VCARD;
+    std::string_view key, value;
+    CPPUNIT_ASSERT(vCard::utils::nextProperty(content, key, value));
+    CPPUNIT_ASSERT(key == "BEGIN" && value == "VCARD");
+    CPPUNIT_ASSERT(vCard::utils::nextProperty(content, key, value));
+    CPPUNIT_ASSERT(key == "VERSION" && value == "2.1");
+    CPPUNIT_ASSERT(vCard::utils::nextProperty(content, key, value));
+    CPPUNIT_ASSERT(key == "FN" && value == "Alice");
+    // empty lines and lines without ':' are skipped
+    CPPUNIT_ASSERT(vCard::utils::nextProperty(content, key, value));
+    CPPUNIT_ASSERT(key == vCard::Property::PHOTO_PNG && value == "iVBORw0KGgo=");
+    // views point into the payload
+    CPPUNIT_ASSERT(value.data() >= VCARD.data() && value.data() < VCARD.data() + VCARD.size());
+    CPPUNIT_ASSERT(vCard::utils::nextProperty(content, key, value));
+    CPPUNIT_ASSERT(key == "END" && value == "VCARD");
+    CPPUNIT_ASSERT(!vCard::utils::nextProperty(content, key, value));
+}
+
+void
+VCardTest::testToMap()
+{
+    auto map = vCard::utils::toMap(VCARD);
+    CPPUNIT_ASSERT_EQUAL(size_t(5), map.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("Alice"), map[vCard::Property::FORMATTED_NAME]);
+    CPPUNIT_ASSERT_EQUAL(std::string("iVBORw0KGgo="), map[vCard::Property::PHOTO_PNG]);
+}
+
+void
+VCardTest::testLoadProfile()
+{
+    write(VCARD);
+    auto profile = vCard::utils::loadProfile(path_);
+    CPPUNIT_ASSERT(profile);
+    CPPUNIT_ASSERT_EQUAL(VCARD, profile->content());
+    CPPUNIT_ASSERT_EQUAL(fileutils::sha3File(path_), profile->sha3());
+
+    // Unchanged file: the cached profile is returned
+    CPPUNIT_ASSERT(vCard::utils::loadProfile(path_) == profile);
+
+    // Rewritten file: reloaded
+    auto updated = VCARD + "\nNOTE:changed";
+    write(updated);
+    std::filesystem::last_write_time(path_, profile->mtime() + std::chrono::seconds(1));
+    auto reloaded = vCard::utils::loadProfile(path_);
+    CPPUNIT_ASSERT(reloaded && reloaded != profile);
+    CPPUNIT_ASSERT_EQUAL(updated, reloaded->content());
+    CPPUNIT_ASSERT_EQUAL(fileutils::sha3File(path_), reloaded->sha3());
+    // the previous instance stays valid for its holders
+    CPPUNIT_ASSERT_EQUAL(VCARD, profile->content());
+}
+
+void
+VCardTest::testLoadProfileMissing()
+{
+    CPPUNIT_ASSERT(!vCard::utils::loadProfile(path_));
+    CPPUNIT_ASSERT(!vCard::utils::loadProfile(dir_));
+}
+
+void
+VCardTest::testInvalidateProfile()
+{
+    write(VCARD);
+    auto profile = vCard::utils::loadProfile(path_);
+    CPPUNIT_ASSERT(profile);
+
+    // Rewritten with the same size and modification time: only the
+    // invalidation tells the cache
+    auto updated = VCARD;
+    updated.replace(updated.find("Alice"), 5, "Alicia");
+    updated.pop_back();
+    CPPUNIT_ASSERT_EQUAL(VCARD.size(), updated.size());
+    write(updated);
+    std::filesystem::last_write_time(path_, profile->mtime());
+    CPPUNIT_ASSERT(vCard::utils::loadProfile(path_) == profile);
+
+    vCard::utils::invalidateProfile(path_);
+    auto reloaded = vCard::utils::loadProfile(path_);
+    CPPUNIT_ASSERT(reloaded && reloaded != profile);
+    CPPUNIT_ASSERT_EQUAL(updated, reloaded->content());
+
+    // Unknown paths are ignored
+    vCard::utils::invalidateProfile(dir_ / "unknown.vcf");
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::VCardTest::name());